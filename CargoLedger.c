@@ -0,0 +1,262 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+#include "CargoLedger.h"
+
+DWORD WINAPI CargoLedgerSampler(LPVOID Param);
+// Reads every crane's counters into the next sample, dropping every other sample if the series is full.
+void sampleCargoLedger(CargoLedger* ledger);
+
+CargoLedger* openCargoLedger(int numberOfCranes, DWORD interval)
+{
+    CargoLedger* ledger = (CargoLedger*)calloc(1, sizeof(CargoLedger));
+
+    if (ledger == NULL)
+    {
+        fprintf(stderr, "CargoLedger::openCargoLedger::Unexpected Error - Memory allocation failed!\n");
+        return NULL;
+    }
+
+    ledger->craneLedgers = (CraneLedger*)_aligned_malloc(numberOfCranes * sizeof(CraneLedger),
+        CARGO_LEDGER_CACHE_LINE);
+    ledger->samples = (CargoLedgerEntry*)calloc((size_t)CARGO_LEDGER_MAX_SAMPLES * numberOfCranes,
+        sizeof(CargoLedgerEntry));
+    ledger->stopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    if (ledger->craneLedgers == NULL || ledger->samples == NULL || ledger->stopEvent == NULL)
+    {
+        fprintf(stderr, "CargoLedger::openCargoLedger::Unexpected Error - "
+            "Memory allocation or event creation failed!\n");
+        closeCargoLedger(ledger);
+        return NULL;
+    }
+
+    memset(ledger->craneLedgers, 0, numberOfCranes * sizeof(CraneLedger));
+    ledger->numberOfCranes = numberOfCranes;
+    ledger->interval = interval;
+    ledger->startTime = GetTickCount64();
+    ledger->samplerHandle = CreateThread(NULL, 0, CargoLedgerSampler, ledger, 0, NULL);
+
+    if (ledger->samplerHandle == NULL)
+    {
+        fprintf(stderr, "CargoLedger::openCargoLedger::Unexpected Error - Sampler thread creation failed!\n");
+        closeCargoLedger(ledger);
+        return NULL;
+    }
+
+    return ledger;
+}
+
+void stopCargoLedger(CargoLedger* ledger)
+{
+    SetEvent(ledger->stopEvent);
+    WaitForSingleObject(ledger->samplerHandle, INFINITE);
+
+    // The last interval ends when the ledger stops, so it may be a short one.
+    sampleCargoLedger(ledger);
+}
+
+void closeCargoLedger(CargoLedger* ledger)
+{
+    if (ledger->samplerHandle != NULL)
+    {
+        CloseHandle(ledger->samplerHandle);
+    }
+
+    if (ledger->stopEvent != NULL)
+    {
+        CloseHandle(ledger->stopEvent);
+    }
+
+    _aligned_free(ledger->craneLedgers);
+    free(ledger->samples);
+    free(ledger);
+}
+
+void beginCraneActivity(CraneLedger* craneLedger, LONG activity)
+{
+    ULONGLONG now = GetTickCount64();
+
+    // Comment: the interlocked increments are full barriers, so a reader never sees the
+    // sequence even while the counters between them are being written.
+    InterlockedIncrement(&craneLedger->sequence);
+    craneLedger->activity = activity;
+    craneLedger->activityStartTime = now;
+    InterlockedIncrement(&craneLedger->sequence);
+}
+
+void recordCraneIdleTime(CraneLedger* craneLedger)
+{
+    ULONGLONG now = GetTickCount64();
+
+    InterlockedIncrement(&craneLedger->sequence);
+    craneLedger->idleTime += now - craneLedger->activityStartTime;
+    craneLedger->activity = CRANE_LEDGER_NONE;
+    InterlockedIncrement(&craneLedger->sequence);
+}
+
+void recordCraneUnloading(CraneLedger* craneLedger, int tons)
+{
+    ULONGLONG now = GetTickCount64();
+
+    InterlockedIncrement(&craneLedger->sequence);
+    craneLedger->numberOfUnloadedVessels++;
+    craneLedger->numberOfUnloadedTons += tons;
+    craneLedger->busyTime += now - craneLedger->activityStartTime;
+    craneLedger->activity = CRANE_LEDGER_NONE;
+    InterlockedIncrement(&craneLedger->sequence);
+}
+
+void recordCraneLostTime(CraneLedger* craneLedger)
+{
+    ULONGLONG now = GetTickCount64();
+
+    InterlockedIncrement(&craneLedger->sequence);
+    craneLedger->busyTime += now - craneLedger->activityStartTime;
+    craneLedger->lostTime += now - craneLedger->activityStartTime;
+    craneLedger->activity = CRANE_LEDGER_NONE;
+    InterlockedIncrement(&craneLedger->sequence);
+}
+
+void readCraneLedger(CraneLedger* craneLedger, CargoLedgerEntry* entry)
+{
+    LONG sequence;
+    LONG activity;
+    ULONGLONG activityStartTime;
+    ULONGLONG now;
+
+    do
+    {
+        while ((sequence = craneLedger->sequence) & 1)
+        {
+            YieldProcessor();
+        }
+
+        MemoryBarrier();
+        now = GetTickCount64();
+        entry->numberOfUnloadedVessels = craneLedger->numberOfUnloadedVessels;
+        entry->numberOfUnloadedTons = craneLedger->numberOfUnloadedTons;
+        entry->busyTime = craneLedger->busyTime;
+        entry->idleTime = craneLedger->idleTime;
+        entry->lostTime = craneLedger->lostTime;
+        activity = craneLedger->activity;
+        activityStartTime = craneLedger->activityStartTime;
+        MemoryBarrier();
+    } while (craneLedger->sequence != sequence);
+
+    // Comment: a vessel being unloaded isn't known to be lost till the crane ends its unloading,
+    // so its lost time is only counted then, while its busy time counts as it goes.
+    if (activity != CRANE_LEDGER_NONE && now > activityStartTime)
+    {
+        *(activity == CRANE_LEDGER_BUSY ? &entry->busyTime : &entry->idleTime) += now - activityStartTime;
+    }
+}
+
+void mergeCargoLedger(CargoLedger* ledger, CargoLedgerEntry* total)
+{
+    CargoLedgerEntry entry;
+
+    memset(total, 0, sizeof(CargoLedgerEntry));
+
+    for (int i = 0; i < ledger->numberOfCranes; i++)
+    {
+        readCraneLedger(&ledger->craneLedgers[i], &entry);
+        total->numberOfUnloadedVessels += entry.numberOfUnloadedVessels;
+        total->numberOfUnloadedTons += entry.numberOfUnloadedTons;
+        total->busyTime += entry.busyTime;
+        total->idleTime += entry.idleTime;
+        total->lostTime += entry.lostTime;
+    }
+}
+
+DWORD WINAPI CargoLedgerSampler(LPVOID Param)
+{
+    CargoLedger* ledger = (CargoLedger*)Param;
+    ULONGLONG nextSampleTime = ledger->interval;
+
+    // Samples are due on the interval from the ledger's start, so a late one doesn't push the rest.
+    for (;;)
+    {
+        ULONGLONG now = GetTickCount64() - ledger->startTime;
+
+        if (WaitForSingleObject(ledger->stopEvent, nextSampleTime > now ? (DWORD)(nextSampleTime - now) : 0) !=
+            WAIT_TIMEOUT)
+        {
+            break;
+        }
+
+        sampleCargoLedger(ledger);
+        nextSampleTime += ledger->interval;
+    }
+
+    return 0;
+}
+
+void sampleCargoLedger(CargoLedger* ledger)
+{
+    // The samples are cumulative, so keeping every other one merges each pair of intervals.
+    if (ledger->numberOfSamples == CARGO_LEDGER_MAX_SAMPLES)
+    {
+        for (int i = 0; i < CARGO_LEDGER_MAX_SAMPLES / 2; i++)
+        {
+            ledger->sampleTimes[i] = ledger->sampleTimes[2 * i + 1];
+            memcpy(&ledger->samples[i * ledger->numberOfCranes], &ledger->samples[(2 * i + 1) * ledger->numberOfCranes],
+                ledger->numberOfCranes * sizeof(CargoLedgerEntry));
+        }
+
+        ledger->numberOfSamples = CARGO_LEDGER_MAX_SAMPLES / 2;
+        ledger->interval *= 2;
+    }
+
+    CargoLedgerEntry* sample = &ledger->samples[ledger->numberOfSamples * ledger->numberOfCranes];
+
+    for (int i = 0; i < ledger->numberOfCranes; i++)
+    {
+        readCraneLedger(&ledger->craneLedgers[i], &sample[i]);
+    }
+
+    ledger->sampleTimes[ledger->numberOfSamples++] = GetTickCount64() - ledger->startTime;
+}
+
+int writeCargoLedgerSeries(CargoLedger* ledger, const char* fileName)
+{
+    FILE* file = fopen(fileName, "w");
+
+    if (file == NULL)
+    {
+        return FALSE;
+    }
+
+    fprintf(file, "start_ms,end_ms,crane,vessels,tons,busy_ms,idle_ms,lost_ms,tons_per_second\n");
+
+    for (int i = 0; i < ledger->numberOfSamples; i++)
+    {
+        ULONGLONG startTime = i == 0 ? 0 : ledger->sampleTimes[i - 1];
+        ULONGLONG duration = ledger->sampleTimes[i] - startTime;
+
+        for (int j = 0; j < ledger->numberOfCranes; j++)
+        {
+            CargoLedgerEntry* entry = &ledger->samples[i * ledger->numberOfCranes + j];
+            CargoLedgerEntry previous = { 0 };
+
+            if (i > 0)
+            {
+                previous = ledger->samples[(i - 1) * ledger->numberOfCranes + j];
+            }
+
+            LONGLONG numberOfTons = entry->numberOfUnloadedTons - previous.numberOfUnloadedTons;
+
+            fprintf(file, "%llu,%llu,%d,%ld,%lld,%lld,%lld,%lld,%.2f\n", startTime, ledger->sampleTimes[i], j + 1,
+                entry->numberOfUnloadedVessels - previous.numberOfUnloadedVessels, numberOfTons,
+                entry->busyTime - previous.busyTime, entry->idleTime - previous.idleTime,
+                entry->lostTime - previous.lostTime,
+                duration == 0 ? 0.0 : numberOfTons * 1000.0 / duration);
+        }
+    }
+
+    return fclose(file) == 0;
+}
@@ -0,0 +1,73 @@
+#ifndef CARGO_LEDGER_H
+#define CARGO_LEDGER_H
+
+#include <windows.h>
+
+#define CARGO_LEDGER_CACHE_LINE 64
+#define CARGO_LEDGER_DEFAULT_INTERVAL 1000 // Miliseconds between the ledger's samples.
+#define CARGO_LEDGER_MAX_SAMPLES 1024 // Once full, every other sample is dropped and the interval doubles.
+
+// What a crane is doing since its activity started.
+#define CRANE_LEDGER_NONE 0
+#define CRANE_LEDGER_IDLE 1 // Waiting for a vessel.
+#define CRANE_LEDGER_BUSY 2 // Unloading a vessel.
+
+// A crane's counters, each crane on a cache line of its own so the cranes never share one.
+// Only the crane writes them, without a lock: it makes the sequence odd while it updates them,
+// so a reader which finds it odd or changed reads them again.
+typedef struct __declspec(align(CARGO_LEDGER_CACHE_LINE)) {
+    volatile LONG sequence;
+    volatile LONG numberOfUnloadedVessels;
+    volatile LONGLONG numberOfUnloadedTons;
+    volatile LONGLONG busyTime; // Miliseconds the crane spent unloading.
+    volatile LONGLONG idleTime; // Miliseconds the crane waited for a vessel.
+    volatile LONGLONG lostTime; // Miliseconds of the busy time spent on vessels which were moved to other stations.
+    volatile LONG activity;
+    volatile ULONGLONG activityStartTime;
+} CraneLedger;
+
+// A consistent read of a crane's counters, or of every crane's merged. The time of the activity
+// in progress is counted up to the read, so the samples split it between their intervals.
+typedef struct {
+    LONG numberOfUnloadedVessels;
+    LONGLONG numberOfUnloadedTons;
+    LONGLONG busyTime;
+    LONGLONG idleTime;
+    LONGLONG lostTime;
+} CargoLedgerEntry;
+
+// Tonnage unloaded by EilatPort's cranes, sampled every interval by the ledger's thread into
+// a time series of every crane's counters as they were at the end of the interval.
+typedef struct {
+    CraneLedger* craneLedgers;
+    int numberOfCranes;
+    DWORD interval;
+    ULONGLONG startTime;
+    CargoLedgerEntry* samples; // numberOfCranes entries for each sample.
+    ULONGLONG sampleTimes[CARGO_LEDGER_MAX_SAMPLES]; // Miliseconds after the ledger was opened.
+    int numberOfSamples;
+    HANDLE stopEvent;
+    HANDLE samplerHandle;
+} CargoLedger;
+
+// Opens a ledger for the cranes and starts sampling it every interval miliseconds. Returns NULL on failure.
+CargoLedger* openCargoLedger(int numberOfCranes, DWORD interval);
+// Stops sampling, with a last sample of the counters as they are now.
+void stopCargoLedger(CargoLedger* ledger);
+void closeCargoLedger(CargoLedger* ledger);
+// Starts the crane's wait for a vessel or its unloading.
+void beginCraneActivity(CraneLedger* craneLedger, LONG activity);
+// Ends the crane's activity: its wait for a vessel, its unloading of a vessel, or its unloading
+// of a vessel which was moved to another station, whose time is busy and lost.
+void recordCraneIdleTime(CraneLedger* craneLedger);
+void recordCraneUnloading(CraneLedger* craneLedger, int tons);
+void recordCraneLostTime(CraneLedger* craneLedger);
+// Reads the crane's counters. Any thread may read them at any time.
+void readCraneLedger(CraneLedger* craneLedger, CargoLedgerEntry* entry);
+// Reads every crane's counters and merges them.
+void mergeCargoLedger(CargoLedger* ledger, CargoLedgerEntry* total);
+// Writes the time series as CSV, a row for each crane in each interval with what it did in it.
+// Returns FALSE if the file couldn't be written.
+int writeCargoLedgerSeries(CargoLedger* ledger, const char* fileName);
+
+#endif
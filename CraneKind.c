@@ -0,0 +1,167 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "CraneKind.h"
+
+#define MAX_CRANE_KIND_OPTION 256 // Longest -cranekinds or -cargo option.
+#define MAX_CRANE_KIND_RATE 1000 // A crane may unload at most ten times the base rate.
+#define MAX_CARGO_MIX_WEIGHT 1000 // Weights are drawn with rand(), so together they stay well under RAND_MAX.
+
+const char* cargoTypeNames[] = { "container", "bulk", "liquid", "roro" };
+
+// Splits the option's copy at its commas. Returns the number of entries, -1 if more than maxEntries.
+int splitCraneKindOption(char buffer[], char* entries[], int maxEntries);
+
+int getCargoType(const char* name)
+{
+    for (int i = 0; i < CARGO_TYPES; i++)
+    {
+        if (strcmp(name, cargoTypeNames[i]) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+const char* getCargoTypeName(int cargoType)
+{
+    return cargoTypeNames[cargoType];
+}
+
+void formatCargoTypes(char string[], DWORD cargoTypes)
+{
+    size_t length = 0;
+
+    string[0] = '\0';
+
+    if (cargoTypes == CARGO_ANY)
+    {
+        strcpy(string, "any");
+        return;
+    }
+
+    for (int i = 0; i < CARGO_TYPES; i++)
+    {
+        if (cargoTypes & 1 << i)
+        {
+            length += sprintf(string + length, "%s%s", length == 0 ? "" : "+", cargoTypeNames[i]);
+        }
+    }
+}
+
+int splitCraneKindOption(char buffer[], char* entries[], int maxEntries)
+{
+    int numberOfEntries = 0;
+
+    for (char* entry = strtok(buffer, ","); entry != NULL; entry = strtok(NULL, ","))
+    {
+        if (numberOfEntries == maxEntries)
+        {
+            return -1;
+        }
+
+        entries[numberOfEntries++] = entry;
+    }
+
+    return numberOfEntries;
+}
+
+int parseCraneKinds(CraneKind kinds[], const char* value)
+{
+    char buffer[MAX_CRANE_KIND_OPTION];
+    char* entries[MAX_CRANE_KINDS];
+
+    if (strlen(value) >= MAX_CRANE_KIND_OPTION)
+    {
+        return 0;
+    }
+
+    strcpy(buffer, value);
+
+    int numberOfKinds = splitCraneKindOption(buffer, entries, MAX_CRANE_KINDS);
+
+    // The entries are split off first, since their cargo types are split with strtok as well.
+    for (int i = 0; i < numberOfKinds; i++)
+    {
+        char* rate = strchr(entries[i], ':');
+
+        if (rate == NULL)
+        {
+            return 0;
+        }
+
+        *rate++ = '\0';
+        kinds[i].capabilities = 0;
+        kinds[i].rate = atoi(rate);
+        kinds[i].numberOfCranes = 0;
+
+        for (char* name = strtok(entries[i], "+"); name != NULL; name = strtok(NULL, "+"))
+        {
+            int cargoType = getCargoType(name);
+
+            if (cargoType == -1 && strcmp(name, "any") != 0)
+            {
+                return 0;
+            }
+
+            kinds[i].capabilities |= cargoType == -1 ? CARGO_ANY : 1 << cargoType;
+        }
+
+        if (kinds[i].capabilities == 0 || kinds[i].rate < 1 || kinds[i].rate > MAX_CRANE_KIND_RATE)
+        {
+            return 0;
+        }
+    }
+
+    return numberOfKinds > 0 ? numberOfKinds : 0;
+}
+
+int parseCargoMix(int weights[], const char* value)
+{
+    char buffer[MAX_CRANE_KIND_OPTION];
+    char* entries[CARGO_TYPES];
+    int totalWeight = 0;
+
+    if (strlen(value) >= MAX_CRANE_KIND_OPTION)
+    {
+        return FALSE;
+    }
+
+    strcpy(buffer, value);
+
+    int numberOfEntries = splitCraneKindOption(buffer, entries, CARGO_TYPES);
+
+    for (int i = 0; i < CARGO_TYPES; i++)
+    {
+        weights[i] = 0;
+    }
+
+    for (int i = 0; i < numberOfEntries; i++)
+    {
+        char* weight = strchr(entries[i], ':');
+
+        if (weight == NULL)
+        {
+            return FALSE;
+        }
+
+        *weight++ = '\0';
+
+        int cargoType = getCargoType(entries[i]);
+
+        if (cargoType == -1 || atoi(weight) < 0 || atoi(weight) > MAX_CARGO_MIX_WEIGHT)
+        {
+            return FALSE;
+        }
+
+        weights[cargoType] = atoi(weight);
+        totalWeight += weights[cargoType];
+    }
+
+    return totalWeight > 0;
+}
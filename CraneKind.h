@@ -0,0 +1,41 @@
+#ifndef CRANE_KIND_H
+#define CRANE_KIND_H
+
+#include <windows.h>
+
+// Cargo a vessel carries. A crane's capabilities are a mask of the types it unloads,
+// bit 1 << type for each of them.
+#define CARGO_CONTAINER 0
+#define CARGO_BULK 1
+#define CARGO_LIQUID 2
+#define CARGO_RORO 3
+#define CARGO_TYPES 4
+#define CARGO_ANY ((1 << CARGO_TYPES) - 1)
+
+#define MAX_CRANE_KINDS 8
+#define CRANE_KIND_BASE_RATE 100 // A crane of this rate unloads in the service time, one of 200 in half of it.
+
+// A kind of crane, as set by the -cranekinds option. Cranes take the kinds in turn.
+typedef struct {
+    DWORD capabilities;
+    int rate; // Percent of the base rate.
+    int numberOfCranes;
+    // Statistics for the report.
+    volatile LONGLONG busyTime; // Total miliseconds the kind's cranes spent unloading.
+    volatile LONG numberOfUnloadedVessels;
+    volatile LONGLONG numberOfUnloadedTons;
+} CraneKind;
+
+// Returns the cargo type of the name, -1 if there is none.
+int getCargoType(const char* name);
+const char* getCargoTypeName(int cargoType);
+// Writes the names of the mask's cargo types joined by '+', or "any" for every type.
+void formatCargoTypes(char string[], DWORD cargoTypes);
+// Parses "<type>[+<type>...]:<rate>[,...]" of a -cranekinds option, where a type may also
+// be "any". Returns the number of kinds, 0 if invalid.
+int parseCraneKinds(CraneKind kinds[], const char* value);
+// Parses "<type>:<weight>[,...]" of a -cargo option into each cargo type's weight, types
+// which aren't given weigh 0. Returns FALSE if invalid or if nothing weighs anything.
+int parseCargoMix(int weights[], const char* value);
+
+#endif
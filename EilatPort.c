@@ -2,8 +2,31 @@
 
 #include <stdio.h> 
 #include <stdlib.h> 
+#include <string.h>
 #include <windows.h> 
 #include <time.h>
+#ifdef EILAT_PORT_DLL
+#include <setjmp.h>
+#endif
+
+#include "LatencyHistogram.h"
+#include "VesselJournal.h"
+#include "SuezCanal.h"
+#include "MessageChannel.h"
+#include "EilatPortThread.h"
+#include "RunNamespace.h"
+#include "ServiceTime.h"
+#include "VesselQueue.h"
+#include "PortArena.h"
+#include "ParkingLot.h"
+#include "LockProfiler.h"
+#include "ThreadPlacement.h"
+#include "StorageYard.h"
+#include "CraneKind.h"
+#include "FaultInjector.h"
+#include "CargoLedger.h"
+#include "EilatPortServer.h"
+#include "SafeCalls.h"
 
 #define MIN_SLEEP_TIME 5 // 5 miliseconds.
 #define MAX_SLEEP_TIME 3000 // 3 seconds.
@@ -11,536 +34,1429 @@
 #define MIN_WEIGHT 5 // min weight for cargo.
 #define MAX_WEIGHT 50 // max weight for cargo.
 
-#define BUFFER_SIZE 60 // Size of largest message to send/receive through pipes.
+#define MAX_NUMBER_OF_CRANES 25 // Max number of crane threads.
+#define MIN_NUMBER_OF_ACTIVE_CRANES 1 // The crane pool controller never parks below this.
+#define MAX_NUMBER_OF_QUAYS 4 // Most unloading quays, each with its own share of the cranes.
+#define QUAY_IDLE_INTERVAL 100 // A quay waiting for vessels checks every 100 miliseconds if any are left for it.
+
+#define ROUTE_SHORTEST_QUEUE 0 // An arriving vessel joins the quay with the fewest vessels per active crane.
+#define ROUTE_TWO_CHOICES 1 // An arriving vessel joins the shorter of two quays drawn at random.
+#define MAX_WATCHED_PORT_THREADS 4 // EilatPort's threads the stall detector watches besides the vessels and cranes.
+
+#define CRANE_CONTROLLER_INTERVAL 1000 // The crane pool controller samples once a second.
+#define TARGET_BARRIER_WAIT 3000 // Barrier wait in miliseconds the controller tries to stay under.
+#define CRANE_CONTROLLER_HYSTERESIS 3 // Samples in a row which must agree before a crane is activated/parked.
+#define LOW_CRANE_UTILIZATION 0.5 // Below this share of busy time the active cranes are considered idle.
+
+
+#define DEFAULT_BATCH_FLUSH_TIMEOUT 3000 // A partial batch is admitted after 3 seconds, 0 never flushes.
+
+#define NUMBER_OF_PRIORITY_CLASSES 3 // 0 - express, 1 - standard, 2 - bulk.
+#define AGING_INTERVAL 3000 // Every 3 seconds in the barrier promote a vessel by one priority class.
+
+
+#define BUFFER_SIZE MESSAGE_SIZE // Size of largest message to send/receive through pipes.
 #define MAX_STRING 200 // Size of the larget string to send to the safe printf.
 
-// Node of Queue
-typedef struct Node_t {
+// A vessel as it arrives from HaifaPort. Owned by the vessel's thread.
+typedef struct {
 	int vesselId;
-	struct Node_t* prev;
-} VesselNode;
-
-// Queue for the Barrier, so nodes will leave FIFO.
+	int cargoWeight; // Tons from HaifaPort's manifest, -1 when it should be drawn at random.
+	int priority;
+	ULONGLONG arrivalTime; // GetTickCount64() when the vessel arrived at EilatPort.
+	int journalState; // The vessel's last journaled state before a restart, VESSEL_JOURNAL_NONE if new.
+	int berthIndex; // The berth the vessel holds by its transit credit, while it is in EilatPort.
+	int quayIndex; // The unloading quay the vessel was routed to once it entered a barrier.
+	int cargoType; // Drawn by the -cargo mix as the vessel arrived.
+	int haifaPortSlot; // HaifaPort's slot of the vessel, returned to it along with the vessel.
+} VesselRecord;
+
+// Multi-level queue for the Barrier, a queue for each priority class and cargo type. The class
+// which leaves first is the one whose oldest vessel has the best priority after aging, among the
+// cargo types a free station unloads.
+// Only one vessel at a time enters or leaves the barrier, and its semaphore counts the vessels
+// which reached it for its quay's coordinator.
 typedef struct {
-	VesselNode* head;
-	VesselNode* tail;
+	VesselQueue* classQueue[NUMBER_OF_PRIORITY_CLASSES][CARGO_TYPES];
 	int size;
 	int limit;
-} VesselQueue;
+	HANDLE mutex;
+	HANDLE semaphore;
+	LockProfile* mutexProfile;
+} PriorityBarrier;
 
 // 1 to 1 relation between crane and vessel.
 typedef struct {
 	int craneId;
 	int vesselId;
+	int berthIndex;
 	int cargoWeight;
 	int isOccupied;
+	DWORD capabilities; // Cargo types the station's crane unloads, by its kind.
+	int rate;
+	int cargoType;
+	// With faults injected, set from the vessel's signal to its crane till the crane is done.
+	int isUnloading;
+	volatile ULONGLONG heartbeatTime; // When the crane last checked in while unloading.
+	volatile DWORD sliceTime; // Miliseconds the crane's slice since its last check-in takes, as slowed.
+	volatile LONG assignment; // Bumped whenever the station's vessel is moved away, so its crane abandons it.
 } UnloadingQuayStation;
 
+// Settings and state of the unloading quay's batch admission. A batch is admitted once it
+// reaches tunedBatchSize vessels, or when flushTimeout has passed since its first vessel
+// was available. tunedBatchSize is adjusted after each batch between 1 and maxBatchSize.
+typedef struct {
+	int maxBatchSize;
+	int flushTimeout;
+	int tunedBatchSize;
+	int numberOfBatches;
+	int numberOfFlushedBatches;
+	int numberOfAdmittedVessels;
+} BatchAdmissionStruct;
+
 // Holds all unloading quay stations and the amount of them.
+// Only the first unloadingQuaySize stations (and their cranes) are active, the rest are parked.
+// Each quay has its own barrier, coordinator thread and batch admission, and its stations hold
+// the cranes from firstCraneIndex on. Vessels are matched to stations by the masks of the
+// stations which unload each cargo type.
 typedef struct {
 	UnloadingQuayStation* unloadingQuayStation;
 	int unloadingQuaySize;
+	int maxUnloadingQuaySize;
+	int minUnloadingQuaySize; // The fewest stations which unload every cargo type routed to the quay.
+	DWORD cargoStations[CARGO_TYPES];
+	DWORD cargoTypes; // Cargo types any of the quay's cranes unload, only these are routed to it.
+	int numberOfDeferredVessels; // Vessels admitted while no free station unloaded their cargo.
+	int quayIndex;
+	int firstCraneIndex;
+	PriorityBarrier* barrier;
+	HANDLE stationMutex; // Allows only one vessel at a time to find its station.
+	LockProfile* stationMutexProfile;
+	BatchAdmissionStruct batchAdmission;
+	volatile LONG numberOfVesselsToUnload; // Vessels routed to the quay which it hasn't admitted yet.
+	volatile LONG numberOfVesselsInQuay; // Vessels routed to the quay which haven't left it yet.
+	volatile LONG numberOfRoutedVessels;
 } UnloadingQuayStruct;
 
-// Functions which support handling a Queue.
-VesselQueue* constructQueue(int limit);
-void destructQueue(VesselQueue* UnloadingQuay);
-int enqueue(VesselQueue* UnloadingQuay, int vesselId);
-int dequeue(VesselQueue* UnloadingQuay);
-int isEmpty(VesselQueue* UnloadingQuay);
+// State of the controller which activates and parks cranes, according to the barrier's depth
+// and wait and to the cranes' utilization. The unloading quay applies the requested number
+// of cranes between batches, when none of its stations are occupied.
+typedef struct {
+	int minNumberOfCranes;
+	int maxNumberOfCranes;
+	volatile LONG requestedNumberOfCranes;
+	volatile LONGLONG busyTime; // Total miliseconds the cranes spent unloading.
+	volatile LONGLONG barrierWaitTime; // Total miliseconds vessels waited in the barrier.
+	volatile LONG numberOfBarrierWaits;
+	int numberOfActivations;
+	int numberOfParkings;
+} CranePoolControllerStruct;
+
+// Transit credits granted to HaifaPort. Each credit is a berth a vessel holds from its arrival
+// till it departs, so no more vessels than berths are in EilatPort at once, whatever the fleet's
+// size. A departing vessel frees its berth and returns the credit along with it.
+typedef struct {
+	int numberOfBerths;
+	int* freeBerths; // Stack of the berths no vessel holds.
+	int numberOfFreeBerths;
+	int maxNumberOfVesselsInPort;
+	int numberOfGrantedCredits;
+	HANDLE berthsMutex;
+} TransitCreditStruct;
+
+// Vessels which HaifaPort resends after EilatPort was restarted with -recover, since they
+// left HaifaPort but haven't returned to it, and how many vessels have already returned.
+typedef struct {
+	VesselRecord* vesselsInFlight; // Till each one takes a berth.
+	int numberOfVesselsInFlight;
+	int numberOfReturnedVessels;
+	int numberOfReservedCredits; // Credits HaifaPort's vessels took before the restart and still hold.
+	int numberOfVesselsToUnload; // Vessels in flight which the journal hasn't got as unloaded.
+} RecoveryStruct;
+
+// Functions which support handling the Barrier.
+PriorityBarrier* constructPriorityBarrier(int limit, int quayIndex);
+int enqueueToBarrier(PriorityBarrier* priorityBarrier, int berthIndex, int priorityClass, int cargoType);
+// Dequeues the berth of the vessel of the class with the best aged priority among the given cargo
+// types, and sets its cargo type. Returns -1 if no vessel of these types is in the barrier.
+int dequeueFromBarrier(PriorityBarrier* priorityBarrier, DWORD cargoTypes, int* cargoType);
+// Returns how many miliseconds the oldest vessel in the barrier has waited.
+ULONGLONG getOldestBarrierWait(PriorityBarrier* priorityBarrier);
+// Clamps a manifest's priority into one of the priority classes.
+int getPriorityClass(int priority);
 // Functions which support handling UnloadingQuay.
-UnloadingQuayStruct* constructUnloadingQuay(int cranesId[], int numberOfCranes);
-void destructUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay);
+UnloadingQuayStruct* constructUnloadingQuay(int quayIndex, int cranesId[], int numberOfCranes, int barrierLimit);
 int isUnloadingQuayEmpty(UnloadingQuayStruct* pUnloadingQuay);
 void removeVesselsFromUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay);
+// Activates or parks stations till the number of active ones is numberOfStations.
+void resizeUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay, int numberOfStations);
+// Returns the quay's share of the given number of active cranes, at least one of them.
+int getUnloadingQuayNumberOfCranes(UnloadingQuayStruct* pUnloadingQuay, int numberOfCranes);
+// Matches up to batchSize vessels in the barrier to free stations which unload their cargo.
+// Returns the mask of the stations it matched.
+DWORD matchVesselsToStations(UnloadingQuayStruct* pUnloadingQuay, int batchSize);
+// Returns TRUE if the station unloads fewer other cargo types than the other station, or as
+// many at a higher rate, so versatile cranes stay free for the cargo only they unload.
+int isBetterStationMatch(UnloadingQuayStation* station, UnloadingQuayStation* otherStation);
+// Returns the quay whose stations hold the crane.
+UnloadingQuayStruct* getCraneUnloadingQuay(int craneIndex);
+// Routes an arriving vessel to a quay whose cranes unload its cargo, by the policy set with -route.
+UnloadingQuayStruct* routeVesselToUnloadingQuay(int cargoType);
+// Returns TRUE if the quay has fewer vessels per active crane than the other quay.
+int isShorterUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay, UnloadingQuayStruct* pOtherUnloadingQuay);
+// Returns TRUE once every vessel has been routed and the quay has admitted all of its own.
+int isUnloadingQuayDone(UnloadingQuayStruct* pUnloadingQuay);
+// Returns the number of vessels which are still to be admitted to any quay.
+int getNumberOfVesselsToUnload(void);
 
 // Random Functions:
-// Thread safe rand().
-int safeRand(void);
-// Calculates sleep time according to the defined MIN_SLEEP_TIME and MAX_SLEEP_TIME.
-int randomSleepTime(void);
 // Calculates cargo weight according to the defined MIN_WEIGHT and MAX_WEIGHT.
 int randomCargoWeight(void);
+// Draws a cargo type by the -cargo mix, containers without one.
+int randomCargoType(void);
+
+// Parse the options EilatPort was started with by HaifaPort.
+void parseEilatPortOptions(int argc, char* argv[]);
+// As a session of EilatPortServer, wait for a HaifaPort on the server's pipe, set the channels
+// to it and parse the options it gives.
+void acceptEilatPortSession(const char* serverName);
+// Sets the options back to their defaults and clears what the last run left, before a session
+// accepts its next HaifaPort.
+void resetEilatPortSession(void);
+// Runs EilatPort once its options are parsed and its channels to HaifaPort are set.
+int runEilatPort(void);
+// Ends EilatPort after an error. EilatPort.exe exits with the status, while in HaifaPort's process
+// only EilatPort's threads end: its own thread returns the status from EilatPortThread, and any
+// other thread fails the channels, so HaifaPort and EilatPort's thread find it failed, and ends.
+__declspec(noreturn) void stopEilatPort(int status);
+
+// Create the run's arena, sized for the berths, cranes and quays the fleet allows, which holds
+// the vessel and crane state of the run, and take the records of the berths' vessels from it.
+// A session reuses the arena of its last run when the run fits in it.
+void createRunArena(int numberOfVessels);
+// Print how much of each region of the run's arena was used of what it reserved.
+void printRunArenaReport(void);
+// Print the profiled primitives ranked by their total wait, if built with PORT_LOCK_PROFILER.
+void printLockProfileReport(void);
 
 // Initialize and destruct all global Mutexes/Semaphores.
-void initializeGlobalMutexAndSemaphores(int numberOfVessels, int numberOfCranes);
-void cleanGlobalMutexAndSemaphores(int numberOfVessels, int numberOfCranes);
+void initializeGlobalMutexAndSemaphores(int numberOfVessels, int numberOfBerths, int numberOfCranes);
+void cleanGlobalMutexAndSemaphores(void);
 
 // Main thread functions:
 // Read number of vessels from HaifaPort.
 int getNumberOfVesselsFromHaifaPort(void);
-// Processes whether the number of vessels is a prime number and according to that
-// returns to HaifaPort its passage result.
-void writeToHaifaPortPassageResult(int numberOfVessels);
-// Returns TRUE or FALSE whether the number is a prime number or not.
-int isPrimeNumber(int number);
-// Returns a divisor which will operate as the number of cranes.
-int getRandomDivisor(int dividendNumber);
-// Create all crane threads according to the number given by the random divisor.
+// Processes whether the fleet has a crane to unload it and according to that
+// returns to HaifaPort its passage result, which it returns as well.
+int writeToHaifaPortPassageResult(int numberOfVessels);
+// Returns the largest number of cranes a fleet of the given size may run.
+int getMaxNumberOfCranes(int numberOfVessels);
+// Returns a random number of cranes which start active, between 1 and the largest number the fleet may run.
+int getRandomNumberOfCranes(int numberOfVessels);
+// Returns how many berths, and so transit credits, EilatPort has. By default a berth for every
+// station of the quays and for every vessel of a full batch waiting in each quay's barrier.
+int getNumberOfBerths(int numberOfVessels, int maxNumberOfCranes, int numberOfHeldBerths);
+// Functions which support the transit credits.
+void initializeTransitCredits(int numberOfBerths);
+void destructTransitCredits(void);
+int takeBerth(void);
+void freeBerth(int berthIndex);
+// Write to HaifaPort the number of credits it may use for vessels to enter the canal.
+void grantTransitCredits(int numberOfCredits);
+// Print the number of berths and how many of them were held at most.
+void printTransitCreditReport(void);
+// Print the placement policy and the hand-offs' count, p50, p99 and jitter.
+void printPlacementReport(void);
+// Open the storage yard set with -yard, if any, and place its workers.
+void openStorageYardAndPlaceWorkers(void);
+// Print the tons the yard took and its workers hauled, its fill and how long cranes were blocked.
+void printStorageYardReport(void);
+// Set the cargo mix by the kinds of the port's cranes, and check that a crane unloads every cargo of it.
+void initializeCargoMix(int numberOfCranes);
+// Print each crane kind's vessels, tons and utilization over the cranes' run time, and each cargo
+// type's wait in the barriers.
+void printCraneKindReport(ULONGLONG runTime);
+// Create all crane threads, as many as the largest number the fleet may run.
 HANDLE* createCraneThreads(int numberOfCranes, int** cranesId);
-// Create unloading quay thread and set its priority to be the highest.
-void createUnloadingQuayThread(HANDLE* unloadingQuayHandler);
-// "Listen" for vessels from HaifaPort and create their threads.
-HANDLE* readAndCreateIncomingVesselsFromHaifaPort(int numberOfVessels, int** vesselsId);
+// Create every unloading quay's thread and set its priority to be the highest.
+void createUnloadingQuayThreads(HANDLE unloadingQuayHandlers[], int numberOfVessels);
+// Create the crane pool controller thread.
+void createCranePoolControllerThread(HANDLE* cranePoolControllerHandler, int numberOfCranes,
+	int maxNumberOfCranes);
+// Start the fault injector's clock and create the fault supervisor thread, if any faults are injected.
+void createFaultSupervisorThread(HANDLE* faultSupervisorHandler, int numberOfCranes);
+// Print each crane's vessels, tons, busy and idle time and tons per second from the cargo ledger,
+// and write its time series to the file set with -ledger.
+void printCargoLedgerReport(ULONGLONG runTime);
+// Print the faults applied, how long the cranes were down, how many vessels were moved, and the
+// throughput and p99 turnaround they resulted in.
+void printFaultReport(ULONGLONG runTime);
+// Print how the crane pool was resized and the barrier wait it resulted in.
+void printCranePoolReport(void);
+// Print how many vessels were routed to each quay, how many batches it admitted, how many of
+// them flushed and their average size.
+void printBatchAdmissionReport(void);
+// Open the journal given by -journal, and when recovering resume the vessels in flight from it.
+void openJournalAndRecoverVessels(RecoveryStruct* recovery, int numberOfVessels);
+// Read the vessels in flight which HaifaPort resends after a restart.
+void readVesselsInFlightFromHaifaPort(RecoveryStruct* recovery, int vesselStates[], int numberOfVessels);
+// Create the threads of the vessels in flight, each resumes from its journaled state.
+void createRecoveredVesselThreads(RecoveryStruct* recovery);
+// Append a vessel's state to the journal, if durable wait till it is on disk.
+void writeVesselStateToJournal(int vesselId, int state, int isDurable);
+// Print the number of records and commits, and the journal's overhead per vessel.
+void printJournalReport(int numberOfVessels);
+// Commit the remaining records and close the journal.
+void closeJournal(void);
+// "Listen" for vessels from HaifaPort and create their threads. Returns the number of vessels
+// which arrived, once a voyage each in round trips.
+int readAndCreateIncomingVesselsFromHaifaPort(int numberOfVessels);
+// Wait for every vessel thread to signal vesselsDoneSemaphore.
+void waitForVesselThreads(int numberOfVessels);
 // Check if all the vessels are done running in HaifaPort.
 int areAllVesselsDoneatHaifaPort(void);
 // Signal cranes semaphores to continue so they can reach the break point set by areAllVesselsDone.
 void signalCranesToFinish(int numberOfCranes);
-// Free vessels HANDLER and CloseHandle.
-void freeVesselThreads(HANDLE* vesselsHandler, int* vesselsId, int numberOfVessels);
-// Free cranes HANDLER and CloseHandle.
-void freeCraneThreads(HANDLE* cranesHandler, int* cranesId, int numberOfCranes);
-// CloseHandle for unloading quay and destruct both unloading quay and barrier.
-void cleanUnloadingQuayAndBarrier(HANDLE* unloadingQuayHandler);
+// CloseHandle for every crane thread, their memory is released with the run's arena.
+void freeCraneThreads(HANDLE* cranesHandler, int numberOfCranes);
+// CloseHandle for every unloading quay and its barrier, their memory is released with the run's arena.
+void cleanUnloadingQuaysAndBarriers(HANDLE unloadingQuayHandlers[]);
+// Print count, p50, p99 and max turnaround in EilatPort for each priority class.
+void printTurnaroundReport(void);
 // Write to HaifaPort that EilatPort has cleaned all of its threads and it is exiting.
 void writeToHaifaPortThatEilatPortIsDone(void);
 
-// printf may be a thread safe function, though it isn't process safe and for that reason
-// the function is protected by a semaphore that is shared between both HaifaPort and EilatPort.
-int safePrintWithTimeStamp(char string[]);
-
 // The thread functions for vessels, cranes and the unloading quay.
 DWORD WINAPI Vessel(LPVOID Param);
 DWORD WINAPI Crane(LPVOID Param);
 DWORD WINAPI UnloadingQuay(LPVOID Param);
+DWORD WINAPI CranePoolController(LPVOID Param);
+DWORD WINAPI FaultSupervisor(LPVOID Param);
+
+// These functions are pieces of the unloading quay thread:
+// Waits till a batch of vessels is in the quay's barrier, or flushes a partial one. Returns its size.
+int waitForBatchInBarrier(UnloadingQuayStruct* pUnloadingQuay, int batchSize);
+// Adjusts the batch size according to how the last batch filled up.
+void tuneBatchSize(BatchAdmissionStruct* admission, int batchSize, int numberOfAdmittedVessels, int isFlushed,
+	ULONGLONG fillTime);
+
+// These functions are pieces of the crane and fault supervisor threads:
+// Unloads the station's vessel a slice at a time, held while the crane is failed. Returns FALSE
+// if the vessel was moved to another station meanwhile.
+int unloadWithFaults(UnloadingQuayStruct* pUnloadingQuay, UnloadingQuayStation* station, CraneFault* craneFault,
+	LONG assignment, DWORD unloadingTime);
+// Stalls the cranes which stopped checking in, and moves the vessels of cranes which are down
+// to free stations of the quay which unload their cargo.
+void moveStrandedVessels(UnloadingQuayStruct* pUnloadingQuay);
 
 // These functions are pieces of the vessel thread:
-int startSailingAndEnterBarrier(int vesselId, int vesselIndex);
-int enterUnloadingQuayAndStartUnloadingProcess(int vesselId, int vesselIndex);
-int stationVesselInUnloadingQuay(int vesselId);
-int startUnloadingVessel(int vesselId, int vesselIndex, int stationIndex);
-int exitUnloadingQuay(int vesselId, int stationIndex);
-int sailToHaiafaPort(int vesselId);
-
-
-// Queue which holds vessels that have reached the synchronization point.
-VesselQueue* barrier; 
-
-// Holds all relations between cranes and vessels.
-UnloadingQuayStruct* unloadingQuay; 
+int arriveAtEilatPort(VesselRecord* vesselRecord);
+int enterBarrier(VesselRecord* vesselRecord);
+int enterUnloadingQuayAndStartUnloadingProcess(VesselRecord* vesselRecord);
+int stationVesselInUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay, int vesselId, int berthIndex);
+int startUnloadingVessel(VesselRecord* vesselRecord, int stationIndex);
+int exitUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay, int vesselId, int stationIndex);
+int sailToHaiafaPort(VesselRecord* vesselRecord);
+
+
+// Holds the vessel and crane state of the run, which is released at once when the run ends,
+// or reset for a session's next run.
+// Wait words, stations and the barrier's queues are in its hot region, the rest in its cold one.
+PortArena* runArena;
+int runArenaNumberOfBerths, runArenaNumberOfCranes; // What the run's arena was sized for.
+// Record of the vessel at each berth, by berth index. A vessel takes its berth's record as it
+// arrives and leaves it to the next one once it leaves the berth.
+VesselRecord* vesselRecords;
+
+// Turnaround in EilatPort, from arrival till departure to HaifaPort, of each priority class.
+LatencyHistogram turnaroundHistogram[NUMBER_OF_PRIORITY_CLASSES];
+// Turnaround of every vessel, whatever its class, for the fault report.
+LatencyHistogram fleetTurnaroundHistogram;
+// Time vessels waited in the barrier till the unloading quay admitted them.
+LatencyHistogram barrierWaitHistogram;
+// Time in microseconds from signaling a vessel's or crane's wait word till the thread runs,
+// under the placement policy set with -placement.
+LatencyHistogram handOffHistogram;
+int threadPlacementPolicy = PLACEMENT_NONE;
+
+// Activates and parks cranes at runtime.
+CranePoolControllerStruct cranePoolController;
+// Number of vessels which are still to enter a barrier and be routed to a quay.
+volatile LONG numberOfVesselsToRoute;
+
+// Cargo the cranes unloaded, waiting to be hauled away. Its capacity in tons is set by the -yard
+// option, 0 leaves the cargo on the cranes, and its workers by the -trucks and -rail options.
+StorageYard* storageYard = NULL;
+int storageYardCapacity = 0;
+StorageYardWorkers storageYardWorkers[STORAGE_YARD_WORKER_KINDS] = {
+	{ STORAGE_YARD_DEFAULT_TRUCKS, STORAGE_YARD_DEFAULT_TRUCK_RATE },
+	{ STORAGE_YARD_DEFAULT_TRAINS, STORAGE_YARD_DEFAULT_TRAIN_RATE } };
+
+// Kinds of the cranes set with -cranekinds, which the cranes take in turn. Without it every crane
+// is of a single kind, which unloads every cargo at the base rate.
+CraneKind craneKinds[MAX_CRANE_KINDS] = { { CARGO_ANY, CRANE_KIND_BASE_RATE } };
+int numberOfCraneKinds = 1;
+// Weight of each cargo type among the arriving vessels, set with -cargo. Without -cargo or
+// -cranekinds every vessel carries containers.
+int cargoMix[CARGO_TYPES];
+int isCargoMixed = FALSE;
+// Vessels of each cargo type which left a barrier, and how long they waited in it.
+volatile LONG numberOfCargoVessels[CARGO_TYPES];
+volatile LONGLONG cargoBarrierWaitTime[CARGO_TYPES];
+
+// Berths of the vessels in EilatPort, the number of them may be set by the -credits option.
+TransitCreditStruct transitCredits;
+int requestedNumberOfCredits = 0; // 0 takes the quays' stations and a batch in each barrier.
+int requestedNumberOfCranes = 0; // Cranes which start active, 0 takes a random number of them.
+unsigned int randomSeed; // Seeds rand() and the service times, set with -seed or by the time.
+
+// Batch admission of every unloading quay, the max batch size and flush timeout may be set
+// by the -maxbatch and -flush options.
+BatchAdmissionStruct batchAdmission = { MAX_NUMBER_OF_CRANES, DEFAULT_BATCH_FLUSH_TIMEOUT };
+
+// Hold all relations between cranes and vessels. The number of quays may be set by the -quays
+// option, and how arriving vessels are routed between them by the -route option.
+UnloadingQuayStruct* unloadingQuays[MAX_NUMBER_OF_QUAYS];
+int numberOfUnloadingQuays = 1;
+int routingPolicy = ROUTE_SHORTEST_QUEUE;
+const char* routingPolicyNames[] = { "jsq", "p2c" };
+
+// Write-ahead journal of the vessels' states, NULL when EilatPort runs without -journal.
+VesselJournal* journal = NULL;
+const char* journalFileName = NULL;
+// Set by -recover when HaifaPort restarts EilatPort after it stopped mid-run.
+int isRecovering = FALSE;
+// Set by -roundtrip when HaifaPort's vessels sail again, so they arrive till HaifaPort ends the voyages.
+int isRoundTrip = FALSE;
+// Waits longer than this many miliseconds are reported by the stall detector, set with -stall.
+DWORD stallDetectorThreshold = 0; // 0 runs without it.
+// Faults injected into the cranes and the canal's lanes by -faults and -faultrate, and the crane
+// watchdog set with -cranetimeout. With any of them the cranes unload a slice at a time, and the
+// fault supervisor moves the vessels of cranes which are down to other stations.
+FaultInjector faultInjector;
+CraneFault* craneFaults = NULL;
+int isFaultInjected = FALSE;
+DWORD craneTimeout = 0; // Miliseconds an unloading crane may go without checking in, 0 runs without the watchdog.
+// Tons, vessels, busy and idle time of every crane, kept by -ledger and sampled every -ledgerinterval.
+CargoLedger* cargoLedger = NULL;
+const char* cargoLedgerFileName = NULL;
+DWORD cargoLedgerInterval = CARGO_LEDGER_DEFAULT_INTERVAL;
 
 // Struct for Date and Time. Fill in the struct with GetLocalTime().
 SYSTEMTIME currentTime; 
 
-// With this duo we are able to allow only 1 vessel at a time to be in the canal
-HANDLE redToMedCanalSemaphore; // Mutex to allow only one vessel at a time to enter the canal (pipe).
-HANDLE medToRedCanalSemaphore; // Mutex to allow only one vessel at a time to exit the canal (pipe).
+// The canal's single lane, whose controller in HaifaPort lets vessels enter it in convoys.
+SuezCanal* suezCanal;
+
+// Names every shared object of the run, given by HaifaPort with -run.
+const char* runId = NULL;
 
 // Semaphore/Mutex which allow us to control our threads.
-HANDLE* vesselsSemaphores; // Semaphore for each Vessel to signal them when to wait and continue.
-HANDLE* cranesSemaphores; // Semaphore for each Crane to signal them when to wait and continue.
-HANDLE barrierSemaphore; // Semaphore which provides a synchronization point for the vessel threads.
-HANDLE stationMutex; // Mutex to allow only one vessel at a time to enter unloading quay. 
-HANDLE* unloadingQuaySemaphore; // Semaphore the size of unloading quay, which waits upon all vessels to leave. 
-
-// Mutex to make rand() thread safe.
-HANDLE randomMutex; 
-
-// The reasoning behind the semaphore is to prevent race conditions.
-// printf is a thread safe function, although it isn't process safe. 
-// To solve this problem both HaifaPort and EilatPort need to wait untill it's their turn to print.
-HANDLE processSafePrintSemaphore;
-
-// Variables which support our pipes.
-HANDLE readFromHaifaHandle; // Output for Med. Sea ==> Red Sea Pipe.
-HANDLE writeToHaifaHandle; // Input for Med. Sea <== Red Sea Pipe.
-DWORD numberOfReadBytes, numberOfWrittenBytes;
+WaitWord* vesselsWaitWords; // Wait word for each berth to signal its vessel when to wait and continue.
+WaitWord* cranesWaitWords; // Wait word for each Crane to signal them when to wait and continue.
+WaitWord* unloadingQuayWaitWords; // Wait word for each station, which waits upon its vessel to leave.
+HandOffStamp* vesselsHandOffStamps; // When each berth's wait word was last signaled.
+HandOffStamp* cranesHandOffStamps; // When each crane's wait word was last signaled.
+HANDLE vesselsDoneSemaphore; // Semaphore which every vessel thread signals once it is done.
+
+// Contention of the primitives above, reported on exit when built with PORT_LOCK_PROFILER.
+// Every quay's barrier and stations have mutexes of their own.
+LockProfile barrierMutexProfiles[MAX_NUMBER_OF_QUAYS] = { LOCK_PROFILE("barrierMutex 1"),
+	LOCK_PROFILE("barrierMutex 2"), LOCK_PROFILE("barrierMutex 3"), LOCK_PROFILE("barrierMutex 4") };
+LockProfile barrierSemaphoreProfile = SIGNAL_PROFILE("barrierSemaphore");
+LockProfile stationMutexProfiles[MAX_NUMBER_OF_QUAYS] = { LOCK_PROFILE("stationMutex 1"),
+	LOCK_PROFILE("stationMutex 2"), LOCK_PROFILE("stationMutex 3"), LOCK_PROFILE("stationMutex 4") };
+LockProfile berthsMutexProfile = LOCK_PROFILE("berthsMutex");
+LockProfile vesselsDoneSemaphoreProfile = SIGNAL_PROFILE("vesselsDoneSemaphore");
+LockProfile vesselsWaitWordsProfile = SIGNAL_PROFILE("vesselsWaitWords");
+LockProfile cranesWaitWordsProfile = SIGNAL_PROFILE("cranesWaitWords");
+LockProfile unloadingQuayWaitWordsProfile = SIGNAL_PROFILE("unloadingQuayWaitWords");
+
+// Variables which support our pipes, or in-memory channels when EilatPort runs in HaifaPort.
+MessageChannel* fromHaifaChannel; // Output for Med. Sea ==> Red Sea Pipe.
+MessageChannel* toHaifaChannel; // Input for Med. Sea <== Red Sea Pipe.
 char buffer[BUFFER_SIZE]; // Contains messages that are sent/received through pipes.
 
-// A "Bolean" variable to help us indicate that all the vessels have arrived to EilatPort.
-int haveAllVesselsArrived = FALSE; 
 // A "Boolean" variable with which the main thread will indicate the crane threads when to end.
 int areAllVesselsDone = FALSE;
 
-int main(int argc, char* argv[])
-{
-	// Receive pipe ends for output and input.
-	readFromHaifaHandle = GetStdHandle(STD_INPUT_HANDLE);
-	writeToHaifaHandle = GetStdHandle(STD_OUTPUT_HANDLE);
-
-	const int numberOfVessels = getNumberOfVesselsFromHaifaPort();
+// Options a session of EilatPortServer was given by its HaifaPort, which are parsed in place.
+char sessionArguments[EILAT_PORT_SERVER_MAX_OPTIONS];
+char* sessionArgv[EILAT_PORT_SERVER_MAX_ARGUMENTS];
 
-	writeToHaifaPortPassageResult(numberOfVessels);
+#ifdef EILAT_PORT_DLL
+// Where stopEilatPort returns to on EilatPort's own thread, and the status it returns with.
+jmp_buf eilatPortStop;
+DWORD eilatPortThreadId;
+volatile LONG eilatPortStopStatus = 0;
+#endif
 
-	// Set seed for rand() function.
-	srand((unsigned int)time(NULL));
+#ifndef EILAT_PORT_DLL
+int main(int argc, char* argv[])
+{
+	// A session is started by EilatPortServer ahead of its HaifaPort, which gives it the options.
+	// It serves the server's runs one after another, the given number of them or till it is
+	// stopped, so only its first run pays for starting the process.
+	if ((argc == 3 || argc == 4) && strcmp(argv[1], "-session") == 0)
+	{
+		const int numberOfSessionRuns = argc == 4 ? atoi(argv[3]) : 0;
 
-	const int numberOfCranes = getRandomDivisor(numberOfVessels);
+		for (int i = 0; numberOfSessionRuns == 0 || i < numberOfSessionRuns; i++)
+		{
+			resetEilatPortSession();
+			acceptEilatPortSession(argv[2]);
+			runEilatPort();
+		}
 
-	initializeGlobalMutexAndSemaphores(numberOfVessels, numberOfCranes);
+		return 0;
+	}
 
-	int* cranesId = NULL;
-	HANDLE* cranesHandler = createCraneThreads(numberOfCranes, &cranesId);
+	parseEilatPortOptions(argc, argv);
 
-	barrier = constructQueue(numberOfVessels);
-	unloadingQuay = constructUnloadingQuay(cranesId, numberOfCranes);
+	// Receive pipe ends for output and input.
+	fromHaifaChannel = createPipeChannel(GetStdHandle(STD_INPUT_HANDLE));
+	toHaifaChannel = createPipeChannel(GetStdHandle(STD_OUTPUT_HANDLE));
 
-	if (barrier == NULL || unloadingQuay == NULL || 
-		unloadingQuay->unloadingQuayStation == NULL)
+	if (fromHaifaChannel == NULL || toHaifaChannel == NULL)
 	{
-		fprintf(stderr, "EilatPort::Main::Unexpected Error - "
-			"barrier/unloadingQuay is NULL!\n");
-		exit(EXIT_FAILURE);
+		fprintf(stderr, "EilatPort::Main::Unexpected Error - Memory allocation failed!\n");
+		stopEilatPort(EXIT_FAILURE);
 	}
 
-	HANDLE unloadingQuayHandler;
-	createUnloadingQuayThread(&unloadingQuayHandler);
+	int result = runEilatPort();
 
-	int* vesselsId = NULL;
-	HANDLE* vesselsHandler = readAndCreateIncomingVesselsFromHaifaPort(numberOfVessels, &vesselsId);
-	haveAllVesselsArrived = TRUE;
+	if (runArena != NULL)
+	{
+		releasePortArena(runArena);
+	}
 
-	// Wait for all vessel threads to terminate.
-	WaitForMultipleObjects(numberOfVessels, vesselsHandler, TRUE, INFINITE);
+	return result;
+}
 
-	// Indication for crane threads to end.
-	areAllVesselsDone = areAllVesselsDoneatHaifaPort();
-	signalCranesToFinish(numberOfCranes);
+void stopEilatPort(int status)
+{
+	exit(status);
+}
+#else
+__declspec(dllexport) DWORD WINAPI EilatPortThread(LPVOID Param)
+{
+	EilatPortThreadParameter* parameter = (EilatPortThreadParameter*)Param;
 
-	// Wait for all crane threads to terminate.
-	WaitForMultipleObjects(numberOfCranes, cranesHandler, TRUE, INFINITE);
-	// Wait for unloading quay thread to terminate.
-	WaitForSingleObject(unloadingQuayHandler, INFINITE);
+	// Receive the in-memory channels HaifaPort created in place of the pipes.
+	fromHaifaChannel = parameter->fromHaifaChannel;
+	toHaifaChannel = parameter->toHaifaChannel;
+	eilatPortThreadId = GetCurrentThreadId();
 
-	// Memory clean up.
-	freeVesselThreads(vesselsHandler, vesselsId, numberOfVessels);
-	freeCraneThreads(cranesHandler, cranesId, numberOfCranes);
-	cleanUnloadingQuayAndBarrier(&unloadingQuayHandler);
+	// Comment: the run's other threads may still use the arena and their handles, which are
+	// left to HaifaPort's process once EilatPort failed.
+	if (setjmp(eilatPortStop) != 0)
+	{
+		closeMessageChannel(fromHaifaChannel);
+		closeMessageChannel(toHaifaChannel);
+		return eilatPortStopStatus;
+	}
 
-	writeToHaifaPortThatEilatPortIsDone();
+	parseEilatPortOptions(parameter->argc, parameter->argv);
 
-	cleanGlobalMutexAndSemaphores(numberOfVessels, numberOfCranes);
+	int result = runEilatPort();
 
-	// Close EilatPorts ends of pipes.
-	CloseHandle(readFromHaifaHandle);
-	CloseHandle(writeToHaifaHandle);
+	if (runArena != NULL)
+	{
+		releasePortArena(runArena);
+	}
 
-	return 0;
+	return result;
 }
 
-VesselQueue* constructQueue(int limit)
+void stopEilatPort(int status)
 {
-	VesselQueue* vesselQueue = (VesselQueue*)malloc(sizeof(VesselQueue));
+	InterlockedCompareExchange(&eilatPortStopStatus, status, 0);
 
-	if (vesselQueue == NULL)
+	if (GetCurrentThreadId() == eilatPortThreadId)
 	{
-		fprintf(stderr, "EilatPort::ConstructQueue::Unexpected Error - "
-			"Memory allocation failed!\n");
-		return NULL;
+		longjmp(eilatPortStop, TRUE);
 	}
 
-	vesselQueue->limit = limit;
-	vesselQueue->size = 0;
-	vesselQueue->head = NULL;
-	vesselQueue->tail = NULL;
-
-	return vesselQueue;
+	// Comment: only HaifaPort may close its ends, so the channels are failed rather than closed.
+	breakMessageChannel(fromHaifaChannel);
+	breakMessageChannel(toHaifaChannel);
+	ExitThread(status);
 }
+#endif
 
-void destructQueue(VesselQueue* vesselQueue)
+int runEilatPort(void)
 {
-	while (!isEmpty(vesselQueue))
+	const int numberOfVessels = getNumberOfVesselsFromHaifaPort();
+
+	// HaifaPort exits by itself once it reads a denial, EilatPort has nothing to clean by then.
+	if (!writeToHaifaPortPassageResult(numberOfVessels))
 	{
-		dequeue(vesselQueue);
+		closeMessageChannel(fromHaifaChannel);
+		closeMessageChannel(toHaifaChannel);
+		return 0;
 	}
 
-	free(vesselQueue);
-}
+	createRunArena(numberOfVessels);
 
-int enqueue(VesselQueue* vesselQueue, int vesselId)
-{
-	if (vesselQueue == NULL)
+	RecoveryStruct recovery = { NULL, 0, 0, 0, 0 };
+	openJournalAndRecoverVessels(&recovery, numberOfVessels);
+
+	// Vessels which haven't left HaifaPort yet, they arrive through the pipe as usual.
+	const int numberOfArrivingVessels = numberOfVessels - recovery.numberOfReturnedVessels -
+		recovery.numberOfVesselsInFlight;
+
+	// Set seed for rand() function.
+	srand(randomSeed);
+
+	// A random number of cranes, or the cranes set with -cranes, start active, the pool holds
+	// as many cranes as the fleet may run so the controller may activate more.
+	const int maxNumberOfCranes = getMaxNumberOfCranes(numberOfVessels);
+	const int numberOfCranes = requestedNumberOfCranes == 0 ? getRandomNumberOfCranes(numberOfVessels) :
+		requestedNumberOfCranes < maxNumberOfCranes ? requestedNumberOfCranes : maxNumberOfCranes;
+	const int numberOfBerths = getNumberOfBerths(numberOfVessels, maxNumberOfCranes,
+		recovery.numberOfVesselsInFlight + recovery.numberOfReservedCredits);
+
+	// Comment: the port before a restart had as many berths, so its vessels never hold more credits.
+	if (numberOfBerths > runArenaNumberOfBerths)
 	{
-		return FALSE;
+		fprintf(stderr, "EilatPort::Main::Unexpected Error - "
+			"HaifaPort's vessels hold %d credits, more than the %d berths!\n", numberOfBerths, runArenaNumberOfBerths);
+		stopEilatPort(EXIT_FAILURE);
 	}
 
-	if (vesselQueue->size >= vesselQueue->limit)
+	// A vessel's thread only runs while the vessel holds a berth, so the berths bound the vessels
+	// watched at once. A thread whose credit has just returned may still hold its watch as the
+	// next vessel arrives, in which case the vessel runs unwatched.
+	if (stallDetectorThreshold > 0)
 	{
-		return FALSE;
+		if (!startStallDetector("Eilat Port", numberOfBerths + maxNumberOfCranes + MAX_NUMBER_OF_QUAYS +
+			MAX_WATCHED_PORT_THREADS, stallDetectorThreshold))
+		{
+			stopEilatPort(EXIT_FAILURE);
+		}
+
+		watchStallThread("Main", 0);
 	}
 
-	VesselNode* vesselNode = (VesselNode*)malloc(sizeof(VesselNode));
+	// Every quay has a crane at least.
+	numberOfUnloadingQuays = numberOfUnloadingQuays < maxNumberOfCranes ? numberOfUnloadingQuays : maxNumberOfCranes;
 
-	if (vesselNode == NULL)
+	// This thread reads the pipe from HaifaPort.
+	if (!initializeThreadPlacement(threadPlacementPolicy, PLACEMENT_EILAT_PORT, numberOfUnloadingQuays,
+		maxNumberOfCranes) || !placeThread(GetCurrentThread(), PLACEMENT_CANAL_IO, 0))
 	{
-		return FALSE;
+		fprintf(stderr, "EilatPort::Main::Unexpected Error - Thread placement failed!\n");
+		stopEilatPort(EXIT_FAILURE);
 	}
 
-	vesselNode->vesselId = vesselId;
-	vesselNode->prev = NULL;
+	initializeGlobalMutexAndSemaphores(numberOfVessels, numberOfBerths, maxNumberOfCranes);
+	initializeTransitCredits(numberOfBerths);
+	openStorageYardAndPlaceWorkers();
 
-	if (vesselQueue->size == 0) // Queue is empty
-	{
-		vesselQueue->head = vesselNode;
-		vesselQueue->tail = vesselNode;
+	int* cranesId = NULL;
 
-	}
-	else // Add to the end of the Queue
+	if (cargoLedgerFileName != NULL)
 	{
+		cargoLedger = openCargoLedger(maxNumberOfCranes, cargoLedgerInterval);
 
-		vesselQueue->tail->prev = vesselNode;
-		vesselQueue->tail = vesselNode;
+		if (cargoLedger == NULL || !placeThread(cargoLedger->samplerHandle, PLACEMENT_HELPER, 0))
+		{
+			fprintf(stderr, "EilatPort::Main::Unexpected Error - Cargo ledger opening or placement failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
 	}
 
-	vesselQueue->size++;
-	return TRUE;
-}
+	const ULONGLONG cranesStartTime = GetTickCount64();
+	HANDLE* cranesHandler = createCraneThreads(maxNumberOfCranes, &cranesId);
 
-int dequeue(VesselQueue* vesselQueue)
-{
-	if (isEmpty(vesselQueue))
+	initializeCargoMix(maxNumberOfCranes);
+
+	// The cranes are shared out between the quays as evenly as they may be, and so are the ones
+	// which start active. Any quay's barrier may hold every berth's vessel.
+	for (int i = 0, firstCraneIndex = 0; i < numberOfUnloadingQuays; i++)
 	{
-		return -1;
+		int numberOfQuayCranes = maxNumberOfCranes / numberOfUnloadingQuays +
+			(i < maxNumberOfCranes % numberOfUnloadingQuays);
+
+		unloadingQuays[i] = constructUnloadingQuay(i, cranesId + firstCraneIndex, numberOfQuayCranes,
+			numberOfBerths);
+
+		if (unloadingQuays[i] == NULL)
+		{
+			fprintf(stderr, "EilatPort::Main::Unexpected Error - "
+				"barrier/unloadingQuay is NULL!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+
+		unloadingQuays[i]->unloadingQuaySize = getUnloadingQuayNumberOfCranes(unloadingQuays[i], numberOfCranes);
+		firstCraneIndex += numberOfQuayCranes;
 	}
 
-	VesselNode* vesselNode;
-	int vesselId;
+	// Every vessel and crane has its state by now, so any later allocation from the arena fails.
+	sealPortArena(runArena);
 
-	vesselNode = vesselQueue->head;
-	vesselId = vesselNode->vesselId;
-	vesselQueue->head = vesselNode->prev;
-	vesselQueue->size--;
+	HANDLE unloadingQuayHandlers[MAX_NUMBER_OF_QUAYS], cranePoolControllerHandler, faultSupervisorHandler;
+	createCranePoolControllerThread(&cranePoolControllerHandler, numberOfCranes, maxNumberOfCranes);
+	createFaultSupervisorThread(&faultSupervisorHandler, maxNumberOfCranes);
+	// Comment: the number of voyages isn't known in round trips, so the quays hold a vessel
+	// to route till HaifaPort ends the voyages.
+	createUnloadingQuayThreads(unloadingQuayHandlers,
+		isRoundTrip ? 1 : numberOfArrivingVessels + recovery.numberOfVesselsToUnload);
 
-	free(vesselNode);
+	createRecoveredVesselThreads(&recovery);
 
-	return vesselId;
-}
+	// Vessels in flight already hold their credits, HaifaPort gets one for each other berth.
+	grantTransitCredits(numberOfBerths - recovery.numberOfVesselsInFlight -
+		recovery.numberOfReservedCredits);
+	const int numberOfArrivedVessels = readAndCreateIncomingVesselsFromHaifaPort(numberOfArrivingVessels);
 
-int isEmpty(VesselQueue* vesselQueue)
-{
-	return vesselQueue->size == 0;
-}
+	// Wait for all vessel threads to terminate.
+	waitForVesselThreads(numberOfArrivedVessels + recovery.numberOfVesselsInFlight);
+	printTurnaroundReport();
+	printJournalReport(numberOfArrivedVessels + recovery.numberOfVesselsInFlight);
+	closeJournal();
 
-UnloadingQuayStruct* constructUnloadingQuay(int cranesId[], int numberOfCranes)
-{
-	UnloadingQuayStruct* pUnloadingQuay =
-		(UnloadingQuayStruct*)malloc(sizeof(UnloadingQuayStruct));
+	// Indication for crane threads to end.
+	areAllVesselsDone = areAllVesselsDoneatHaifaPort();
+	signalCranesToFinish(maxNumberOfCranes);
 
-	if (pUnloadingQuay == NULL)
+	// Wait for all crane threads to terminate.
+	WaitForMultipleObjects(maxNumberOfCranes, cranesHandler, TRUE, INFINITE);
+	const ULONGLONG cranesRunTime = GetTickCount64() - cranesStartTime;
+
+	if (cargoLedger != NULL)
 	{
-		fprintf(stderr, "EilatPort::ConstructUnloadingQuay::Unexpected Error - "
-			"UnloadingQuayStruct memory allocation failed!");
-		return NULL;
+		stopCargoLedger(cargoLedger);
 	}
 
-	pUnloadingQuay->unloadingQuayStation =
-		(UnloadingQuayStation*)malloc(numberOfCranes * sizeof(UnloadingQuayStation));
+	// Wait for the unloading quays' and crane pool controller threads to terminate.
+	WaitForMultipleObjects(numberOfUnloadingQuays, unloadingQuayHandlers, TRUE, INFINITE);
+	WaitForSingleObject(cranePoolControllerHandler, INFINITE);
+	CloseHandle(cranePoolControllerHandler);
 
-	if (pUnloadingQuay->unloadingQuayStation == NULL)
+	if (faultSupervisorHandler != NULL)
 	{
-		fprintf(stderr, "EilatPort::ConstructUnloadingQuay::Unexpected Error - "
-			"UnloadingQuayStation memory allocation failed!");
-		return NULL;
+		WaitForSingleObject(faultSupervisorHandler, INFINITE);
+		CloseHandle(faultSupervisorHandler);
 	}
 
-	pUnloadingQuay->unloadingQuaySize = numberOfCranes;
-
-	for (int i = 0; i < pUnloadingQuay->unloadingQuaySize; i++)
+	// The yard's workers haul away what the cranes left in it.
+	if (storageYard != NULL)
 	{
-		pUnloadingQuay->unloadingQuayStation[i].craneId = cranesId[i];
-		pUnloadingQuay->unloadingQuayStation[i].vesselId = -1;
-		pUnloadingQuay->unloadingQuayStation[i].cargoWeight = -1;
-		pUnloadingQuay->unloadingQuayStation[i].isOccupied = FALSE;
+		drainStorageYard(storageYard);
 	}
 
-	return pUnloadingQuay;
-}
+	printCranePoolReport();
+	printCraneKindReport(cranesRunTime);
+	printFaultReport(cranesRunTime);
+	printCargoLedgerReport(cranesRunTime);
+	printBatchAdmissionReport();
+	printStorageYardReport();
+	printTransitCreditReport();
+	printPlacementReport();
+	printRunArenaReport();
+	printLockProfileReport();
 
-void destructUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay)
-{
-	free(pUnloadingQuay->unloadingQuayStation);
-	free(pUnloadingQuay);
-}
+	// Memory clean up.
+	freeCraneThreads(cranesHandler, maxNumberOfCranes);
+	cleanUnloadingQuaysAndBarriers(unloadingQuayHandlers);
 
-int isUnloadingQuayEmpty(UnloadingQuayStruct* pUnloadingQuay)
-{
-	for (int i = 0; i < pUnloadingQuay->unloadingQuaySize; i++)
+	if (storageYard != NULL)
 	{
-		if (pUnloadingQuay->unloadingQuayStation[i].vesselId != -1 ||
-			pUnloadingQuay->unloadingQuayStation[i].isOccupied != FALSE)
-		{
-			return FALSE;
-		}
+		closeStorageYard(storageYard);
 	}
 
-	return TRUE;
-}
-
-void removeVesselsFromUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay)
-{
-	for (int i = 0; i < pUnloadingQuay->unloadingQuaySize; i++)
+	if (cargoLedger != NULL)
 	{
-		pUnloadingQuay->unloadingQuayStation[i].isOccupied = FALSE;
-		pUnloadingQuay->unloadingQuayStation[i].vesselId = -1;
+		closeCargoLedger(cargoLedger);
 	}
-}
-
-int safeRand(void)
-{
-	WaitForSingleObject(randomMutex, INFINITE);
 
-	int randomNumber = rand();
+	writeToHaifaPortThatEilatPortIsDone();
 
-	if (!ReleaseMutex(randomMutex))
-	{
-		fprintf(stderr, "safeRand::Unexpected error - randomMutex.V()\n");
-	}
+	destructTransitCredits();
+	stopStallDetector();
+	cleanGlobalMutexAndSemaphores();
 
-	return randomNumber;
-}
+	// Close EilatPorts ends of pipes.
+	closeMessageChannel(fromHaifaChannel);
+	closeMessageChannel(toHaifaChannel);
 
-int randomSleepTime(void)
-{
-	return safeRand() % (MAX_SLEEP_TIME - MIN_SLEEP_TIME + 1) + MIN_SLEEP_TIME;
+	return 0;
 }
 
-int randomCargoWeight(void)
+void parseEilatPortOptions(int argc, char* argv[])
 {
-	return safeRand() % (MAX_WEIGHT - MIN_WEIGHT + 1) + MIN_WEIGHT;
-}
+	initializeServiceTimes(MIN_SLEEP_TIME, MAX_SLEEP_TIME);
+	randomSeed = (unsigned int)time(NULL);
 
-void initializeGlobalMutexAndSemaphores(int numberOfVessels, int numberOfCranes)
-{
-	// Shared semaphore's names
-	LPCWSTR medToRedCanalString = L"MedToRedCanal";
-	LPCWSTR redToMedCanalString = L"RedToMedCanal";
-	LPCWSTR processSafePrintString = L"ProcessSafePrint";
+	for (int i = 1; i < argc; i++)
+	{
+		if (i + 1 < argc && strcmp(argv[i], "-maxbatch") == 0)
+		{
+			batchAdmission.maxBatchSize = atoi(argv[++i]);
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-flush") == 0)
+		{
+			batchAdmission.flushTimeout = atoi(argv[++i]);
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-credits") == 0)
+		{
+			requestedNumberOfCredits = atoi(argv[++i]);
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-service") == 0)
+		{
+			if (!setServiceTimeDistribution(argv[++i]))
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - Invalid service time '%s'!\n",
+					argv[i]);
+				stopEilatPort(EXIT_FAILURE);
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-seed") == 0)
+		{
+			// HaifaPort seeds its own times with the even seed, from 2 on.
+			randomSeed = (unsigned int)strtoul(argv[++i], NULL, 10);
+			seedServiceTimes((ULONGLONG)randomSeed << 1 | 1);
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-quays") == 0)
+		{
+			numberOfUnloadingQuays = atoi(argv[++i]);
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-route") == 0)
+		{
+			routingPolicy = strcmp(argv[++i], "jsq") == 0 ? ROUTE_SHORTEST_QUEUE :
+				strcmp(argv[i], "p2c") == 0 ? ROUTE_TWO_CHOICES : -1;
 
-	randomMutex = CreateMutex(NULL, FALSE, NULL);
-	stationMutex = CreateMutex(NULL, FALSE, NULL);
-	barrierSemaphore = CreateSemaphore(NULL, 0, numberOfVessels, NULL);
+			if (routingPolicy == -1)
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - Route must be jsq or p2c!\n");
+				stopEilatPort(EXIT_FAILURE);
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-placement") == 0)
+		{
+			threadPlacementPolicy = getThreadPlacementPolicy(argv[++i]);
 
-	// Open shared semaphores between HaifaPort and EilatPort.
-	redToMedCanalSemaphore = OpenSemaphore(SEMAPHORE_ALL_ACCESS, FALSE, redToMedCanalString);
-	medToRedCanalSemaphore = OpenSemaphore(SEMAPHORE_ALL_ACCESS, FALSE, medToRedCanalString);
-	processSafePrintSemaphore = OpenSemaphore(SEMAPHORE_ALL_ACCESS, FALSE, processSafePrintString);
+			if (threadPlacementPolicy == -1)
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - Invalid placement '%s'!\n",
+					argv[i]);
+				stopEilatPort(EXIT_FAILURE);
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-stall") == 0)
+		{
+			stallDetectorThreshold = (DWORD)strtoul(argv[++i], NULL, 10);
+#ifndef PORT_STALL_DETECTOR
+			if (stallDetectorThreshold > 0)
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - -stall needs a build with "
+					"PORT_STALL_DETECTOR defined!\n");
+				stopEilatPort(EXIT_FAILURE);
+			}
+#endif
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-cranes") == 0)
+		{
+			requestedNumberOfCranes = atoi(argv[++i]);
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-cranekinds") == 0)
+		{
+			numberOfCraneKinds = parseCraneKinds(craneKinds, argv[++i]);
+			isCargoMixed = TRUE;
 
-	if (randomMutex == NULL || stationMutex == NULL || 
-		barrierSemaphore == NULL || processSafePrintSemaphore == NULL ||
-		medToRedCanalSemaphore == NULL || redToMedCanalSemaphore == NULL)
-	{
-		fprintf(stderr, "EilatPort::initializeGlobalMutexAndSemaphores::Unexpected Error -"
-			" Mutex/Semaphore creation failed!\n");
-		exit(EXIT_FAILURE);
-	}
+			if (numberOfCraneKinds == 0)
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - Invalid crane kinds '%s', "
+					"expected at most %d of <type>[+<type>...]:<rate %%>!\n", argv[i], MAX_CRANE_KINDS);
+				stopEilatPort(EXIT_FAILURE);
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-cargo") == 0)
+		{
+			isCargoMixed = TRUE;
 
-	vesselsSemaphores = (HANDLE*)malloc(numberOfVessels * sizeof(HANDLE));
-	cranesSemaphores = (HANDLE*)malloc(numberOfCranes * sizeof(HANDLE));
-	unloadingQuaySemaphore = (HANDLE*)malloc(numberOfCranes * sizeof(HANDLE));
+			if (!parseCargoMix(cargoMix, argv[++i]))
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - Invalid cargo mix '%s', "
+					"expected <type>:<weight>[,...]!\n", argv[i]);
+				stopEilatPort(EXIT_FAILURE);
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-faults") == 0)
+		{
+			isFaultInjected = TRUE;
 
-	if (vesselsSemaphores == NULL || cranesSemaphores == NULL ||
-		unloadingQuaySemaphore == NULL)
-	{
-		fprintf(stderr, "EilatPort::initializeGlobalMutexAndSemaphores::Unexpected Error -"
-			" Memory allocation failed!\n");
-		exit(EXIT_FAILURE);
-	}
+			if (!parseFaultSchedule(&faultInjector, argv[++i]))
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - Invalid faults '%s', expected at most "
+					"%d of <crane<ID>|canal-red|canal-med>:<fail|slow=<percent>|recover>@<ms>!\n", argv[i],
+					MAX_FAULT_EVENTS);
+				stopEilatPort(EXIT_FAILURE);
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-faultrate") == 0)
+		{
+			isFaultInjected = TRUE;
 
-	for (int i = 0; i < numberOfVessels; i++)
-	{
-		vesselsSemaphores[i] = CreateSemaphore(NULL, 0, 1, NULL);
+			if (!parseFaultRate(&faultInjector, argv[++i]))
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - Invalid fault rate '%s', "
+					"expected <failures per minute>:<repair ms>!\n", argv[i]);
+				stopEilatPort(EXIT_FAILURE);
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-cranetimeout") == 0)
+		{
+			isFaultInjected = TRUE;
+			craneTimeout = (DWORD)strtoul(argv[++i], NULL, 10);
 
-		if (vesselsSemaphores[i] == NULL)
+			// The timeout is past the end of the crane's slice, and is checked once a supervisor's
+			// interval, so a shorter one would take a crane that is a check late as stalled.
+			if (craneTimeout < FAULT_INJECTOR_INTERVAL)
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - -cranetimeout must be at least %d ms!\n",
+					FAULT_INJECTOR_INTERVAL);
+				stopEilatPort(EXIT_FAILURE);
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-yard") == 0)
 		{
-			fprintf(stderr, "EilatPort::initializeGlobalMutexAndSemaphores::Unexpected Error -"
-				" vessel semphore %d Creation Failed!\n", i);
-			exit(EXIT_FAILURE);
+			storageYardCapacity = atoi(argv[++i]);
 		}
-	}
+		else if (i + 1 < argc && (strcmp(argv[i], "-trucks") == 0 || strcmp(argv[i], "-rail") == 0))
+		{
+			int kind = strcmp(argv[i], "-trucks") == 0 ? STORAGE_YARD_TRUCK : STORAGE_YARD_RAIL;
 
-	for (int i = 0; i < numberOfCranes; i++)
-	{
-		cranesSemaphores[i] = CreateSemaphore(NULL, 0, 1, NULL);
-		unloadingQuaySemaphore[i] = CreateSemaphore(NULL, 0, 1, NULL);
+			if (!parseStorageYardWorkers(&storageYardWorkers[kind], argv[++i]))
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - Invalid workers '%s', "
+					"expected <0-%d workers>:<tons per second>!\n", argv[i], STORAGE_YARD_MAX_WORKERS);
+				stopEilatPort(EXIT_FAILURE);
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-ledger") == 0)
+		{
+			cargoLedgerFileName = argv[++i];
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-ledgerinterval") == 0)
+		{
+			cargoLedgerInterval = (DWORD)strtoul(argv[++i], NULL, 10);
 
-		if (cranesSemaphores[i] == NULL || unloadingQuaySemaphore[i] == NULL)
+			if (cargoLedgerInterval == 0)
+			{
+				fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - -ledgerinterval must be positive!\n");
+				stopEilatPort(EXIT_FAILURE);
+			}
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-journal") == 0)
+		{
+			journalFileName = argv[++i];
+		}
+		else if (i + 1 < argc && strcmp(argv[i], "-run") == 0 && isValidRunId(argv[i + 1]))
+		{
+			runId = argv[++i];
+		}
+		else if (strcmp(argv[i], "-recover") == 0)
+		{
+			isRecovering = TRUE;
+		}
+		else if (strcmp(argv[i], "-roundtrip") == 0)
+		{
+			isRoundTrip = TRUE;
+		}
+		else
 		{
-			fprintf(stderr, "initializeGlobalMutexAndSemaphores::Unexpected Error - "
-				"crane/unloadingquay semphore %d Creation Failed!\n", i);
-			exit(EXIT_FAILURE);
+			fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - Unknown option '%s'!\n",
+				argv[i]);
+			stopEilatPort(EXIT_FAILURE);
 		}
 	}
-}
 
-void cleanGlobalMutexAndSemaphores(int numberOfVessels, int numberOfCranes)
-{
-	CloseHandle(randomMutex);
-	CloseHandle(stationMutex);
-	CloseHandle(barrierSemaphore);
-	CloseHandle(redToMedCanalSemaphore);
-	CloseHandle(medToRedCanalSemaphore);
-	CloseHandle(processSafePrintSemaphore);
+	if (batchAdmission.maxBatchSize < 1 || batchAdmission.flushTimeout < 0 ||
+		requestedNumberOfCredits < 0 || requestedNumberOfCranes < 0)
+	{
+		fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - "
+			"-maxbatch must be positive and -flush, -credits and -cranes may not be negative!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
 
-	for (int i = 0; i < numberOfVessels; i++)
+	// Comment: a yard nobody drains would block the cranes for good.
+	if (storageYardCapacity < 0 || (storageYardCapacity > 0 &&
+		storageYardWorkers[STORAGE_YARD_TRUCK].numberOfWorkers == 0 &&
+		storageYardWorkers[STORAGE_YARD_RAIL].numberOfWorkers == 0))
 	{
-		CloseHandle(vesselsSemaphores[i]);
+		fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - "
+			"-yard may not be negative and a yard needs a truck or a train!\n");
+		stopEilatPort(EXIT_FAILURE);
 	}
 
-	free(vesselsSemaphores);
+	if (numberOfUnloadingQuays < 1 || numberOfUnloadingQuays > MAX_NUMBER_OF_QUAYS)
+	{
+		fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - "
+			"-quays must be between 1-%d!\n", MAX_NUMBER_OF_QUAYS);
+		stopEilatPort(EXIT_FAILURE);
+	}
 
-	for (int i = 0; i < numberOfCranes; i++)
+	if (runId == NULL)
 	{
-		CloseHandle(cranesSemaphores[i]);
-		CloseHandle(unloadingQuaySemaphore[i]);
+		fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - "
+			"EilatPort must be given its run id with -run by HaifaPort!\n");
+		stopEilatPort(EXIT_FAILURE);
 	}
 
-	free(cranesSemaphores);
-	free(unloadingQuaySemaphore);
-}
+	if (isRecovering && journalFileName == NULL)
+	{
+		fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - "
+			"-recover requires a -journal to recover from!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
 
-int getNumberOfVesselsFromHaifaPort(void)
-{
-	// Read number of vessels incoming from HaifaPort.
-	if (!ReadFile(readFromHaifaHandle, buffer, BUFFER_SIZE, &numberOfReadBytes, NULL))
+	// Comment: a journal resumes every vessel once, while in round trips a vessel arrives again.
+	if (isRoundTrip && journalFileName != NULL)
 	{
-		fprintf(stderr, "EilatPort::Main::Unexpected Error - "
-			"Reading number of vessels from 'Med Sea. ==> Red Sea' pipe failed!\n");
-		exit(EXIT_FAILURE);
+		fprintf(stderr, "EilatPort::parseEilatPortOptions::Error - "
+			"-roundtrip can't be kept in a -journal!\n");
+		stopEilatPort(EXIT_FAILURE);
 	}
 
-	return atoi(buffer);
+	batchAdmission.tunedBatchSize = batchAdmission.maxBatchSize;
 }
 
-void writeToHaifaPortPassageResult(int numberOfVessels)
+void acceptEilatPortSession(const char* serverName)
 {
-	GetLocalTime(&currentTime);
-	fprintf(stderr, "[%02d:%02d:%02d] Eilat Port: "
-		"Proccessing passage approval for %d vessels...\n",
-		currentTime.wHour, currentTime.wMinute, currentTime.wSecond, numberOfVessels);
+	WCHAR pipeName[MAX_RUN_OBJECT_NAME];
+	WCHAR sessionPipeName[MAX_RUN_OBJECT_NAME];
+	DWORD pipeMode = PIPE_TYPE_MESSAGE | PIPE_READMODE_MESSAGE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS;
+	DWORD pipeSize = MESSAGE_SIZE * MESSAGE_CHANNEL_CAPACITY;
 
-	int passageResult = !isPrimeNumber(numberOfVessels);
+	if (!isValidRunId(serverName))
+	{
+		fprintf(stderr, "EilatPort::acceptEilatPortSession::Error - "
+			"Server name must be 1-%d letters, digits, '-' or '_'!\n", MAX_RUN_ID);
+		stopEilatPort(EXIT_FAILURE);
+	}
 
-	GetLocalTime(&currentTime);
-	fprintf(stderr, "[%02d:%02d:%02d] Eilat Port: passage for %d vessels %s!\n",
-		currentTime.wHour, currentTime.wMinute, currentTime.wSecond, numberOfVessels,
-		passageResult ? "approved" : "denied");
+	getRunObjectName(pipeName, EILAT_PORT_SERVER_PIPE, serverName);
+	swprintf(sessionPipeName, MAX_RUN_OBJECT_NAME, L"%ls.%lu", pipeName, GetCurrentProcessId());
 
-	sprintf(buffer, "%d", passageResult);
+	// Every standby session is an instance of the server's pipe, HaifaPort connects to any free one.
+	// Comment: in message mode every read returns a whole message, as the anonymous pipes do.
+	HANDLE pipeHandle = CreateNamedPipe(pipeName, PIPE_ACCESS_DUPLEX, pipeMode, PIPE_UNLIMITED_INSTANCES,
+		pipeSize, pipeSize, 0, NULL);
+	HANDLE sessionPipeHandle = CreateNamedPipe(sessionPipeName, PIPE_ACCESS_OUTBOUND, pipeMode, 1,
+		pipeSize, pipeSize, 0, NULL);
 
-	// Writing passage result to 'Med. Sea <== Red Sea' pipe
-	if (!WriteFile(writeToHaifaHandle, buffer, BUFFER_SIZE, &numberOfWrittenBytes, NULL))
+	if (pipeHandle == INVALID_HANDLE_VALUE || sessionPipeHandle == INVALID_HANDLE_VALUE)
 	{
-		fprintf(stderr, "EilatPort::writeToHaifaPortPassageResult::Unexpected Error -"
-			" Writing passage result to 'Med. Sea <== Red Sea' pipe failed\n");
-		exit(EXIT_FAILURE);
+		fprintf(stderr, "EilatPort::acceptEilatPortSession::Unexpected Error - "
+			"Creating the pipes of server '%s' failed (%d)!\n", serverName, GetLastError());
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	if (!ConnectNamedPipe(pipeHandle, NULL) && GetLastError() != ERROR_PIPE_CONNECTED)
+	{
+		fprintf(stderr, "EilatPort::acceptEilatPortSession::Unexpected Error - "
+			"Waiting for HaifaPort on server '%s' failed (%d)!\n", serverName, GetLastError());
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	fromHaifaChannel = createPipeChannel(pipeHandle);
+	toHaifaChannel = createPipeChannel(sessionPipeHandle);
+
+	if (fromHaifaChannel == NULL || toHaifaChannel == NULL)
+	{
+		fprintf(stderr, "EilatPort::acceptEilatPortSession::Unexpected Error - Memory allocation failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	// Comment: the process ID is written through the server's pipe, which is only read from then on.
+	sprintf(buffer, "%lu", GetCurrentProcessId());
+
+	if (!writeMessage(fromHaifaChannel, buffer) ||
+		(!ConnectNamedPipe(sessionPipeHandle, NULL) && GetLastError() != ERROR_PIPE_CONNECTED))
+	{
+		fprintf(stderr, "EilatPort::acceptEilatPortSession::Unexpected Error - "
+			"Connecting HaifaPort to the session's pipe failed (%d)!\n", GetLastError());
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	// The options' length, followed by the options a message's worth at a time.
+	int length;
+
+	if (!readMessage(fromHaifaChannel, buffer) || sscanf(buffer, "%d", &length) != 1 ||
+		length < 0 || length >= EILAT_PORT_SERVER_MAX_OPTIONS)
+	{
+		fprintf(stderr, "EilatPort::acceptEilatPortSession::Unexpected Error - "
+			"Reading the options' length from HaifaPort failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < length; i += MESSAGE_SIZE)
+	{
+		if (!readMessage(fromHaifaChannel, buffer))
+		{
+			fprintf(stderr, "EilatPort::acceptEilatPortSession::Unexpected Error - "
+				"Reading the options from HaifaPort failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+
+		memcpy(sessionArguments + i, buffer, length - i < MESSAGE_SIZE ? length - i : MESSAGE_SIZE);
+	}
+
+	sessionArguments[length] = '\0';
+
+	// Split the options as EilatPort.exe's command line would be, argv[0] is its name.
+	int argc = 0;
+
+	sessionArgv[argc++] = "EilatPort";
+
+	for (char* argument = strtok(sessionArguments, " "); argument != NULL; argument = strtok(NULL, " "))
+	{
+		if (argc == EILAT_PORT_SERVER_MAX_ARGUMENTS - 1)
+		{
+			fprintf(stderr, "EilatPort::acceptEilatPortSession::Error - Options are too many!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+
+		sessionArgv[argc++] = argument;
+	}
+
+	sessionArgv[argc] = NULL;
+	parseEilatPortOptions(argc, sessionArgv);
+}
+
+void resetEilatPortSession(void)
+{
+	const StorageYardWorkers defaultStorageYardWorkers[STORAGE_YARD_WORKER_KINDS] = {
+		{ STORAGE_YARD_DEFAULT_TRUCKS, STORAGE_YARD_DEFAULT_TRUCK_RATE },
+		{ STORAGE_YARD_DEFAULT_TRAINS, STORAGE_YARD_DEFAULT_TRAIN_RATE } };
+
+	// The options, as they are set where they are declared.
+	memset(&batchAdmission, 0, sizeof(batchAdmission));
+	batchAdmission.maxBatchSize = MAX_NUMBER_OF_CRANES;
+	batchAdmission.flushTimeout = DEFAULT_BATCH_FLUSH_TIMEOUT;
+	requestedNumberOfCredits = 0;
+	requestedNumberOfCranes = 0;
+	numberOfUnloadingQuays = 1;
+	routingPolicy = ROUTE_SHORTEST_QUEUE;
+	threadPlacementPolicy = PLACEMENT_NONE;
+	stallDetectorThreshold = 0;
+	memset(craneKinds, 0, sizeof(craneKinds));
+	craneKinds[0].capabilities = CARGO_ANY;
+	craneKinds[0].rate = CRANE_KIND_BASE_RATE;
+	numberOfCraneKinds = 1;
+	memset(cargoMix, 0, sizeof(cargoMix));
+	isCargoMixed = FALSE;
+	memset(&faultInjector, 0, sizeof(faultInjector));
+	isFaultInjected = FALSE;
+	craneTimeout = 0;
+	storageYardCapacity = 0;
+	memcpy(storageYardWorkers, defaultStorageYardWorkers, sizeof(storageYardWorkers));
+	cargoLedgerFileName = NULL;
+	cargoLedgerInterval = CARGO_LEDGER_DEFAULT_INTERVAL;
+	journalFileName = NULL;
+	runId = NULL;
+	isRecovering = FALSE;
+	isRoundTrip = FALSE;
+	seedServiceTimes(0);
+
+	// The last run's state and statistics.
+	areAllVesselsDone = FALSE;
+	memset(turnaroundHistogram, 0, sizeof(turnaroundHistogram));
+	memset(&fleetTurnaroundHistogram, 0, sizeof(fleetTurnaroundHistogram));
+	memset(&barrierWaitHistogram, 0, sizeof(barrierWaitHistogram));
+	memset(&handOffHistogram, 0, sizeof(handOffHistogram));
+	memset(&cranePoolController, 0, sizeof(cranePoolController));
+	memset(&transitCredits, 0, sizeof(transitCredits));
+	memset((void*)numberOfCargoVessels, 0, sizeof(numberOfCargoVessels));
+	memset((void*)cargoBarrierWaitTime, 0, sizeof(cargoBarrierWaitTime));
+	memset(unloadingQuays, 0, sizeof(unloadingQuays));
+	storageYard = NULL;
+	cargoLedger = NULL;
+	craneFaults = NULL;
+	journal = NULL;
+	resetLockProfiles();
+
+	// Comment: the last run may have placed this thread, which the next one may not place at all.
+	DWORD_PTR processMask, systemMask;
+
+	if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+	{
+		SetThreadAffinityMask(GetCurrentThread(), processMask);
+	}
+}
+
+PriorityBarrier* constructPriorityBarrier(int limit, int quayIndex)
+{
+	PriorityBarrier* priorityBarrier =
+		(PriorityBarrier*)allocateFromPortArena(runArena, PORT_ARENA_HOT, sizeof(PriorityBarrier));
+
+	if (priorityBarrier == NULL)
+	{
+		fprintf(stderr, "EilatPort::constructPriorityBarrier::Unexpected Error - "
+			"Memory allocation failed!\n");
+		return NULL;
+	}
+
+	priorityBarrier->limit = limit;
+	priorityBarrier->size = 0;
+	priorityBarrier->mutex = CreateMutex(NULL, FALSE, NULL);
+	priorityBarrier->semaphore = CreateSemaphore(NULL, 0, limit, NULL);
+	priorityBarrier->mutexProfile = &barrierMutexProfiles[quayIndex];
+
+	if (priorityBarrier->mutex == NULL || priorityBarrier->semaphore == NULL)
+	{
+		fprintf(stderr, "EilatPort::constructPriorityBarrier::Unexpected Error - "
+			"Mutex or semaphore creation failed!\n");
+		return NULL;
 	}
 
-	if (!passageResult)
+	// Each class's queue of each cargo type may hold the whole barrier, so the queues share
+	// a single pool of a node for each vessel the barrier may hold.
+	VesselNodePool* nodePool = constructNodePool(limit, runArena);
+
+	if (nodePool == NULL)
+	{
+		return NULL;
+	}
+
+	for (int i = 0; i < NUMBER_OF_PRIORITY_CLASSES; i++)
 	{
-		exit(EXIT_SUCCESS);
+		for (int j = 0; j < CARGO_TYPES; j++)
+		{
+			priorityBarrier->classQueue[i][j] = constructSharedQueue(limit, nodePool, runArena);
+
+			if (priorityBarrier->classQueue[i][j] == NULL)
+			{
+				return NULL;
+			}
+		}
 	}
+
+	return priorityBarrier;
 }
 
-int isPrimeNumber(int number)
+int enqueueToBarrier(PriorityBarrier* priorityBarrier, int berthIndex, int priorityClass, int cargoType)
 {
-	if (number == 1)
+	int isEnqueued = FALSE;
+
+	waitForProfiledObject(priorityBarrier->mutexProfile, priorityBarrier->mutex, INFINITE);
+
+	if (priorityBarrier->size < priorityBarrier->limit &&
+		enqueue(priorityBarrier->classQueue[priorityClass][cargoType], berthIndex))
+	{
+		priorityBarrier->size++;
+		isEnqueued = TRUE;
+	}
+
+	if (!releaseProfiledMutex(priorityBarrier->mutexProfile, priorityBarrier->mutex))
 	{
+		fprintf(stderr, "EilatPort::enqueueToBarrier::Unexpected Error - barrierMutex.V()\n");
 		return FALSE;
 	}
 
-	for (int i = 2; i < number; i++)
+	return isEnqueued;
+}
+
+int dequeueFromBarrier(PriorityBarrier* priorityBarrier, DWORD cargoTypes, int* cargoType)
+{
+	ULONGLONG currentTickCount = GetTickCount64();
+	LONGLONG bestAgedPriority = 0;
+	VesselQueue* bestQueue = NULL;
+	int bestClass = -1;
+	int bestCargoType = -1;
+	int berthIndex = -1;
+
+	waitForProfiledObject(priorityBarrier->mutexProfile, priorityBarrier->mutex, INFINITE);
+
+	// A class's aged priority is its class lowered by one for every AGING_INTERVAL
+	// its oldest vessel has waited, so bulk vessels can't starve behind express ones.
+	// On a tie the better class wins, and within a class the vessel which waited longest.
+	for (int i = 0; i < NUMBER_OF_PRIORITY_CLASSES; i++)
+	{
+		for (int j = 0; j < CARGO_TYPES; j++)
+		{
+			VesselQueue* classQueue = priorityBarrier->classQueue[i][j];
+
+			if (!(cargoTypes & 1 << j) || isEmpty(classQueue))
+			{
+				continue;
+			}
+
+			LONGLONG agedPriority = i -
+				(LONGLONG)((currentTickCount - classQueue->head->enqueueTime) / AGING_INTERVAL);
+
+			if (bestClass == -1 || agedPriority < bestAgedPriority || (agedPriority == bestAgedPriority &&
+				i == bestClass && classQueue->head->enqueueTime < bestQueue->head->enqueueTime))
+			{
+				bestAgedPriority = agedPriority;
+				bestQueue = classQueue;
+				bestClass = i;
+				bestCargoType = j;
+			}
+		}
+	}
+
+	if (bestClass != -1)
+	{
+		ULONGLONG barrierWait = currentTickCount - bestQueue->head->enqueueTime;
+
+		berthIndex = dequeue(bestQueue);
+		priorityBarrier->size--;
+		*cargoType = bestCargoType;
+
+		recordLatency(&barrierWaitHistogram, barrierWait);
+		InterlockedExchangeAdd64(&cranePoolController.barrierWaitTime, (LONGLONG)barrierWait);
+		InterlockedIncrement(&cranePoolController.numberOfBarrierWaits);
+		InterlockedExchangeAdd64(&cargoBarrierWaitTime[bestCargoType], (LONGLONG)barrierWait);
+		InterlockedIncrement(&numberOfCargoVessels[bestCargoType]);
+	}
+
+	if (!releaseProfiledMutex(priorityBarrier->mutexProfile, priorityBarrier->mutex))
+	{
+		fprintf(stderr, "EilatPort::dequeueFromBarrier::Unexpected Error - barrierMutex.V()\n");
+		return -1;
+	}
+
+	return berthIndex;
+}
+
+ULONGLONG getOldestBarrierWait(PriorityBarrier* priorityBarrier)
+{
+	ULONGLONG currentTickCount = GetTickCount64();
+	ULONGLONG oldestWait = 0;
+
+	waitForProfiledObject(priorityBarrier->mutexProfile, priorityBarrier->mutex, INFINITE);
+
+	for (int i = 0; i < NUMBER_OF_PRIORITY_CLASSES; i++)
+	{
+		for (int j = 0; j < CARGO_TYPES; j++)
+		{
+			VesselQueue* classQueue = priorityBarrier->classQueue[i][j];
+
+			if (!isEmpty(classQueue) && currentTickCount - classQueue->head->enqueueTime > oldestWait)
+			{
+				oldestWait = currentTickCount - classQueue->head->enqueueTime;
+			}
+		}
+	}
+
+	if (!releaseProfiledMutex(priorityBarrier->mutexProfile, priorityBarrier->mutex))
+	{
+		fprintf(stderr, "EilatPort::getOldestBarrierWait::Unexpected Error - barrierMutex.V()\n");
+	}
+
+	return oldestWait;
+}
+
+int getPriorityClass(int priority)
+{
+	if (priority < 0)
+	{
+		return 0;
+	}
+
+	if (priority >= NUMBER_OF_PRIORITY_CLASSES)
+	{
+		return NUMBER_OF_PRIORITY_CLASSES - 1;
+	}
+
+	return priority;
+}
+
+UnloadingQuayStruct* constructUnloadingQuay(int quayIndex, int cranesId[], int numberOfCranes, int barrierLimit)
+{
+	UnloadingQuayStruct* pUnloadingQuay =
+		(UnloadingQuayStruct*)allocateFromPortArena(runArena, PORT_ARENA_HOT, sizeof(UnloadingQuayStruct));
+
+	if (pUnloadingQuay == NULL)
+	{
+		fprintf(stderr, "EilatPort::ConstructUnloadingQuay::Unexpected Error - "
+			"UnloadingQuayStruct memory allocation failed!");
+		return NULL;
+	}
+
+	pUnloadingQuay->unloadingQuayStation = (UnloadingQuayStation*)allocateFromPortArena(runArena,
+		PORT_ARENA_HOT, numberOfCranes * sizeof(UnloadingQuayStation));
+
+	if (pUnloadingQuay->unloadingQuayStation == NULL)
+	{
+		fprintf(stderr, "EilatPort::ConstructUnloadingQuay::Unexpected Error - "
+			"UnloadingQuayStation memory allocation failed!");
+		return NULL;
+	}
+
+	pUnloadingQuay->unloadingQuaySize = numberOfCranes;
+	pUnloadingQuay->maxUnloadingQuaySize = numberOfCranes;
+	pUnloadingQuay->quayIndex = quayIndex;
+	pUnloadingQuay->firstCraneIndex = cranesId[0] - 1;
+	pUnloadingQuay->barrier = constructPriorityBarrier(barrierLimit, quayIndex);
+	pUnloadingQuay->stationMutex = CreateMutex(NULL, FALSE, NULL);
+	pUnloadingQuay->stationMutexProfile = &stationMutexProfiles[quayIndex];
+	pUnloadingQuay->batchAdmission = batchAdmission;
+	pUnloadingQuay->numberOfVesselsToUnload = 0;
+	pUnloadingQuay->numberOfVesselsInQuay = 0;
+	pUnloadingQuay->numberOfRoutedVessels = 0;
+	pUnloadingQuay->numberOfDeferredVessels = 0;
+	pUnloadingQuay->cargoTypes = 0;
+
+	if (pUnloadingQuay->barrier == NULL || pUnloadingQuay->stationMutex == NULL)
+	{
+		fprintf(stderr, "EilatPort::ConstructUnloadingQuay::Unexpected Error - "
+			"Barrier or stationMutex creation failed!");
+		return NULL;
+	}
+
+	for (int i = 0; i < CARGO_TYPES; i++)
+	{
+		pUnloadingQuay->cargoStations[i] = 0;
+	}
+
+	for (int i = 0; i < pUnloadingQuay->maxUnloadingQuaySize; i++)
+	{
+		// The crane of ID n is of kind (n - 1) % numberOfCraneKinds.
+		CraneKind* craneKind = &craneKinds[(cranesId[i] - 1) % numberOfCraneKinds];
+
+		pUnloadingQuay->unloadingQuayStation[i].craneId = cranesId[i];
+		pUnloadingQuay->unloadingQuayStation[i].vesselId = -1;
+		pUnloadingQuay->unloadingQuayStation[i].berthIndex = -1;
+		pUnloadingQuay->unloadingQuayStation[i].cargoWeight = -1;
+		pUnloadingQuay->unloadingQuayStation[i].isOccupied = FALSE;
+		pUnloadingQuay->unloadingQuayStation[i].isUnloading = FALSE;
+		pUnloadingQuay->unloadingQuayStation[i].assignment = 0;
+		pUnloadingQuay->unloadingQuayStation[i].capabilities = craneKind->capabilities;
+		pUnloadingQuay->unloadingQuayStation[i].rate = craneKind->rate;
+		pUnloadingQuay->cargoTypes |= craneKind->capabilities;
+
+		for (int j = 0; j < CARGO_TYPES; j++)
+		{
+			if (craneKind->capabilities & 1 << j)
+			{
+				pUnloadingQuay->cargoStations[j] |= (DWORD)1 << i;
+			}
+		}
+	}
+
+	// Stations are activated and parked from the last one, so the quay's first stations which
+	// together unload all of its cargo types stay active.
+	DWORD activeCargoTypes = 0;
+
+	for (pUnloadingQuay->minUnloadingQuaySize = 0; activeCargoTypes != pUnloadingQuay->cargoTypes;
+		pUnloadingQuay->minUnloadingQuaySize++)
+	{
+		activeCargoTypes |= pUnloadingQuay->unloadingQuayStation[pUnloadingQuay->minUnloadingQuaySize].capabilities;
+	}
+
+	return pUnloadingQuay;
+}
+
+int isUnloadingQuayEmpty(UnloadingQuayStruct* pUnloadingQuay)
+{
+	for (int i = 0; i < pUnloadingQuay->unloadingQuaySize; i++)
 	{
-		if (number % i == 0)
+		if (pUnloadingQuay->unloadingQuayStation[i].vesselId != -1 ||
+			pUnloadingQuay->unloadingQuayStation[i].isOccupied != FALSE)
 		{
 			return FALSE;
 		}
@@ -549,421 +1465,2080 @@ int isPrimeNumber(int number)
 	return TRUE;
 }
 
-int getRandomDivisor(int dividendNumber)
+void removeVesselsFromUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay)
+{
+	for (int i = 0; i < pUnloadingQuay->unloadingQuaySize; i++)
+	{
+		pUnloadingQuay->unloadingQuayStation[i].isOccupied = FALSE;
+		pUnloadingQuay->unloadingQuayStation[i].vesselId = -1;
+		pUnloadingQuay->unloadingQuayStation[i].berthIndex = -1;
+	}
+}
+
+void resizeUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay, int numberOfStations)
+{
+	char string[MAX_STRING];
+
+	// Stations past unloadingQuaySize are parked, so resizing only moves the boundary.
+	while (pUnloadingQuay->unloadingQuaySize != numberOfStations)
+	{
+		int isActivating = pUnloadingQuay->unloadingQuaySize < numberOfStations;
+		int stationIndex = isActivating ?
+			pUnloadingQuay->unloadingQuaySize : pUnloadingQuay->unloadingQuaySize - 1;
+
+		pUnloadingQuay->unloadingQuaySize += isActivating ? 1 : -1;
+
+		sprintf(string, "Crane  %2d - %s", pUnloadingQuay->unloadingQuayStation[stationIndex].craneId,
+			isActivating ? "activated" : "parked");
+
+		if (!safePrintWithTimeStamp(string))
+		{
+			fprintf(stderr, "EilatPort::resizeUnloadingQuay::Unexpected Error - Print failed!\n");
+		}
+	}
+}
+
+int getUnloadingQuayNumberOfCranes(UnloadingQuayStruct* pUnloadingQuay, int numberOfCranes)
 {
-	int divisor;
+	int numberOfQuayCranes = numberOfCranes / numberOfUnloadingQuays +
+		(pUnloadingQuay->quayIndex < numberOfCranes % numberOfUnloadingQuays);
 
-	do
+	// A vessel routed to the quay never waits for a parked crane to unload its cargo.
+	if (numberOfQuayCranes < pUnloadingQuay->minUnloadingQuaySize)
 	{
-		divisor = rand() % (dividendNumber - 2) + 2;
-	} while (dividendNumber % divisor != 0);
+		return pUnloadingQuay->minUnloadingQuaySize;
+	}
 
-	return divisor;
+	return numberOfQuayCranes > pUnloadingQuay->maxUnloadingQuaySize ?
+		pUnloadingQuay->maxUnloadingQuaySize : numberOfQuayCranes;
 }
 
-HANDLE* createCraneThreads(int numberOfCranes, int** cranesId)
+DWORD matchVesselsToStations(UnloadingQuayStruct* pUnloadingQuay, int batchSize)
 {
-	DWORD threadId;
-	*cranesId = (int*)malloc(numberOfCranes * sizeof(int));
-	HANDLE* cranesHandler = (HANDLE*)malloc(numberOfCranes * sizeof(HANDLE));
+	UnloadingQuayStation* stations = pUnloadingQuay->unloadingQuayStation;
+	DWORD freeStations = ((DWORD)1 << pUnloadingQuay->unloadingQuaySize) - 1;
+	DWORD matchedStations = 0;
 
-	if (*cranesId == NULL || cranesHandler == NULL)
+	// A crane which is failed or stalled takes no vessel till it is back up.
+	for (int i = 0; isFaultInjected && i < pUnloadingQuay->unloadingQuaySize; i++)
 	{
-		fprintf(stderr, "EilatPort::createCraneThreads::Unexpected Error -"
-			" Memory allocation failed!\n");
-		exit(EXIT_FAILURE);
+		if (craneFaults[pUnloadingQuay->firstCraneIndex + i].state != CRANE_UP)
+		{
+			freeStations &= ~((DWORD)1 << i);
+		}
 	}
 
-	// Create all Crane threads. ID starts with 1 till numberOfCranes.
-	for (int i = 1; i <= numberOfCranes; i++)
+	for (int i = 0; i < batchSize; i++)
 	{
-		int craneIndex = i - 1;
+		// Only vessels whose cargo a free station unloads may leave the barrier, so a vessel
+		// waiting for a busy kind of crane doesn't hold back the ones behind it.
+		DWORD cargoTypes = 0;
+		int cargoType = -1;
 
-		(*cranesId)[craneIndex] = i;
-		cranesHandler[craneIndex] =
-			CreateThread(NULL, 0, Crane, &(*cranesId)[craneIndex], 0, &threadId);
+		for (int j = 0; j < CARGO_TYPES; j++)
+		{
+			if (pUnloadingQuay->cargoStations[j] & freeStations)
+			{
+				cargoTypes |= 1 << j;
+			}
+		}
+
+		int berthIndex = cargoTypes == 0 ? -1 : dequeueFromBarrier(pUnloadingQuay->barrier, cargoTypes, &cargoType);
 
-		if (cranesHandler[craneIndex] == NULL)
+		if (berthIndex == -1)
 		{
-			fprintf(stderr, "EilatPort::createCraneThreads::Unexpected Error -"
-				" Crane thread %d creation failed!\n", (*cranesId)[craneIndex]);
-			exit(EXIT_FAILURE);
+			break;
+		}
+
+		DWORD cargoStations = pUnloadingQuay->cargoStations[cargoType] & freeStations;
+		int stationIndex = -1;
+
+		for (int j = 0; j < pUnloadingQuay->unloadingQuaySize; j++)
+		{
+			if (cargoStations & (DWORD)1 << j &&
+				(stationIndex == -1 || isBetterStationMatch(&stations[j], &stations[stationIndex])))
+			{
+				stationIndex = j;
+			}
+		}
+
+		// The vessel takes the station once it is signaled to enter the unloading quay.
+		stations[stationIndex].berthIndex = berthIndex;
+		stations[stationIndex].cargoType = cargoType;
+		stations[stationIndex].isOccupied = TRUE;
+		freeStations &= ~((DWORD)1 << stationIndex);
+		matchedStations |= (DWORD)1 << stationIndex;
+	}
+
+	return matchedStations;
+}
+
+int isBetterStationMatch(UnloadingQuayStation* station, UnloadingQuayStation* otherStation)
+{
+	int numberOfCargoTypes = 0, otherNumberOfCargoTypes = 0;
+
+	for (int i = 0; i < CARGO_TYPES; i++)
+	{
+		numberOfCargoTypes += (station->capabilities & 1 << i) != 0;
+		otherNumberOfCargoTypes += (otherStation->capabilities & 1 << i) != 0;
+	}
+
+	return numberOfCargoTypes < otherNumberOfCargoTypes ||
+		(numberOfCargoTypes == otherNumberOfCargoTypes && station->rate > otherStation->rate);
+}
+
+UnloadingQuayStruct* getCraneUnloadingQuay(int craneIndex)
+{
+	for (int i = numberOfUnloadingQuays - 1; i > 0; i--)
+	{
+		if (craneIndex >= unloadingQuays[i]->firstCraneIndex)
+		{
+			return unloadingQuays[i];
+		}
+	}
+
+	return unloadingQuays[0];
+}
+
+UnloadingQuayStruct* routeVesselToUnloadingQuay(int cargoType)
+{
+	UnloadingQuayStruct* cargoQuays[MAX_NUMBER_OF_QUAYS];
+	int numberOfCargoQuays = 0;
+
+	// Only quays with a crane which unloads the vessel's cargo may take it.
+	for (int i = 0; i < numberOfUnloadingQuays; i++)
+	{
+		if (unloadingQuays[i]->cargoTypes & 1 << cargoType)
+		{
+			cargoQuays[numberOfCargoQuays++] = unloadingQuays[i];
+		}
+	}
+
+	UnloadingQuayStruct* pUnloadingQuay = cargoQuays[0];
+
+	// Comment: the quays' lengths are read without a lock, so two vessels routed at once may
+	// both pick the same quay. Routing only has to be about even, not exact.
+	if (routingPolicy == ROUTE_TWO_CHOICES && numberOfCargoQuays > 1)
+	{
+		int firstChoice = safeRand() % numberOfCargoQuays;
+		int secondChoice = (firstChoice + 1 + safeRand() % (numberOfCargoQuays - 1)) % numberOfCargoQuays;
+
+		pUnloadingQuay = isShorterUnloadingQuay(cargoQuays[secondChoice], cargoQuays[firstChoice]) ?
+			cargoQuays[secondChoice] : cargoQuays[firstChoice];
+	}
+	else
+	{
+		for (int i = 1; i < numberOfCargoQuays; i++)
+		{
+			if (isShorterUnloadingQuay(cargoQuays[i], pUnloadingQuay))
+			{
+				pUnloadingQuay = cargoQuays[i];
+			}
+		}
+	}
+
+	// The quay counts the vessel before it leaves the vessels to route, so the quay's
+	// coordinator never sees itself as done while the vessel is on its way to the barrier.
+	InterlockedIncrement(&pUnloadingQuay->numberOfVesselsInQuay);
+	InterlockedIncrement(&pUnloadingQuay->numberOfRoutedVessels);
+	InterlockedIncrement(&pUnloadingQuay->numberOfVesselsToUnload);
+	InterlockedDecrement(&numberOfVesselsToRoute);
+
+	return pUnloadingQuay;
+}
+
+int isShorterUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay, UnloadingQuayStruct* pOtherUnloadingQuay)
+{
+	// Compares the vessels per active crane, multiplied across so no division is made.
+	return (LONGLONG)pUnloadingQuay->numberOfVesselsInQuay * pOtherUnloadingQuay->unloadingQuaySize <
+		(LONGLONG)pOtherUnloadingQuay->numberOfVesselsInQuay * pUnloadingQuay->unloadingQuaySize;
+}
+
+int isUnloadingQuayDone(UnloadingQuayStruct* pUnloadingQuay)
+{
+	return numberOfVesselsToRoute == 0 && pUnloadingQuay->numberOfVesselsToUnload == 0;
+}
+
+int getNumberOfVesselsToUnload(void)
+{
+	int numberOfVessels = numberOfVesselsToRoute;
+
+	for (int i = 0; i < numberOfUnloadingQuays; i++)
+	{
+		numberOfVessels += unloadingQuays[i]->numberOfVesselsToUnload;
+	}
+
+	return numberOfVessels;
+}
+
+int randomCargoWeight(void)
+{
+	return safeRand() % (MAX_WEIGHT - MIN_WEIGHT + 1) + MIN_WEIGHT;
+}
+
+int randomCargoType(void)
+{
+	int totalWeight = 0;
+
+	// Comment: without a mix nothing is drawn, so a run's random numbers are as they were
+	// before cargo had types.
+	if (!isCargoMixed)
+	{
+		return CARGO_CONTAINER;
+	}
+
+	for (int i = 0; i < CARGO_TYPES; i++)
+	{
+		totalWeight += cargoMix[i];
+	}
+
+	int draw = safeRand() % totalWeight;
+	int cargoType = 0;
+
+	while (draw >= cargoMix[cargoType])
+	{
+		draw -= cargoMix[cargoType++];
+	}
+
+	return cargoType;
+}
+
+void createRunArena(int numberOfVessels)
+{
+	const int maxNumberOfCranes = getMaxNumberOfCranes(numberOfVessels);
+	const int numberOfQuays = numberOfUnloadingQuays < maxNumberOfCranes ? numberOfUnloadingQuays : maxNumberOfCranes;
+	// Comment: a restarted port runs with the options of the port before the restart, so the vessels
+	// which held a credit then have as many berths as it had.
+	const SIZE_T numberOfBerths = getNumberOfBerths(numberOfVessels, maxNumberOfCranes, 0);
+	const SIZE_T numberOfCranes = maxNumberOfCranes;
+
+	runArenaNumberOfBerths = (int)numberOfBerths;
+	runArenaNumberOfCranes = (int)numberOfCranes;
+
+	// Every block the run takes from each region, as they are allocated from it at start-up.
+	SIZE_T hotRegionSize = numberOfQuays * (PORT_ARENA_ALIGN(sizeof(UnloadingQuayStruct)) +
+		PORT_ARENA_ALIGN(numberOfCranes * sizeof(UnloadingQuayStation)) + PORT_ARENA_ALIGN(sizeof(PriorityBarrier)) +
+		PORT_ARENA_ALIGN(sizeof(VesselNodePool) + numberOfBerths * sizeof(VesselNode)) +
+		NUMBER_OF_PRIORITY_CLASSES * CARGO_TYPES * PORT_ARENA_ALIGN(sizeof(VesselQueue))) +
+		PORT_ARENA_ALIGN(numberOfBerths * sizeof(WaitWord)) + 2 * PORT_ARENA_ALIGN(numberOfCranes * sizeof(WaitWord)) +
+		PORT_ARENA_ALIGN(numberOfBerths * sizeof(HandOffStamp)) + PORT_ARENA_ALIGN(numberOfCranes * sizeof(HandOffStamp)) +
+		PORT_ARENA_ALIGN(numberOfCranes * sizeof(CraneFault)) + PORT_ARENA_ALIGN(numberOfBerths * sizeof(int));
+	// Only a restarted port takes the journaled state of the fleet's vessels, and the records
+	// of its vessels in flight till they take their berths.
+	SIZE_T coldRegionSize = PORT_ARENA_ALIGN(numberOfBerths * sizeof(VesselRecord)) +
+		PORT_ARENA_ALIGN(numberOfCranes * sizeof(int)) + PORT_ARENA_ALIGN(numberOfCranes * sizeof(HANDLE)) +
+		(isRecovering ? PORT_ARENA_ALIGN(numberOfVessels * sizeof(int)) +
+			PORT_ARENA_ALIGN((numberOfBerths + 1) * sizeof(VesselRecord)) : 0);
+
+	// Comment: the arena's memory stays committed between a session's runs, a run with more
+	// berths or cranes takes a new arena.
+	if (runArena != NULL && !resetPortArena(runArena, hotRegionSize, coldRegionSize))
+	{
+		releasePortArena(runArena);
+		runArena = NULL;
+	}
+
+	if (runArena == NULL)
+	{
+		runArena = createPortArena(hotRegionSize, coldRegionSize);
+	}
+
+	if (runArena == NULL)
+	{
+		fprintf(stderr, "EilatPort::createRunArena::Unexpected Error - Arena creation failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	// Comment: the records are laid out together at start-up, since vessels arrive while
+	// the run goes on, when nothing may be allocated anymore.
+	vesselRecords = (VesselRecord*)allocateFromPortArena(runArena, PORT_ARENA_COLD,
+		numberOfBerths * sizeof(VesselRecord));
+
+	if (vesselRecords == NULL)
+	{
+		fprintf(stderr, "EilatPort::createRunArena::Unexpected Error - Memory allocation failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+void printRunArenaReport(void)
+{
+	char string[MAX_STRING];
+
+	sprintf(string, "Eilat Port: Run arena for %d berths and %d cranes - %Iu of %Iu bytes hot, "
+		"%Iu of %Iu bytes cold in %d allocations", runArenaNumberOfBerths, runArenaNumberOfCranes,
+		getPortArenaUsedSize(runArena, PORT_ARENA_HOT), runArena->regions[PORT_ARENA_HOT].reserved,
+		getPortArenaUsedSize(runArena, PORT_ARENA_COLD), runArena->regions[PORT_ARENA_COLD].reserved,
+		runArena->numberOfAllocations);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printRunArenaReport::Unexpected Error - Print failed!\n");
+	}
+}
+
+void printLockProfileReport(void)
+{
+#ifdef PORT_LOCK_PROFILER
+	char string[MAX_STRING];
+	char profileString[MAX_LOCK_PROFILE_STRING];
+	LockProfile* rankedProfiles[MAX_LOCK_PROFILES];
+	int numberOfProfiles = rankLockProfiles(rankedProfiles);
+
+	for (int i = 0; i < numberOfProfiles; i++)
+	{
+		formatLockProfile(profileString, rankedProfiles[i]);
+		sprintf(string, "Eilat Port: Lock %2d. %s", i + 1, profileString);
+
+		if (!safePrintWithTimeStamp(string))
+		{
+			fprintf(stderr, "EilatPort::printLockProfileReport::Unexpected Error - Print failed!\n");
+		}
+	}
+#endif
+}
+
+void initializeGlobalMutexAndSemaphores(int numberOfVessels, int numberOfBerths, int numberOfCranes)
+{
+	// Shared semaphore's names
+	WCHAR processSafePrintString[MAX_RUN_OBJECT_NAME];
+
+	getRunObjectName(processSafePrintString, L"ProcessSafePrint", runId);
+
+	randomMutex = CreateMutex(NULL, FALSE, NULL);
+	// Comment: in round trips every voyage's thread signals it, till the run is done.
+	vesselsDoneSemaphore = CreateSemaphore(NULL, 0, isRoundTrip ? MAXLONG : numberOfVessels, NULL);
+
+	// Open shared semaphores between HaifaPort and EilatPort.
+	suezCanal = openSuezCanal(runId);
+	processSafePrintSemaphore = OpenSemaphore(SEMAPHORE_ALL_ACCESS, FALSE, processSafePrintString);
+
+	if (randomMutex == NULL || vesselsDoneSemaphore == NULL || processSafePrintSemaphore == NULL ||
+		suezCanal == NULL)
+	{
+		fprintf(stderr, "EilatPort::initializeGlobalMutexAndSemaphores::Unexpected Error -"
+			" Mutex/Semaphore creation failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	// The arena's blocks are zeroed, so every wait word starts unsignaled.
+	vesselsWaitWords = (WaitWord*)allocateFromPortArena(runArena, PORT_ARENA_HOT, numberOfBerths * sizeof(WaitWord));
+	cranesWaitWords = (WaitWord*)allocateFromPortArena(runArena, PORT_ARENA_HOT, numberOfCranes * sizeof(WaitWord));
+	unloadingQuayWaitWords =
+		(WaitWord*)allocateFromPortArena(runArena, PORT_ARENA_HOT, numberOfCranes * sizeof(WaitWord));
+	vesselsHandOffStamps =
+		(HandOffStamp*)allocateFromPortArena(runArena, PORT_ARENA_HOT, numberOfBerths * sizeof(HandOffStamp));
+	cranesHandOffStamps =
+		(HandOffStamp*)allocateFromPortArena(runArena, PORT_ARENA_HOT, numberOfCranes * sizeof(HandOffStamp));
+
+	if (isFaultInjected)
+	{
+		craneFaults = (CraneFault*)allocateFromPortArena(runArena, PORT_ARENA_HOT, numberOfCranes * sizeof(CraneFault));
+	}
+
+	if (vesselsWaitWords == NULL || cranesWaitWords == NULL || unloadingQuayWaitWords == NULL ||
+		vesselsHandOffStamps == NULL || cranesHandOffStamps == NULL || (isFaultInjected && craneFaults == NULL))
+	{
+		fprintf(stderr, "EilatPort::initializeGlobalMutexAndSemaphores::Unexpected Error -"
+			" Memory allocation failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+void cleanGlobalMutexAndSemaphores(void)
+{
+	CloseHandle(randomMutex);
+	CloseHandle(vesselsDoneSemaphore);
+	closeSuezCanal(suezCanal);
+	CloseHandle(processSafePrintSemaphore);
+}
+
+int getNumberOfVesselsFromHaifaPort(void)
+{
+	// Read number of vessels incoming from HaifaPort.
+	if (!readMessage(fromHaifaChannel, buffer))
+	{
+		fprintf(stderr, "EilatPort::Main::Unexpected Error - "
+			"Reading number of vessels from 'Med Sea. ==> Red Sea' pipe failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	return atoi(buffer);
+}
+
+int writeToHaifaPortPassageResult(int numberOfVessels)
+{
+	GetLocalTime(&currentTime);
+	fprintf(stderr, "[%02d:%02d:%02d] Eilat Port: "
+		"Proccessing passage approval for %d vessels...\n",
+		currentTime.wHour, currentTime.wMinute, currentTime.wSecond, numberOfVessels);
+
+	// Comment: batches are cut short by the flush timeout and by the vessels left to unload, so the
+	// fleet needn't divide between the cranes, any fleet with a crane may pass.
+	int passageResult = getMaxNumberOfCranes(numberOfVessels) >= 1;
+
+	GetLocalTime(&currentTime);
+	fprintf(stderr, "[%02d:%02d:%02d] Eilat Port: passage for %d vessels %s!\n",
+		currentTime.wHour, currentTime.wMinute, currentTime.wSecond, numberOfVessels,
+		passageResult ? "approved" : "denied");
+
+	sprintf(buffer, "%d", passageResult);
+
+	// Writing passage result to 'Med. Sea <== Red Sea' pipe
+	if (!writeMessage(toHaifaChannel, buffer))
+	{
+		fprintf(stderr, "EilatPort::writeToHaifaPortPassageResult::Unexpected Error -"
+			" Writing passage result to 'Med. Sea <== Red Sea' pipe failed\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	return passageResult;
+}
+
+int getMaxNumberOfCranes(int numberOfVessels)
+{
+	return numberOfVessels - 1 < MAX_NUMBER_OF_CRANES ? numberOfVessels - 1 : MAX_NUMBER_OF_CRANES;
+}
+
+int getRandomNumberOfCranes(int numberOfVessels)
+{
+	return rand() % getMaxNumberOfCranes(numberOfVessels) + 1;
+}
+
+HANDLE* createCraneThreads(int numberOfCranes, int** cranesId)
+{
+	DWORD threadId;
+	*cranesId = (int*)allocateFromPortArena(runArena, PORT_ARENA_COLD, numberOfCranes * sizeof(int));
+	HANDLE* cranesHandler =
+		(HANDLE*)allocateFromPortArena(runArena, PORT_ARENA_COLD, numberOfCranes * sizeof(HANDLE));
+
+	if (*cranesId == NULL || cranesHandler == NULL)
+	{
+		fprintf(stderr, "EilatPort::createCraneThreads::Unexpected Error -"
+			" Memory allocation failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	// Create all Crane threads. ID starts with 1 till numberOfCranes.
+	for (int i = 1; i <= numberOfCranes; i++)
+	{
+		int craneIndex = i - 1;
+
+		(*cranesId)[craneIndex] = i;
+		craneKinds[craneIndex % numberOfCraneKinds].numberOfCranes++;
+		cranesHandler[craneIndex] =
+			CreateThread(NULL, 0, Crane, &(*cranesId)[craneIndex], 0, &threadId);
+
+		if (cranesHandler[craneIndex] == NULL ||
+			!placeThread(cranesHandler[craneIndex], PLACEMENT_CRANE, craneIndex))
+		{
+			fprintf(stderr, "EilatPort::createCraneThreads::Unexpected Error -"
+				" Crane thread %d creation or placement failed!\n", (*cranesId)[craneIndex]);
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+
+	return cranesHandler;
+}
+
+void createUnloadingQuayThreads(HANDLE unloadingQuayHandlers[], int numberOfVessels)
+{
+	DWORD threadId;
+
+	numberOfVesselsToRoute = numberOfVessels;
+
+	for (int i = 0; i < numberOfUnloadingQuays; i++)
+	{
+		unloadingQuayHandlers[i] =
+			CreateThread(NULL, 0, UnloadingQuay, unloadingQuays[i], 0, &threadId);
+
+		if (unloadingQuayHandlers[i] == NULL ||
+			!placeThread(unloadingQuayHandlers[i], PLACEMENT_COORDINATOR, i))
+		{
+			fprintf(stderr, "EilatPort::createUnloadingQuayThreads::Unexpected Error -"
+				" unloadingQuayHandle thread creation or placement failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+
+		// Set threads prioirty to be the highest, so when the barrier has reached
+		// an amount that is allowed to unload, the unloading quay will set in motion
+		// immediately 
+		if (!SetThreadPriority(unloadingQuayHandlers[i], THREAD_PRIORITY_HIGHEST))
+		{
+			fprintf(stderr, "EilatPort::createUnloadingQuayThreads::Unexpected Error -"
+				" thread priority failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+}
+
+void createCranePoolControllerThread(HANDLE* cranePoolControllerHandler, int numberOfCranes,
+	int maxNumberOfCranes)
+{
+	DWORD threadId;
+
+	// Every quay keeps a crane active at least.
+	cranePoolController.minNumberOfCranes = numberOfUnloadingQuays > MIN_NUMBER_OF_ACTIVE_CRANES ?
+		numberOfUnloadingQuays : MIN_NUMBER_OF_ACTIVE_CRANES;
+	cranePoolController.maxNumberOfCranes = maxNumberOfCranes;
+	cranePoolController.requestedNumberOfCranes = numberOfCranes;
+
+	*cranePoolControllerHandler =
+		CreateThread(NULL, 0, CranePoolController, &cranePoolController, 0, &threadId);
+
+	if (*cranePoolControllerHandler == NULL ||
+		!placeThread(*cranePoolControllerHandler, PLACEMENT_HELPER, 0))
+	{
+		fprintf(stderr, "EilatPort::createCranePoolControllerThread::Unexpected Error -"
+			" crane pool controller thread creation or placement failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+void createFaultSupervisorThread(HANDLE* faultSupervisorHandler, int numberOfCranes)
+{
+	DWORD threadId;
+
+	*faultSupervisorHandler = NULL;
+
+	if (!isFaultInjected)
+	{
+		return;
+	}
+
+	if (!startFaultInjector(&faultInjector, craneFaults, numberOfCranes, randomSeed))
+	{
+		fprintf(stderr, "EilatPort::createFaultSupervisorThread::Error - "
+			"-faults names a crane past the port's %d cranes!\n", numberOfCranes);
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	*faultSupervisorHandler = CreateThread(NULL, 0, FaultSupervisor, &faultInjector, 0, &threadId);
+
+	if (*faultSupervisorHandler == NULL || !placeThread(*faultSupervisorHandler, PLACEMENT_HELPER, 0))
+	{
+		fprintf(stderr, "EilatPort::createFaultSupervisorThread::Unexpected Error -"
+			" fault supervisor thread creation or placement failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+int getNumberOfBerths(int numberOfVessels, int maxNumberOfCranes, int numberOfHeldBerths)
+{
+	const int numberOfQuays = numberOfUnloadingQuays < maxNumberOfCranes ? numberOfUnloadingQuays : maxNumberOfCranes;
+	int numberOfBatchBerths = 0;
+
+	// A quay's batch is bounded by its stations, and its cranes are shared out as in runEilatPort.
+	for (int i = 0; i < numberOfQuays; i++)
+	{
+		int numberOfQuayCranes = maxNumberOfCranes / numberOfQuays + (i < maxNumberOfCranes % numberOfQuays);
+
+		numberOfBatchBerths += batchAdmission.maxBatchSize < numberOfQuayCranes ? batchAdmission.maxBatchSize :
+			numberOfQuayCranes;
+	}
+
+	// Comment: a barrier which never flushes waits for its full batch, and the vessels it waits
+	// for can't sail without a credit, so fewer credits than a batch for every quay deadlock.
+	if (requestedNumberOfCredits > 0 && requestedNumberOfCredits < numberOfBatchBerths &&
+		batchAdmission.flushTimeout == 0 && numberOfVessels > requestedNumberOfCredits)
+	{
+		fprintf(stderr, "EilatPort::getNumberOfBerths::Error - With -flush 0, -credits must be at least %d, "
+			"a full batch for every quay!\n", numberOfBatchBerths);
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	int numberOfBerths = requestedNumberOfCredits ? requestedNumberOfCredits : maxNumberOfCranes + numberOfBatchBerths;
+
+	if (numberOfBerths > numberOfVessels)
+	{
+		numberOfBerths = numberOfVessels;
+	}
+
+	// Every vessel which holds a credit from before a restart must have a berth.
+	return numberOfBerths > numberOfHeldBerths ? numberOfBerths : numberOfHeldBerths;
+}
+
+void initializeTransitCredits(int numberOfBerths)
+{
+	transitCredits.numberOfBerths = numberOfBerths;
+	transitCredits.numberOfFreeBerths = numberOfBerths;
+	transitCredits.freeBerths = (int*)allocateFromPortArena(runArena, PORT_ARENA_HOT, numberOfBerths * sizeof(int));
+	transitCredits.berthsMutex = CreateMutex(NULL, FALSE, NULL);
+
+	if (transitCredits.freeBerths == NULL || transitCredits.berthsMutex == NULL)
+	{
+		fprintf(stderr, "EilatPort::initializeTransitCredits::Unexpected Error - "
+			"Memory allocation or mutex creation failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < numberOfBerths; i++)
+	{
+		transitCredits.freeBerths[i] = numberOfBerths - 1 - i;
+	}
+}
+
+void destructTransitCredits(void)
+{
+	CloseHandle(transitCredits.berthsMutex);
+}
+
+int takeBerth(void)
+{
+	waitForProfiledObject(&berthsMutexProfile, transitCredits.berthsMutex, INFINITE);
+
+	// HaifaPort only sends a vessel with a credit, so a berth is always free for it.
+	if (transitCredits.numberOfFreeBerths == 0)
+	{
+		fprintf(stderr, "EilatPort::takeBerth::Unexpected Error - "
+			"A vessel arrived without a transit credit!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	int berthIndex = transitCredits.freeBerths[--transitCredits.numberOfFreeBerths];
+	int numberOfVesselsInPort = transitCredits.numberOfBerths - transitCredits.numberOfFreeBerths;
+
+	if (numberOfVesselsInPort > transitCredits.maxNumberOfVesselsInPort)
+	{
+		transitCredits.maxNumberOfVesselsInPort = numberOfVesselsInPort;
+	}
+
+	releaseProfiledMutex(&berthsMutexProfile, transitCredits.berthsMutex);
+
+	return berthIndex;
+}
+
+void freeBerth(int berthIndex)
+{
+	waitForProfiledObject(&berthsMutexProfile, transitCredits.berthsMutex, INFINITE);
+	transitCredits.freeBerths[transitCredits.numberOfFreeBerths++] = berthIndex;
+	transitCredits.numberOfGrantedCredits++;
+	releaseProfiledMutex(&berthsMutexProfile, transitCredits.berthsMutex);
+}
+
+void grantTransitCredits(int numberOfCredits)
+{
+	// Vessel ID 0 is a message which only grants credits.
+	sprintf(buffer, "%d %d", 0, numberOfCredits);
+
+	if (!writeMessage(toHaifaChannel, buffer))
+	{
+		fprintf(stderr, "EilatPort::grantTransitCredits::Unexpected Error - "
+			"Writing credits to 'Med. Sea <== Red Sea' pipe failed\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	transitCredits.numberOfGrantedCredits += numberOfCredits;
+}
+
+void printTransitCreditReport(void)
+{
+	char string[MAX_STRING];
+
+	sprintf(string, "Eilat Port: Transit credits - %d berths, %d credits granted,"
+		" at most %d vessels in port", transitCredits.numberOfBerths,
+		transitCredits.numberOfGrantedCredits, transitCredits.maxNumberOfVesselsInPort);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printTransitCreditReport::Unexpected Error - Print failed!\n");
+	}
+}
+
+void printPlacementReport(void)
+{
+	char string[MAX_STRING];
+
+	// Jitter is how much longer the slow hand-offs take than the typical one.
+	ULONGLONG medianHandOff = getLatencyPercentile(&handOffHistogram, 50);
+	ULONGLONG tailHandOff = getLatencyPercentile(&handOffHistogram, 99);
+
+	sprintf(string, "Eilat Port: Placement %s on %d cores - %ld hand-offs, p50 %llu us, p99 %llu us,"
+		" jitter %llu us", getThreadPlacementPolicyName(threadPlacementPolicy), getNumberOfPlacementCores(),
+		handOffHistogram.numberOfSamples, medianHandOff, tailHandOff, tailHandOff - medianHandOff);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printPlacementReport::Unexpected Error - Print failed!\n");
+	}
+}
+
+void openStorageYardAndPlaceWorkers(void)
+{
+	if (storageYardCapacity == 0)
+	{
+		return;
+	}
+
+	storageYard = openStorageYard(storageYardCapacity, storageYardWorkers);
+
+	if (storageYard == NULL)
+	{
+		fprintf(stderr, "EilatPort::openStorageYardAndPlaceWorkers::Unexpected Error - "
+			"Storage yard opening failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	// The workers mostly sleep while they haul, so they float like the other helpers.
+	for (int i = 0; i < storageYard->numberOfWorkerHandles; i++)
+	{
+		if (!placeThread(storageYard->workerHandles[i], PLACEMENT_HELPER, i))
+		{
+			fprintf(stderr, "EilatPort::openStorageYardAndPlaceWorkers::Unexpected Error - "
+				"Worker placement failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+}
+
+void printStorageYardReport(void)
+{
+	char string[MAX_STRING];
+
+	if (storageYard == NULL)
+	{
+		return;
+	}
+
+	sprintf(string, "Eilat Port: Storage yard - %d tons, %lld deposited, %lld hauled by truck, %lld by rail,"
+		" peak %d tons, average fill %.0f%%", storageYard->capacity, storageYard->numberOfDepositedTons,
+		storageYard->numberOfDrainedTons[STORAGE_YARD_TRUCK], storageYard->numberOfDrainedTons[STORAGE_YARD_RAIL],
+		storageYard->peakStock, getStorageYardAverageFill(storageYard) * 100.0);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printStorageYardReport::Unexpected Error - Print failed!\n");
+	}
+
+	sprintf(string, "Eilat Port: Storage yard - %d of %d deposits blocked the crane, %.1f s in total,"
+		" %llu ms at most", storageYard->numberOfBlockedDeposits, storageYard->numberOfDeposits,
+		storageYard->blockedTime / 1000.0, storageYard->maxBlockedTime);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printStorageYardReport::Unexpected Error - Print failed!\n");
+	}
+}
+
+void initializeCargoMix(int numberOfCranes)
+{
+	DWORD portCargoTypes = 0;
+	int totalWeight = 0;
+
+	if (!isCargoMixed)
+	{
+		return;
+	}
+
+	// Comment: a fleet with fewer cranes than kinds has only the first kinds.
+	for (int i = 0; i < numberOfCraneKinds && i < numberOfCranes; i++)
+	{
+		portCargoTypes |= craneKinds[i].capabilities;
+	}
+
+	for (int i = 0; i < CARGO_TYPES; i++)
+	{
+		totalWeight += cargoMix[i];
+	}
+
+	// Without -cargo the vessels carry every cargo the port's cranes unload, in equal shares.
+	for (int i = 0; i < CARGO_TYPES; i++)
+	{
+		if (totalWeight == 0 && portCargoTypes & 1 << i)
+		{
+			cargoMix[i] = 1;
+		}
+
+		if (cargoMix[i] > 0 && !(portCargoTypes & 1 << i))
+		{
+			fprintf(stderr, "EilatPort::initializeCargoMix::Error - "
+				"None of the %d cranes unloads %s cargo!\n", numberOfCranes, getCargoTypeName(i));
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+}
+
+void printCraneKindReport(ULONGLONG runTime)
+{
+	char string[MAX_STRING];
+	char cargoTypes[MAX_STRING];
+	int numberOfDeferredVessels = 0;
+
+	if (!isCargoMixed)
+	{
+		return;
+	}
+
+	for (int i = 0; i < numberOfCraneKinds; i++)
+	{
+		CraneKind* craneKind = &craneKinds[i];
+
+		if (craneKind->numberOfCranes == 0)
+		{
+			continue;
+		}
+
+		formatCargoTypes(cargoTypes, craneKind->capabilities);
+		sprintf(string, "Eilat Port: Crane kind %d (%s at %d%%) - %d cranes, %ld vessels, %lld tons, "
+			"utilization %.0f%%", i + 1, cargoTypes, craneKind->rate, craneKind->numberOfCranes,
+			craneKind->numberOfUnloadedVessels, craneKind->numberOfUnloadedTons, runTime == 0 ? 0.0 :
+			craneKind->busyTime * 100.0 / ((double)craneKind->numberOfCranes * runTime));
+
+		if (!safePrintWithTimeStamp(string))
+		{
+			fprintf(stderr, "EilatPort::printCraneKindReport::Unexpected Error - Print failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+
+	for (int i = 0; i < CARGO_TYPES; i++)
+	{
+		if (numberOfCargoVessels[i] == 0)
+		{
+			continue;
+		}
+
+		sprintf(string, "Eilat Port: Cargo %s - %ld vessels, average barrier wait %.0f ms", getCargoTypeName(i),
+			numberOfCargoVessels[i], (double)cargoBarrierWaitTime[i] / numberOfCargoVessels[i]);
+
+		if (!safePrintWithTimeStamp(string))
+		{
+			fprintf(stderr, "EilatPort::printCraneKindReport::Unexpected Error - Print failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+
+	for (int i = 0; i < numberOfUnloadingQuays; i++)
+	{
+		numberOfDeferredVessels += unloadingQuays[i]->numberOfDeferredVessels;
+	}
+
+	sprintf(string, "Eilat Port: %d times a vessel stayed in the barrier while no free crane unloaded its cargo",
+		numberOfDeferredVessels);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printCraneKindReport::Unexpected Error - Print failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+void printCargoLedgerReport(ULONGLONG runTime)
+{
+	char string[MAX_STRING];
+	CargoLedgerEntry entry;
+
+	if (cargoLedger == NULL)
+	{
+		return;
+	}
+
+	// A row for every crane, then the whole port's, merged from the cranes.
+	for (int i = 0; i <= cargoLedger->numberOfCranes; i++)
+	{
+		if (i < cargoLedger->numberOfCranes)
+		{
+			readCraneLedger(&cargoLedger->craneLedgers[i], &entry);
+			sprintf(string, "Eilat Port: Ledger crane %2d - ", i + 1);
+		}
+		else
+		{
+			mergeCargoLedger(cargoLedger, &entry);
+			sprintf(string, "Eilat Port: Ledger total    - ");
+		}
+
+		sprintf(string + strlen(string), "%ld vessels, %lld tons, busy %lld ms (%lld lost), idle %lld ms, "
+			"%.2f tons per second", entry.numberOfUnloadedVessels, entry.numberOfUnloadedTons, entry.busyTime,
+			entry.lostTime, entry.idleTime,
+			runTime == 0 ? 0.0 : entry.numberOfUnloadedTons * 1000.0 / runTime);
+
+		if (!safePrintWithTimeStamp(string))
+		{
+			fprintf(stderr, "EilatPort::printCargoLedgerReport::Unexpected Error - Print failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+
+	if (!writeCargoLedgerSeries(cargoLedger, cargoLedgerFileName))
+	{
+		fprintf(stderr, "EilatPort::printCargoLedgerReport::Unexpected Error - "
+			"Writing the ledger to '%s' failed!\n", cargoLedgerFileName);
+	}
+}
+
+void printFaultReport(ULONGLONG runTime)
+{
+	char string[MAX_STRING];
+
+	if (!isFaultInjected)
+	{
+		return;
+	}
+
+	sprintf(string, "Eilat Port: Faults - %d crane failures, %d crane stalls, %llu ms of crane down time, "
+		"%d vessels moved, %d canal lane failures", faultInjector.numberOfCraneFailures,
+		faultInjector.numberOfCraneStalls, getCraneDownTime(&faultInjector), faultInjector.numberOfMovedVessels,
+		faultInjector.numberOfLaneFailures);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printFaultReport::Unexpected Error - Print failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	sprintf(string, "Eilat Port: Faults - %ld vessels at %.2f vessels per second, turnaround p99 %llu ms",
+		fleetTurnaroundHistogram.numberOfSamples, runTime == 0 ? 0.0 :
+		fleetTurnaroundHistogram.numberOfSamples * 1000.0 / runTime,
+		getLatencyPercentile(&fleetTurnaroundHistogram, 99.0));
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printFaultReport::Unexpected Error - Print failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+int readAndCreateIncomingVesselsFromHaifaPort(int numberOfVessels)
+{
+	DWORD threadId;
+	VesselRecord arrivingVessel;
+	int numberOfArrivedVessels = 0;
+
+	// Read incoming vessels from HaifaPort and create threads according to their ID.
+	// In round trips a vessel arrives on every voyage, till HaifaPort ends them with vessel ID 0.
+	while (isRoundTrip || numberOfArrivedVessels < numberOfVessels)
+	{
+		// Receive vessel's ID, cargo weight, priority and slot through the 'Med. Sea ==> Red Sea' pipe.
+		beginStallWait("fromHaifaChannel");
+
+		int isRead = readMessage(fromHaifaChannel, buffer);
+
+		endStallWait();
+
+		if (!isRead)
+		{
+			fprintf(stderr, "EilatPort::readAndCreateIncomingVesselsFromHaifaPort::Unexptected Error -"
+				" reading vessel from 'Med. Sea ==> Red Sea' pipe failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+
+		if (sscanf(buffer, "%d %d %d %d", &arrivingVessel.vesselId, &arrivingVessel.cargoWeight,
+			&arrivingVessel.priority, &arrivingVessel.haifaPortSlot) != 4)
+		{
+			fprintf(stderr, "EilatPort::readAndCreateIncomingVesselsFromHaifaPort::Unexpected Error -"
+				" malformed vessel message '%s'!\n", buffer);
+			stopEilatPort(EXIT_FAILURE);
+		}
+
+		if (isRoundTrip && arrivingVessel.vesselId == 0)
+		{
+			// Release the quays' hold, they are done once the vessels which arrived are unloaded.
+			InterlockedDecrement(&numberOfVesselsToRoute);
+			break;
+		}
+
+		// The vessel takes the record of the berth its credit holds.
+		int berthIndex = takeBerth();
+		VesselRecord* vesselRecord = &vesselRecords[berthIndex];
+
+		memset(vesselRecord, 0, sizeof(VesselRecord));
+		vesselRecord->vesselId = arrivingVessel.vesselId;
+		vesselRecord->cargoWeight = arrivingVessel.cargoWeight;
+		vesselRecord->priority = arrivingVessel.priority;
+		vesselRecord->haifaPortSlot = arrivingVessel.haifaPortSlot;
+		vesselRecord->arrivalTime = GetTickCount64();
+		vesselRecord->journalState = VESSEL_JOURNAL_NONE;
+		vesselRecord->berthIndex = berthIndex;
+
+		// The vessel is counted before its thread runs, so no quay is done while it is on its way.
+		if (isRoundTrip)
+		{
+			InterlockedIncrement(&numberOfVesselsToRoute);
+		}
+
+		HANDLE vesselHandler = CreateThread(NULL, 0, Vessel, vesselRecord, 0, &threadId);
+
+		if (vesselHandler == NULL || !placeThread(vesselHandler, PLACEMENT_VESSEL, vesselRecord->vesselId - 1))
+		{
+			fprintf(stderr, "EilatPort::readAndCreateIncomingVesselsFromHaifaPort::Unexpected Error -" 
+				"Vessel thread %d creation or placement failed!\n", vesselRecord->vesselId);
+			stopEilatPort(EXIT_FAILURE);
+		}
+
+		// The vessel signals vesselsDoneSemaphore when done, its handle isn't needed.
+		CloseHandle(vesselHandler);
+
+		numberOfArrivedVessels++;
+	}
+
+	return numberOfArrivedVessels;
+}
+
+void openJournalAndRecoverVessels(RecoveryStruct* recovery, int numberOfVessels)
+{
+	if (journalFileName == NULL)
+	{
+		return;
+	}
+
+	// Last journaled state of each vessel, only taken when recovering.
+	int* vesselStates = isRecovering ?
+		(int*)allocateFromPortArena(runArena, PORT_ARENA_COLD, numberOfVessels * sizeof(int)) : NULL;
+
+	if (isRecovering && vesselStates == NULL)
+	{
+		fprintf(stderr, "EilatPort::openJournalAndRecoverVessels::Unexpected Error - "
+			"Memory allocation failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	journal = openVesselJournal(journalFileName, numberOfVessels * VESSEL_JOURNAL_STATES,
+		isRecovering, vesselStates, numberOfVessels);
+
+	if (journal == NULL)
+	{
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	if (isRecovering)
+	{
+		readVesselsInFlightFromHaifaPort(recovery, vesselStates, numberOfVessels);
+	}
+}
+
+void readVesselsInFlightFromHaifaPort(RecoveryStruct* recovery, int vesselStates[], int numberOfVessels)
+{
+	char string[MAX_STRING];
+
+	// HaifaPort first sends how many vessels are in flight, how many have returned
+	// and how many credits its vessels hold.
+	if (!readMessage(fromHaifaChannel, buffer) ||
+		sscanf(buffer, "%d %d %d", &recovery->numberOfVesselsInFlight,
+			&recovery->numberOfReturnedVessels, &recovery->numberOfReservedCredits) != 3)
+	{
+		fprintf(stderr, "EilatPort::readVesselsInFlightFromHaifaPort::Unexpected Error - "
+			"reading vessels in flight from 'Med. Sea ==> Red Sea' pipe failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	// Comment: every vessel in flight holds a credit, so the arena has a record for each of them
+	// as long as they fit in the berths.
+	recovery->vesselsInFlight = (VesselRecord*)allocateFromPortArena(runArena, PORT_ARENA_COLD,
+		(recovery->numberOfVesselsInFlight + 1) * sizeof(VesselRecord));
+
+	if (recovery->vesselsInFlight == NULL)
+	{
+		fprintf(stderr, "EilatPort::readVesselsInFlightFromHaifaPort::Unexpected Error - "
+			"Memory allocation failed, more vessels in flight than berths!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < recovery->numberOfVesselsInFlight; i++)
+	{
+		VesselRecord* vesselRecord = &recovery->vesselsInFlight[i];
+
+		if (!readMessage(fromHaifaChannel, buffer) ||
+			sscanf(buffer, "%d %d %d %d", &vesselRecord->vesselId, &vesselRecord->cargoWeight,
+				&vesselRecord->priority, &vesselRecord->haifaPortSlot) != 4 ||
+			vesselRecord->vesselId < 1 || vesselRecord->vesselId > numberOfVessels)
+		{
+			fprintf(stderr, "EilatPort::readVesselsInFlightFromHaifaPort::Unexpected Error - "
+				"reading vessel in flight from 'Med. Sea ==> Red Sea' pipe failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+
+		vesselRecord->arrivalTime = GetTickCount64();
+		vesselRecord->journalState = vesselStates[vesselRecord->vesselId - 1];
+
+		// Vessels which finished unloading before the restart don't pass the unloading quay again.
+		if (vesselRecord->journalState < VESSEL_JOURNAL_UNLOADED)
+		{
+			recovery->numberOfVesselsToUnload++;
+		}
+
+	}
+
+	sprintf(string, "Eilat Port: Recovered %d vessels in flight from the journal, %d of them unloaded",
+		recovery->numberOfVesselsInFlight,
+		recovery->numberOfVesselsInFlight - recovery->numberOfVesselsToUnload);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::readVesselsInFlightFromHaifaPort::Unexpected Error - "
+			"Print failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+void createRecoveredVesselThreads(RecoveryStruct* recovery)
+{
+	DWORD threadId;
+
+	for (int i = 0; i < recovery->numberOfVesselsInFlight; i++)
+	{
+		// The vessel takes the record of the berth its credit holds.
+		int berthIndex = takeBerth();
+		VesselRecord* vesselRecord = &vesselRecords[berthIndex];
+
+		*vesselRecord = recovery->vesselsInFlight[i];
+		vesselRecord->berthIndex = berthIndex;
+
+		HANDLE vesselHandler = CreateThread(NULL, 0, Vessel, vesselRecord, 0, &threadId);
+
+		if (vesselHandler == NULL || !placeThread(vesselHandler, PLACEMENT_VESSEL, vesselRecord->vesselId - 1))
+		{
+			fprintf(stderr, "EilatPort::createRecoveredVesselThreads::Unexpected Error - "
+				"Vessel thread %d creation or placement failed!\n", vesselRecord->vesselId);
+			stopEilatPort(EXIT_FAILURE);
+		}
+
+		// The vessel signals vesselsDoneSemaphore when done, its handle isn't needed.
+		CloseHandle(vesselHandler);
+	}
+
+	recovery->vesselsInFlight = NULL;
+}
+
+void writeVesselStateToJournal(int vesselId, int state, int isDurable)
+{
+	if (journal == NULL)
+	{
+		return;
+	}
+
+	LONG sequence = appendVesselJournalRecord(journal, vesselId, state);
+
+	if (sequence == 0)
+	{
+		fprintf(stderr, "EilatPort::Vessel %2d::writeVesselStateToJournal::Unexpected Error - "
+			"The journal is full!\n", vesselId);
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	if (isDurable && !waitForVesselJournalCommit(journal, sequence))
+	{
+		fprintf(stderr, "EilatPort::Vessel %2d::writeVesselStateToJournal::Unexpected Error - "
+			"Committing the journal failed!\n", vesselId);
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+void printJournalReport(int numberOfVessels)
+{
+	char string[MAX_STRING];
+
+	if (journal == NULL)
+	{
+		return;
+	}
+
+	int numberOfRecords = journal->numberOfReservedRecords - journal->numberOfRecoveredRecords;
+
+	sprintf(string, "Eilat Port: Journal - %d records in %d commits (%.1f per commit),"
+		" %.3f ms overhead per vessel", numberOfRecords, journal->numberOfCommits,
+		journal->numberOfCommits ? (double)numberOfRecords / journal->numberOfCommits : 0.0,
+		numberOfVessels ? getVesselJournalOverhead(journal) / numberOfVessels : 0.0);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printJournalReport::Unexpected Error - Print failed!\n");
+	}
+}
+
+void closeJournal(void)
+{
+	if (journal != NULL)
+	{
+		closeVesselJournal(journal);
+		journal = NULL;
+	}
+}
+
+void waitForVesselThreads(int numberOfVessels)
+{
+	char string[MAX_STRING];
+
+	// By using a loop on WaitForSingleObject we are able to lower the 
+	// semaphore's counter by the number of vessels.
+	for (int i = 0; i < numberOfVessels; i++)
+	{
+		waitForProfiledObject(&vesselsDoneSemaphoreProfile, vesselsDoneSemaphore, INFINITE);
+	}
+
+	sprintf(string, "Eilat Port: All Vessel Threads are done");
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::waitForVesselThreads::Unexpected Error - Print failed!\n");
+	}
+}
+
+int areAllVesselsDoneatHaifaPort(void)
+{
+	// Check that all vessel threads are done in HaifaPort.
+	// Comment: This command operates more as a cosmetic reason, since when the last thread 
+	// has returend to HaifaPort, EilatPort will start its printing ending messages. 
+	// With this EilatPort will wait till the end of all vessel's messages.
+	beginStallWait("fromHaifaChannel");
+
+	int isRead = readMessage(fromHaifaChannel, buffer);
+
+	endStallWait();
+
+	if (!isRead)
+	{
+		fprintf(stderr, "EilatPort::areAllVesselsDoneatHaifaPort::Unexptected Error -"
+			" Reading all vessels ended has failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	if (!atoi(buffer))
+	{
+		fprintf(stderr, "EilatPort::areAllVesselsDoneatHaifaPort::Unexptected Error -"
+			" Vessels in HaifaPort still exist!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	return TRUE;
+}
+
+void signalCranesToFinish(int numberOfCranes)
+{
+	// Signal cranes to continue so they can end.
+	for (int i = 0; i < numberOfCranes; i++)
+	{
+		if (!signalProfiledWord(&cranesWaitWordsProfile, &cranesWaitWords[i]))
+		{
+			fprintf(stderr, "EilatPort::signalCranesToFinish::Unexpected Error -"
+				" cranesWaitWords[%d].V()\n", i);
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+}
+
+void freeCraneThreads(HANDLE* cranesHandler, int numberOfCranes)
+{
+	char string[MAX_STRING];
+
+	// Close all crane Handles, their memory is released with the run's arena.
+	for (int i = 0; i < numberOfCranes; i++)
+	{
+		if (!CloseHandle(cranesHandler[i]))
+		{
+			fprintf(stderr, "EilatPort::freeCraneThreads::Unexptected Error -"
+				" CloseHandle(cranesHandler[%d])\n", i);
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+
+	sprintf(string, "Eilat Port: All Crane Threads are done");
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::freeCraneThreads::Unexpected Error -"
+			" Print failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+void cleanUnloadingQuaysAndBarriers(HANDLE unloadingQuayHandlers[])
+{
+	// Close the unloading quays' Handles, their memory is released with the run's arena.
+	for (int i = 0; i < numberOfUnloadingQuays; i++)
+	{
+		CloseHandle(unloadingQuayHandlers[i]);
+		CloseHandle(unloadingQuays[i]->barrier->mutex);
+		CloseHandle(unloadingQuays[i]->barrier->semaphore);
+		CloseHandle(unloadingQuays[i]->stationMutex);
+	}
+}
+
+void printTurnaroundReport(void)
+{
+	char string[MAX_STRING];
+
+	for (int i = 0; i < NUMBER_OF_PRIORITY_CLASSES; i++)
+	{
+		if (turnaroundHistogram[i].numberOfSamples == 0)
+		{
+			continue;
+		}
+
+		sprintf(string, "Eilat Port: Priority class %d - %ld vessels, turnaround "
+			"p50 %llu ms, p99 %llu ms, max %ld ms", i, turnaroundHistogram[i].numberOfSamples,
+			getLatencyPercentile(&turnaroundHistogram[i], 50.0),
+			getLatencyPercentile(&turnaroundHistogram[i], 99.0),
+			turnaroundHistogram[i].maxLatency);
+
+		if (!safePrintWithTimeStamp(string))
+		{
+			fprintf(stderr, "EilatPort::printTurnaroundReport::Unexpected Error -"
+				" Print failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+}
+
+void printCranePoolReport(void)
+{
+	char string[MAX_STRING];
+
+	sprintf(string, "Eilat Port: Crane pool %d-%d cranes, %d activated, %d parked, "
+		"barrier wait p50 %llu ms, p99 %llu ms", cranePoolController.minNumberOfCranes,
+		cranePoolController.maxNumberOfCranes, cranePoolController.numberOfActivations,
+		cranePoolController.numberOfParkings, getLatencyPercentile(&barrierWaitHistogram, 50.0),
+		getLatencyPercentile(&barrierWaitHistogram, 99.0));
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printCranePoolReport::Unexpected Error -"
+			" Print failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+void printBatchAdmissionReport(void)
+{
+	char string[MAX_STRING];
+
+	sprintf(string, "Eilat Port: %d unloading quays, vessels routed by %s", numberOfUnloadingQuays,
+		routingPolicyNames[routingPolicy]);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::printBatchAdmissionReport::Unexpected Error -"
+			" Print failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	for (int i = 0; i < numberOfUnloadingQuays; i++)
+	{
+		BatchAdmissionStruct* admission = &unloadingQuays[i]->batchAdmission;
+
+		sprintf(string, "Eilat Port: Quay %d - %ld vessels routed, %d batches admitted, %d flushed by timeout, "
+			"average batch %.1f vessels, final batch size %d", i + 1, unloadingQuays[i]->numberOfRoutedVessels,
+			admission->numberOfBatches, admission->numberOfFlushedBatches, admission->numberOfBatches == 0 ? 0.0 :
+			(double)admission->numberOfAdmittedVessels / admission->numberOfBatches, admission->tunedBatchSize);
+
+		if (!safePrintWithTimeStamp(string))
+		{
+			fprintf(stderr, "EilatPort::printBatchAdmissionReport::Unexpected Error -"
+				" Print failed!\n");
+			stopEilatPort(EXIT_FAILURE);
+		}
+	}
+}
+
+void writeToHaifaPortThatEilatPortIsDone(void)
+{
+	char string[MAX_STRING];
+
+	sprintf(string, "Eilat Port: Exiting...");
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::writeToHaifaPortThatEilatPortIsDone::Unexpected Error -"
+			" Print failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+
+	// Write to HaifaPort that EilatPort has successfuly ended.
+	sprintf(buffer, "%d", TRUE);
+
+	if (!writeMessage(toHaifaChannel, buffer))
+	{
+		fprintf(stderr, "EilatPort::writeToHaifaPortThatEilatPortIsDone::Unexpected Error -"
+			" Write process exit confimation to HaifaPort has failed!\n");
+		stopEilatPort(EXIT_FAILURE);
+	}
+}
+
+DWORD WINAPI Crane(LPVOID Param)
+{
+	// Get the thread's ID and save its index for array usage.
+	int craneId = *(int*)Param;
+	int craneIndex = craneId - 1;
+	char string[MAX_STRING];
+
+	sprintf(string, "Crane  %2d - starts operating", craneId);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::Crane  %2d::Unexpected Error - Print failed!\n",
+			craneId);
+		return 1;
+	}
+
+	// Comment: for some reason rand() kept producing the same values
+	// even though the seed has been set at the main. As far as I'm aware
+	// the seed only needs to be set once, even in a threaded enviorment 
+	// (for example our for Home Tasks it was enough only in the main).
+	// For that reason the seed is set in every thread which makes use of rand().
+	// I would like to know what's the reason for this if possible
+	srand(randomSeed + craneId);
+	// The cranes' draws are streams apart from the vessels'.
+	seedServiceTimeThread((ULONGLONG)1 << 32 | craneId);
+	watchStallThread("Crane", craneId);
+
+	// The function will live until indicated by the main thread to stop.
+	// Comment: Would just like to mention that a for loop which runs 
+	// numberOfVessels/numberOfCranes iterations could've also done the job,
+	// but from what we understood in 5.6.3 we thought that an infinite loop was desired.
+	while (!areAllVesselsDone)
+	{
+		CraneLedger* craneLedger = cargoLedger == NULL ? NULL : &cargoLedger->craneLedgers[craneIndex];
+
+		if (craneLedger != NULL)
+		{
+			beginCraneActivity(craneLedger, CRANE_LEDGER_IDLE);
+		}
+
+		// Wait till a vessel signals to start unloading its cargo.
+		waitForProfiledWord(&cranesWaitWordsProfile, &cranesWaitWords[craneIndex]);
+
+		if (craneLedger != NULL)
+		{
+			recordCraneIdleTime(craneLedger);
+		}
+
+		// Check if the main thread has indicated to stop running.
+		if (areAllVesselsDone)
+		{
+			break;
+		}
+
+		recordHandOff(&handOffHistogram, &cranesHandOffStamps[craneIndex]);
+
+		// The crane's station is in the quay which holds the crane.
+		UnloadingQuayStruct* pUnloadingQuay = getCraneUnloadingQuay(craneIndex);
+		UnloadingQuayStation* station =
+			&pUnloadingQuay->unloadingQuayStation[craneIndex - pUnloadingQuay->firstCraneIndex];
+		CraneKind* craneKind = &craneKinds[craneIndex % numberOfCraneKinds];
+		LONG assignment = 0;
+
+		// With faults injected the vessel may have been moved to another station before the crane woke.
+		if (isFaultInjected)
+		{
+			waitForProfiledObject(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex, INFINITE);
+
+			int isUnloading = station->isUnloading;
+
+			assignment = station->assignment;
+			releaseProfiledMutex(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex);
+
+			if (!isUnloading)
+			{
+				continue;
+			}
+		}
+
+		ULONGLONG unloadingStartTime = GetTickCount64();
+
+		if (craneLedger != NULL)
+		{
+			beginCraneActivity(craneLedger, CRANE_LEDGER_BUSY);
+		}
+
+		// The crane's kind unloads at its rate, a percent of the base rate.
+		DWORD unloadingTime = (DWORD)((ULONGLONG)getServiceTime(SERVICE_TIME_UNLOAD, station->cargoWeight) *
+			CRANE_KIND_BASE_RATE / station->rate);
+
+		if (!isFaultInjected)
+		{
+			Sleep(unloadingTime);
+		}
+		else if (!unloadWithFaults(pUnloadingQuay, station, &craneFaults[craneIndex], assignment, unloadingTime))
+		{
+			// The crane was down and its vessel was moved to another station, which unloads it anew.
+			if (craneLedger != NULL)
+			{
+				recordCraneLostTime(craneLedger);
+			}
+
+			continue;
+		}
+
+		LONGLONG busyTime = (LONGLONG)(GetTickCount64() - unloadingStartTime);
+
+		InterlockedExchangeAdd64(&cranePoolController.busyTime, busyTime);
+		InterlockedExchangeAdd64(&craneKind->busyTime, busyTime);
+		InterlockedExchangeAdd64(&craneKind->numberOfUnloadedTons, station->cargoWeight);
+		InterlockedIncrement(&craneKind->numberOfUnloadedVessels);
+
+		if (craneLedger != NULL)
+		{
+			recordCraneUnloading(craneLedger, station->cargoWeight);
+		}
+
+		// The cargo goes to the storage yard, and while the yard is full the crane holds it,
+		// so the vessel stays at its station and the quay can't admit the next batch.
+		if (storageYard != NULL)
+		{
+			depositToStorageYard(storageYard, station->cargoWeight);
+		}
+
+		sprintf(string, "Crane  %2d - unloaded %d tons from vessel %d", craneId,
+			station->cargoWeight, station->vesselId);
+
+		if (!safePrintWithTimeStamp(string))
+		{
+			fprintf(stderr, "EilatPort::Crane  %2d::Unexpected Error - Print failed!\n",
+				craneId);
+			return 1;
+		}
+
+		// Unload the vessel's cargo.
+		station->cargoWeight = -1;
+
+		// Signal vessel that the unloading process has ended.
+		stampHandOff(&vesselsHandOffStamps[station->berthIndex]);
+
+		if (!signalProfiledWord(&vesselsWaitWordsProfile, &vesselsWaitWords[station->berthIndex]))
+		{
+			fprintf(stderr, "EilatPort::Crane::Unexpected Error - vesselsWaitWords[%d].V()\n",
+				station->vesselId);
+		}
+	}
+
+	unwatchStallThread();
+	sprintf(string, "Crane  %2d - done operating", craneId);
+
+	if (!safePrintWithTimeStamp(string))
+	{
+		fprintf(stderr, "EilatPort::Crane  %2d::Unexpected Error - Print failed!\n",
+			craneId);
+		return 1;
+	}
+
+	return 0;
+}
+
+DWORD WINAPI Vessel(LPVOID Param)
+{
+	// Get the thread's record and ID.
+	// Comment: the record is the berth's, and goes to the next vessel once this one leaves the berth,
+	// so what the turnaround needs is kept aside.
+	VesselRecord* vesselRecord = (VesselRecord*)Param;
+	int vesselId = vesselRecord->vesselId;
+	int priority = vesselRecord->priority;
+	ULONGLONG arrivalTime = vesselRecord->arrivalTime;
+
+	// Comment: for some reason rand() kept producing the same values
+	// even though the seed has been set at the main. As far as I'm aware
+	// the seed only needs to be set once, even in a threaded enviorment 
+	// (for example our for Home Tasks it was enough only in the main).
+	// For that reason the seed is set in every thread which makes use of rand().
+	// I would like to know what's the reason for this if possible
+	srand(randomSeed + vesselId);
+	seedServiceTimeThread(vesselId);
+	watchStallThread("Vessel", vesselId);
+
+	// The type is the first draw of the vessel's own stream, so the vessel carries the same cargo
+	// on every voyage and after a restart, whatever order the vessels arrived in.
+	vesselRecord->cargoType = randomCargoType();
+
+	// A vessel recovered from the journal resumes from its last state: a queued or docked
+	// vessel enters the barrier again, since its place in the unloading quay was lost,
+	// and an unloaded one sails straight back to HaifaPort.
+	int result = (vesselRecord->journalState < VESSEL_JOURNAL_QUEUED &&
+			arriveAtEilatPort(vesselRecord)) ||
+		(vesselRecord->journalState < VESSEL_JOURNAL_UNLOADED &&
+			(enterBarrier(vesselRecord) || enterUnloadingQuayAndStartUnloadingProcess(vesselRecord))) ||
+		sailToHaiafaPort(vesselRecord);
+
+	if (!result)
+	{
+		ULONGLONG turnaround = GetTickCount64() - arrivalTime;
+
+		recordLatency(&turnaroundHistogram[getPriorityClass(priority)], turnaround);
+		recordLatency(&fleetTurnaroundHistogram, turnaround);
+	}
+
+	unwatchStallThread();
+
+	// Signal the main thread that the vessel is done.
+	if (!releaseProfiledSemaphore(&vesselsDoneSemaphoreProfile, vesselsDoneSemaphore, 1))
+	{
+		fprintf(stderr, "EilatPort::Vessel %2d::Unexpected Error -"
+			" vesselsDoneSemaphore.V()\n", vesselId);
+		return 1;
+	}
+
+	return result;
+}
+
+DWORD WINAPI UnloadingQuay(LPVOID Param)
+{
+	UnloadingQuayStruct* pUnloadingQuay = (UnloadingQuayStruct*)Param;
+
+	watchStallThread("UnloadingQuay", pUnloadingQuay->quayIndex + 1);
+
+	// Run untill every vessel has been routed and all of the quay's have left its barrier.
+	while (!isUnloadingQuayDone(pUnloadingQuay))
+	{
+		// The quay is empty between batches, so stations may be activated or parked
+		// as requested by the crane pool controller, which the quays share.
+		if (isUnloadingQuayEmpty(pUnloadingQuay))
+		{
+			resizeUnloadingQuay(pUnloadingQuay,
+				getUnloadingQuayNumberOfCranes(pUnloadingQuay, cranePoolController.requestedNumberOfCranes));
+		}
+
+		// A batch is at most the tuned batch size and the number of active stations,
+		// and once every vessel is routed no more than the quay's vessels which are still to come.
+		int batchSize = pUnloadingQuay->batchAdmission.tunedBatchSize;
+
+		if (pUnloadingQuay->unloadingQuaySize < batchSize)
+		{
+			batchSize = pUnloadingQuay->unloadingQuaySize;
+		}
+
+		if (numberOfVesselsToRoute == 0 && pUnloadingQuay->numberOfVesselsToUnload < batchSize)
+		{
+			batchSize = pUnloadingQuay->numberOfVesselsToUnload;
+		}
+
+		batchSize = batchSize > 0 ? waitForBatchInBarrier(pUnloadingQuay, batchSize) : 0;
+
+		// The barrier picks each vessel by its priority class and how long it has waited, among
+		// the ones whose cargo a free station unloads. Every station unloads a cargo of the quay
+		// while the quay is empty, so a batch's first vessel is always matched, unless faults
+		// are injected and every crane for its cargo is down.
+		DWORD matchedStations = matchVesselsToStations(pUnloadingQuay, batchSize);
+		int numberOfMatchedVessels = 0;
+
+		if (batchSize > 0 && matchedStations == 0 && !isFaultInjected)
+		{
+			fprintf(stderr, "EilatPort::UnloadingQuay::Unexpected Error - "
+				"No vessel was matched to a station!\n");
+			return 1;
+		}
+
+		for (int i = 0; i < pUnloadingQuay->unloadingQuaySize; i++)
+		{
+			if (!(matchedStations & (DWORD)1 << i))
+			{
+				continue;
+			}
+
+			// Signal the vessel at the berth to continue its unloading process.
+			int berthIndex = pUnloadingQuay->unloadingQuayStation[i].berthIndex;
+
+			stampHandOff(&vesselsHandOffStamps[berthIndex]);
+
+			if (!signalProfiledWord(&vesselsWaitWordsProfile, &vesselsWaitWords[berthIndex]))
+			{
+				fprintf(stderr, "EilatPort::UnloadingQuay::Unexpected Error - "
+					"vesselsWaitWords[%d].V()\n", berthIndex);
+				return 1;
+			}
+
+			numberOfMatchedVessels++;
+		}
+
+		// The vessels which weren't matched stay in the barrier, and are counted for the next batch.
+		if (numberOfMatchedVessels < batchSize)
+		{
+			pUnloadingQuay->numberOfDeferredVessels += batchSize - numberOfMatchedVessels;
+			pUnloadingQuay->batchAdmission.numberOfAdmittedVessels -= batchSize - numberOfMatchedVessels;
+
+			if (!releaseProfiledSemaphore(&barrierSemaphoreProfile, pUnloadingQuay->barrier->semaphore,
+				batchSize - numberOfMatchedVessels))
+			{
+				fprintf(stderr, "EilatPort::UnloadingQuay::Unexpected Error - barrierSemaphore.V()\n");
+				return 1;
+			}
+
+			// Comment: the batch's vessels are back in the barrier, so without a pause the quay
+			// would admit them again and again till a crane recovers.
+			if (matchedStations == 0)
+			{
+				Sleep(QUAY_IDLE_INTERVAL);
+			}
+		}
+
+		InterlockedExchangeAdd(&pUnloadingQuay->numberOfVesselsToUnload, -numberOfMatchedVessels);
+
+		// Wait untill all vessels have left the unloading quay (is empty).
+		for (int i = 0; i < pUnloadingQuay->unloadingQuaySize; i++)
+		{
+			if (matchedStations & (DWORD)1 << i)
+			{
+				waitForProfiledWord(&unloadingQuayWaitWordsProfile,
+					&unloadingQuayWaitWords[pUnloadingQuay->firstCraneIndex + i]);
+			}
 		}
+
+		// Empty all unloading quay stations so new vessels can stop there.
+		removeVesselsFromUnloadingQuay(pUnloadingQuay);
 	}
 
-	return cranesHandler;
+	unwatchStallThread();
+
+	return 0;
 }
 
-void createUnloadingQuayThread(HANDLE* unloadingQuayHandler)
+int waitForBatchInBarrier(UnloadingQuayStruct* pUnloadingQuay, int batchSize)
 {
-	DWORD threadId;
-	int unloadingQuayId = 1;
-	*unloadingQuayHandler =
-		CreateThread(NULL, 0, UnloadingQuay, &unloadingQuayId, 0, &threadId);
-
-	if (*unloadingQuayHandler == NULL)
-	{
-		fprintf(stderr, "EilatPort::createUnloadingQuayThread::Unexpected Error -"
-			" unloadingQuayHandle thread %d creation failed!\n", unloadingQuayId);
-		exit(EXIT_FAILURE);
-	}
+	PriorityBarrier* priorityBarrier = pUnloadingQuay->barrier;
+	BatchAdmissionStruct* admission = &pUnloadingQuay->batchAdmission;
 
-	// Set threads prioirty to be the highest, so when the barrier has reached
-	// an amount that is allowed to unload, the unloading quay will set in motion
-	// immediately 
-	if (!SetThreadPriority(*unloadingQuayHandler, THREAD_PRIORITY_HIGHEST))
+	// Wait for the batch's first vessel to reach the barrier. A quay which is routed no
+	// vessels wakes up every QUAY_IDLE_INTERVAL to check whether the run is done.
+	while (waitForProfiledObject(&barrierSemaphoreProfile, priorityBarrier->semaphore,
+		QUAY_IDLE_INTERVAL) == WAIT_TIMEOUT)
 	{
-		fprintf(stderr, "EilatPort::createUnloadingQuayThread::Unexpected Error -"
-			" thread priority failed!\n");
-		exit(EXIT_FAILURE);
+		if (isUnloadingQuayDone(pUnloadingQuay))
+		{
+			return 0;
+		}
 	}
-}
 
-HANDLE* readAndCreateIncomingVesselsFromHaifaPort(int numberOfVessels, int** vesselsId)
-{
-	DWORD threadId;
-	*vesselsId = (int*)malloc(numberOfVessels * sizeof(int));
-	HANDLE* vesselsHandler = (HANDLE*)malloc(numberOfVessels * sizeof(HANDLE));
+	ULONGLONG batchStartTime = GetTickCount64();
+	int numberOfAdmittedVessels = 1;
+	int isFlushed = FALSE;
 
-	if (*vesselsId == NULL || vesselsHandler == NULL)
+	// Wait for the rest of the batch. By using a loop on WaitForSingleObject we are able
+	// to lower the semaphore's counter by the desired amount, though once the flush timeout
+	// has passed the vessels which arrived so far are admitted as a partial batch.
+	while (numberOfAdmittedVessels < batchSize)
 	{
-		fprintf(stderr, "EilatPort::readAndCreateIncomingVesselsFromHaifaPort::Unexpected Error -"
-			" Memory allocation failed!\n");
-		exit(EXIT_FAILURE);
-	}
+		DWORD timeout = QUAY_IDLE_INTERVAL;
+		int isFlushTimeout = FALSE;
 
-	// Read incoming vessels from HaifaPort and create threads according to their ID.
-	for (int i = 0; i < numberOfVessels; i++)
-	{
-		// Receive vessel's ID through the 'Med. Sea ==> Red Sea' pipe.
-		if (!ReadFile(readFromHaifaHandle, buffer, BUFFER_SIZE, &numberOfReadBytes, NULL))
+		if (admission->flushTimeout > 0)
 		{
-			fprintf(stderr, "EilatPort::readAndCreateIncomingVesselsFromHaifaPort::Unexptected Error -"
-				" reading vessel from 'Med. Sea ==> Red Sea' pipe failed!\n");
-			exit(EXIT_FAILURE);
+			ULONGLONG elapsedTime = GetTickCount64() - batchStartTime;
+			ULONGLONG flushTime = elapsedTime >= (ULONGLONG)admission->flushTimeout ?
+				0 : admission->flushTimeout - elapsedTime;
+
+			isFlushTimeout = flushTime <= QUAY_IDLE_INTERVAL;
+			timeout = isFlushTimeout ? (DWORD)flushTime : QUAY_IDLE_INTERVAL;
 		}
 
-		int vesselId = atoi(buffer);
-		int vesselIndex = vesselId - 1;
+		if (waitForProfiledObject(&barrierSemaphoreProfile, priorityBarrier->semaphore, timeout) == WAIT_TIMEOUT)
+		{
+			if (isFlushTimeout)
+			{
+				isFlushed = TRUE;
+				break;
+			}
 
-		(*vesselsId)[vesselIndex] = vesselId;
-		vesselsHandler[vesselIndex] =
-			CreateThread(NULL, 0, Vessel, &(*vesselsId)[vesselIndex], 0, &threadId);
+			// Every vessel was routed while the batch filled, and fewer of them came to this quay.
+			if (numberOfVesselsToRoute == 0 && pUnloadingQuay->numberOfVesselsToUnload <= numberOfAdmittedVessels)
+			{
+				break;
+			}
 
-		if (vesselsHandler[vesselIndex] == NULL)
-		{
-			fprintf(stderr, "EilatPort::readAndCreateIncomingVesselsFromHaifaPort::Unexpected Error -" 
-				"Vessel thread %d creation failed!\n", (*vesselsId)[vesselIndex]);
-			exit(EXIT_FAILURE);
+			continue;
 		}
+
+		numberOfAdmittedVessels++;
 	}
 
-	return vesselsHandler;
+	tuneBatchSize(admission, batchSize, numberOfAdmittedVessels, isFlushed, GetTickCount64() - batchStartTime);
+
+	return numberOfAdmittedVessels;
 }
 
-int areAllVesselsDoneatHaifaPort(void)
+void tuneBatchSize(BatchAdmissionStruct* admission, int batchSize, int numberOfAdmittedVessels, int isFlushed,
+	ULONGLONG fillTime)
 {
-	// Check that all vessel threads are done in HaifaPort.
-	// Comment: This command operates more as a cosmetic reason, since when the last thread 
-	// has returend to HaifaPort, EilatPort will start its printing ending messages. 
-	// With this EilatPort will wait till the end of all vessel's messages.
-	if (!ReadFile(readFromHaifaHandle, buffer, BUFFER_SIZE, &numberOfReadBytes, NULL))
+	admission->numberOfBatches++;
+	admission->numberOfAdmittedVessels += numberOfAdmittedVessels;
+
+	if (isFlushed)
 	{
-		fprintf(stderr, "EilatPort::areAllVesselsDoneatHaifaPort::Unexptected Error -"
-			" Reading all vessels ended has failed!\n");
-		exit(EXIT_FAILURE);
+		// Vessels arrive slower than the batch fills, so the next batch is the number of
+		// vessels which arrived within the timeout. This bounds the barrier wait.
+		admission->numberOfFlushedBatches++;
+		admission->tunedBatchSize = numberOfAdmittedVessels;
 	}
-
-	if (!atoi(buffer))
+	else if (batchSize == admission->tunedBatchSize &&
+		fillTime < (ULONGLONG)admission->flushTimeout / 2 &&
+		admission->tunedBatchSize < admission->maxBatchSize)
 	{
-		fprintf(stderr, "EilatPort::areAllVesselsDoneatHaifaPort::Unexptected Error -"
-			" Vessels in HaifaPort still exist!\n");
-		exit(EXIT_FAILURE);
+		// The batch filled well before the timeout, so grow it by one vessel at a time
+		// to amortize the quay's wait for every vessel to leave over more vessels.
+		admission->tunedBatchSize++;
 	}
-
-	return TRUE;
 }
 
-void signalCranesToFinish(int numberOfCranes)
+DWORD WINAPI CranePoolController(LPVOID Param)
 {
-	// Signal cranes to continue so they can end.
-	for (int i = 0; i < numberOfCranes; i++)
+	CranePoolControllerStruct* controller = (CranePoolControllerStruct*)Param;
+	LONGLONG lastBusyTime = 0, lastBarrierWaitTime = 0;
+	LONG lastNumberOfBarrierWaits = 0;
+	int activationVotes = 0, parkingVotes = 0;
+
+	// Sample the barriers and the cranes of every quay together till every vessel has been
+	// admitted to a quay.
+	while (getNumberOfVesselsToUnload() > 0)
 	{
-		if (!ReleaseSemaphore(cranesSemaphores[i], 1, NULL))
+		Sleep(CRANE_CONTROLLER_INTERVAL);
+
+		int numberOfActiveCranes = 0;
+		int barrierDepth = 0;
+		ULONGLONG barrierWait = 0;
+
+		for (int i = 0; i < numberOfUnloadingQuays; i++)
 		{
-			fprintf(stderr, "EilatPort::signalCranesToFinish::Unexpected Error -"
-				" cranesSemaphores[%d].V()\n", i);
-			exit(EXIT_FAILURE);
+			ULONGLONG oldestWait = getOldestBarrierWait(unloadingQuays[i]->barrier);
+
+			numberOfActiveCranes += unloadingQuays[i]->unloadingQuaySize;
+			barrierDepth += unloadingQuays[i]->barrier->size;
+			barrierWait = oldestWait > barrierWait ? oldestWait : barrierWait;
 		}
-	}
-}
 
-void freeVesselThreads(HANDLE* vesselsHandler, int* vesselsId, int numberOfVessels)
-{
-	char string[MAX_STRING];
+		LONGLONG busyTime = controller->busyTime;
+		LONGLONG barrierWaitTime = controller->barrierWaitTime;
+		LONG numberOfBarrierWaits = controller->numberOfBarrierWaits;
 
-	// Close all vessel Handles and free any related allocated memory.
-	for (int i = 0; i < numberOfVessels; i++)
-	{
-		if (!CloseHandle(vesselsHandler[i]))
+		double utilization = (double)(busyTime - lastBusyTime) /
+			((double)CRANE_CONTROLLER_INTERVAL * numberOfActiveCranes);
+
+		// The barrier wait is the average of the vessels which left the barriers since the last
+		// sample, or the wait of the oldest vessel still in any of them if that's longer.
+
+		if (numberOfBarrierWaits > lastNumberOfBarrierWaits)
 		{
-			fprintf(stderr, "EilatPort::freeVesselThreads::Unexptected Error -"
-				" CloseHandle(vesselsHandler[%d])\n", i);
-			exit(EXIT_FAILURE);
+			ULONGLONG averageWait = (ULONGLONG)((barrierWaitTime - lastBarrierWaitTime) /
+				(numberOfBarrierWaits - lastNumberOfBarrierWaits));
+
+			barrierWait = averageWait > barrierWait ? averageWait : barrierWait;
 		}
-	}
 
-	free(vesselsId);
-	free(vesselsHandler);
+		lastBusyTime = busyTime;
+		lastBarrierWaitTime = barrierWaitTime;
+		lastNumberOfBarrierWaits = numberOfBarrierWaits;
 
-	sprintf(string, "Eilat Port: All Vessel Threads are done");
+		// Hysteresis: activate when the wait is above the target or vessels pile up past a
+		// full batch, park only when the wait is well under it and the cranes are mostly idle.
+		if (barrierWait > TARGET_BARRIER_WAIT || barrierDepth > numberOfActiveCranes)
+		{
+			activationVotes++;
+			parkingVotes = 0;
+		}
+		else if (barrierWait < TARGET_BARRIER_WAIT / 2 && utilization < LOW_CRANE_UTILIZATION &&
+			barrierDepth < numberOfActiveCranes)
+		{
+			parkingVotes++;
+			activationVotes = 0;
+		}
+		else
+		{
+			activationVotes = 0;
+			parkingVotes = 0;
+		}
 
-	if (!safePrintWithTimeStamp(string))
-	{
-		fprintf(stderr, "EilatPort::freeVesselThreads::Unexpected Error -"
-			" Print failed!\n");
-		exit(EXIT_FAILURE);
+		if (activationVotes >= CRANE_CONTROLLER_HYSTERESIS &&
+			controller->requestedNumberOfCranes < controller->maxNumberOfCranes)
+		{
+			InterlockedIncrement(&controller->requestedNumberOfCranes);
+			controller->numberOfActivations++;
+			activationVotes = 0;
+		}
+		else if (parkingVotes >= CRANE_CONTROLLER_HYSTERESIS &&
+			controller->requestedNumberOfCranes > controller->minNumberOfCranes)
+		{
+			InterlockedDecrement(&controller->requestedNumberOfCranes);
+			controller->numberOfParkings++;
+			parkingVotes = 0;
+		}
 	}
+
+	return 0;
 }
 
-void freeCraneThreads(HANDLE* cranesHandler, int* cranesId, int numberOfCranes)
+DWORD WINAPI FaultSupervisor(LPVOID Param)
 {
+	FaultInjector* injector = (FaultInjector*)Param;
+	const char* laneNames[] = { "Med. Sea ==> Red Sea", "Red Sea ==> Med. Sea" };
 	char string[MAX_STRING];
+	FaultEvent event;
 
-	// Close all crane Handles and free any related allocated memory.
-	for (int i = 0; i < numberOfCranes; i++)
+	// Apply the faults as they are due and rebalance the quays till every vessel is done.
+	while (!areAllVesselsDone)
 	{
-		if (!CloseHandle(cranesHandler[i]))
+		while (takeDueFaultEvent(injector, &event))
 		{
-			fprintf(stderr, "EilatPort::freeCraneThreads::Unexptected Error -"
-				" CloseHandle(cranesHandler[%d])\n", i);
-			exit(EXIT_FAILURE);
-		}
-	}
-
-	free(cranesId);
-	free(cranesHandler);
-
-	sprintf(string, "Eilat Port: All Crane Threads are done");
+			if (!applyFaultEvent(injector, &event))
+			{
+				continue;
+			}
 
-	if (!safePrintWithTimeStamp(string))
-	{
-		fprintf(stderr, "EilatPort::freeCraneThreads::Unexpected Error -"
-			" Print failed!\n");
-		exit(EXIT_FAILURE);
-	}
-}
+			if (event.target == FAULT_CRANE)
+			{
+				sprintf(string, event.action == FAULT_FAIL ? "Crane  %2d - failed" :
+					event.action == FAULT_SLOW ? "Crane  %2d - slowed to %d%%" : "Crane  %2d - recovered",
+					event.index + 1, event.value);
+			}
+			else
+			{
+				sprintf(string, event.action == FAULT_FAIL ? "Eilat Port: Canal lane %s - failed" :
+					event.action == FAULT_SLOW ? "Eilat Port: Canal lane %s - slowed to %d%%" :
+					"Eilat Port: Canal lane %s - recovered", laneNames[event.index], event.value);
+			}
 
-void cleanUnloadingQuayAndBarrier(HANDLE* unloadingQuayHandler)
-{
-	// Close unloading quay Handle and free any related allocated memory.
-	CloseHandle(*unloadingQuayHandler);
+			if (!safePrintWithTimeStamp(string))
+			{
+				fprintf(stderr, "EilatPort::FaultSupervisor::Unexpected Error - Print failed!\n");
+			}
+		}
 
-	destructQueue(barrier);
-	destructUnloadingQuay(unloadingQuay);
+		for (int i = 0; i < numberOfUnloadingQuays; i++)
+		{
+			moveStrandedVessels(unloadingQuays[i]);
+		}
 
-	/*sprintf(string, "Eilat Port: Unloading Quay Thread is done");
+		Sleep(FAULT_INJECTOR_INTERVAL);
+	}
 
-	if (!safePrintWithTimeStamp(string))
-	{
-		fprintf(stderr, "EilatPort::cleanUnloadingQuayAndBarrier::Unexpected Error -"
-		" Print failed!\n");
-		exit(EXIT_FAILURE);
-	}*/
+	return 0;
 }
 
-void writeToHaifaPortThatEilatPortIsDone(void)
+int unloadWithFaults(UnloadingQuayStruct* pUnloadingQuay, UnloadingQuayStation* station, CraneFault* craneFault,
+	LONG assignment, DWORD unloadingTime)
 {
-	char string[MAX_STRING];
+	for (DWORD unloadedTime = 0; unloadedTime < unloadingTime; unloadedTime += FAULT_SLICE)
+	{
+		// A failed crane holds its vessel till it recovers, or till the vessel is moved away.
+		// Its thread still checks in, so the watchdog doesn't take it as stalled once it recovers.
+		while (craneFault->state == CRANE_FAILED && station->assignment == assignment)
+		{
+			Sleep(FAULT_INJECTOR_INTERVAL);
+			station->heartbeatTime = GetTickCount64();
+		}
 
-	sprintf(string, "Eilat Port: Exiting...");
+		if (station->assignment != assignment)
+		{
+			return FALSE;
+		}
 
-	if (!safePrintWithTimeStamp(string))
-	{
-		fprintf(stderr, "EilatPort::writeToHaifaPortThatEilatPortIsDone::Unexpected Error -"
-			" Print failed!\n");
-		exit(EXIT_FAILURE);
-	}
+		// The crane checks in between slices, which brings it back up if the watchdog stalled it.
+		station->heartbeatTime = GetTickCount64();
+		InterlockedCompareExchange(&craneFault->state, CRANE_UP, CRANE_STALLED);
 
-	// Write to HaifaPort that EilatPort has successfuly ended.
-	sprintf(buffer, "%d", TRUE);
+		DWORD slice = unloadingTime - unloadedTime < FAULT_SLICE ? unloadingTime - unloadedTime : FAULT_SLICE;
 
-	if (!WriteFile(writeToHaifaHandle, buffer, BUFFER_SIZE, &numberOfWrittenBytes, NULL))
-	{
-		fprintf(stderr, "EilatPort::writeToHaifaPortThatEilatPortIsDone::Unexpected Error -"
-			" Write process exit confimation to HaifaPort has failed!\n");
-		exit(EXIT_FAILURE);
+		station->sliceTime = (DWORD)((ULONGLONG)slice * craneFault->slowdown / FAULT_FULL_SPEED);
+		Sleep(station->sliceTime);
 	}
-}
 
-int safePrintWithTimeStamp(char string[])
-{
-	WaitForSingleObject(processSafePrintSemaphore, INFINITE);
+	// The vessel is done only if it wasn't moved away during the last slice.
+	waitForProfiledObject(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex, INFINITE);
 
-	GetLocalTime(&currentTime);
-	fprintf(stderr, "[%02d:%02d:%02d] %s\n",
-		currentTime.wHour, currentTime.wMinute, currentTime.wSecond, string);
+	int isUnloaded = station->assignment == assignment;
 
-	if (!ReleaseSemaphore(processSafePrintSemaphore, 1, NULL))
+	if (isUnloaded)
 	{
-		fprintf(stderr, "EilatPort::safePrintWithTimeStamp::Unexpected Error - "
-			"processSafePrintSemaphore.V()\n");
-		return FALSE;
+		station->isUnloading = FALSE;
 	}
 
-	return TRUE;
+	releaseProfiledMutex(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex);
+	InterlockedCompareExchange(&craneFault->state, CRANE_UP, CRANE_STALLED);
+
+	return isUnloaded;
 }
 
-DWORD WINAPI Crane(LPVOID Param)
+void moveStrandedVessels(UnloadingQuayStruct* pUnloadingQuay)
 {
-	// Get the thread's ID and save its index for array usage.
-	int craneId = *(int*)Param;
-	int craneIndex = craneId - 1;
-	char string[MAX_STRING];
-
-	sprintf(string, "Crane  %2d - starts operating", craneId);
+	UnloadingQuayStation* stations = pUnloadingQuay->unloadingQuayStation;
+	CraneFault* quayCraneFaults = &craneFaults[pUnloadingQuay->firstCraneIndex];
+	char strings[2 * MAX_NUMBER_OF_CRANES][MAX_STRING]; // A stall and a move for each station at most.
+	int numberOfStrings = 0;
 
-	if (!safePrintWithTimeStamp(string))
-	{
-		fprintf(stderr, "EilatPort::Crane  %2d::Unexpected Error - Print failed!\n",
-			craneId);
-		return 1;
-	}
-
-	// Comment: for some reason rand() kept producing the same values
-	// even though the seed has been set at the main. As far as I'm aware
-	// the seed only needs to be set once, even in a threaded enviorment 
-	// (for example our for Home Tasks it was enough only in the main).
-	// For that reason the seed is set in every thread which makes use of rand().
-	// I would like to know what's the reason for this if possible
-	srand((unsigned int)time(NULL));
+	// The stations are only read and moved under the mutex, and printed once it is released.
+	waitForProfiledObject(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex, INFINITE);
 
-	// The function will live until indicated by the main thread to stop.
-	// Comment: Would just like to mention that a for loop which runs 
-	// numberOfVessels/numberOfCranes iterations could've also done the job,
-	// but from what we understood in 5.6.3 we thought that an infinite loop was desired.
-	while (!areAllVesselsDone)
+	for (int i = 0; i < pUnloadingQuay->unloadingQuaySize; i++)
 	{
-		// Wait till a vessel signals to start unloading its cargo.
-		WaitForSingleObject(cranesSemaphores[craneIndex], INFINITE);
+		UnloadingQuayStation* station = &stations[i];
 
-		// Check if the main thread has indicated to stop running.
-		if (areAllVesselsDone)
+		if (!station->isUnloading)
 		{
-			break;
+			continue;
 		}
 
-		Sleep(randomSleepTime());
-
-		sprintf(string, "Crane  %2d - unloaded %d tons from vessel %d", craneId,
-			unloadingQuay->unloadingQuayStation[craneIndex].cargoWeight,
-			unloadingQuay->unloadingQuayStation[craneIndex].vesselId);
-
-		if (!safePrintWithTimeStamp(string))
+		// The watchdog: a crane which unloads and hasn't checked in for too long after its slice
+		// should have ended is stalled, so a slowed crane isn't taken as stalled for its slow slices.
+		if (craneTimeout > 0 && GetTickCount64() - station->heartbeatTime > station->sliceTime + craneTimeout &&
+			stallCrane(&faultInjector, pUnloadingQuay->firstCraneIndex + i))
 		{
-			fprintf(stderr, "EilatPort::Crane  %2d::Unexpected Error - Print failed!\n",
-				craneId);
-			return 1;
+			sprintf(strings[numberOfStrings++], "Crane  %2d - stalled, no check-in for over %lu ms past its slice",
+				station->craneId, craneTimeout);
 		}
 
-		// Unload the vessel's cargo.
-		unloadingQuay->unloadingQuayStation[craneIndex].cargoWeight = -1;
-
-		// Signal vessel that the unloading process has ended.
-		if (!ReleaseSemaphore(vesselsSemaphores[
-			unloadingQuay->unloadingQuayStation[craneIndex].vesselId - 1], 1, NULL))
+		if (quayCraneFaults[i].state == CRANE_UP)
 		{
-			fprintf(stderr, "EilatPort::Crane::Unexpected Error - vesselsSemaphores[%d].V()\n",
-				unloadingQuay->unloadingQuayStation[craneIndex].vesselId);
+			continue;
 		}
-	}
-
-	sprintf(string, "Crane  %2d - done operating", craneId);
-
-	if (!safePrintWithTimeStamp(string))
-	{
-		fprintf(stderr, "EilatPort::Crane  %2d::Unexpected Error - Print failed!\n",
-			craneId);
-		return 1;
-	}
 
-	return 0;
-}
+		// The vessel takes the best free station which unloads its cargo and whose crane is up,
+		// the ones whose vessels left are free again.
+		int targetIndex = -1;
 
-DWORD WINAPI Vessel(LPVOID Param)
-{
-	// Get the thread's ID and save its index for array usage.
-	int vesselId = *(int*)Param;
-	int vesselIndex = vesselId - 1;
+		for (int j = 0; j < pUnloadingQuay->unloadingQuaySize; j++)
+		{
+			if (stations[j].berthIndex == -1 && quayCraneFaults[j].state == CRANE_UP &&
+				stations[j].capabilities & 1 << station->cargoType &&
+				(targetIndex == -1 || isBetterStationMatch(&stations[j], &stations[targetIndex])))
+			{
+				targetIndex = j;
+			}
+		}
 
-	// Comment: for some reason rand() kept producing the same values
-	// even though the seed has been set at the main. As far as I'm aware
-	// the seed only needs to be set once, even in a threaded enviorment 
-	// (for example our for Home Tasks it was enough only in the main).
-	// For that reason the seed is set in every thread which makes use of rand().
-	// I would like to know what's the reason for this if possible
-	srand((unsigned int)time(NULL));
+		if (targetIndex == -1)
+		{
+			continue;
+		}
 
-	return startSailingAndEnterBarrier(vesselId, vesselIndex) ||
-		enterUnloadingQuayAndStartUnloadingProcess(vesselId, vesselIndex) ||
-		sailToHaiafaPort(vesselId);
+		UnloadingQuayStation* target = &stations[targetIndex];
 
+		target->berthIndex = station->berthIndex;
+		target->vesselId = station->vesselId;
+		target->cargoWeight = station->cargoWeight;
+		target->cargoType = station->cargoType;
+		target->isOccupied = TRUE;
+		target->isUnloading = TRUE;
+		target->heartbeatTime = GetTickCount64();
+		target->sliceTime = 0;
 
+		// Comment: the station stays occupied, since the quay waits for the vessel to leave it,
+		// but its crane abandons the vessel once it checks in.
+		station->berthIndex = -1;
+		station->isUnloading = FALSE;
+		InterlockedIncrement(&station->assignment);
+		faultInjector.numberOfMovedVessels++;
 
-	return 0;
-}
+		sprintf(strings[numberOfStrings++], "Vessel %2d - moved from crane %d to crane %d", target->vesselId,
+			station->craneId, target->craneId);
 
-DWORD WINAPI UnloadingQuay(LPVOID Param)
-{
-	// Get the thread's ID
-	int craneId = *(int*)Param;
+		// Signal the crane to unload the vessel from the start.
+		stampHandOff(&cranesHandOffStamps[pUnloadingQuay->firstCraneIndex + targetIndex]);
 
-	// Run untill all the vessels have left the barrier.
-	while (!(isEmpty(barrier) && haveAllVesselsArrived))
-	{
-		// Wait for vessels of an equal number to cranes to reach the barrier.
-		// By using a loop on WaitForSingleObject we are able to lower the 
-		// semaphore's counter by the desired amount.
-		for (int i = 0; i < unloadingQuay->unloadingQuaySize; i++)
+		if (!signalProfiledWord(&cranesWaitWordsProfile,
+			&cranesWaitWords[pUnloadingQuay->firstCraneIndex + targetIndex]))
 		{
-			WaitForSingleObject(barrierSemaphore, INFINITE);
+			fprintf(stderr, "EilatPort::moveStrandedVessels::Unexpected Error - cranesWaitWords[%d].V()\n",
+				target->craneId);
 		}
+	}
 
-		if (barrier->size >= unloadingQuay->unloadingQuaySize &&
-			isUnloadingQuayEmpty(unloadingQuay))
-		{
-			for (int i = 0; i < unloadingQuay->unloadingQuaySize; i++)
-			{
-				int vesselId = dequeue(barrier);
-
-				if (vesselId == -1)
-				{
-					fprintf(stderr, "EilatPort::UnloadingQuay::Unexpected Error - "
-						"Dequeue == -1!\n");
-					return 1;
-				}
-
-				// Signal the vessel to continue its unloading process.
-				if (!ReleaseSemaphore(vesselsSemaphores[vesselId - 1], 1, NULL))
-				{
-					fprintf(stderr, "EilatPort::UnloadingQuay::Unexpected Error - "
-						"vesselsSemaphores[%d].V()\n", vesselId);
-					return 1;
-				}
-			}
+	releaseProfiledMutex(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex);
 
-			// Wait untill all vessels have left the unloading quay (is empty).
-			WaitForMultipleObjects(unloadingQuay->unloadingQuaySize, unloadingQuaySemaphore, TRUE, INFINITE);
-			// Empty all unloading quay stations so new vessels can stop there.
-			removeVesselsFromUnloadingQuay(unloadingQuay);
+	for (int i = 0; i < numberOfStrings; i++)
+	{
+		if (!safePrintWithTimeStamp(strings[i]))
+		{
+			fprintf(stderr, "EilatPort::moveStrandedVessels::Unexpected Error - Print failed!\n");
 		}
 	}
-
-	return 0;
 }
 
-int startSailingAndEnterBarrier(int vesselId, int vesselIndex)
+int arriveAtEilatPort(VesselRecord* vesselRecord)
 {
+	int vesselId = vesselRecord->vesselId;
 	char string[MAX_STRING];
 
 	// Comment: At start we also printed this line, though we noticed that in the 
@@ -972,63 +3547,89 @@ int startSailingAndEnterBarrier(int vesselId, int vesselIndex)
 
 	if (!safePrintWithTimeStamp(string))
 	{
-		fprintf(stderr, "EilatPort::Vessel %2d::startSailingAndEnterBarrier::"
+		fprintf(stderr, "EilatPort::Vessel %2d::arriveAtEilatPort::"
 			"Unexpected Error - Print failed!\n", vesselId);
-		exit(EXIT_FAILURE);
+		stopEilatPort(EXIT_FAILURE);
 	}*/
 
+	writeVesselStateToJournal(vesselId, VESSEL_JOURNAL_ARRIVED, FALSE);
+
 	sprintf(string, "Vessel %2d - arrived @ Eilat Port", vesselId);
 
 	if (!safePrintWithTimeStamp(string))
 	{
-		fprintf(stderr, "EilatPort::Vessel %2d::startSailingAndEnterBarrier::"
+		fprintf(stderr, "EilatPort::Vessel %2d::arriveAtEilatPort::"
 			"Unexpected Error - Print failed!\n", vesselId);
 		return 1;
 	}
 
-	Sleep(randomSleepTime());
-
-	// Signal that the 'Med. Sea ==> Red Sea' pipe is free for another vessel to pass.
-	if (!ReleaseSemaphore(medToRedCanalSemaphore, 1, NULL))
+	// A failed lane holds the vessel in the canal till it recovers.
+	if (isFaultInjected)
 	{
-		fprintf(stderr, "EilatPort::Vessel %2d::startSailingAndEnterBarrier::"
-			"Unexpected Error - medToRedCanalSemaphore.V()\n", vesselId);
-		exit(EXIT_FAILURE);
+		transitFaultedLane(&faultInjector, SUEZ_CANAL_MED_TO_RED, getServiceTime(SERVICE_TIME_TRANSIT, 0));
 	}
+	else
+	{
+		Sleep(getServiceTime(SERVICE_TIME_TRANSIT, 0));
+	}
+
+	// Signal the canal that the vessel has left the 'Med. Sea ==> Red Sea' lane.
+	exitSuezCanal(suezCanal, SUEZ_CANAL_MED_TO_RED);
+
+	return 0;
+}
+
+int enterBarrier(VesselRecord* vesselRecord)
+{
+	int vesselId = vesselRecord->vesselId;
+	int berthIndex = vesselRecord->berthIndex;
+	char string[MAX_STRING];
+
+	// The vessel is routed as it reaches the barriers, so a recovered vessel may be routed
+	// to another quay than the one it was in before the restart.
+	UnloadingQuayStruct* pUnloadingQuay = routeVesselToUnloadingQuay(vesselRecord->cargoType);
 
-	// Enter barrier for the unloading quay.
-	if (!enqueue(barrier, vesselId))
+	vesselRecord->quayIndex = pUnloadingQuay->quayIndex;
+
+	// Enter barrier for the unloading quay, in the queue of the vessel's priority class.
+	if (!enqueueToBarrier(pUnloadingQuay->barrier, berthIndex, getPriorityClass(vesselRecord->priority),
+		vesselRecord->cargoType))
 	{
-		fprintf(stderr, "EilatPort::Vessel %2d::startSailingAndEnterBarrier::"
+		fprintf(stderr, "EilatPort::Vessel %2d::enterBarrier::"
 			"Unexpected Error - Enqueue failed!\n", vesselId);
 		return 1;
 	}
 
-	sprintf(string, "Vessel %2d - entering Barrier", vesselId);
+	writeVesselStateToJournal(vesselId, VESSEL_JOURNAL_QUEUED, FALSE);
+
+	sprintf(string, "Vessel %2d - entering Barrier of quay %d", vesselId, pUnloadingQuay->quayIndex + 1);
 
 	if (!safePrintWithTimeStamp(string))
 	{
-		fprintf(stderr, "EilatPort::Vessel %2d::startSailingAndEnterBarrier::"
+		fprintf(stderr, "EilatPort::Vessel %2d::enterBarrier::"
 			"Unexpected Error - Print failed!\n", vesselId);
 		return 1;
 	}
 
 	// Signal that the vessel has reached the barrier.
-	if (!ReleaseSemaphore(barrierSemaphore, 1, NULL))
+	if (!releaseProfiledSemaphore(&barrierSemaphoreProfile, pUnloadingQuay->barrier->semaphore, 1))
 	{
-		fprintf(stderr, "EilatPort::Vessel %2d::startSailingAndEnterBarrier"
+		fprintf(stderr, "EilatPort::Vessel %2d::enterBarrier"
 			"::Unexpected Error - barrierSemaphore.V()\n", vesselId);
 		return 1;
 	}
 
 	// Wait untill the vessel enters the unloading quay.
-	WaitForSingleObject(vesselsSemaphores[vesselIndex], INFINITE);
+	waitForProfiledWord(&vesselsWaitWordsProfile, &vesselsWaitWords[berthIndex]);
+	recordHandOff(&handOffHistogram, &vesselsHandOffStamps[berthIndex]);
 
 	return 0;
 }
 
-int enterUnloadingQuayAndStartUnloadingProcess(int vesselId, int vesselIndex)
+int enterUnloadingQuayAndStartUnloadingProcess(VesselRecord* vesselRecord)
 {
+	int vesselId = vesselRecord->vesselId;
+	UnloadingQuayStruct* pUnloadingQuay = unloadingQuays[vesselRecord->quayIndex];
 	char string[MAX_STRING];
 
 	sprintf(string, "Vessel %2d - entering Unloading Quay", vesselId);
@@ -1040,17 +3641,19 @@ int enterUnloadingQuayAndStartUnloadingProcess(int vesselId, int vesselIndex)
 		return 1;
 	}
 
-	Sleep(randomSleepTime());
+	Sleep(getServiceTime(SERVICE_TIME_DOCK, 0));
 
-	int stationIndex = stationVesselInUnloadingQuay(vesselId);
+	int stationIndex = stationVesselInUnloadingQuay(pUnloadingQuay, vesselId, vesselRecord->berthIndex);
 
 	if (stationIndex == -1)
 	{
 		return 1;
 	}
 
+	writeVesselStateToJournal(vesselId, VESSEL_JOURNAL_DOCKED, FALSE);
+
 	sprintf(string, "Vessel %2d - stationed near crane %d", vesselId,
-		unloadingQuay->unloadingQuayStation[stationIndex].craneId);
+		pUnloadingQuay->unloadingQuayStation[stationIndex].craneId);
 
 	if (!safePrintWithTimeStamp(string))
 	{
@@ -1059,25 +3662,25 @@ int enterUnloadingQuayAndStartUnloadingProcess(int vesselId, int vesselIndex)
 		return 1;
 	}
 
-	return startUnloadingVessel(vesselId, vesselIndex, stationIndex) ||
-		exitUnloadingQuay(vesselId, stationIndex);
+	return startUnloadingVessel(vesselRecord, stationIndex) ||
+		exitUnloadingQuay(pUnloadingQuay, vesselId, stationIndex);
 }
 
-int stationVesselInUnloadingQuay(int vesselId)
+int stationVesselInUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay, int vesselId, int berthIndex)
 {
-	// "Critical Section" only allow one vessel to find a station 
+	// "Critical Section" only allow one vessel to take a station 
 	// in the unloading quay at a time to prevent race condition.
-	WaitForSingleObject(stationMutex, INFINITE);
+	waitForProfiledObject(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex, INFINITE);
 
 	int stationIndex = -1;
 
-	// Find a free station for the vessel in the unloading quay.
-	for (int i = 0; i < unloadingQuay->unloadingQuaySize; i++)
+	// Find the station the unloading quay matched the vessel's berth to.
+	for (int i = 0; i < pUnloadingQuay->unloadingQuaySize; i++)
 	{
-		if (unloadingQuay->unloadingQuayStation[i].isOccupied == FALSE)
+		if (pUnloadingQuay->unloadingQuayStation[i].isOccupied &&
+			pUnloadingQuay->unloadingQuayStation[i].berthIndex == berthIndex)
 		{
-			unloadingQuay->unloadingQuayStation[i].vesselId = vesselId;
-			unloadingQuay->unloadingQuayStation[i].isOccupied = TRUE;
+			pUnloadingQuay->unloadingQuayStation[i].vesselId = vesselId;
 			stationIndex = i;
 
 			break;
@@ -1092,7 +3695,7 @@ int stationVesselInUnloadingQuay(int vesselId)
 	}
 
 	// Release entry to critical section to allow another vessel to find its station.
-	if (!ReleaseMutex(stationMutex))
+	if (!releaseProfiledMutex(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex))
 	{
 		fprintf(stderr, "EilatPort::Vessel %2d::findStationInUnloadingQuay::"
 			"Unexpected Error - unloadingQuayMutex.V()\n", vesselId);
@@ -1102,15 +3705,30 @@ int stationVesselInUnloadingQuay(int vesselId)
 	return stationIndex;
 }
 
-int startUnloadingVessel(int vesselId, int vesselIndex, int stationIndex)
+int startUnloadingVessel(VesselRecord* vesselRecord, int stationIndex)
 {
+	int vesselId = vesselRecord->vesselId;
+	UnloadingQuayStruct* pUnloadingQuay = unloadingQuays[vesselRecord->quayIndex];
+	UnloadingQuayStation* station = &pUnloadingQuay->unloadingQuayStation[stationIndex];
+	int craneIndex = pUnloadingQuay->firstCraneIndex + stationIndex;
 	char string[MAX_STRING];
 
-	// Assign random cargo weight for the vessel.
-	unloadingQuay->unloadingQuayStation[stationIndex].cargoWeight = randomCargoWeight();
+	// Assign the manifest's cargo weight, or a random one if it has none, for the vessel.
+	station->cargoWeight = vesselRecord->cargoWeight > 0 ? vesselRecord->cargoWeight : randomCargoWeight();
+
+	// From now on the fault supervisor may move the vessel off the station if its crane is down.
+	if (isFaultInjected)
+	{
+		waitForProfiledObject(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex, INFINITE);
+		station->isUnloading = TRUE;
+		station->heartbeatTime = GetTickCount64();
+		station->sliceTime = 0;
+		releaseProfiledMutex(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex);
+	}
 
-	sprintf(string, "Vessel %2d - cargo's weight is %d tons", vesselId,
-		unloadingQuay->unloadingQuayStation[stationIndex].cargoWeight);
+	sprintf(string, isCargoMixed ? "Vessel %2d - cargo's weight is %d tons of %s" :
+		"Vessel %2d - cargo's weight is %d tons", vesselId, station->cargoWeight,
+		getCargoTypeName(vesselRecord->cargoType));
 
 	if (!safePrintWithTimeStamp(string))
 	{
@@ -1120,25 +3738,31 @@ int startUnloadingVessel(int vesselId, int vesselIndex, int stationIndex)
 	}
 
 	// Signal crane to start unloading cargo from the vessel.
-	if (!ReleaseSemaphore(cranesSemaphores[stationIndex], 1, NULL))
+	stampHandOff(&cranesHandOffStamps[craneIndex]);
+
+	if (!signalProfiledWord(&cranesWaitWordsProfile, &cranesWaitWords[craneIndex]))
 	{
 		fprintf(stderr, "EilatPort::Vessel %2d::startUnloadingVessel::"
-			"Unexpected Error - cranesSemaphores[%d].V()\n", vesselId,
-			unloadingQuay->unloadingQuayStation[stationIndex].craneId);
+			"Unexpected Error - cranesWaitWords[%d].V()\n", vesselId, station->craneId);
 		return 1;
 	}
 
-	// Wait untill the crane is done unloading cargo from the vessel.
-	WaitForSingleObject(vesselsSemaphores[vesselIndex], INFINITE);
+	// Wait untill the crane is done unloading cargo from the vessel, whichever crane it was moved to.
+	waitForProfiledWord(&vesselsWaitWordsProfile, &vesselsWaitWords[vesselRecord->berthIndex]);
+	recordHandOff(&handOffHistogram, &vesselsHandOffStamps[vesselRecord->berthIndex]);
 
 	return 0;
 }
 
-int exitUnloadingQuay(int vesselId, int stationIndex)
+int exitUnloadingQuay(UnloadingQuayStruct* pUnloadingQuay, int vesselId, int stationIndex)
 {
 	char string[MAX_STRING];
 
-	Sleep(randomSleepTime());
+	// The cargo must be on disk as unloaded before the vessel leaves, so a restarted
+	// EilatPort doesn't unload it again.
+	writeVesselStateToJournal(vesselId, VESSEL_JOURNAL_UNLOADED, TRUE);
+
+	Sleep(getServiceTime(SERVICE_TIME_DEPART, 0));
 
 	sprintf(string, "Vessel %2d - exiting unloading quay", vesselId);
 
@@ -1149,24 +3773,46 @@ int exitUnloadingQuay(int vesselId, int stationIndex)
 		return 1;
 	}
 
+	InterlockedDecrement(&pUnloadingQuay->numberOfVesselsInQuay);
+
+	// The station the vessel was unloaded at, which may not be the one it docked at, may take
+	// a vessel moved off a crane which is down. The quay still waits on the one it docked at.
+	if (isFaultInjected)
+	{
+		waitForProfiledObject(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex, INFINITE);
+
+		for (int i = 0; i < pUnloadingQuay->unloadingQuaySize; i++)
+		{
+			if (pUnloadingQuay->unloadingQuayStation[i].berthIndex != -1 &&
+				pUnloadingQuay->unloadingQuayStation[i].vesselId == vesselId)
+			{
+				pUnloadingQuay->unloadingQuayStation[i].berthIndex = -1;
+			}
+		}
+
+		releaseProfiledMutex(pUnloadingQuay->stationMutexProfile, pUnloadingQuay->stationMutex);
+	}
+
 	// Signal the unloading quay that the vessel has left the station.
-	if (!ReleaseSemaphore(unloadingQuaySemaphore[stationIndex], 1, NULL))
+	if (!signalProfiledWord(&unloadingQuayWaitWordsProfile,
+		&unloadingQuayWaitWords[pUnloadingQuay->firstCraneIndex + stationIndex]))
 	{
 		fprintf(stderr, "EilatPort::Vessel %2d::exitUnloadingQuay::"
-			"Unexpected Error - unloadingQuaySemaphore[%d].V()\n", vesselId,
-			unloadingQuay->unloadingQuayStation[stationIndex].craneId);
+			"Unexpected Error - unloadingQuayWaitWords[%d].V()\n", vesselId,
+			pUnloadingQuay->unloadingQuayStation[stationIndex].craneId);
 		return 1;
 	}
 
 	return 0;
 }
 
-int sailToHaiafaPort(int vesselId)
+int sailToHaiafaPort(VesselRecord* vesselRecord)
 {
+	int vesselId = vesselRecord->vesselId;
 	char string[MAX_STRING];
 
-	// Wait for access to the canal.
-	WaitForSingleObject(redToMedCanalSemaphore, INFINITE);
+	// Wait for the vessel's convoy to enter the canal.
+	enterSuezCanal(suezCanal, SUEZ_CANAL_RED_TO_MED);
 
 	sprintf(string, "Vessel %2d - entering Canal: Red Sea ==> Med.Sea", vesselId);
 
@@ -1177,12 +3823,29 @@ int sailToHaiafaPort(int vesselId)
 		return 1;
 	}
 
-	Sleep(randomSleepTime());
+	if (isFaultInjected)
+	{
+		transitFaultedLane(&faultInjector, SUEZ_CANAL_RED_TO_MED, getServiceTime(SERVICE_TIME_TRANSIT, 0));
+	}
+	else
+	{
+		Sleep(getServiceTime(SERVICE_TIME_TRANSIT, 0));
+	}
+
+	// HaifaPort takes the vessel as returned once it is written, so journal it first.
+	writeVesselStateToJournal(vesselId, VESSEL_JOURNAL_DEPARTED, TRUE);
+
+	// Comment: the message has its own buffer, since the main thread reads incoming
+	// vessels into the global buffer at the same time.
+	char message[BUFFER_SIZE];
+
+	sprintf(message, "%d %d %d", vesselId, 1, vesselRecord->haifaPortSlot);
 
-	sprintf(buffer, "%d", vesselId);
+	// The vessel leaves its berth, and its credit returns to HaifaPort with it.
+	freeBerth(vesselRecord->berthIndex);
 
-	// Writing vessel's ID to 'Med. Sea <== Red Sea' pipe.
-	if (!WriteFile(writeToHaifaHandle, buffer, BUFFER_SIZE, &numberOfWrittenBytes, NULL))
+	// Writing vessel's ID, its credit and its slot to 'Med. Sea <== Red Sea' pipe.
+	if (!writeMessage(toHaifaChannel, message))
 	{
 		fprintf(stderr, "EilatPort::Vessel %2d::sailToHaiafaPort::"
 			"Unexpected Error - writing vessel to 'Med. Sea <== Red Sea' pipe failed\n", vesselId);
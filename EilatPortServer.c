@@ -0,0 +1,182 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+
+#include "RunNamespace.h"
+#include "EilatPortServer.h"
+
+#define MIN_NUMBER_OF_STANDBY_SESSIONS 1
+#define MAX_NUMBER_OF_STANDBY_SESSIONS 16
+#define MAX_COMMAND_LINE 1024 // Size of the largest command line to start a session with.
+#define MAX_EARLY_SESSION_FAILURES 3 // Sessions in a row which may fail right away before the server gives up.
+#define EARLY_SESSION_FAILURE_TIME 1000 // Miliseconds, a session which fails sooner never served a fleet.
+
+// A session the server started, which waits for its HaifaPort or serves it.
+typedef struct {
+    HANDLE processHandle;
+    int sessionNumber;
+    ULONGLONG startTime;
+} ServerSession;
+
+// Main thread functions:
+// Start an EilatPort.exe -session, which waits for a HaifaPort on an instance of the server's pipe
+// and serves the given number of runs, 0 till it is stopped.
+void startEilatPortSession(ServerSession* session, const char* serverName, int numberOfSessionRuns);
+// Wait for any of the sessions to exit and print how it ended. Returns FALSE if it failed
+// before it could have served a fleet.
+int waitForAnySession(ServerSession sessions[], int* numberOfSessions, int* numberOfFailedSessions);
+
+int main(int argc, char* argv[])
+{
+    // Check that the user's input is valid and save it to a variable.
+    if (argc < 2)
+    {
+        fprintf(stderr, "EilatPortServer::Main::Error - Number of arguments is invalid!"
+            " Please enter the server's name, optionally followed by the standby sessions,"
+            " the sessions to serve and the runs each session serves!\n");
+        exit(EXIT_SUCCESS);
+    }
+
+    const char* serverName = argv[1];
+    const int numberOfStandbySessions = argc > 2 ? atoi(argv[2]) : MIN_NUMBER_OF_STANDBY_SESSIONS;
+    const int maxNumberOfSessions = argc > 3 ? atoi(argv[3]) : 0; // 0 serves till the server is stopped.
+    const int numberOfSessionRuns = argc > 4 ? atoi(argv[4]) : 0; // 0 serves till the session is stopped.
+
+    if (!isValidRunId(serverName))
+    {
+        fprintf(stderr, "EilatPortServer::Main::Error - "
+            "Server name must be 1-%d letters, digits, '-' or '_'!\n", MAX_RUN_ID);
+        exit(EXIT_SUCCESS);
+    }
+
+    if (numberOfStandbySessions < MIN_NUMBER_OF_STANDBY_SESSIONS ||
+        numberOfStandbySessions > MAX_NUMBER_OF_STANDBY_SESSIONS || maxNumberOfSessions < 0 ||
+        numberOfSessionRuns < 0)
+    {
+        fprintf(stderr, "EilatPortServer::Main::Error - Standby sessions must be between %d-%d"
+            " and the sessions and runs to serve may not be negative!\n",
+            MIN_NUMBER_OF_STANDBY_SESSIONS, MAX_NUMBER_OF_STANDBY_SESSIONS);
+        exit(EXIT_SUCCESS);
+    }
+
+    ServerSession sessions[MAX_NUMBER_OF_STANDBY_SESSIONS];
+    int numberOfSessions = 0;
+    int numberOfStartedSessions = 0;
+    int numberOfFailedSessions = 0;
+    int numberOfEarlyFailures = 0;
+    ULONGLONG startTime = GetTickCount64();
+
+    fprintf(stderr, "EilatPortServer: Serving '%s' with %d standby sessions\n", serverName,
+        numberOfStandbySessions);
+
+    for (;;)
+    {
+        // A session takes the place of every one which exited, till every session to serve started.
+        while (numberOfSessions < numberOfStandbySessions &&
+            (maxNumberOfSessions == 0 || numberOfStartedSessions < maxNumberOfSessions))
+        {
+            sessions[numberOfSessions].sessionNumber = ++numberOfStartedSessions;
+            startEilatPortSession(&sessions[numberOfSessions++], serverName, numberOfSessionRuns);
+        }
+
+        if (numberOfSessions == 0)
+        {
+            break;
+        }
+
+        // Comment: sessions which fail right away, as when the pipe's name is taken by another
+        // program, would otherwise be started again and again.
+        numberOfEarlyFailures = waitForAnySession(sessions, &numberOfSessions, &numberOfFailedSessions) ?
+            0 : numberOfEarlyFailures + 1;
+
+        if (numberOfEarlyFailures == MAX_EARLY_SESSION_FAILURES)
+        {
+            fprintf(stderr, "EilatPortServer::Main::Error - "
+                "%d sessions in a row failed as they started, giving up!\n", numberOfEarlyFailures);
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    fprintf(stderr, "EilatPortServer: %d sessions, %d failed, %.1f seconds\n",
+        numberOfStartedSessions, numberOfFailedSessions, (GetTickCount64() - startTime) / 1000.0);
+
+    return numberOfFailedSessions == 0 ? 0 : EXIT_FAILURE;
+}
+
+void startEilatPortSession(ServerSession* session, const char* serverName, int numberOfSessionRuns)
+{
+    TCHAR ProcessName[MAX_COMMAND_LINE];
+    STARTUPINFO startupInfo;
+    PROCESS_INFORMATION processInformation;
+
+    swprintf(ProcessName, MAX_COMMAND_LINE, L"EilatPort.exe -session %hs %d", serverName, numberOfSessionRuns);
+    SecureZeroMemory(&processInformation, sizeof(processInformation));
+    GetStartupInfo(&startupInfo);
+
+    // A session prints to the server's standard error, its messages go through the pipes.
+    startupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    startupInfo.hStdOutput = GetStdHandle(STD_OUTPUT_HANDLE);
+    startupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+
+    if (!CreateProcess(NULL,    // No module name (use command line).
+        ProcessName,            // Command line.
+        NULL,                   // Process handle not inheritable.
+        NULL,                   // Thread handle not inheritable.
+        TRUE,                   // Set handle inheritance to TRUE.
+        0,                      // No creation flags.
+        NULL,                   // Use parent's environment block.
+        NULL,                   // Use parent's starting directory.
+        &startupInfo,           // Pointer to STARTUPINFO structure.
+        &processInformation)    // Pointer to PROCESS_INFORMATION structure.
+        )
+    {
+        fprintf(stderr, "EilatPortServer::startEilatPortSession::Unexpected Error -"
+            " CreateProcess for EilatPort failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    CloseHandle(processInformation.hThread);
+
+    session->processHandle = processInformation.hProcess;
+    session->startTime = GetTickCount64();
+}
+
+int waitForAnySession(ServerSession sessions[], int* numberOfSessions, int* numberOfFailedSessions)
+{
+    HANDLE processHandles[MAX_NUMBER_OF_STANDBY_SESSIONS];
+
+    for (int i = 0; i < *numberOfSessions; i++)
+    {
+        processHandles[i] = sessions[i].processHandle;
+    }
+
+    DWORD waitResult = WaitForMultipleObjects(*numberOfSessions, processHandles, FALSE, INFINITE);
+
+    if (waitResult >= WAIT_OBJECT_0 + *numberOfSessions)
+    {
+        fprintf(stderr, "EilatPortServer::waitForAnySession::Unexpected Error - "
+            "Waiting for the sessions failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    ServerSession* session = &sessions[waitResult - WAIT_OBJECT_0];
+    DWORD exitCode = EXIT_FAILURE;
+    ULONGLONG sessionTime = GetTickCount64() - session->startTime;
+
+    GetExitCodeProcess(session->processHandle, &exitCode);
+    CloseHandle(session->processHandle);
+
+    fprintf(stderr, "EilatPortServer: Session %d exited with %lu after %.1f seconds\n",
+        session->sessionNumber, exitCode, sessionTime / 1000.0);
+
+    *numberOfFailedSessions += exitCode != 0;
+
+    // The last session takes the exited session's slot.
+    *session = sessions[--*numberOfSessions];
+
+    return exitCode == 0 || sessionTime >= EARLY_SESSION_FAILURE_TIME;
+}
@@ -0,0 +1,23 @@
+#ifndef EILAT_PORT_SERVER_H
+#define EILAT_PORT_SERVER_H
+
+#include <windows.h>
+
+// EilatPortServer keeps standby EilatPort sessions started, each an EilatPort.exe -session
+// which waits for a HaifaPort on an instance of the server's pipe, so a HaifaPort with -connect
+// doesn't wait for EilatPort's process to start. A session serves fleets one after another,
+// each from the default options, and keeps its run's arena committed in between. Once it
+// served its runs, or if it fails, the server starts another one in its place.
+//
+// Once a HaifaPort connects, the session writes its process ID through the server's pipe,
+// which names the session's own pipe, "<server's pipe>.<process ID>", for EilatPort's messages.
+// HaifaPort then writes the length of EilatPort's options and the options themselves, a
+// message's worth at a time. From then on each pipe is only written one way, as the anonymous
+// pipes are, since a synchronous handle serializes a read and a write to it.
+#define EILAT_PORT_SERVER_PIPE L"\\\\.\\pipe\\EilatPort" // Suffixed with the server's name, as a run's objects with its run id.
+#define EILAT_PORT_SERVER_WAIT 5000 // Miliseconds HaifaPort waits for a server whose pipe doesn't exist.
+#define EILAT_PORT_SERVER_RETRY 100 // Miliseconds HaifaPort waits between attempts to connect.
+#define EILAT_PORT_SERVER_MAX_OPTIONS 1024 // Longest options a HaifaPort gives a session, as its command line.
+#define EILAT_PORT_SERVER_MAX_ARGUMENTS 64 // Most arguments a session is given.
+
+#endif
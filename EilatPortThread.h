@@ -0,0 +1,22 @@
+#ifndef EILAT_PORT_THREAD_H
+#define EILAT_PORT_THREAD_H
+
+#include <windows.h>
+
+#include "MessageChannel.h"
+
+// Built with EILAT_PORT_DLL, EilatPort.c makes EilatPort.dll instead of EilatPort.exe.
+// HaifaPort's -inprocess option loads it and runs EilatPort on a thread of its own,
+// connected to HaifaPort by in-memory channels instead of pipes.
+#define EILAT_PORT_DLL_NAME L"EilatPort.dll"
+#define EILAT_PORT_THREAD_NAME "EilatPortThread"
+
+// Parameter of EilatPortThread, which owns its ends of the channels from then on.
+typedef struct {
+    int argc;
+    char** argv; // As EilatPort.exe's command line, argv[0] included.
+    MessageChannel* fromHaifaChannel;
+    MessageChannel* toHaifaChannel;
+} EilatPortThreadParameter;
+
+#endif
@@ -0,0 +1,357 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "FaultInjector.h"
+#include "StallDetector.h"
+
+#define MAX_FAULT_OPTION 512 // Longest -faults option.
+#define MAX_FAULT_SLOWDOWN 10000 // A crane or lane may take at most a hundred times its time.
+
+// Parses a single "<target>:<action>@<ms>" of the schedule. Returns FALSE if invalid.
+int parseFaultEvent(FaultEvent* event, char* value);
+// Returns the next number of the injector's own random stream, so drawing faults doesn't
+// change what the port's threads draw.
+ULONGLONG nextFaultRandom(FaultInjector* injector);
+ULONGLONG getFaultInjectorTime(FaultInjector* injector);
+
+int parseFaultSchedule(FaultInjector* injector, const char* value)
+{
+    char buffer[MAX_FAULT_OPTION];
+
+    if (strlen(value) >= MAX_FAULT_OPTION)
+    {
+        return FALSE;
+    }
+
+    strcpy(buffer, value);
+
+    for (char* entry = strtok(buffer, ","); entry != NULL; entry = strtok(NULL, ","))
+    {
+        if (injector->numberOfEvents == MAX_FAULT_EVENTS ||
+            !parseFaultEvent(&injector->events[injector->numberOfEvents], entry))
+        {
+            return FALSE;
+        }
+
+        // The schedule is kept sorted by time, it is only a few events long.
+        for (int i = injector->numberOfEvents; i > 0 && injector->events[i].time < injector->events[i - 1].time; i--)
+        {
+            FaultEvent event = injector->events[i];
+
+            injector->events[i] = injector->events[i - 1];
+            injector->events[i - 1] = event;
+        }
+
+        injector->numberOfEvents++;
+    }
+
+    return injector->numberOfEvents > 0;
+}
+
+int parseFaultEvent(FaultEvent* event, char* value)
+{
+    char* action = strchr(value, ':');
+    char* time = strchr(value, '@');
+
+    if (action == NULL || time == NULL || time < action)
+    {
+        return FALSE;
+    }
+
+    *action++ = '\0';
+    *time++ = '\0';
+    event->time = strtoull(time, NULL, 10);
+    event->value = 0;
+
+    if (strncmp(value, "crane", 5) == 0 && atoi(value + 5) >= 1)
+    {
+        event->target = FAULT_CRANE;
+        event->index = atoi(value + 5) - 1;
+    }
+    else if (strcmp(value, "canal-red") == 0 || strcmp(value, "canal-med") == 0)
+    {
+        event->target = FAULT_LANE;
+        event->index = strcmp(value, "canal-red") == 0 ? SUEZ_CANAL_MED_TO_RED : SUEZ_CANAL_RED_TO_MED;
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    if (strcmp(action, "fail") == 0)
+    {
+        event->action = FAULT_FAIL;
+    }
+    else if (strcmp(action, "recover") == 0)
+    {
+        event->action = FAULT_RECOVER;
+    }
+    else if (strncmp(action, "slow=", 5) == 0)
+    {
+        event->action = FAULT_SLOW;
+        event->value = atoi(action + 5);
+
+        // The percent is of the time it takes, so a crane or lane is never made faster than it is.
+        if (event->value < FAULT_FULL_SPEED || event->value > MAX_FAULT_SLOWDOWN)
+        {
+            return FALSE;
+        }
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+int parseFaultRate(FaultInjector* injector, const char* value)
+{
+    double failuresPerMinute;
+    unsigned long repairTime;
+
+    if (sscanf(value, "%lf:%lu", &failuresPerMinute, &repairTime) != 2 || failuresPerMinute <= 0.0 ||
+        repairTime < 1)
+    {
+        return FALSE;
+    }
+
+    injector->failuresPerMinute = failuresPerMinute;
+    injector->repairTime = (DWORD)repairTime;
+
+    return TRUE;
+}
+
+int startFaultInjector(FaultInjector* injector, CraneFault craneFaults[], int numberOfCranes, ULONGLONG seed)
+{
+    for (int i = 0; i < injector->numberOfEvents; i++)
+    {
+        if (injector->events[i].target == FAULT_CRANE && injector->events[i].index >= numberOfCranes)
+        {
+            return FALSE;
+        }
+    }
+
+    injector->craneFaults = craneFaults;
+    injector->numberOfCranes = numberOfCranes;
+    injector->randomState = seed ^ 0x9E3779B97F4A7C15ULL;
+
+    for (int i = 0; i < numberOfCranes; i++)
+    {
+        craneFaults[i].state = CRANE_UP;
+        craneFaults[i].slowdown = FAULT_FULL_SPEED;
+        craneFaults[i].failTime = 0;
+        craneFaults[i].repairTime = 0;
+    }
+
+    for (int i = 0; i < SUEZ_CANAL_DIRECTIONS; i++)
+    {
+        injector->laneFaults[i].isFailed = FALSE;
+        injector->laneFaults[i].slowdown = FAULT_FULL_SPEED;
+    }
+
+    injector->startTime = GetTickCount64();
+    injector->nextFailureTime = 0;
+
+    // The failures drawn by the rate are a Poisson process, each one an exponential interval
+    // after the previous one.
+    if (injector->failuresPerMinute > 0.0)
+    {
+        injector->nextFailureTime = (ULONGLONG)(-log(1.0 - (nextFaultRandom(injector) >> 11) / 9007199254740992.0) *
+            60000.0 / injector->failuresPerMinute);
+    }
+
+    return TRUE;
+}
+
+ULONGLONG nextFaultRandom(FaultInjector* injector)
+{
+    // xorshift64*
+    injector->randomState ^= injector->randomState >> 12;
+    injector->randomState ^= injector->randomState << 25;
+    injector->randomState ^= injector->randomState >> 27;
+
+    return injector->randomState * 2685821657736338717ULL;
+}
+
+ULONGLONG getFaultInjectorTime(FaultInjector* injector)
+{
+    return GetTickCount64() - injector->startTime;
+}
+
+int takeDueFaultEvent(FaultInjector* injector, FaultEvent* event)
+{
+    ULONGLONG now = getFaultInjectorTime(injector);
+
+    if (injector->nextEvent < injector->numberOfEvents && injector->events[injector->nextEvent].time <= now)
+    {
+        *event = injector->events[injector->nextEvent++];
+        return TRUE;
+    }
+
+    event->target = FAULT_CRANE;
+    event->value = 0;
+    event->time = now;
+
+    for (int i = 0; i < injector->numberOfCranes; i++)
+    {
+        if (injector->craneFaults[i].repairTime != 0 && injector->craneFaults[i].repairTime <= now)
+        {
+            injector->craneFaults[i].repairTime = 0;
+            event->index = i;
+            event->action = FAULT_RECOVER;
+            return TRUE;
+        }
+    }
+
+    if (injector->failuresPerMinute == 0.0 || now < injector->nextFailureTime)
+    {
+        return FALSE;
+    }
+
+    event->index = (int)(nextFaultRandom(injector) % injector->numberOfCranes);
+    event->action = FAULT_FAIL;
+    injector->nextFailureTime = now + (ULONGLONG)(-log(1.0 - (nextFaultRandom(injector) >> 11) / 9007199254740992.0) *
+        60000.0 / injector->failuresPerMinute);
+
+    // Comment: a failure which falls on a crane that is already down is lost, as it would be
+    // on a real quay, so the rate is of failures of the whole pool.
+    if (injector->craneFaults[event->index].state == CRANE_FAILED)
+    {
+        return FALSE;
+    }
+
+    injector->craneFaults[event->index].repairTime = now + injector->repairTime;
+
+    return TRUE;
+}
+
+int applyFaultEvent(FaultInjector* injector, FaultEvent* event)
+{
+    ULONGLONG now = getFaultInjectorTime(injector);
+
+    if (event->target == FAULT_LANE)
+    {
+        LaneFault* laneFault = &injector->laneFaults[event->index];
+
+        if (event->action == FAULT_FAIL)
+        {
+            if (laneFault->isFailed)
+            {
+                return FALSE;
+            }
+
+            laneFault->isFailed = TRUE;
+            injector->numberOfLaneFailures++;
+        }
+        else if (event->action == FAULT_SLOW)
+        {
+            laneFault->slowdown = event->value;
+        }
+        else
+        {
+            if (!laneFault->isFailed && laneFault->slowdown == FAULT_FULL_SPEED)
+            {
+                return FALSE;
+            }
+
+            laneFault->isFailed = FALSE;
+            laneFault->slowdown = FAULT_FULL_SPEED;
+        }
+
+        return TRUE;
+    }
+
+    CraneFault* craneFault = &injector->craneFaults[event->index];
+
+    if (event->action == FAULT_FAIL)
+    {
+        if (craneFault->state == CRANE_FAILED)
+        {
+            return FALSE;
+        }
+
+        craneFault->failTime = now;
+        InterlockedExchange(&craneFault->state, CRANE_FAILED);
+        injector->numberOfCraneFailures++;
+    }
+    else if (event->action == FAULT_SLOW)
+    {
+        craneFault->slowdown = event->value;
+    }
+    else
+    {
+        if (craneFault->state == CRANE_UP && craneFault->slowdown == FAULT_FULL_SPEED)
+        {
+            return FALSE;
+        }
+
+        if (craneFault->state == CRANE_FAILED)
+        {
+            injector->craneDownTime += now - craneFault->failTime;
+        }
+
+        craneFault->slowdown = FAULT_FULL_SPEED;
+        craneFault->repairTime = 0;
+        InterlockedExchange(&craneFault->state, CRANE_UP);
+    }
+
+    return TRUE;
+}
+
+int stallCrane(FaultInjector* injector, int craneIndex)
+{
+    if (InterlockedCompareExchange(&injector->craneFaults[craneIndex].state, CRANE_STALLED, CRANE_UP) != CRANE_UP)
+    {
+        return FALSE;
+    }
+
+    injector->numberOfCraneStalls++;
+
+    return TRUE;
+}
+
+void transitFaultedLane(FaultInjector* injector, int direction, DWORD transitTime)
+{
+    LaneFault* laneFault = &injector->laneFaults[direction];
+
+    for (DWORD transitedTime = 0; transitedTime < transitTime; transitedTime += FAULT_SLICE)
+    {
+        // A failed lane holds the vessels in it where they are, till it recovers.
+        if (laneFault->isFailed)
+        {
+            beginStallWait("failedCanalLane");
+
+            while (laneFault->isFailed)
+            {
+                Sleep(FAULT_INJECTOR_INTERVAL);
+            }
+
+            endStallWait();
+        }
+
+        DWORD slice = transitTime - transitedTime < FAULT_SLICE ? transitTime - transitedTime : FAULT_SLICE;
+
+        Sleep((DWORD)((ULONGLONG)slice * laneFault->slowdown / FAULT_FULL_SPEED));
+    }
+}
+
+ULONGLONG getCraneDownTime(FaultInjector* injector)
+{
+    ULONGLONG now = getFaultInjectorTime(injector);
+    ULONGLONG craneDownTime = injector->craneDownTime;
+
+    for (int i = 0; i < injector->numberOfCranes; i++)
+    {
+        if (injector->craneFaults[i].state == CRANE_FAILED)
+        {
+            craneDownTime += now - injector->craneFaults[i].failTime;
+        }
+    }
+
+    return craneDownTime;
+}
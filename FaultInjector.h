@@ -0,0 +1,90 @@
+#ifndef FAULT_INJECTOR_H
+#define FAULT_INJECTOR_H
+
+#include <windows.h>
+
+#include "SuezCanal.h"
+
+// Targets of a fault.
+#define FAULT_CRANE 0
+#define FAULT_LANE 1 // A lane of the canal as EilatPort's vessels transit it, by its direction.
+
+// Actions of a fault.
+#define FAULT_FAIL 0 // The crane stops unloading, or the lane holds its vessels, till it recovers.
+#define FAULT_SLOW 1 // The crane or lane takes value percent of its time.
+#define FAULT_RECOVER 2 // Undoes a failure and a slow down.
+
+// States of a crane.
+#define CRANE_UP 0
+#define CRANE_FAILED 1 // Failed by the schedule or the failure rate, till it recovers.
+#define CRANE_STALLED 2 // Unloaded longer than -cranetimeout, till its thread checks in again.
+
+#define MAX_FAULT_EVENTS 32
+#define FAULT_INJECTOR_INTERVAL 100 // Miliseconds between the supervisor's checks, and a held crane's or vessel's.
+#define FAULT_SLICE 100 // A crane unloads and a vessel transits this many miliseconds at a time, so a fault takes hold within it.
+#define FAULT_FULL_SPEED 100 // Percent of its time a crane or lane takes when it isn't slowed.
+
+// A fault of the schedule, or one drawn by the failure rate.
+typedef struct {
+    int target;
+    int index; // The crane's index, or the lane's direction.
+    int action;
+    int value;
+    ULONGLONG time; // Miliseconds after the injector started.
+} FaultEvent;
+
+typedef struct {
+    volatile LONG state;
+    volatile LONG slowdown; // Percent of its unloading time the crane takes.
+    ULONGLONG failTime; // Miliseconds after the injector started, as the rest of its times.
+    ULONGLONG repairTime; // When a failure drawn by the rate is repaired, 0 for any other.
+} CraneFault;
+
+typedef struct {
+    volatile LONG isFailed;
+    volatile LONG slowdown;
+} LaneFault;
+
+// Faults injected into EilatPort's cranes and canal lanes, on the schedule set with -faults and
+// at random at the rate set with -faultrate. Only the fault supervisor applies them, the cranes
+// and vessels read their state without a lock.
+typedef struct {
+    FaultEvent events[MAX_FAULT_EVENTS]; // Sorted by their time.
+    int numberOfEvents;
+    int nextEvent;
+    double failuresPerMinute;
+    DWORD repairTime;
+    ULONGLONG nextFailureTime;
+    ULONGLONG randomState;
+    ULONGLONG startTime;
+    CraneFault* craneFaults;
+    int numberOfCranes;
+    LaneFault laneFaults[SUEZ_CANAL_DIRECTIONS];
+    // Statistics for the report.
+    int numberOfCraneFailures;
+    int numberOfCraneStalls;
+    int numberOfLaneFailures;
+    ULONGLONG craneDownTime;
+    int numberOfMovedVessels;
+} FaultInjector;
+
+// Parses "<target>:<action>@<ms>[,...]" of a -faults option, where a target is crane<ID>,
+// canal-red or canal-med and an action is fail, slow=<percent> or recover. Returns FALSE if invalid.
+int parseFaultSchedule(FaultInjector* injector, const char* value);
+// Parses "<failures per minute>:<repair ms>" of a -faultrate option. Returns FALSE if invalid.
+int parseFaultRate(FaultInjector* injector, const char* value);
+// Starts the schedule's clock, with every crane and lane up. Returns FALSE if the schedule
+// names a crane the fleet doesn't have.
+int startFaultInjector(FaultInjector* injector, CraneFault craneFaults[], int numberOfCranes, ULONGLONG seed);
+// Takes the next fault which is due, of the schedule or drawn by the rate. Returns FALSE if none is.
+int takeDueFaultEvent(FaultInjector* injector, FaultEvent* event);
+// Applies the fault. Returns FALSE if it changed nothing, as failing a failed crane.
+int applyFaultEvent(FaultInjector* injector, FaultEvent* event);
+// Marks a crane which unloaded too long as stalled. Returns FALSE if it already isn't up.
+int stallCrane(FaultInjector* injector, int craneIndex);
+// Transits the lane, held while it is failed and as slow as it is.
+void transitFaultedLane(FaultInjector* injector, int direction, DWORD transitTime);
+// Returns how many miliseconds the cranes were down, the ones still failed up till now.
+ULONGLONG getCraneDownTime(FaultInjector* injector);
+
+#endif
@@ -2,485 +2,2221 @@
 
 #include <stdio.h> 
 #include <stdlib.h> 
+#include <string.h>
 #include <windows.h> 
 #include <time.h> 
 
+#include "SuezCanal.h"
+#include "MessageChannel.h"
+#include "EilatPortThread.h"
+#include "RunNamespace.h"
+#include "LatencyHistogram.h"
+#include "ServiceTime.h"
+#include "ParkingLot.h"
+#include "LockProfiler.h"
+#include "ThreadPlacement.h"
+#include "EilatPortServer.h"
+#include "SafeCalls.h"
+
 #define MIN_NUMBER_OF_VESSELS 2
 #define MAX_NUMBER_OF_VESSELS 50
+#define MAX_NUMBER_OF_MANIFEST_VESSELS 10000000 // Upper bound for fleets read from a manifest file.
 
-#define MIN_SLEEP_TIME 5 // 5 miliseconds 
+#define MIN_SLEEP_TIME 5 // 5 miliseconds, every stage's default is uniform in between.
 #define MAX_SLEEP_TIME 3000 // 3 seconds
 
-#define BUFFER_SIZE 60 // Size of largest message to send/receive through pipes.
+#define BUFFER_SIZE MESSAGE_SIZE // Size of largest message to send/receive through pipes.
 #define MAX_STRING 200 // Size of the larget string to send to the safe fprintf.
-
-// Random Functions:
-// Thread safe rand()
-int safeRand(void);
-// Calculates sleep time according to the defined MIN_SLEEP_TIME and MAX_SLEEP_TIME.
-int randomSleepTime(void);
+#define MAX_COMMAND_LINE 1024 // Size of the largest command line to start EilatPort with.
+#define MAX_EILAT_PORT_RESTARTS 3 // Times EilatPort is restarted from its journal before giving up.
+#define MAX_EILAT_PORT_ARGUMENTS 64 // Most arguments EilatPort's thread is given with -inprocess.
+#define MAX_WATCHED_PORT_THREADS 4 // HaifaPort's threads the stall detector watches besides the vessels.
+#define DEFAULT_NUMBER_OF_LOADING_CRANES 2
+#define MAX_NUMBER_OF_LOADING_CRANES 25
+#define MIN_WEIGHT 5 // min weight for cargo, as EilatPort draws it.
+#define MAX_WEIGHT 50 // max weight for cargo.
+
+#define MANIFEST_MAGIC "VMAN" // First 4 bytes of a binary manifest file.
+
+// Stages of a voyage as HaifaPort sees them, each has its latencies in the results.
+#define VOYAGE_DEPART 0 // Leaving HaifaPort.
+#define VOYAGE_OUTBOUND 1 // Waiting for a credit and the canal, and sailing to EilatPort.
+#define VOYAGE_EILAT 2 // In EilatPort and sailing back, till HaifaPort reads the vessel's return.
+#define VOYAGE_DOCK 3 // Docking at HaifaPort and leaving the canal.
+#define VOYAGE_STAGES 4
+
+// A single vessel of the fleet. Binary manifests are an array of these records,
+// CSV manifests hold one "vesselId,cargoWeight,priority,departureTime" line per record.
+typedef struct {
+    int vesselId;
+    int cargoWeight; // Tons, -1 lets EilatPort draw a random weight.
+    int priority;
+    int departureTime; // Miliseconds after the first departure.
+} VesselRecord;
+
+// Header of a binary manifest, followed by numberOfRecords VesselRecords.
+typedef struct {
+    char magic[4];
+    int numberOfRecords;
+} ManifestHeader;
+
+// A station of HaifaPort's loading quay, where a vessel is loaded by the station's crane
+// before each of its round trips.
+typedef struct {
+    int craneId;
+    int vesselId;
+    int vesselSlot;
+    int cargoWeight;
+    int isOccupied;
+} LoadingQuayStation;
+
+// The fleet's manifest. The file is memory-mapped and records are parsed one at a time,
+// only when the vessel is about to depart. Without a file the fleet is generated
+// from the number of vessels given at the command line.
+typedef struct {
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+    const char* view;
+    LONGLONG viewSize;
+    LONGLONG position; // Offset of the next unread record in the view.
+    int isBinary;
+    int numberOfRecords;
+    int numberOfReadRecords;
+    unsigned char* vesselIdsRead; // A bit for every vessel ID read from the file, so a duplicate is rejected.
+} FleetManifest;
 
 // Initialize and destruct all global Mutexes/Semaphores.
 void initializeGlobalMutexAndSemaphores(int numberOfVessels, SECURITY_ATTRIBUTES* securityAttributes);
-void cleanGlobalMutexAndSemaphores(int numberOfVessels);
+void cleanGlobalMutexAndSemaphores(void);
+// Allocate the state of the vessels in flight, a slot for every credit of EilatPort's first grant.
+void initializeVesselSlots(int numberOfSlots);
+// Take a free slot for a departing vessel, waiting till one is, and free it once the vessel is done.
+int takeVesselSlot(void);
+void freeVesselSlot(int vesselSlot);
+
+// Functions which support handling the fleet manifest.
+// Returns TRUE if the argument is a number of vessels rather than a manifest file.
+int isNumberOfVesselsArgument(const char* argument);
+void openGeneratedFleetManifest(FleetManifest* manifest, int numberOfVessels);
+void openFleetManifestFile(FleetManifest* manifest, const char* fileName);
+void closeFleetManifest(FleetManifest* manifest);
+// Parses the next record of the manifest. Returns FALSE once all records were read.
+int readNextVesselRecord(FleetManifest* manifest, VesselRecord* vesselRecord);
+int countManifestLines(const char* view, LONGLONG viewSize);
+int parseManifestField(FleetManifest* manifest, int* value);
 
 // Main thread functions:
 // Creates 'Med. Sea ==> Red Sea' and 'Med. Sea <== Red Sea' pipes.
 void createSuezCanalPipes(SECURITY_ATTRIBUTES* securityAttributes);
+// Join the command line options which are meant for EilatPort into its arguments.
+void buildEilatPortArguments(int argc, char* argv[], char eilatPortArguments[]);
+// Parse HaifaPort's own option at argv[i]. Returns the number of arguments it takes, 0 if it isn't one.
+int parseHaifaPortOption(int argc, char* argv[], int i);
+// Create the thread which switches the canal's direction and admits convoys.
+HANDLE createSuezCanalControllerThread(void);
+// Print the canal's throughput under its policy, the number of convoys and the wait to enter it.
+void printSuezCanalReport(void);
+// Start EilatPort as a process connected by pipes, or with -inprocess as a thread connected
+// by in-memory channels, and set both channels to it.
+void startEilatPort(const char* eilatPortArguments, SECURITY_ATTRIBUTES* securityAttributes);
 // Set the STARTUPINFO struct and create EilatPort process.
-void setStartUpInfoAndStartEilatPortProcess(void);
+void setStartUpInfoAndStartEilatPortProcess(const char* eilatPortArguments);
+// Load EilatPort.dll and run EilatPort on a thread with the given arguments.
+void startEilatPortThread(const char* eilatPortArguments);
+// Wait for EilatPort's thread to end and unload EilatPort.dll.
+void waitForEilatPortThread(void);
+// Connect to a standby session of the EilatPort server given with -connect, and give it EilatPort's options.
+void connectToEilatPortServer(const char* eilatPortArguments);
+// Print how long EilatPort took to start and to write a message, in either mode.
+void printEilatPortStartUpReport(void);
+// Print the profiled primitives ranked by their total wait, if built with PORT_LOCK_PROFILER.
+void printLockProfileReport(void);
+// Print the placement policy and the hand-offs' count, p50, p99 and jitter.
+void printPlacementReport(void);
+// With -results print the run's makespan, throughput and voyage percentiles as a CSV row
+// to the standard output, which is otherwise unused.
+void printResults(int numberOfVessels, ULONGLONG makespan);
+// Reads the process's kernel and user time in 100 nanoseconds. Returns FALSE if it couldn't be read.
+int getProcessCpuTicks(HANDLE processHandle, ULONGLONG* kernelTicks, ULONGLONG* userTicks);
 // Handles all of the passage approval process between Haifa and Eilat ports.
 void suezCanalPassageApproval(int numberOfVessels);
-// Create all vessel threads according to the number given at the command line.
-HANDLE* createVesselThreads(int numberOfVessels, int** vesselsId);
+// Reads the credits a new EilatPort grants once it approved the passage. Returns their number.
+int readInitialTransitCredits(void);
+// Create the thread which streams the manifest and starts every vessel at its departure time.
+HANDLE createDeparturesThread(FleetManifest* manifest);
 // Listen for incoming vessels from 'Med. Sea <== Red Sea' pipe and signal them to continue.
-void readIncomingVesselsFromEilatPort(int numberOfVessels);
+// If EilatPort stops and it has a journal, it is restarted to recover from it.
+void readIncomingVesselsFromEilatPort(int numberOfVessels, const char* eilatPortArguments,
+    SECURITY_ATTRIBUTES* securityAttributes);
+// Set the stages' distributions given with -service, the seed given with -seed, the stall
+// detector's threshold given with -stall and the placement policy given with -placement,
+// which are passed on to EilatPort as well.
+void parseSharedOptions(int argc, char* argv[]);
+// Returns TRUE if EilatPort's options give it a journal, so it may be restarted.
+int isEilatPortRecoverable(int argc, char* argv[]);
+// Start a new EilatPort with -recover and resend it the vessels in flight.
+void restartEilatPort(int numberOfVessels, int numberOfReturnedVessels,
+    const char* eilatPortArguments, SECURITY_ATTRIBUTES* securityAttributes);
 // Write To EilatPort that all Vessel threads are done and also wait till all EilatPort 
 // threads are done.
 void updateEilatAllVesselsDoneAndWaitForThreads(void);
-// Free vessels HANDLER and CloseHandle.
-void freeVesselThreads(HANDLE* vesselsHandler, int* vesselsId, int numberOfVessels);
-
-// fprintf may be a thread safe function, though it isn't process safe and for that reason
-// the function is protected by a semaphore that is shared between both HaifaPort and EilatPort.
-int safePrintWithTimeStamp(char string[]);
-
-// The vessels thread function.
+// Wait for every vessel thread to signal vesselsDoneSemaphore.
+void waitForVesselThreads(int numberOfVessels);
+
+// Functions of round trips:
+// Decides whether the returned vessel sails again and counts its voyage, before it is signaled.
+// Returns TRUE if it does.
+int isVesselSailingAgain(int vesselSlot, int numberOfVessels, int numberOfDoneVessels);
+// Write to EilatPort that no vessel arrives anymore, as vessel ID 0.
+void endVoyagesAtEilatPort(void);
+// Create the loading quay's stations and crane threads, and stop them once every voyage is done.
+void createLoadingCraneThreads(void);
+void stopLoadingCraneThreads(void);
+// Print the voyages per second over the whole run and in steady state, and the loading quay's waits.
+void printRoundTripReport(int numberOfVessels, ULONGLONG makespan);
+
+// The departures, vessels and loading cranes thread functions.
+DWORD WINAPI Departures(LPVOID Param);
 DWORD WINAPI Vessel(LPVOID Param);
+DWORD WINAPI LoadingCrane(LPVOID Param);
 
 // These functions are pieces of the vessel thread:
+// Loads the vessel at a station of the loading quay, with the manifest's cargo weight or a random one.
+int loadVesselAtHaifaPort(VesselRecord* vesselRecord, int vesselSlot, int manifestCargoWeight);
 int startSailing(int vesselId);
-int sailToEilatPort(int vesselId);
-int returnFromEilatToEndSailing(int vesselId);
+int sailToEilatPort(VesselRecord* vesselRecord, int vesselSlot);
+int returnFromEilatToEndSailing(int vesselId, int vesselSlot, ULONGLONG* stageStartTime);
+// Records the latency of the voyage's stage which started at stageStartTime, the next stage
+// starts now. Returns 0, so it may be chained between the pieces of the vessel thread.
+int recordVoyageStage(int stage, ULONGLONG* stageStartTime);
 
 // Struct for Date and Time. Fill in the struct with GetLocalTime().
 SYSTEMTIME currentTime; 
 
-// With this duo we are able to allow only 1 vessel at a time to be in the canal
-HANDLE medToRedCanalSemaphore; // Mutex to allow only one vessel at a time to enter the canal (pipe).
-HANDLE redToMedCanalSemaphore; // Mutex to allow only one vessel at a time to exit the canal (pipe).
-
-// Mutex to make rand() thread safe.
-HANDLE randomMutex;
-
-// The reasoning behind the semaphore is to prevent race conditions.
-// fprintf is a thread safe function, although it isn't process safe. 
-// To solve this problem both HaifaPort and EilatPort need to wait untill it's their turn to print.
-HANDLE processSafePrintSemaphore;
-
-// Semaphore for each Vessel to signal when to wait and continue.
-HANDLE* vesselsSemaphores; 
+// Names every shared object of this run, set with -run or to HaifaPort's process ID.
+char runId[MAX_RUN_ID + 1] = "";
+
+// The canal has a single lane for both directions, its controller groups the waiting vessels
+// into convoys and switches the lane's direction by the policy set with -canal and -switch.
+SuezCanal* suezCanal;
+int canalPolicy = SUEZ_CANAL_DEFAULT_POLICY;
+int canalPolicyParameter = -1; // -1 takes the policy's default.
+int canalConvoySize = SUEZ_CANAL_DEFAULT_CONVOY_SIZE;
+// Vessels which returned from EilatPort and haven't left the lane yet.
+volatile LONG numberOfVesselsLeavingCanal = 0;
+
+// Transit credits EilatPort has granted, a vessel takes one before it departs and EilatPort
+// returns it once the vessel departs from there.
+HANDLE transitCreditsSemaphore;
+int numberOfReceivedCredits = 0; // Credits granted by the running EilatPort.
+volatile LONG numberOfUsedCredits = 0; // Credits of vessels written to the running EilatPort's pipe.
+
+// A departed vessel holds a slot till its thread is done, and the state below is kept by slot
+// rather than by vessel ID, so it takes as much memory as there are credits whatever the fleet's
+// size. EilatPort returns a vessel's slot along with the vessel.
+int numberOfVesselSlots;
+VesselRecord* vesselSlotRecords;
+int* freeVesselSlots;
+int numberOfFreeVesselSlots;
+SRWLOCK vesselSlotsLock = SRWLOCK_INIT;
+HANDLE vesselSlotsSemaphore; // Counts the free slots.
+
+// Wait word for each Vessel to signal when to wait and continue.
+WaitWord* vesselsWaitWords;
+HandOffStamp* vesselsHandOffStamps; // When each vessel's wait word was signaled.
+
+// Semaphore which every vessel thread signals once it is done. Vessel thread handles
+// are closed as soon as the thread starts, so a fleet isn't limited by MAXIMUM_WAIT_OBJECTS.
+HANDLE vesselsDoneSemaphore;
+
+// Contention of the primitives above, reported on exit when built with PORT_LOCK_PROFILER.
+LockProfile transitCreditsSemaphoreProfile = SIGNAL_PROFILE("transitCreditsSemaphore");
+LockProfile vesselSlotsSemaphoreProfile = SIGNAL_PROFILE("vesselSlotsSemaphore");
+LockProfile vesselsWaitWordsProfile = SIGNAL_PROFILE("vesselsWaitWords");
+LockProfile vesselsDoneSemaphoreProfile = SIGNAL_PROFILE("vesselsDoneSemaphore");
+
+// Vessels which were written to 'Med. Sea ==> Red Sea' pipe and haven't returned yet, by slot.
+// EilatPort's pipe is only replaced while eilatPortLock is held exclusively, vessels write to it
+// holding it shared.
+VesselRecord* volatile* vesselsInFlight;
+SRWLOCK eilatPortLock = SRWLOCK_INIT;
+int isRecoverable = FALSE;
+int numberOfEilatPortRestarts = 0;
+
+// With -inprocess EilatPort runs on a thread of HaifaPort, loaded from EilatPort.dll,
+// so the cost of starting a process and of the pipes can be compared against it.
+int isInProcess = FALSE;
+HMODULE eilatPortModule;
+HANDLE eilatPortThreadHandler;
+EilatPortThreadParameter eilatPortThreadParameter;
+char eilatPortThreadArguments[MAX_COMMAND_LINE];
+char* eilatPortThreadArgv[MAX_EILAT_PORT_ARGUMENTS];
+// With -connect EilatPort is a session an EilatPortServer of this name started ahead of the run.
+char eilatPortServerName[MAX_RUN_ID + 1] = "";
+// Voyage of every vessel, from its departure till it returned to HaifaPort, its stages,
+// and whether they are printed as a CSV row once the run is done.
+LatencyHistogram voyageLatencies;
+LatencyHistogram voyageStageLatencies[VOYAGE_STAGES];
+// Time in microseconds from signaling a returned vessel till its thread runs, under the
+// placement policy set with -placement.
+LatencyHistogram handOffHistogram;
+int threadPlacementPolicy = PLACEMENT_NONE;
+int isPrintingResults = FALSE;
+HANDLE eilatPortProcessHandle = NULL; // For EilatPort's CPU time in the results.
+// CPU time a server's session had taken on its earlier runs when this run connected to it, 100 nanoseconds.
+ULONGLONG eilatPortBaseKernelTicks = 0;
+ULONGLONG eilatPortBaseUserTicks = 0;
+
+// Seeds rand() and the service times, set with -seed or by the time.
+unsigned int randomSeed;
+
+// Waits longer than this many miliseconds are reported by the stall detector, set with -stall.
+// 0 runs without it.
+DWORD stallDetectorThreshold = 0;
+
+// In round trips every vessel is loaded and sails again once it returned, for the voyages set
+// with -voyages (0 for no limit) or till the duration set with -duration in seconds is over.
+// The main thread decides whether a returned vessel sails again, before it signals the vessel.
+int maxNumberOfVoyages = 1;
+int voyagesDuration = 0;
+int isRoundTrip = FALSE;
+ULONGLONG voyagesDeadline = 0; // No voyage starts after it, 0 without -duration.
+int* vesselsNumberOfVoyages;
+int* vesselsSailingAgain;
+int numberOfReturnedVoyages = 0;
+// Steady state starts once as many voyages returned as the fleet has vessels, and ends once
+// the first vessel doesn't sail again.
+int isInSteadyState = FALSE;
+int numberOfSteadyStateVoyages = 0;
+ULONGLONG steadyStateStartTime = 0, steadyStateEndTime = 0;
+
+// The loading quay, a station for each loading crane set with -loaders.
+LoadingQuayStation* loadingQuayStations;
+int numberOfLoadingCranes = DEFAULT_NUMBER_OF_LOADING_CRANES;
+int* loadingCranesId;
+HANDLE* loadingCranesHandlers;
+HANDLE loadingQuaySemaphore; // Counts the free stations.
+HANDLE loadingStationMutex; // Only one vessel at a time takes or leaves a station.
+WaitWord* loadingCranesWaitWords; // Wait word for each loading crane to signal it when to load.
+HandOffStamp* loadingCranesHandOffStamps;
+volatile int areAllVoyagesDone = FALSE;
+LatencyHistogram loadingWaitHistogram; // Time vessels waited for a free station.
+LockProfile loadingQuaySemaphoreProfile = SIGNAL_PROFILE("loadingQuaySemaphore");
+LockProfile loadingStationMutexProfile = LOCK_PROFILE("loadingStationMutex");
+LockProfile loadingCranesWaitWordsProfile = SIGNAL_PROFILE("loadingCranesWaitWords");
+
+LARGE_INTEGER eilatPortStartTicks; // Set once EilatPort is started, till its passage result is read.
+double eilatPortStartUpTime; // Miliseconds.
 
 // Variables which support our pipes.
 HANDLE readFromHaifaHandle, writeToEilatHandle; // Output and Input for Med. Sea ==> Red Sea Pipe.
 HANDLE readFromEilatHandle, writeToHaifaHandle; // Output and Input for Med. Sea <== Red Sea Pipe.
-DWORD numberOfReadBytes, numberOfWrittenBytes;
+// HaifaPort's ends of the link to EilatPort, over the pipes or in memory.
+MessageChannel* toEilatChannel;
+MessageChannel* fromEilatChannel;
 char buffer[BUFFER_SIZE]; // Contains messages that are sent/received through pipes.
 
 int main(int argc, char* argv[])
 {
     // Check that the user's input is valid and save it to a variable.
-    if (argc != 2)
+    if (argc < 2)
     {
         fprintf(stderr, "HaifaPort::Main::Error - Number of arguments is invalid!"
-            " Please enter only 1 arguement!\n");
+            " Please enter the number of vessels or a manifest file, followed by options!\n");
         exit(EXIT_SUCCESS);
     }
 
-    const int numberOfVessels = atoi(argv[1]);
+    char eilatPortArguments[MAX_COMMAND_LINE];
+    initializeServiceTimes(MIN_SLEEP_TIME, MAX_SLEEP_TIME);
+    parseSharedOptions(argc, argv);
+    buildEilatPortArguments(argc, argv, eilatPortArguments);
+    // Comment: EilatPort's thread can't be restarted from its journal, a failed thread takes
+    // the whole process down with it. A server's session isn't started by HaifaPort, so neither
+    // can it be restarted.
+    isRecoverable = !isInProcess && eilatPortServerName[0] == '\0' && isEilatPortRecoverable(argc, argv);
+
+    if (isInProcess && eilatPortServerName[0] != '\0')
+    {
+        fprintf(stderr, "HaifaPort::Main::Error - -inprocess and -connect can't be combined!\n");
+        exit(EXIT_SUCCESS);
+    }
 
-    if (numberOfVessels < MIN_NUMBER_OF_VESSELS || numberOfVessels > MAX_NUMBER_OF_VESSELS)
+    // Comment: a journal resumes every vessel once, while in round trips a vessel arrives again.
+    if (isRoundTrip && isEilatPortRecoverable(argc, argv))
     {
-        fprintf(stderr, "HaifaPort::Main::Error - Number of vessels must be between %d-%d!\n",
-            MIN_NUMBER_OF_VESSELS, MAX_NUMBER_OF_VESSELS);
+        fprintf(stderr, "HaifaPort::Main::Error - Round trips can't be kept in a -journal!\n");
         exit(EXIT_SUCCESS);
     }
 
+    if (canalPolicyParameter == -1)
+    {
+        canalPolicyParameter = getSuezCanalDefaultParameter(canalPolicy);
+    }
+
+    FleetManifest fleetManifest;
+
+    if (isNumberOfVesselsArgument(argv[1]))
+    {
+        int numberOfGeneratedVessels = atoi(argv[1]);
+
+        if (numberOfGeneratedVessels < MIN_NUMBER_OF_VESSELS ||
+            numberOfGeneratedVessels > MAX_NUMBER_OF_VESSELS)
+        {
+            fprintf(stderr, "HaifaPort::Main::Error - Number of vessels must be between %d-%d!\n",
+                MIN_NUMBER_OF_VESSELS, MAX_NUMBER_OF_VESSELS);
+            exit(EXIT_SUCCESS);
+        }
+
+        openGeneratedFleetManifest(&fleetManifest, numberOfGeneratedVessels);
+    }
+    else
+    {
+        openFleetManifestFile(&fleetManifest, argv[1]);
+    }
+
+    const int numberOfVessels = fleetManifest.numberOfRecords;
+
+    // This thread reads the pipe from EilatPort.
+    if (!initializeThreadPlacement(threadPlacementPolicy, PLACEMENT_HAIFA_PORT, 1,
+        isRoundTrip ? numberOfLoadingCranes : 0) || !placeThread(GetCurrentThread(), PLACEMENT_CANAL_IO, 0))
+    {
+        fprintf(stderr, "HaifaPort::Main::Unexpected Error - Thread placement failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
     // Set seed for rand() function.
-    srand((unsigned int)time(NULL));
+    srand(randomSeed);
 
     // Set-up security attributes, so that handles may be inherited.
     SECURITY_ATTRIBUTES securityAttributes = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
 
-    createSuezCanalPipes(&securityAttributes);
-
     // Initialize Mutex/Semaphores before the EilatPort process is created,
     // so they can be inherited if so desired.
     initializeGlobalMutexAndSemaphores(numberOfVessels, &securityAttributes);
 
-    setStartUpInfoAndStartEilatPortProcess();
-
-    // Close HaifaPort's unused ends of the pipes.
-    CloseHandle(readFromHaifaHandle);
-    CloseHandle(writeToHaifaHandle);
+    startEilatPort(eilatPortArguments, &securityAttributes);
 
     // Send the number of vessels to EilatPort and operate according to the approval result.
     suezCanalPassageApproval(numberOfVessels);
 
-    // Run all vessel threads and Wait for them to return from EilatPort.
-    int* vesselsId = NULL;
-    HANDLE* vesselsHandler = createVesselThreads(numberOfVessels, &vesselsId);
-    readIncomingVesselsFromEilatPort(numberOfVessels);
+    // The vessels in flight are kept by slot, a slot for every credit EilatPort granted.
+    initializeVesselSlots(readInitialTransitCredits());
+
+    // Comment: a departed vessel's thread holds its slot till it is done, so the slots bound
+    // the threads watched at once.
+    if (stallDetectorThreshold > 0)
+    {
+        if (!startStallDetector("Haifa Port", numberOfVesselSlots + (isRoundTrip ? numberOfLoadingCranes : 0) +
+            MAX_WATCHED_PORT_THREADS, stallDetectorThreshold))
+        {
+            exit(EXIT_FAILURE);
+        }
+
+        watchStallThread("Main", 0);
+    }
+
+    if (isRoundTrip)
+    {
+        createLoadingCraneThreads();
+    }
+
+    HANDLE suezCanalControllerHandler = createSuezCanalControllerThread();
+
+    // Start the vessels by their departure times and Wait for them to return from EilatPort.
+    ULONGLONG firstDepartureTime = GetTickCount64();
+
+    voyagesDeadline = voyagesDuration > 0 ? firstDepartureTime + voyagesDuration * 1000ULL : 0;
+
+    HANDLE departuresHandler = createDeparturesThread(&fleetManifest);
+    readIncomingVesselsFromEilatPort(numberOfVessels, eilatPortArguments, &securityAttributes);
+
+    if (isRoundTrip)
+    {
+        endVoyagesAtEilatPort();
+    }
 
     // Wait for all vessels threads to terminate.
-    WaitForMultipleObjects(numberOfVessels, vesselsHandler, TRUE, INFINITE);
+    WaitForSingleObject(departuresHandler, INFINITE);
+    CloseHandle(departuresHandler);
+    waitForVesselThreads(numberOfVessels);
+    ULONGLONG makespan = GetTickCount64() - firstDepartureTime;
     updateEilatAllVesselsDoneAndWaitForThreads();
+
+    if (isRoundTrip)
+    {
+        stopLoadingCraneThreads();
+    }
+
+    stopSuezCanalController(suezCanal, suezCanalControllerHandler);
+    CloseHandle(suezCanalControllerHandler);
+    printSuezCanalReport();
+    printEilatPortStartUpReport();
+    printPlacementReport();
+    printRoundTripReport(numberOfVessels, makespan);
+    printLockProfileReport();
+    // In round trips every voyage counts as a vessel of the results.
+    printResults(isRoundTrip ? numberOfReturnedVoyages : numberOfVessels, makespan);
     
     // Close HaifaPorts ends of pipes.
-    CloseHandle(readFromEilatHandle);
-    CloseHandle(writeToEilatHandle);
+    closeMessageChannel(fromEilatChannel);
+    closeMessageChannel(toEilatChannel);
+
+    if (isInProcess)
+    {
+        waitForEilatPortThread();
+    }
 
-    freeVesselThreads(vesselsHandler, vesselsId, numberOfVessels);
-    cleanGlobalMutexAndSemaphores(numberOfVessels);
+    closeFleetManifest(&fleetManifest);
+    stopStallDetector();
+    cleanGlobalMutexAndSemaphores();
 
     GetLocalTime(&currentTime);
     fprintf(stderr, "[%02d:%02d:%02d] Haifa Port: Exiting...\n",
         currentTime.wHour, currentTime.wMinute, currentTime.wSecond);
 
-    return 0;
+    return 0;
+}
+
+int isNumberOfVesselsArgument(const char* argument)
+{
+    for (int i = 0; argument[i] != '\0'; i++)
+    {
+        if (argument[i] < '0' || argument[i] > '9')
+        {
+            return FALSE;
+        }
+    }
+
+    return argument[0] != '\0';
+}
+
+void openGeneratedFleetManifest(FleetManifest* manifest, int numberOfVessels)
+{
+    SecureZeroMemory(manifest, sizeof(FleetManifest));
+
+    manifest->fileHandle = INVALID_HANDLE_VALUE;
+    manifest->numberOfRecords = numberOfVessels;
+}
+
+void openFleetManifestFile(FleetManifest* manifest, const char* fileName)
+{
+    LARGE_INTEGER fileSize;
+
+    SecureZeroMemory(manifest, sizeof(FleetManifest));
+
+    manifest->fileHandle = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL,
+        OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (manifest->fileHandle == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "HaifaPort::openFleetManifestFile::Error - "
+            "Manifest file '%s' could not be opened (%d)!\n", fileName, GetLastError());
+        exit(EXIT_SUCCESS);
+    }
+
+    if (!GetFileSizeEx(manifest->fileHandle, &fileSize) || fileSize.QuadPart == 0)
+    {
+        fprintf(stderr, "HaifaPort::openFleetManifestFile::Error - "
+            "Manifest file '%s' is empty!\n", fileName);
+        exit(EXIT_SUCCESS);
+    }
+
+    // Map the whole file, pages are only read from disk once a record on them is parsed.
+    manifest->mappingHandle = CreateFileMapping(manifest->fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+    manifest->view = (manifest->mappingHandle == NULL) ? NULL :
+        (const char*)MapViewOfFile(manifest->mappingHandle, FILE_MAP_READ, 0, 0, 0);
+
+    if (manifest->view == NULL)
+    {
+        fprintf(stderr, "HaifaPort::openFleetManifestFile::Unexpected Error - "
+            "Mapping manifest file '%s' failed (%d)!\n", fileName, GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    manifest->viewSize = fileSize.QuadPart;
+    manifest->isBinary = manifest->viewSize >= (LONGLONG)sizeof(ManifestHeader) &&
+        memcmp(manifest->view, MANIFEST_MAGIC, sizeof(((ManifestHeader*)0)->magic)) == 0;
+
+    if (manifest->isBinary)
+    {
+        // The number of records is known from the header, nothing else is touched until departure.
+        const ManifestHeader* header = (const ManifestHeader*)manifest->view;
+        LONGLONG recordsSize = manifest->viewSize - (LONGLONG)sizeof(ManifestHeader);
+
+        manifest->numberOfRecords = header->numberOfRecords;
+        manifest->position = sizeof(ManifestHeader);
+
+        if (recordsSize / (LONGLONG)sizeof(VesselRecord) < manifest->numberOfRecords)
+        {
+            fprintf(stderr, "HaifaPort::openFleetManifestFile::Error - "
+                "Manifest file '%s' is truncated!\n", fileName);
+            exit(EXIT_SUCCESS);
+        }
+    }
+    else
+    {
+        // A CSV manifest has no header with its size, so count its lines once.
+        manifest->numberOfRecords = countManifestLines(manifest->view, manifest->viewSize);
+        manifest->position = 0;
+    }
+
+    if (manifest->numberOfRecords < MIN_NUMBER_OF_VESSELS ||
+        manifest->numberOfRecords > MAX_NUMBER_OF_MANIFEST_VESSELS)
+    {
+        fprintf(stderr, "HaifaPort::openFleetManifestFile::Error - "
+            "Number of vessels in the manifest must be between %d-%d!\n",
+            MIN_NUMBER_OF_VESSELS, MAX_NUMBER_OF_MANIFEST_VESSELS);
+        exit(EXIT_SUCCESS);
+    }
+
+    manifest->vesselIdsRead = (unsigned char*)calloc(manifest->numberOfRecords / 8 + 1, sizeof(unsigned char));
+
+    if (manifest->vesselIdsRead == NULL)
+    {
+        fprintf(stderr, "HaifaPort::openFleetManifestFile::Unexpected Error - Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void closeFleetManifest(FleetManifest* manifest)
+{
+    free(manifest->vesselIdsRead);
+
+    if (manifest->view != NULL)
+    {
+        UnmapViewOfFile(manifest->view);
+    }
+
+    if (manifest->mappingHandle != NULL)
+    {
+        CloseHandle(manifest->mappingHandle);
+    }
+
+    if (manifest->fileHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(manifest->fileHandle);
+    }
+}
+
+int countManifestLines(const char* view, LONGLONG viewSize)
+{
+    int numberOfLines = 0;
+    const char* line = view;
+    const char* end = view + viewSize;
+
+    // Count lines which start with a vessel ID, so a header line and blank lines are skipped.
+    while (line < end)
+    {
+        const char* lineEnd = (const char*)memchr(line, '\n', end - line);
+
+        if (*line >= '0' && *line <= '9')
+        {
+            numberOfLines++;
+        }
+
+        line = (lineEnd == NULL) ? end : lineEnd + 1;
+    }
+
+    return numberOfLines;
+}
+
+int parseManifestField(FleetManifest* manifest, int* value)
+{
+    const char* view = manifest->view;
+    int isNegative = FALSE;
+    int hasDigits = FALSE;
+
+    *value = 0;
+
+    while (manifest->position < manifest->viewSize && view[manifest->position] == ' ')
+    {
+        manifest->position++;
+    }
+
+    if (manifest->position < manifest->viewSize && view[manifest->position] == '-')
+    {
+        isNegative = TRUE;
+        manifest->position++;
+    }
+
+    while (manifest->position < manifest->viewSize &&
+        view[manifest->position] >= '0' && view[manifest->position] <= '9')
+    {
+        *value = *value * 10 + (view[manifest->position] - '0');
+        hasDigits = TRUE;
+        manifest->position++;
+    }
+
+    if (isNegative)
+    {
+        *value = -*value;
+    }
+
+    // Step over the separator of the field.
+    if (manifest->position < manifest->viewSize && view[manifest->position] == ',')
+    {
+        manifest->position++;
+    }
+
+    return hasDigits;
+}
+
+int readNextVesselRecord(FleetManifest* manifest, VesselRecord* vesselRecord)
+{
+    if (manifest->numberOfReadRecords >= manifest->numberOfRecords)
+    {
+        return FALSE;
+    }
+
+    if (manifest->view == NULL)
+    {
+        // Generated fleet: ID starts with 1 till numberOfVessels and all depart at once.
+        vesselRecord->vesselId = manifest->numberOfReadRecords + 1;
+        vesselRecord->cargoWeight = -1;
+        vesselRecord->priority = 0;
+        vesselRecord->departureTime = 0;
+    }
+    else if (manifest->isBinary)
+    {
+        memcpy(vesselRecord, manifest->view + manifest->position, sizeof(VesselRecord));
+        manifest->position += sizeof(VesselRecord);
+    }
+    else
+    {
+        const char* view = manifest->view;
+
+        // Skip the header line and blank lines, the same lines countManifestLines skipped.
+        while (manifest->position < manifest->viewSize &&
+            (view[manifest->position] < '0' || view[manifest->position] > '9'))
+        {
+            const char* lineEnd = (const char*)memchr(view + manifest->position, '\n',
+                manifest->viewSize - manifest->position);
+
+            manifest->position = (lineEnd == NULL) ? manifest->viewSize : lineEnd - view + 1;
+        }
+
+        if (!parseManifestField(manifest, &vesselRecord->vesselId) ||
+            !parseManifestField(manifest, &vesselRecord->cargoWeight) ||
+            !parseManifestField(manifest, &vesselRecord->priority) ||
+            !parseManifestField(manifest, &vesselRecord->departureTime))
+        {
+            fprintf(stderr, "HaifaPort::readNextVesselRecord::Error - "
+                "Manifest record %d is malformed!\n", manifest->numberOfReadRecords + 1);
+            exit(EXIT_FAILURE);
+        }
+
+        // Move to the start of the next line.
+        while (manifest->position < manifest->viewSize && view[manifest->position] != '\n')
+        {
+            manifest->position++;
+        }
+
+        manifest->position++;
+    }
+
+    manifest->numberOfReadRecords++;
+
+    // IDs index EilatPort's journal, so they must be between 1 and the size of the fleet.
+    if (vesselRecord->vesselId < 1 || vesselRecord->vesselId > manifest->numberOfRecords)
+    {
+        fprintf(stderr, "HaifaPort::readNextVesselRecord::Error - "
+            "Manifest vessel ID %d is out of range 1-%d!\n",
+            vesselRecord->vesselId, manifest->numberOfRecords);
+        exit(EXIT_FAILURE);
+    }
+
+    // Comment: a vessel ID twice would share a vessel's journal state, and leave another ID unused.
+    if (manifest->vesselIdsRead != NULL)
+    {
+        unsigned char vesselIdBit = (unsigned char)(1 << (vesselRecord->vesselId % 8));
+
+        if (manifest->vesselIdsRead[vesselRecord->vesselId / 8] & vesselIdBit)
+        {
+            fprintf(stderr, "HaifaPort::readNextVesselRecord::Error - "
+                "Manifest vessel ID %d appears more than once!\n", vesselRecord->vesselId);
+            exit(EXIT_FAILURE);
+        }
+
+        manifest->vesselIdsRead[vesselRecord->vesselId / 8] |= vesselIdBit;
+    }
+
+    return TRUE;
+}
+
+void initializeGlobalMutexAndSemaphores(int numberOfVessels, SECURITY_ATTRIBUTES* securityAttributes)
+{
+    // Shared semaphore's names
+    WCHAR processSafePrintString[MAX_RUN_OBJECT_NAME];
+
+    getRunObjectName(processSafePrintString, L"ProcessSafePrint", runId);
+
+    randomMutex = CreateMutex(NULL, FALSE, NULL);
+    // Create shared semaphores between HaifaPort and EilatPort.
+    suezCanal = createSuezCanal(runId, canalPolicy, canalPolicyParameter, canalConvoySize);
+    processSafePrintSemaphore = CreateSemaphore(securityAttributes, 1, 1, processSafePrintString);
+    vesselsDoneSemaphore = CreateSemaphore(NULL, 0, numberOfVessels, NULL);
+    transitCreditsSemaphore = CreateSemaphore(NULL, 0, numberOfVessels, NULL);
+
+    if (randomMutex == NULL || suezCanal == NULL || processSafePrintSemaphore == NULL ||
+        vesselsDoneSemaphore == NULL || transitCreditsSemaphore == NULL)
+    {
+        fprintf(stderr, "HaifaPort::initializeGlobalMutexAndSemaphores::Unexpected Error - "
+            "Mutex/Semaphore creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void initializeVesselSlots(int numberOfSlots)
+{
+    numberOfVesselSlots = numberOfSlots;
+    vesselSlotsSemaphore = CreateSemaphore(NULL, numberOfSlots, numberOfSlots, NULL);
+
+    if (vesselSlotsSemaphore == NULL)
+    {
+        fprintf(stderr, "HaifaPort::initializeVesselSlots::Unexpected Error - "
+            "Semaphore creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Comment: a zeroed wait word is unsignaled, so the slots take no kernel objects here.
+    vesselSlotRecords = (VesselRecord*)calloc(numberOfSlots, sizeof(VesselRecord));
+    freeVesselSlots = (int*)calloc(numberOfSlots, sizeof(int));
+    vesselsWaitWords = (WaitWord*)calloc(numberOfSlots, sizeof(WaitWord));
+    vesselsHandOffStamps = (HandOffStamp*)calloc(numberOfSlots, sizeof(HandOffStamp));
+    vesselsInFlight = (VesselRecord* volatile*)calloc(numberOfSlots, sizeof(VesselRecord*));
+    vesselsNumberOfVoyages = (int*)calloc(numberOfSlots, sizeof(int));
+    vesselsSailingAgain = (int*)calloc(numberOfSlots, sizeof(int));
+
+    if (vesselSlotRecords == NULL || freeVesselSlots == NULL || vesselsWaitWords == NULL ||
+        vesselsHandOffStamps == NULL || vesselsInFlight == NULL ||
+        vesselsNumberOfVoyages == NULL || vesselsSailingAgain == NULL)
+    {
+        fprintf(stderr, "HaifaPort::initializeVesselSlots::Unexpected Error - "
+            "Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The lowest slots are taken first.
+    for (int i = 0; i < numberOfSlots; i++)
+    {
+        freeVesselSlots[i] = numberOfSlots - 1 - i;
+    }
+
+    numberOfFreeVesselSlots = numberOfSlots;
+}
+
+int takeVesselSlot(void)
+{
+    waitForProfiledObject(&vesselSlotsSemaphoreProfile, vesselSlotsSemaphore, INFINITE);
+
+    // Comment: the semaphore let the vessel in, so a slot is free.
+    AcquireSRWLockExclusive(&vesselSlotsLock);
+    int vesselSlot = freeVesselSlots[--numberOfFreeVesselSlots];
+    ReleaseSRWLockExclusive(&vesselSlotsLock);
+
+    return vesselSlot;
+}
+
+void freeVesselSlot(int vesselSlot)
+{
+    AcquireSRWLockExclusive(&vesselSlotsLock);
+    freeVesselSlots[numberOfFreeVesselSlots++] = vesselSlot;
+    ReleaseSRWLockExclusive(&vesselSlotsLock);
+
+    if (!releaseProfiledSemaphore(&vesselSlotsSemaphoreProfile, vesselSlotsSemaphore, 1))
+    {
+        fprintf(stderr, "HaifaPort::freeVesselSlot::Unexpected Error - vesselSlotsSemaphore.V()\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void cleanGlobalMutexAndSemaphores(void)
+{
+    CloseHandle(randomMutex);
+    closeSuezCanal(suezCanal);
+    CloseHandle(processSafePrintSemaphore);
+    CloseHandle(vesselsDoneSemaphore);
+    CloseHandle(transitCreditsSemaphore);
+    CloseHandle(vesselSlotsSemaphore);
+
+    free(vesselSlotRecords);
+    free(freeVesselSlots);
+    free((void*)vesselsWaitWords);
+    free((void*)vesselsHandOffStamps);
+    free((void*)vesselsInFlight);
+    free(vesselsNumberOfVoyages);
+    free(vesselsSailingAgain);
+}
+
+void createSuezCanalPipes(SECURITY_ATTRIBUTES* securityAttributes)
+{
+    // Create the pipe Haifa to Eilat (Med. Sea ==> Red Sea)
+    if (!CreatePipe(&readFromHaifaHandle, &writeToEilatHandle, securityAttributes, 0))
+    {
+        fprintf(stderr, "HaifaPort::createSuezCanalPipes::Unexpected Error - "
+            "'Med. Sea ==> Red Sea' pipe creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // create the pipe Eilat to Haifa (Med. Sea <== Red Sea)
+    if (!CreatePipe(&readFromEilatHandle, &writeToHaifaHandle, securityAttributes, 0))
+    {
+        fprintf(stderr, "HaifaPort::createSuezCanalPipes::Unexpected Error - "
+            "'Med. Sea <== Red Sea' pipe creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void buildEilatPortArguments(int argc, char* argv[], char eilatPortArguments[])
+{
+    size_t length = 0;
+    int isSeeded = FALSE;
+
+    eilatPortArguments[0] = '\0';
+
+    // Every option after the fleet which isn't HaifaPort's is passed on to EilatPort,
+    // which validates them.
+    for (int i = 2; i < argc; i++)
+    {
+        int numberOfHaifaPortArguments = parseHaifaPortOption(argc, argv, i);
+
+        if (numberOfHaifaPortArguments > 0)
+        {
+            i += numberOfHaifaPortArguments - 1;
+            continue;
+        }
+
+        if (length + strlen(argv[i]) + 2 >
+            MAX_COMMAND_LINE - sizeof("EilatPort.exe -run -recover -roundtrip -seed 4294967295") - MAX_RUN_ID)
+        {
+            fprintf(stderr, "HaifaPort::buildEilatPortArguments::Error - "
+                "Options are too long!\n");
+            exit(EXIT_SUCCESS);
+        }
+
+        isSeeded = isSeeded || strcmp(argv[i], "-seed") == 0;
+        length += sprintf(eilatPortArguments + length, " %s", argv[i]);
+    }
+
+    // Comment: EilatPort draws every vessel's cargo type from its seed, so without -seed it is
+    // given HaifaPort's, which a restarted EilatPort is given as well.
+    if (!isSeeded)
+    {
+        length += sprintf(eilatPortArguments + length, " -seed %u", randomSeed);
+    }
+
+    // EilatPort opens the shared objects within the same run's namespace.
+    if (runId[0] == '\0')
+    {
+        sprintf(runId, "%lu", GetCurrentProcessId());
+    }
+
+    // Comment: unlimited voyages would never end without a duration.
+    if (maxNumberOfVoyages == 0 && voyagesDuration == 0)
+    {
+        fprintf(stderr, "HaifaPort::buildEilatPortArguments::Error - "
+            "-voyages 0 requires a -duration!\n");
+        exit(EXIT_SUCCESS);
+    }
+
+    // EilatPort reads arriving vessels till the voyages end, rather than once for each vessel.
+    isRoundTrip = maxNumberOfVoyages != 1 || voyagesDuration > 0;
+
+    if (isRoundTrip)
+    {
+        length += sprintf(eilatPortArguments + length, " -roundtrip");
+    }
+
+    sprintf(eilatPortArguments + length, " -run %s", runId);
+}
+
+int parseHaifaPortOption(int argc, char* argv[], int i)
+{
+    if (strcmp(argv[i], "-inprocess") == 0)
+    {
+        isInProcess = TRUE;
+        return 1;
+    }
+
+    if (strcmp(argv[i], "-results") == 0)
+    {
+        isPrintingResults = TRUE;
+        return 1;
+    }
+
+    if (i + 1 >= argc)
+    {
+        return 0;
+    }
+
+    if (strcmp(argv[i], "-canal") == 0)
+    {
+        canalPolicy = getSuezCanalPolicy(argv[i + 1]);
+
+        if (canalPolicy == -1)
+        {
+            fprintf(stderr, "HaifaPort::parseHaifaPortOption::Error - "
+                "Canal policy must be cycle, queue or wait!\n");
+            exit(EXIT_SUCCESS);
+        }
+    }
+    else if (strcmp(argv[i], "-switch") == 0)
+    {
+        canalPolicyParameter = atoi(argv[i + 1]);
+
+        // Comment: -1 only stands for the policy's default, so -switch itself may not be negative.
+        if (canalPolicyParameter < 0)
+        {
+            fprintf(stderr, "HaifaPort::parseHaifaPortOption::Error - -switch may not be negative!\n");
+            exit(EXIT_SUCCESS);
+        }
+    }
+    else if (strcmp(argv[i], "-convoy") == 0)
+    {
+        canalConvoySize = atoi(argv[i + 1]);
+    }
+    else if (strcmp(argv[i], "-connect") == 0)
+    {
+        if (!isValidRunId(argv[i + 1]))
+        {
+            fprintf(stderr, "HaifaPort::parseHaifaPortOption::Error - "
+                "Server name must be 1-%d letters, digits, '-' or '_'!\n", MAX_RUN_ID);
+            exit(EXIT_SUCCESS);
+        }
+
+        strcpy(eilatPortServerName, argv[i + 1]);
+    }
+    else if (strcmp(argv[i], "-voyages") == 0)
+    {
+        maxNumberOfVoyages = atoi(argv[i + 1]);
+    }
+    else if (strcmp(argv[i], "-duration") == 0)
+    {
+        voyagesDuration = atoi(argv[i + 1]);
+    }
+    else if (strcmp(argv[i], "-loaders") == 0)
+    {
+        numberOfLoadingCranes = atoi(argv[i + 1]);
+    }
+    else if (strcmp(argv[i], "-run") == 0)
+    {
+        if (!isValidRunId(argv[i + 1]))
+        {
+            fprintf(stderr, "HaifaPort::parseHaifaPortOption::Error - "
+                "Run id must be 1-%d letters, digits, '-' or '_'!\n", MAX_RUN_ID);
+            exit(EXIT_SUCCESS);
+        }
+
+        strcpy(runId, argv[i + 1]);
+    }
+    else
+    {
+        return 0;
+    }
+
+    if (canalConvoySize < 1)
+    {
+        fprintf(stderr, "HaifaPort::parseHaifaPortOption::Error - -convoy must be positive!\n");
+        exit(EXIT_SUCCESS);
+    }
+
+    if (maxNumberOfVoyages < 0 || voyagesDuration < 0 ||
+        numberOfLoadingCranes < 1 || numberOfLoadingCranes > MAX_NUMBER_OF_LOADING_CRANES)
+    {
+        fprintf(stderr, "HaifaPort::parseHaifaPortOption::Error - "
+            "-voyages and -duration may not be negative and -loaders must be between 1-%d!\n",
+            MAX_NUMBER_OF_LOADING_CRANES);
+        exit(EXIT_SUCCESS);
+    }
+
+    return 2;
+}
+
+void startEilatPort(const char* eilatPortArguments, SECURITY_ATTRIBUTES* securityAttributes)
+{
+    QueryPerformanceCounter(&eilatPortStartTicks);
+
+    if (isInProcess)
+    {
+        toEilatChannel = createMemoryChannel(MESSAGE_CHANNEL_CAPACITY);
+        fromEilatChannel = createMemoryChannel(MESSAGE_CHANNEL_CAPACITY);
+
+        if (toEilatChannel == NULL || fromEilatChannel == NULL)
+        {
+            fprintf(stderr, "HaifaPort::startEilatPort::Unexpected Error - "
+                "In-memory channels creation failed!\n");
+            exit(EXIT_FAILURE);
+        }
+
+        startEilatPortThread(eilatPortArguments);
+        return;
+    }
+
+    if (eilatPortServerName[0] != '\0')
+    {
+        connectToEilatPortServer(eilatPortArguments);
+        return;
+    }
+
+    createSuezCanalPipes(securityAttributes);
+    setStartUpInfoAndStartEilatPortProcess(eilatPortArguments);
+
+    // Close HaifaPort's unused ends of the pipes.
+    CloseHandle(readFromHaifaHandle);
+    CloseHandle(writeToHaifaHandle);
+
+    toEilatChannel = createPipeChannel(writeToEilatHandle);
+    fromEilatChannel = createPipeChannel(readFromEilatHandle);
+
+    if (toEilatChannel == NULL || fromEilatChannel == NULL)
+    {
+        fprintf(stderr, "HaifaPort::startEilatPort::Unexpected Error - "
+            "Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void setStartUpInfoAndStartEilatPortProcess(const char* eilatPortArguments)
+{
+    STARTUPINFO startupInfo;
+    PROCESS_INFORMATION processInformation;
+
+    // Fill pi with zeros, in bytes.
+    SecureZeroMemory(&processInformation, sizeof(processInformation));
+
+    // Retrieves the conents of the STARTUPINFO structure
+    // that was specified when the calling process was created.
+    GetStartupInfo(&startupInfo);
+
+    // The standard error device. This is the active console screen buffer.
+    startupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    // Redirect the standard input to the read end of the pipe.
+    startupInfo.hStdOutput = writeToHaifaHandle;
+    startupInfo.hStdInput = readFromHaifaHandle;
+    // To inherit the standard input, output, and error handles, 
+    // the dwFlags must include STARTF_USESTDHANDLES.
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+
+    TCHAR ProcessName[MAX_COMMAND_LINE];
+    swprintf(ProcessName, MAX_COMMAND_LINE, L"EilatPort.exe%hs", eilatPortArguments);
+
+    // Create and start the EilatPort process
+    if (!CreateProcess(NULL,    // No module name (use command line).
+        ProcessName,            // Command line.
+        NULL,                   // Process handle not inheritable.
+        NULL,                   // Thread handle not inheritable.
+        TRUE,                   // Set handle inheritance to TRUE.
+        0,                      // No creation flags.
+        NULL,                   // Use parent's environment block.
+        NULL,                   // Use parent's starting directory.
+        &startupInfo,           // Pointer to STARTUPINFO structure.
+        &processInformation)    // Pointer to PROCESS_INFORMATION structure.
+        )
+    {
+        fprintf(stderr, "HaifaPort::setStartUpInfoAndStartEilatPortProcess::Unexpected Error -"
+            " CreateProcess for EilatPort failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    CloseHandle(processInformation.hThread);
+
+    // A restarted EilatPort replaces the stopped one's handle.
+    if (eilatPortProcessHandle != NULL)
+    {
+        CloseHandle(eilatPortProcessHandle);
+    }
+
+    eilatPortProcessHandle = processInformation.hProcess;
+}
+
+void startEilatPortThread(const char* eilatPortArguments)
+{
+    eilatPortModule = LoadLibrary(EILAT_PORT_DLL_NAME);
+
+    if (eilatPortModule == NULL)
+    {
+        fprintf(stderr, "HaifaPort::startEilatPortThread::Unexpected Error - "
+            "Loading EilatPort.dll failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    LPTHREAD_START_ROUTINE eilatPortThread =
+        (LPTHREAD_START_ROUTINE)GetProcAddress(eilatPortModule, EILAT_PORT_THREAD_NAME);
+
+    if (eilatPortThread == NULL)
+    {
+        fprintf(stderr, "HaifaPort::startEilatPortThread::Unexpected Error - "
+            "EilatPort.dll has no %s!\n", EILAT_PORT_THREAD_NAME);
+        exit(EXIT_FAILURE);
+    }
+
+    // Split the arguments as EilatPort.exe's command line would be, argv[0] is its name.
+    int argc = 0;
+
+    strcpy(eilatPortThreadArguments, eilatPortArguments);
+    eilatPortThreadArgv[argc++] = "EilatPort";
+
+    for (char* argument = strtok(eilatPortThreadArguments, " "); argument != NULL;
+        argument = strtok(NULL, " "))
+    {
+        if (argc == MAX_EILAT_PORT_ARGUMENTS - 1)
+        {
+            fprintf(stderr, "HaifaPort::startEilatPortThread::Error - "
+                "Options are too many!\n");
+            exit(EXIT_SUCCESS);
+        }
+
+        eilatPortThreadArgv[argc++] = argument;
+    }
+
+    eilatPortThreadArgv[argc] = NULL;
+
+    // EilatPort's ends of the channels are the other ends of HaifaPort's.
+    eilatPortThreadParameter.argc = argc;
+    eilatPortThreadParameter.argv = eilatPortThreadArgv;
+    eilatPortThreadParameter.fromHaifaChannel = toEilatChannel;
+    eilatPortThreadParameter.toHaifaChannel = fromEilatChannel;
+
+    DWORD threadId;
+    eilatPortThreadHandler = CreateThread(NULL, 0, eilatPortThread, &eilatPortThreadParameter, 0, &threadId);
+
+    if (eilatPortThreadHandler == NULL)
+    {
+        fprintf(stderr, "HaifaPort::startEilatPortThread::Unexpected Error - "
+            "EilatPort thread creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void waitForEilatPortThread(void)
+{
+    WaitForSingleObject(eilatPortThreadHandler, INFINITE);
+    CloseHandle(eilatPortThreadHandler);
+    FreeLibrary(eilatPortModule);
+}
+
+void connectToEilatPortServer(const char* eilatPortArguments)
+{
+    WCHAR pipeName[MAX_RUN_OBJECT_NAME];
+    WCHAR sessionPipeName[MAX_RUN_OBJECT_NAME];
+    DWORD readMode = PIPE_READMODE_MESSAGE;
+    HANDLE pipeHandle = INVALID_HANDLE_VALUE;
+    ULONGLONG missingSinceTime = GetTickCount64();
+
+    getRunObjectName(pipeName, EILAT_PORT_SERVER_PIPE, eilatPortServerName);
+
+    // While every session is busy the run waits for one to be free, the server serves its runs
+    // one after another. Its pipe only goes missing for a moment, till a session takes the place
+    // of the last one.
+    while (pipeHandle == INVALID_HANDLE_VALUE)
+    {
+        pipeHandle = CreateFile(pipeName, GENERIC_READ | GENERIC_WRITE, 0, NULL, OPEN_EXISTING, 0, NULL);
+
+        if (pipeHandle != INVALID_HANDLE_VALUE)
+        {
+            break;
+        }
+
+        DWORD error = GetLastError();
+
+        if (error == ERROR_PIPE_BUSY)
+        {
+            WaitNamedPipe(pipeName, EILAT_PORT_SERVER_RETRY);
+            missingSinceTime = GetTickCount64();
+        }
+        else if (error == ERROR_FILE_NOT_FOUND && GetTickCount64() - missingSinceTime < EILAT_PORT_SERVER_WAIT)
+        {
+            Sleep(EILAT_PORT_SERVER_RETRY);
+        }
+        else
+        {
+            fprintf(stderr, "HaifaPort::connectToEilatPortServer::Error - "
+                "EilatPort server '%s' could not be connected to (%d)!\n", eilatPortServerName, error);
+            exit(EXIT_SUCCESS);
+        }
+    }
+
+    toEilatChannel = createPipeChannel(pipeHandle);
+
+    if (toEilatChannel == NULL)
+    {
+        fprintf(stderr, "HaifaPort::connectToEilatPortServer::Unexpected Error - "
+            "Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // The session writes its process ID, which names the pipe it writes its own messages to.
+    DWORD sessionProcessId;
+
+    if (!SetNamedPipeHandleState(pipeHandle, &readMode, NULL, NULL) ||
+        !readMessage(toEilatChannel, buffer) || sscanf(buffer, "%lu", &sessionProcessId) != 1)
+    {
+        fprintf(stderr, "HaifaPort::connectToEilatPortServer::Unexpected Error - "
+            "Reading the session of server '%s' failed!\n", eilatPortServerName);
+        exit(EXIT_FAILURE);
+    }
+
+    // The session serves the server's runs one after another, so only its time since this run
+    // connected counts. Comment: without the handle the results leave EilatPort's time out.
+    eilatPortProcessHandle = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION, FALSE, sessionProcessId);
+
+    if (eilatPortProcessHandle != NULL)
+    {
+        getProcessCpuTicks(eilatPortProcessHandle, &eilatPortBaseKernelTicks, &eilatPortBaseUserTicks);
+    }
+
+    swprintf(sessionPipeName, MAX_RUN_OBJECT_NAME, L"%ls.%lu", pipeName, sessionProcessId);
+
+    HANDLE sessionPipeHandle = CreateFile(sessionPipeName, GENERIC_READ, 0, NULL, OPEN_EXISTING, 0, NULL);
+
+    if (sessionPipeHandle == INVALID_HANDLE_VALUE ||
+        !SetNamedPipeHandleState(sessionPipeHandle, &readMode, NULL, NULL) ||
+        (fromEilatChannel = createPipeChannel(sessionPipeHandle)) == NULL)
+    {
+        fprintf(stderr, "HaifaPort::connectToEilatPortServer::Unexpected Error - "
+            "Connecting to the pipe of session %lu failed (%d)!\n", sessionProcessId, GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    // EilatPort's options go as their length, followed by a message's worth of them at a time.
+    // Comment: they were built to fit a command line, which the session's options may be as long as.
+    int length = (int)strlen(eilatPortArguments);
+    int isWritten;
+
+    sprintf(buffer, "%d", length);
+    isWritten = writeMessage(toEilatChannel, buffer);
+
+    for (int i = 0; isWritten && i < length; i += BUFFER_SIZE)
+    {
+        strncpy(buffer, eilatPortArguments + i, BUFFER_SIZE);
+        isWritten = writeMessage(toEilatChannel, buffer);
+    }
+
+    if (!isWritten)
+    {
+        fprintf(stderr, "HaifaPort::connectToEilatPortServer::Unexpected Error - "
+            "Writing EilatPort's options to session %lu failed!\n", sessionProcessId);
+        exit(EXIT_FAILURE);
+    }
+}
+
+void suezCanalPassageApproval(int numberOfVessels)
+{
+    char string[MAX_STRING];
+
+    sprintf(string, "Haifa Port : There are %d Vessels in the port",numberOfVessels);
+
+    if (!safePrintWithTimeStamp(string))
+    {
+        fprintf(stderr, "HaifaPort::suezCanalPassageApproval::Unexpected Error -"
+            " Print failed!\n");
+        return 1;
+    }
+
+    sprintf(string, "Haifa Port: Requesting passage from Eilat Port...");
+
+    if (!safePrintWithTimeStamp(string))
+    {
+        fprintf(stderr, "HaifaPort::suezCanalPassageApproval::Unexpected Error -"
+            " Print failed!\n");
+        return 1;
+    }
+
+    sprintf(buffer, "%d", numberOfVessels);
+
+    // Writing number of vessels to 'Med. Sea ==> Red Sea' pipe.
+    if (!writeMessage(toEilatChannel, buffer))
+    {
+        fprintf(stderr, "HaifaPort::suezCanalPassageApproval::Unexptected Error - "
+            "Writing numberOfVessels to 'Med. Sea ==> Red Sea' pipe failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    int isPassageApproved = FALSE;
+
+    // Read passage result response from Eilat port through 'Med. Sea <== Red Sea' pipe.
+    if (!readMessage(fromEilatChannel, buffer))
+    {
+        fprintf(stderr, "HaifaPort::suezCanalPassageApproval::Unexptected Error - "
+            "reading passage answer from 'Med. Sea <== Red Sea' pipe failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    LARGE_INTEGER frequency, ticks;
+
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&ticks);
+    eilatPortStartUpTime = (ticks.QuadPart - eilatPortStartTicks.QuadPart) * 1000.0 / frequency.QuadPart;
+
+    isPassageApproved = atoi(buffer);
+
+    sprintf(string, "Haifa Port: passage from Eilat Port %s!",
+        isPassageApproved ? "approved" : "denied");
+
+    if (!safePrintWithTimeStamp(string))
+    {
+        fprintf(stderr, "HaifaPort::Main::Unexpected Error - Print failed!\n");
+        return 1;
+    }
+
+    if (!isPassageApproved)
+    {
+        exit(EXIT_SUCCESS);
+    }
+}
+
+int readInitialTransitCredits(void)
+{
+    // Comment: once it approved the passage a new EilatPort grants its berths before it writes
+    // anything else, as vessel ID 0.
+    int vesselId, numberOfCredits;
+
+    if (!readMessage(fromEilatChannel, buffer) ||
+        sscanf(buffer, "%d %d", &vesselId, &numberOfCredits) != 2 || vesselId != 0 || numberOfCredits < 1)
+    {
+        fprintf(stderr, "HaifaPort::readInitialTransitCredits::Unexpected Error - "
+            "reading the transit credits from 'Med. Sea <== Red Sea' pipe failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (!releaseProfiledSemaphore(&transitCreditsSemaphoreProfile, transitCreditsSemaphore, numberOfCredits))
+    {
+        fprintf(stderr, "HaifaPort::readInitialTransitCredits::Unexpected Error -"
+            " transitCreditsSemaphore.V(%d)\n", numberOfCredits);
+        exit(EXIT_FAILURE);
+    }
+
+    numberOfReceivedCredits += numberOfCredits;
+
+    return numberOfCredits;
+}
+
+HANDLE createDeparturesThread(FleetManifest* manifest)
+{
+    DWORD threadId;
+    HANDLE departuresHandler = CreateThread(NULL, 0, Departures, manifest, 0, &threadId);
+
+    if (departuresHandler == NULL || !placeThread(departuresHandler, PLACEMENT_HELPER, 0))
+    {
+        fprintf(stderr, "HaifaPort::createDeparturesThread::Unexpected Error - "
+            "Departures thread creation or placement failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return departuresHandler;
+}
+
+void readIncomingVesselsFromEilatPort(int numberOfVessels, const char* eilatPortArguments,
+    SECURITY_ATTRIBUTES* securityAttributes)
+{
+    int numberOfReturnedVessels = 0;
+
+    // Read incoming vessels from EilatPort and signal them to continue.
+    while (numberOfReturnedVessels < numberOfVessels)
+    {
+        beginStallWait("fromEilatChannel");
+
+        int isRead = readMessage(fromEilatChannel, buffer);
+
+        endStallWait();
+
+        if (!isRead)
+        {
+            if (!isRecoverable)
+            {
+                fprintf(stderr, "HaifaPort::readIncomingVesselsFromEilatPort::Unexptected Error -"
+                    " Reading incoming vessel from 'Med. Sea <== Red Sea' pipe failed!\n");
+                exit(EXIT_FAILURE);
+            }
+
+            restartEilatPort(numberOfVessels, numberOfReturnedVessels, eilatPortArguments,
+                securityAttributes);
+            continue;
+        }
+
+        // Every message holds a vessel ID, the credits EilatPort returns with it and the vessel's
+        // slot, vessel ID 0 only grants credits.
+        int vesselId, numberOfCredits, vesselSlot = 0;
+        int numberOfFields = sscanf(buffer, "%d %d %d", &vesselId, &numberOfCredits, &vesselSlot);
+
+        if (numberOfFields < 2 || vesselId < 0 || vesselId > numberOfVessels || numberOfCredits < 0 ||
+            (vesselId != 0 && (numberOfFields != 3 || vesselSlot < 0 || vesselSlot >= numberOfVesselSlots)))
+        {
+            fprintf(stderr, "HaifaPort::readIncomingVesselsFromEilatPort::Unexpected Error -"
+                " malformed message '%s' from 'Med. Sea <== Red Sea' pipe!\n", buffer);
+            exit(EXIT_FAILURE);
+        }
+
+        // A vessel which isn't in flight has returned already, before a restart.
+        int isReturning = vesselId != 0 && vesselsInFlight[vesselSlot] != NULL &&
+            vesselsInFlight[vesselSlot]->vesselId == vesselId;
+        int isSailingAgain = FALSE;
+
+        if (isReturning)
+        {
+            vesselsInFlight[vesselSlot] = NULL;
+            InterlockedIncrement(&numberOfVesselsLeavingCanal);
+
+            // In round trips a vessel which sails again isn't done yet.
+            isSailingAgain = isRoundTrip && isVesselSailingAgain(vesselSlot, numberOfVessels,
+                numberOfReturnedVessels);
+
+            if (!isSailingAgain)
+            {
+                numberOfReturnedVessels++;
+            }
+        }
+
+        // Comment: a vessel which sails again keeps the credit it returned with for its next voyage,
+        // so no more vessel threads run than there are credits.
+        if (numberOfCredits - isSailingAgain > 0 &&
+            !releaseProfiledSemaphore(&transitCreditsSemaphoreProfile, transitCreditsSemaphore,
+                numberOfCredits - isSailingAgain))
+        {
+            fprintf(stderr, "HaifaPort::readIncomingVesselsFromEilatPort::Unexpected Error -"
+                " transitCreditsSemaphore.V(%d)\n", numberOfCredits - isSailingAgain);
+            exit(EXIT_FAILURE);
+        }
+
+        numberOfReceivedCredits += numberOfCredits;
+
+        if (!isReturning)
+        {
+            continue;
+        }
+
+        // Signal that vessel has returned from EilatPort and continue its tasks.
+        stampHandOff(&vesselsHandOffStamps[vesselSlot]);
+
+        if (!signalProfiledWord(&vesselsWaitWordsProfile, &vesselsWaitWords[vesselSlot]))
+        {
+            fprintf(stderr, "HaifaPort::readIncomingVesselsFromEilatPort::Unexpected Error -"
+                "vesselsWaitWords[%d].V()\n", vesselSlot);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+int isVesselSailingAgain(int vesselSlot, int numberOfVessels, int numberOfDoneVessels)
+{
+    ULONGLONG now = GetTickCount64();
+
+    numberOfReturnedVoyages++;
+    vesselsNumberOfVoyages[vesselSlot]++;
+    vesselsSailingAgain[vesselSlot] =
+        (maxNumberOfVoyages == 0 || vesselsNumberOfVoyages[vesselSlot] < maxNumberOfVoyages) &&
+        (voyagesDeadline == 0 || now < voyagesDeadline);
+
+    if (isInSteadyState)
+    {
+        numberOfSteadyStateVoyages++;
+        steadyStateEndTime = now;
+    }
+
+    // Comment: the voyage of the first vessel which is done still counts, though the fleet
+    // thins out from then on.
+    if (!vesselsSailingAgain[vesselSlot])
+    {
+        isInSteadyState = FALSE;
+    }
+    else if (numberOfReturnedVoyages == numberOfVessels && numberOfDoneVessels == 0)
+    {
+        isInSteadyState = TRUE;
+        steadyStateStartTime = now;
+    }
+
+    return vesselsSailingAgain[vesselSlot];
+}
+
+void endVoyagesAtEilatPort(void)
+{
+    sprintf(buffer, "%d %d %d %d", 0, 0, 0, 0);
+
+    if (!writeMessage(toEilatChannel, buffer))
+    {
+        fprintf(stderr, "HaifaPort::endVoyagesAtEilatPort::Unexpected Error -"
+            " Writing the end of the voyages to 'Med. Sea ==> Red Sea' pipe failed!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void createLoadingCraneThreads(void)
+{
+    DWORD threadId;
+
+    loadingQuayStations = (LoadingQuayStation*)calloc(numberOfLoadingCranes, sizeof(LoadingQuayStation));
+    loadingCranesId = (int*)calloc(numberOfLoadingCranes, sizeof(int));
+    loadingCranesHandlers = (HANDLE*)calloc(numberOfLoadingCranes, sizeof(HANDLE));
+    loadingCranesWaitWords = (WaitWord*)calloc(numberOfLoadingCranes, sizeof(WaitWord));
+    loadingCranesHandOffStamps = (HandOffStamp*)calloc(numberOfLoadingCranes, sizeof(HandOffStamp));
+
+    if (loadingQuayStations == NULL || loadingCranesId == NULL || loadingCranesHandlers == NULL ||
+        loadingCranesWaitWords == NULL || loadingCranesHandOffStamps == NULL)
+    {
+        fprintf(stderr, "HaifaPort::createLoadingCraneThreads::Unexpected Error - "
+            "Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    loadingQuaySemaphore = CreateSemaphore(NULL, numberOfLoadingCranes, numberOfLoadingCranes, NULL);
+    loadingStationMutex = CreateMutex(NULL, FALSE, NULL);
+
+    if (loadingQuaySemaphore == NULL || loadingStationMutex == NULL)
+    {
+        fprintf(stderr, "HaifaPort::createLoadingCraneThreads::Unexpected Error - "
+            "Mutex/Semaphore creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Create all loading crane threads, a crane's ID is its station's index + 1.
+    for (int i = 0; i < numberOfLoadingCranes; i++)
+    {
+        loadingCranesId[i] = i + 1;
+        loadingQuayStations[i].craneId = i + 1;
+        loadingCranesHandlers[i] = CreateThread(NULL, 0, LoadingCrane, &loadingCranesId[i], 0, &threadId);
+
+        if (loadingCranesHandlers[i] == NULL || !placeThread(loadingCranesHandlers[i], PLACEMENT_CRANE, i))
+        {
+            fprintf(stderr, "HaifaPort::createLoadingCraneThreads::Unexpected Error - "
+                "Loading crane thread %d creation or placement failed!\n", i + 1);
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void stopLoadingCraneThreads(void)
+{
+    // Indication for loading crane threads to end.
+    areAllVoyagesDone = TRUE;
+
+    for (int i = 0; i < numberOfLoadingCranes; i++)
+    {
+        if (!signalProfiledWord(&loadingCranesWaitWordsProfile, &loadingCranesWaitWords[i]))
+        {
+            fprintf(stderr, "HaifaPort::stopLoadingCraneThreads::Unexpected Error - "
+                "loadingCranesWaitWords[%d].V()\n", i);
+        }
+    }
+
+    WaitForMultipleObjects(numberOfLoadingCranes, loadingCranesHandlers, TRUE, INFINITE);
+
+    for (int i = 0; i < numberOfLoadingCranes; i++)
+    {
+        CloseHandle(loadingCranesHandlers[i]);
+    }
+
+    CloseHandle(loadingQuaySemaphore);
+    CloseHandle(loadingStationMutex);
+    free(loadingQuayStations);
+    free(loadingCranesId);
+    free(loadingCranesHandlers);
+    free((void*)loadingCranesWaitWords);
+    free((void*)loadingCranesHandOffStamps);
+}
+
+void parseSharedOptions(int argc, char* argv[])
+{
+    randomSeed = (unsigned int)time(NULL);
+
+    for (int i = 2; i + 1 < argc; i++)
+    {
+        if (strcmp(argv[i], "-service") == 0 && !setServiceTimeDistribution(argv[++i]))
+        {
+            fprintf(stderr, "HaifaPort::parseSharedOptions::Error - "
+                "Invalid service time '%s'!\n", argv[i]);
+            exit(EXIT_SUCCESS);
+        }
+        else if (strcmp(argv[i], "-seed") == 0)
+        {
+            randomSeed = (unsigned int)strtoul(argv[++i], NULL, 10);
+            // Comment: EilatPort seeds its own times with the odd seed, so a vessel's stages
+            // aren't drawn the same in both ports. The even one is never 0, which is unseeded.
+            seedServiceTimes(((ULONGLONG)randomSeed + 1) << 1);
+        }
+        else if (strcmp(argv[i], "-placement") == 0)
+        {
+            threadPlacementPolicy = getThreadPlacementPolicy(argv[++i]);
+
+            if (threadPlacementPolicy == -1)
+            {
+                fprintf(stderr, "HaifaPort::parseSharedOptions::Error - "
+                    "Placement must be none, compact, spread or isolated!\n");
+                exit(EXIT_SUCCESS);
+            }
+        }
+        else if (strcmp(argv[i], "-stall") == 0)
+        {
+            stallDetectorThreshold = (DWORD)strtoul(argv[++i], NULL, 10);
+#ifndef PORT_STALL_DETECTOR
+            if (stallDetectorThreshold > 0)
+            {
+                fprintf(stderr, "HaifaPort::parseSharedOptions::Error - "
+                    "-stall needs a build with PORT_STALL_DETECTOR defined!\n");
+                exit(EXIT_SUCCESS);
+            }
+#endif
+        }
+    }
+}
+
+int isEilatPortRecoverable(int argc, char* argv[])
+{
+    for (int i = 2; i < argc; i++)
+    {
+        if (strcmp(argv[i], "-journal") == 0)
+        {
+            return TRUE;
+        }
+    }
+
+    return FALSE;
+}
+
+void restartEilatPort(int numberOfVessels, int numberOfReturnedVessels,
+    const char* eilatPortArguments, SECURITY_ATTRIBUTES* securityAttributes)
+{
+    char string[MAX_STRING];
+    char recoverArguments[MAX_COMMAND_LINE + sizeof(" -recover")];
+
+    if (++numberOfEilatPortRestarts > MAX_EILAT_PORT_RESTARTS)
+    {
+        fprintf(stderr, "HaifaPort::restartEilatPort::Error - "
+            "EilatPort stopped %d times, giving up!\n", numberOfEilatPortRestarts);
+        exit(EXIT_FAILURE);
+    }
+
+    // Vessels wait with their departure to EilatPort till its new pipe is ready.
+    AcquireSRWLockExclusive(&eilatPortLock);
+
+    sprintf(string, "Haifa Port: Eilat Port stopped, restarting it from its journal...");
+
+    if (!safePrintWithTimeStamp(string))
+    {
+        fprintf(stderr, "HaifaPort::restartEilatPort::Unexpected Error - Print failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    closeMessageChannel(fromEilatChannel);
+    closeMessageChannel(toEilatChannel);
+
+    // The credits were granted by the stopped EilatPort, the new one grants its own. Vessels which
+    // took a credit but weren't written to the pipe yet keep theirs, the new EilatPort reserves
+    // a berth for each of them.
+    int numberOfUnusedCredits = 0;
+
+    while (waitForProfiledObject(&transitCreditsSemaphoreProfile, transitCreditsSemaphore, 0) == WAIT_OBJECT_0)
+    {
+        numberOfUnusedCredits++;
+    }
+
+    int numberOfHeldCredits = numberOfReceivedCredits - numberOfUnusedCredits - numberOfUsedCredits;
+
+    numberOfReceivedCredits = numberOfHeldCredits;
+    numberOfUsedCredits = 0;
+
+    sprintf(recoverArguments, "%s -recover", eilatPortArguments);
+    startEilatPort(recoverArguments, securityAttributes);
+
+    suezCanalPassageApproval(numberOfVessels);
+
+    int numberOfVesselsInFlight = 0;
+
+    for (int i = 0; i < numberOfVesselSlots; i++)
+    {
+        numberOfVesselsInFlight += vesselsInFlight[i] != NULL;
+    }
+
+    // Resend the vessels in flight, EilatPort resumes each one from its journaled state.
+    sprintf(buffer, "%d %d %d", numberOfVesselsInFlight, numberOfReturnedVessels, numberOfHeldCredits);
+
+    int isWritten = writeMessage(toEilatChannel, buffer);
+
+    for (int i = 0; isWritten && i < numberOfVesselSlots; i++)
+    {
+        if (vesselsInFlight[i] != NULL)
+        {
+            sprintf(buffer, "%d %d %d %d", vesselsInFlight[i]->vesselId,
+                vesselsInFlight[i]->cargoWeight, vesselsInFlight[i]->priority, i);
+            isWritten = writeMessage(toEilatChannel, buffer);
+        }
+    }
+
+    if (!isWritten)
+    {
+        fprintf(stderr, "HaifaPort::restartEilatPort::Unexpected Error - "
+            "Writing vessels in flight to 'Med. Sea ==> Red Sea' pipe failed\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Vessels which waited for the 'Med. Sea <== Red Sea' lane, or were in it but never written
+    // to the pipe, stopped with EilatPort. Only the ones which returned are still in the lane.
+    resetSuezCanalDirection(suezCanal, SUEZ_CANAL_RED_TO_MED, numberOfVesselsLeavingCanal);
+
+    ReleaseSRWLockExclusive(&eilatPortLock);
+}
+
+void updateEilatAllVesselsDoneAndWaitForThreads(void)
+{
+    // Write to EilatPort that all vessel threads are done.
+    // Comment: This command operates more as a cosmetic reason, since when the last thread has returend
+    // EilatPort will start printing ending messages. With this EilatPort will wait till 
+    // the end of all vessel's messages.
+    sprintf(buffer, "%d", TRUE);
+
+    if (!writeMessage(toEilatChannel, buffer))
+    {
+        fprintf(stderr, "HaifaPort::updateEilatAllVesselsDoneAndWaitForThreads::Unexpected Error -"
+            " Writing that vessels ended has failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    // Check that all threads are done in EilatPort.
+    beginStallWait("fromEilatChannel");
+
+    int isRead = readMessage(fromEilatChannel, buffer);
+
+    endStallWait();
+
+    if (!isRead)
+    {
+        fprintf(stderr, "HaifaPort::updateEilatAllVesselsDoneAndWaitForThreads::Unexptected Error -"
+            " Reading EilatPort's end of threads has failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    if (!atoi(buffer))
+    {
+        fprintf(stderr, "HaifaPort::updateEilatAllVesselsDoneAndWaitForThreads::Unexptected Error -"
+            " threads in EilatPort still exist!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+HANDLE createSuezCanalControllerThread(void)
+{
+    DWORD threadId;
+    HANDLE suezCanalControllerHandler = CreateThread(NULL, 0, SuezCanalController, suezCanal, 0, &threadId);
+
+    if (suezCanalControllerHandler == NULL ||
+        !placeThread(suezCanalControllerHandler, PLACEMENT_COORDINATOR, 0))
+    {
+        fprintf(stderr, "HaifaPort::createSuezCanalControllerThread::Unexpected Error - "
+            "Suez canal controller thread creation or placement failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    return suezCanalControllerHandler;
+}
+
+void printSuezCanalReport(void)
+{
+    char string[MAX_STRING];
+    SuezCanalState* state = suezCanal->state;
+
+    int numberOfTransits = state->numberOfTransits[SUEZ_CANAL_MED_TO_RED] +
+        state->numberOfTransits[SUEZ_CANAL_RED_TO_MED];
+    ULONGLONG duration = state->lastTransitTime - state->firstArrivalTime;
+
+    sprintf(string, "Haifa Port: Canal (%s %d) - %.1f vessels per hour, %d convoys, %d switches,"
+        " avg/max wait %llu/%llu ms", getSuezCanalPolicyName(state->policy), state->policyParameter,
+        duration ? numberOfTransits * 3600000.0 / duration : 0.0, state->numberOfConvoys,
+        state->numberOfSwitches, numberOfTransits ? (ULONGLONG)(state->totalWaitTime / numberOfTransits) : 0,
+        state->maxWaitTime);
+
+    if (!safePrintWithTimeStamp(string))
+    {
+        fprintf(stderr, "HaifaPort::printSuezCanalReport::Unexpected Error - Print failed!\n");
+    }
 }
 
-int safeRand(void)
+void printEilatPortStartUpReport(void)
 {
-    WaitForSingleObject(randomMutex, INFINITE);
+    char string[MAX_STRING];
 
-    int randomNumber = rand();
+    sprintf(string, "Haifa Port: Eilat Port (%s) started in %.3f ms, %.3f us per message written",
+        isInProcess ? "in-process" : eilatPortServerName[0] != '\0' ? "server" : "process", eilatPortStartUpTime,
+        getAverageMessageWriteTime(toEilatChannel));
 
-    if (!ReleaseMutex(randomMutex))
+    if (!safePrintWithTimeStamp(string))
     {
-        fprintf(stderr, "HaifaPort::safeRand::Unexpected error - randomMutex.V()\n");
+        fprintf(stderr, "HaifaPort::printEilatPortStartUpReport::Unexpected Error - Print failed!\n");
     }
-
-    return randomNumber;
 }
 
-int randomSleepTime(void)
+void printPlacementReport(void)
 {
-    return safeRand() % (MAX_SLEEP_TIME - MIN_SLEEP_TIME + 1) + MIN_SLEEP_TIME;
+    char string[MAX_STRING];
+
+    // Jitter is how much longer the slow hand-offs take than the typical one.
+    ULONGLONG medianHandOff = getLatencyPercentile(&handOffHistogram, 50);
+    ULONGLONG tailHandOff = getLatencyPercentile(&handOffHistogram, 99);
+
+    sprintf(string, "Haifa Port: Placement %s on %d cores - %ld hand-offs, p50 %llu us, p99 %llu us,"
+        " jitter %llu us", getThreadPlacementPolicyName(threadPlacementPolicy), getNumberOfPlacementCores(),
+        handOffHistogram.numberOfSamples, medianHandOff, tailHandOff, tailHandOff - medianHandOff);
+
+    if (!safePrintWithTimeStamp(string))
+    {
+        fprintf(stderr, "HaifaPort::printPlacementReport::Unexpected Error - Print failed!\n");
+    }
 }
 
-void initializeGlobalMutexAndSemaphores(int numberOfVessels, SECURITY_ATTRIBUTES* securityAttributes)
+void printRoundTripReport(int numberOfVessels, ULONGLONG makespan)
 {
-    // Shared semaphore's names
-    LPCWSTR medToRedCanalString = L"MedToRedCanal";
-    LPCWSTR redToMedCanalString = L"RedToMedCanal";
-    LPCWSTR processSafePrintString = L"ProcessSafePrint";
+    char string[MAX_STRING];
 
-    randomMutex = CreateMutex(NULL, FALSE, NULL);
-    // Create shared semaphores between HaifaPort and EilatPort.
-    medToRedCanalSemaphore = CreateSemaphore(securityAttributes, 1, 1, medToRedCanalString);
-    redToMedCanalSemaphore = CreateSemaphore(securityAttributes, 1, 1, redToMedCanalString);
-    processSafePrintSemaphore = CreateSemaphore(securityAttributes, 1, 1, processSafePrintString);
+    if (!isRoundTrip)
+    {
+        return;
+    }
+
+    ULONGLONG steadyStateTime = steadyStateEndTime - steadyStateStartTime;
+
+    sprintf(string, "Haifa Port: Round trips - %d voyages of %d vessels in %llu ms, %.3f voyages per second,"
+        " %.3f in steady state (%d voyages)", numberOfReturnedVoyages, numberOfVessels, makespan,
+        makespan ? numberOfReturnedVoyages * 1000.0 / makespan : 0.0,
+        steadyStateTime ? numberOfSteadyStateVoyages * 1000.0 / steadyStateTime : 0.0,
+        numberOfSteadyStateVoyages);
 
-    if (randomMutex == NULL || medToRedCanalSemaphore == NULL || 
-        redToMedCanalSemaphore == NULL || processSafePrintSemaphore == NULL)
+    if (!safePrintWithTimeStamp(string))
     {
-        fprintf(stderr, "HaifaPort::initializeGlobalMutexAndSemaphores::Unexpected Error - "
-            "Mutex/Semaphore creation failed!\n");
-        exit(EXIT_FAILURE);
+        fprintf(stderr, "HaifaPort::printRoundTripReport::Unexpected Error - Print failed!\n");
     }
 
-    vesselsSemaphores = (HANDLE*)malloc(numberOfVessels * sizeof(HANDLE));
+    sprintf(string, "Haifa Port: Loading - %d cranes, %ld vessels loaded, wait for a station p50 %llu ms,"
+        " p99 %llu ms", numberOfLoadingCranes, loadingWaitHistogram.numberOfSamples,
+        getLatencyPercentile(&loadingWaitHistogram, 50), getLatencyPercentile(&loadingWaitHistogram, 99));
 
-    if (vesselsSemaphores == NULL)
+    if (!safePrintWithTimeStamp(string))
     {
-        fprintf(stderr, "HaifaPort::initializeGlobalMutexAndSemaphores::Unexpected Error - "
-            "Memory allocation failed!\n");
-        exit(EXIT_FAILURE);
+        fprintf(stderr, "HaifaPort::printRoundTripReport::Unexpected Error - Print failed!\n");
     }
+}
 
-    for (int i = 0; i < numberOfVessels; i++)
+void printLockProfileReport(void)
+{
+#ifdef PORT_LOCK_PROFILER
+    char string[MAX_STRING];
+    char profileString[MAX_LOCK_PROFILE_STRING];
+    LockProfile* rankedProfiles[MAX_LOCK_PROFILES];
+    int numberOfProfiles = rankLockProfiles(rankedProfiles);
+
+    for (int i = 0; i < numberOfProfiles; i++)
     {
-        vesselsSemaphores[i] = CreateSemaphore(NULL, 0, 1, NULL);
+        formatLockProfile(profileString, rankedProfiles[i]);
+        sprintf(string, "Haifa Port: Lock %2d. %s", i + 1, profileString);
 
-        if (vesselsSemaphores[i] == NULL)
+        if (!safePrintWithTimeStamp(string))
         {
-            fprintf(stderr, "HaifaPort::initializeGlobalMutexAndSemaphores::Unexpected Error - "
-                "vesselsSemaphores[%d] Creation Failed!\n", i);
-            exit(EXIT_FAILURE);
+            fprintf(stderr, "HaifaPort::printLockProfileReport::Unexpected Error - Print failed!\n");
         }
     }
+#endif
 }
 
-void cleanGlobalMutexAndSemaphores(int numberOfVessels)
+void printResults(int numberOfVessels, ULONGLONG makespan)
 {
-    CloseHandle(randomMutex);
-    CloseHandle(medToRedCanalSemaphore);
-    CloseHandle(redToMedCanalSemaphore);
-    CloseHandle(processSafePrintSemaphore);
-
-    for (int i = 0; i < numberOfVessels; i++)
+    if (!isPrintingResults)
     {
-        CloseHandle(vesselsSemaphores[i]);
+        return;
     }
 
-    free(vesselsSemaphores);
-}
+    // CPU time of both ports, the kernel's time stands for the cost of their system calls.
+    ULONGLONG kernelTicks = 0, userTicks = 0; // 100 nanoseconds.
+    ULONGLONG eilatPortKernelTicks, eilatPortUserTicks;
 
-void createSuezCanalPipes(SECURITY_ATTRIBUTES* securityAttributes)
-{
-    // Create the pipe Haifa to Eilat (Med. Sea ==> Red Sea)
-    if (!CreatePipe(&readFromHaifaHandle, &writeToEilatHandle, securityAttributes, 0))
+    getProcessCpuTicks(GetCurrentProcess(), &kernelTicks, &userTicks);
+
+    if (eilatPortProcessHandle != NULL &&
+        getProcessCpuTicks(eilatPortProcessHandle, &eilatPortKernelTicks, &eilatPortUserTicks))
     {
-        fprintf(stderr, "HaifaPort::createSuezCanalPipes::Unexpected Error - "
-            "'Med. Sea ==> Red Sea' pipe creation failed!\n");
-        exit(EXIT_FAILURE);
+        kernelTicks += eilatPortKernelTicks - eilatPortBaseKernelTicks;
+        userTicks += eilatPortUserTicks - eilatPortBaseUserTicks;
     }
 
-    // create the pipe Eilat to Haifa (Med. Sea <== Red Sea)
-    if (!CreatePipe(&readFromEilatHandle, &writeToHaifaHandle, securityAttributes, 0))
+    // vessels,makespanMs,vesselsPerSecond,p50Ms,p90Ms,p99Ms,maxMs,userMsPerVessel,kernelMsPerVessel,
+    // then the p50Ms and p99Ms of every stage: depart, outbound, eilat and dock.
+    printf("%d,%llu,%.3f,%llu,%llu,%llu,%ld,%.3f,%.3f", numberOfVessels, makespan,
+        makespan ? numberOfVessels * 1000.0 / makespan : 0.0,
+        getLatencyPercentile(&voyageLatencies, 50.0), getLatencyPercentile(&voyageLatencies, 90.0),
+        getLatencyPercentile(&voyageLatencies, 99.0), voyageLatencies.maxLatency,
+        userTicks / 10000.0 / numberOfVessels, kernelTicks / 10000.0 / numberOfVessels);
+
+    for (int i = 0; i < VOYAGE_STAGES; i++)
     {
-        fprintf(stderr, "HaifaPort::createSuezCanalPipes::Unexpected Error - "
-            "'Med. Sea <== Red Sea' pipe creation failed!\n");
-        exit(EXIT_FAILURE);
+        printf(",%llu,%llu", getLatencyPercentile(&voyageStageLatencies[i], 50.0),
+            getLatencyPercentile(&voyageStageLatencies[i], 99.0));
     }
+
+    printf("\n");
+    fflush(stdout);
 }
 
-void setStartUpInfoAndStartEilatPortProcess(void)
+int getProcessCpuTicks(HANDLE processHandle, ULONGLONG* kernelTicks, ULONGLONG* userTicks)
 {
-    STARTUPINFO startupInfo;
-    PROCESS_INFORMATION processInformation;
-
-    // Fill pi with zeros, in bytes.
-    SecureZeroMemory(&processInformation, sizeof(processInformation));
-
-    // Retrieves the conents of the STARTUPINFO structure
-    // that was specified when the calling process was created.
-    GetStartupInfo(&startupInfo);
-
-    // The standard error device. This is the active console screen buffer.
-    startupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
-    // Redirect the standard input to the read end of the pipe.
-    startupInfo.hStdOutput = writeToHaifaHandle;
-    startupInfo.hStdInput = readFromHaifaHandle;
-    // To inherit the standard input, output, and error handles, 
-    // the dwFlags must include STARTF_USESTDHANDLES.
-    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+    FILETIME creationTime, exitTime, kernelTime, userTime;
 
-    TCHAR ProcessName[MAX_STRING];
-    wcscpy(ProcessName, L"EilatPort.exe");
-
-    // Create and start the EilatPort process
-    if (!CreateProcess(NULL,    // No module name (use command line).
-        ProcessName,            // Command line.
-        NULL,                   // Process handle not inheritable.
-        NULL,                   // Thread handle not inheritable.
-        TRUE,                   // Set handle inheritance to TRUE.
-        0,                      // No creation flags.
-        NULL,                   // Use parent's environment block.
-        NULL,                   // Use parent's starting directory.
-        &startupInfo,           // Pointer to STARTUPINFO structure.
-        &processInformation)    // Pointer to PROCESS_INFORMATION structure.
-        )
+    if (!GetProcessTimes(processHandle, &creationTime, &exitTime, &kernelTime, &userTime))
     {
-        fprintf(stderr, "HaifaPort::setStartUpInfoAndStartEilatPortProcess::Unexpected Error -"
-            " CreateProcess for EilatPort failed (%d)!\n", GetLastError());
-        exit(EXIT_FAILURE);
+        return FALSE;
     }
+
+    *kernelTicks = ((ULONGLONG)kernelTime.dwHighDateTime << 32) | kernelTime.dwLowDateTime;
+    *userTicks = ((ULONGLONG)userTime.dwHighDateTime << 32) | userTime.dwLowDateTime;
+
+    return TRUE;
 }
 
-void suezCanalPassageApproval(int numberOfVessels)
+void waitForVesselThreads(int numberOfVessels)
 {
     char string[MAX_STRING];
 
-    sprintf(string, "Haifa Port : There are %d Vessels in the port",numberOfVessels);
-
-    if (!safePrintWithTimeStamp(string))
+    // By using a loop on WaitForSingleObject we are able to lower the 
+    // semaphore's counter by the number of vessels.
+    for (int i = 0; i < numberOfVessels; i++)
     {
-        fprintf(stderr, "HaifaPort::suezCanalPassageApproval::Unexpected Error -"
-            " Print failed!\n");
-        return 1;
+        waitForProfiledObject(&vesselsDoneSemaphoreProfile, vesselsDoneSemaphore, INFINITE);
     }
 
-    sprintf(string, "Haifa Port: Requesting passage from Eilat Port...");
+    sprintf(string, "Haifa Port: All Vessel Threads are done");
 
     if (!safePrintWithTimeStamp(string))
     {
-        fprintf(stderr, "HaifaPort::suezCanalPassageApproval::Unexpected Error -"
-            " Print failed!\n");
-        return 1;
+        fprintf(stderr, "HaifaPort::waitForVesselThreads::Unexpected Error - Print failed!\n");
     }
+}
 
-    sprintf(buffer, "%d", numberOfVessels);
+DWORD WINAPI Departures(LPVOID Param)
+{
+    FleetManifest* manifest = (FleetManifest*)Param;
+    VesselRecord vesselRecord;
+    ULONGLONG firstDepartureTime = GetTickCount64();
+    DWORD threadId;
 
-    // Writing number of vessels to 'Med. Sea ==> Red Sea' pipe.
-    if (!WriteFile(writeToEilatHandle, buffer, BUFFER_SIZE, &numberOfWrittenBytes, NULL))
+    watchStallThread("Departures", 0);
+
+    // Only vessels which have departed hold a record in memory, the rest stay in the manifest.
+    while (readNextVesselRecord(manifest, &vesselRecord))
     {
-        fprintf(stderr, "HaifaPort::suezCanalPassageApproval::Unexptected Error - "
-            "Writing numberOfVessels to 'Med. Sea ==> Red Sea' pipe failed\n");
-        exit(EXIT_FAILURE);
+        ULONGLONG elapsedTime = GetTickCount64() - firstDepartureTime;
+
+        if (vesselRecord.departureTime > 0 && (ULONGLONG)vesselRecord.departureTime > elapsedTime)
+        {
+            Sleep((DWORD)(vesselRecord.departureTime - elapsedTime));
+        }
+
+        // A vessel departs only once it has a slot and a transit credit, so no more vessel threads
+        // run than EilatPort granted credits, whatever the fleet's size. A vessel which is late
+        // for its departure time departs as soon as another one gives up its slot or credit.
+        int vesselSlot = takeVesselSlot();
+
+        waitForProfiledObject(&transitCreditsSemaphoreProfile, transitCreditsSemaphore, INFINITE);
+
+        VesselRecord* departingVessel = &vesselSlotRecords[vesselSlot];
+
+        *departingVessel = vesselRecord;
+        vesselsNumberOfVoyages[vesselSlot] = 0;
+        vesselsSailingAgain[vesselSlot] = FALSE;
+
+        HANDLE vesselHandler = CreateThread(NULL, 0, Vessel, departingVessel, 0, &threadId);
+
+        if (vesselHandler == NULL || !placeThread(vesselHandler, PLACEMENT_VESSEL, departingVessel->vesselId - 1))
+        {
+            fprintf(stderr, "HaifaPort::Departures::Unexpected Error - "
+                "Vessel thread %d creation or placement failed!\n", departingVessel->vesselId);
+            exit(EXIT_FAILURE);
+        }
+
+        // The vessel signals vesselsDoneSemaphore when done, its handle isn't needed.
+        CloseHandle(vesselHandler);
     }
 
-    int isPassageApproved = FALSE;
+    unwatchStallThread();
 
-    // Read passage result response from Eilat port through 'Med. Sea <== Red Sea' pipe.
-    if (!ReadFile(readFromEilatHandle, buffer, BUFFER_SIZE, &numberOfReadBytes, NULL))
+    return 0;
+}
+
+DWORD WINAPI Vessel(LPVOID Param)
+{
+    // Get the thread's record, which is owned by the thread till it frees the record's slot.
+    VesselRecord* vesselRecord = (VesselRecord*)Param;
+    int vesselId = vesselRecord->vesselId;
+    int vesselSlot = (int)(vesselRecord - vesselSlotRecords);
+
+    // Comment: for some reason rand() kept producing the same values
+    // even though the seed has been set at the main. As far as I'm aware
+    // the seed only needs to be set once, even in a threaded enviorment 
+    // (for example our for Home Tasks it was enough only in the main).
+    // For that reason the seed is set in every thread which makes use of rand().
+    // I would like to know what's the reason for this if possible
+    srand(randomSeed + vesselId);
+    seedServiceTimeThread(vesselId);
+    watchStallThread("Vessel", vesselId);
+
+    // The manifest's cargo weight, kept as the record's weight is the one loaded on each voyage.
+    int manifestCargoWeight = vesselRecord->cargoWeight;
+    int result;
+
+    // In round trips the vessel is loaded before every voyage, and sails again as long as the
+    // main thread decided it does once it returned.
+    do
     {
-        fprintf(stderr, "HaifaPort::suezCanalPassageApproval::Unexptected Error - "
-            "reading passage answer from 'Med. Sea <== Red Sea' pipe failed\n");
-        exit(EXIT_FAILURE);
-    }
+        if (isRoundTrip && loadVesselAtHaifaPort(vesselRecord, vesselSlot, manifestCargoWeight))
+        {
+            result = 1;
+            break;
+        }
 
-    isPassageApproved = atoi(buffer);
+        ULONGLONG departureTime = GetTickCount64();
+        ULONGLONG stageStartTime = departureTime;
 
-    sprintf(string, "Haifa Port: passage from Eilat Port %s!",
-        isPassageApproved ? "approved" : "denied");
+        result = startSailing(vesselId) ||
+            recordVoyageStage(VOYAGE_DEPART, &stageStartTime) ||
+            sailToEilatPort(vesselRecord, vesselSlot) ||
+            recordVoyageStage(VOYAGE_OUTBOUND, &stageStartTime) ||
+            returnFromEilatToEndSailing(vesselId, vesselSlot, &stageStartTime) ||
+            recordVoyageStage(VOYAGE_DOCK, &stageStartTime);
 
-    if (!safePrintWithTimeStamp(string))
+        recordLatency(&voyageLatencies, GetTickCount64() - departureTime);
+    } while (result == 0 && isRoundTrip && vesselsSailingAgain[vesselSlot]);
+
+    unwatchStallThread();
+    freeVesselSlot(vesselSlot);
+
+    // Signal the main thread that the vessel is done.
+    if (!releaseProfiledSemaphore(&vesselsDoneSemaphoreProfile, vesselsDoneSemaphore, 1))
     {
-        fprintf(stderr, "HaifaPort::Main::Unexpected Error - Print failed!\n");
+        fprintf(stderr, "HaifaPort::Vessel %2d::Unexpected Error -"
+            " vesselsDoneSemaphore.V()\n", vesselId);
         return 1;
     }
 
-    if (!isPassageApproved)
-    {
-        exit(EXIT_SUCCESS);
-    }
+    return result;
 }
 
-HANDLE* createVesselThreads(int numberOfVessels, int** vesselsId)
+DWORD WINAPI LoadingCrane(LPVOID Param)
 {
-    DWORD threadId;
-    *vesselsId = (int*)malloc(numberOfVessels * sizeof(int));
-    HANDLE* vesselsHandler = (HANDLE*)malloc(numberOfVessels * sizeof(HANDLE));
+    // Get the thread's ID, its station has the same index.
+    int craneId = *(int*)Param;
+    int craneIndex = craneId - 1;
+    LoadingQuayStation* station = &loadingQuayStations[craneIndex];
+    char string[MAX_STRING];
 
-    if (*vesselsId == NULL || vesselsHandler == NULL)
-    {
-        fprintf(stderr, "HaifaPort::createVesselThreads::Unexpected Error - "
-            "Memory allocation failed!\n");
-        exit(EXIT_FAILURE);
-    }
+    // The loading cranes' draws are streams apart from the vessels'.
+    seedServiceTimeThread((ULONGLONG)1 << 32 | craneId);
+    watchStallThread("LoadingCrane", craneId);
 
-    // Create all Vessel threads. ID starts with 1 till numberOfVessels.
-    for (int i = 1; i <= numberOfVessels; i++)
+    while (!areAllVoyagesDone)
     {
-        int vesselIndex = i - 1;
-
-        (*vesselsId)[vesselIndex] = i;
-        vesselsHandler[vesselIndex] =
-            CreateThread(NULL, 0, Vessel, &(*vesselsId)[vesselIndex], 0, &threadId);
+        // Wait till a vessel signals to start loading its cargo.
+        waitForProfiledWord(&loadingCranesWaitWordsProfile, &loadingCranesWaitWords[craneIndex]);
 
-        if (vesselsHandler[vesselIndex] == NULL)
+        // Check if the main thread has indicated to stop running.
+        if (areAllVoyagesDone)
         {
-            fprintf(stderr, "HaifaPort::createVesselThreads::Unexpected Error - "
-                "Vessel thread %d creation failed!\n", (*vesselsId)[vesselIndex]);
-            exit(EXIT_FAILURE);
+            break;
         }
-    }
 
-    return vesselsHandler;
-}
+        recordHandOff(&handOffHistogram, &loadingCranesHandOffStamps[craneIndex]);
+        Sleep(getServiceTime(SERVICE_TIME_LOAD, station->cargoWeight));
 
-void readIncomingVesselsFromEilatPort(int numberOfVessels)
-{
-    // Read incoming vessels from EilatPort and signal them to continue.
-    for (int i = 0; i < numberOfVessels; i++)
-    {
-        if (!ReadFile(readFromEilatHandle, buffer, BUFFER_SIZE, &numberOfReadBytes, NULL))
+        sprintf(string, "Loading Crane %2d - loaded %d tons on vessel %d", craneId,
+            station->cargoWeight, station->vesselId);
+
+        if (!safePrintWithTimeStamp(string))
         {
-            fprintf(stderr, "HaifaPort::readIncomingVesselsFromEilatPort::Unexptected Error -"
-                " Reading incoming vessel from 'Med. Sea <== Red Sea' pipe failed!\n");
-            exit(EXIT_FAILURE);
+            fprintf(stderr, "HaifaPort::LoadingCrane %2d::Unexpected Error - Print failed!\n", craneId);
+            return 1;
         }
 
-        int vesselId = atoi(buffer);
+        // Signal vessel that the loading process has ended.
+        stampHandOff(&vesselsHandOffStamps[station->vesselSlot]);
 
-        // Signal that vessel has returned from EilatPort and continue its tasks.
-        if (!ReleaseSemaphore(vesselsSemaphores[vesselId - 1], 1, NULL))
+        if (!signalProfiledWord(&vesselsWaitWordsProfile, &vesselsWaitWords[station->vesselSlot]))
         {
-            fprintf(stderr, "HaifaPort::readIncomingVesselsFromEilatPort::Unexpected Error -"
-                "vesselsSemaphores[%d].V()\n", vesselId - 1);
-            exit(EXIT_FAILURE);
+            fprintf(stderr, "HaifaPort::LoadingCrane %2d::Unexpected Error - vesselsWaitWords[%d].V()\n",
+                craneId, station->vesselSlot);
         }
     }
+
+    unwatchStallThread();
+
+    return 0;
 }
 
-void updateEilatAllVesselsDoneAndWaitForThreads(void)
+int loadVesselAtHaifaPort(VesselRecord* vesselRecord, int vesselSlot, int manifestCargoWeight)
 {
-    // Write to EilatPort that all vessel threads are done.
-    // Comment: This command operates more as a cosmetic reason, since when the last thread has returend
-    // EilatPort will start printing ending messages. With this EilatPort will wait till 
-    // the end of all vessel's messages.
-    sprintf(buffer, "%d", TRUE);
+    int vesselId = vesselRecord->vesselId;
+    int stationIndex = 0;
+    char string[MAX_STRING];
+    ULONGLONG waitStartTime = GetTickCount64();
 
-    if (!WriteFile(writeToEilatHandle, buffer, BUFFER_SIZE, &numberOfWrittenBytes, NULL))
-    {
-        fprintf(stderr, "HaifaPort::updateEilatAllVesselsDoneAndWaitForThreads::Unexpected Error -"
-            " Writing that vessels ended has failed!\n");
-        exit(EXIT_FAILURE);
-    }
+    // Wait for a free station of the loading quay.
+    waitForProfiledObject(&loadingQuaySemaphoreProfile, loadingQuaySemaphore, INFINITE);
+    recordLatency(&loadingWaitHistogram, GetTickCount64() - waitStartTime);
 
-    // Check that all threads are done in EilatPort.
-    if (!ReadFile(readFromEilatHandle, buffer, BUFFER_SIZE, &numberOfReadBytes, NULL))
+    waitForProfiledObject(&loadingStationMutexProfile, loadingStationMutex, INFINITE);
+
+    // Comment: the semaphore let the vessel in, so a station is free.
+    while (loadingQuayStations[stationIndex].isOccupied)
     {
-        fprintf(stderr, "HaifaPort::updateEilatAllVesselsDoneAndWaitForThreads::Unexptected Error -"
-            " Reading EilatPort's end of threads has failed!\n");
-        exit(EXIT_FAILURE);
+        stationIndex++;
     }
 
-    if (!atoi(buffer))
+    LoadingQuayStation* station = &loadingQuayStations[stationIndex];
+
+    station->isOccupied = TRUE;
+    station->vesselId = vesselId;
+    station->vesselSlot = vesselSlot;
+
+    if (!releaseProfiledMutex(&loadingStationMutexProfile, loadingStationMutex))
     {
-        fprintf(stderr, "HaifaPort::updateEilatAllVesselsDoneAndWaitForThreads::Unexptected Error -"
-            " threads in EilatPort still exist!\n");
-        exit(EXIT_FAILURE);
+        fprintf(stderr, "HaifaPort::Vessel %2d::loadVesselAtHaifaPort::Unexpected Error -"
+            " loadingStationMutex.V()\n", vesselId);
+        return 1;
     }
-}
 
-void freeVesselThreads(HANDLE* vesselsHandler, int* vesselsId, int numberOfVessels)
-{
-    char string[MAX_STRING];
+    // The manifest's cargo weight, or a random one on every voyage, which EilatPort then unloads.
+    vesselRecord->cargoWeight = manifestCargoWeight > 0 ? manifestCargoWeight :
+        safeRand() % (MAX_WEIGHT - MIN_WEIGHT + 1) + MIN_WEIGHT;
+    station->cargoWeight = vesselRecord->cargoWeight;
 
-    sprintf(string, "Haifa Port: All Vessel Threads are done");
+    sprintf(string, "Vessel %2d - loading %d tons near loading crane %d", vesselId,
+        station->cargoWeight, station->craneId);
 
     if (!safePrintWithTimeStamp(string))
     {
-        fprintf(stderr, "HaifaPort::Main::Unexpected Error - Print failed!\n");
+        fprintf(stderr, "HaifaPort::Vessel %2d::loadVesselAtHaifaPort::Unexpected Error -"
+            " Print failed!\n", vesselId);
         return 1;
     }
 
-    for (int i = 0; i < numberOfVessels; i++)
+    // Signal the crane to start loading, and wait till it is done.
+    stampHandOff(&loadingCranesHandOffStamps[stationIndex]);
+
+    if (!signalProfiledWord(&loadingCranesWaitWordsProfile, &loadingCranesWaitWords[stationIndex]))
     {
-        CloseHandle(vesselsHandler[i]);
+        fprintf(stderr, "HaifaPort::Vessel %2d::loadVesselAtHaifaPort::Unexpected Error -"
+            " loadingCranesWaitWords[%d].V()\n", vesselId, stationIndex);
+        return 1;
     }
 
-    free(vesselsId);
-    free(vesselsHandler);
-}
-
-int safePrintWithTimeStamp(char string[])
-{
-    WaitForSingleObject(processSafePrintSemaphore, INFINITE);
+    waitForProfiledWord(&vesselsWaitWordsProfile, &vesselsWaitWords[vesselSlot]);
+    recordHandOff(&handOffHistogram, &vesselsHandOffStamps[vesselSlot]);
 
-    GetLocalTime(&currentTime);
-    fprintf(stderr, "[%02d:%02d:%02d] %s\n",
-        currentTime.wHour, currentTime.wMinute, currentTime.wSecond, string);
+    // Leave the station to the next vessel.
+    waitForProfiledObject(&loadingStationMutexProfile, loadingStationMutex, INFINITE);
+    station->isOccupied = FALSE;
 
-    if (!ReleaseSemaphore(processSafePrintSemaphore, 1, NULL))
+    if (!releaseProfiledMutex(&loadingStationMutexProfile, loadingStationMutex) ||
+        !releaseProfiledSemaphore(&loadingQuaySemaphoreProfile, loadingQuaySemaphore, 1))
     {
-        fprintf(stderr, "HaifaPort::safePrintWithTimeStamp::Unexpected Error - "
-            "processSafePrintSemaphore.V()\n");
-        return FALSE;
+        fprintf(stderr, "HaifaPort::Vessel %2d::loadVesselAtHaifaPort::Unexpected Error -"
+            " loadingStationMutex.V() or loadingQuaySemaphore.V()\n", vesselId);
+        return 1;
     }
 
-    return TRUE;
-}
-
-DWORD WINAPI Vessel(LPVOID Param)
-{
-    // Get the thread's ID.
-    int vesselId = *(int*)Param;
-
-    // Comment: for some reason rand() kept producing the same values
-    // even though the seed has been set at the main. As far as I'm aware
-    // the seed only needs to be set once, even in a threaded enviorment 
-    // (for example our for Home Tasks it was enough only in the main).
-    // For that reason the seed is set in every thread which makes use of rand().
-    // I would like to know what's the reason for this if possible
-    srand((unsigned int)time(NULL));
-
-    return startSailing(vesselId) ||
-        sailToEilatPort(vesselId) ||
-        returnFromEilatToEndSailing(vesselId);
+    return 0;
 }
 
 int startSailing(int vesselId)
@@ -496,15 +2232,19 @@ int startSailing(int vesselId)
         return 1;
     }
 
-    Sleep(randomSleepTime());
+    Sleep(getServiceTime(SERVICE_TIME_DEPART, 0));
 
     return 0;
 }
 
-int sailToEilatPort(int vesselId)
+int sailToEilatPort(VesselRecord* vesselRecord, int vesselSlot)
 {
-    // Allow only 1 vessel at a time to enter the canal (pipe).
-    WaitForSingleObject(medToRedCanalSemaphore, INFINITE);
+    int vesselId = vesselRecord->vesselId;
+
+    // Wait for the vessel's convoy to enter the canal (pipe).
+    // Comment: the vessel took its transit credit as it departed, so it has a berth in EilatPort
+    // once it arrives.
+    enterSuezCanal(suezCanal, SUEZ_CANAL_MED_TO_RED);
 
     char string[MAX_STRING];
 
@@ -517,12 +2257,27 @@ int sailToEilatPort(int vesselId)
         return 1;
     }
 
-    Sleep(randomSleepTime());
+    Sleep(getServiceTime(SERVICE_TIME_TRANSIT, 0));
+
+    // The vessel's ID is followed by its cargo weight and priority from the manifest, and by its
+    // slot, which EilatPort returns along with the vessel.
+    // Comment: the message has its own buffer, since the main thread reads incoming
+    // vessels into the global buffer at the same time.
+    char message[BUFFER_SIZE];
 
-    sprintf(buffer, "%d", vesselId);
+    sprintf(message, "%d %d %d %d", vesselId, vesselRecord->cargoWeight, vesselRecord->priority, vesselSlot);
+
+    // The vessel is in flight from now on, if EilatPort stops it is resent to the restarted one.
+    AcquireSRWLockShared(&eilatPortLock);
+    vesselsInFlight[vesselSlot] = vesselRecord;
+    InterlockedIncrement(&numberOfUsedCredits);
 
     // Writing vessel ID to 'Med. Sea -> Red Sea' pipe.
-    if (!WriteFile(writeToEilatHandle, buffer, BUFFER_SIZE, &numberOfWrittenBytes, NULL))
+    int isWritten = writeMessage(toEilatChannel, message);
+
+    ReleaseSRWLockShared(&eilatPortLock);
+
+    if (!isWritten && !isRecoverable)
     {
         fprintf(stderr, "HaifaPort::Vessel %2d::sailToEilatPort::Unexpected Error -"
             " Writing vessel ID to 'Med. Sea ==> Red Sea' pipe failed\n", vesselId);
@@ -532,12 +2287,14 @@ int sailToEilatPort(int vesselId)
     return 0;
 }
 
-int returnFromEilatToEndSailing(int vesselId)
+int returnFromEilatToEndSailing(int vesselId, int vesselSlot, ULONGLONG* stageStartTime)
 {
     char string[MAX_STRING];
 
     // Wait for vessel to return from EilatPort
-    WaitForSingleObject(vesselsSemaphores[vesselId - 1], INFINITE);
+    waitForProfiledWord(&vesselsWaitWordsProfile, &vesselsWaitWords[vesselSlot]);
+    recordHandOff(&handOffHistogram, &vesselsHandOffStamps[vesselSlot]);
+    recordVoyageStage(VOYAGE_EILAT, stageStartTime);
 
     sprintf(string, "Vessel %2d - exiting Canal: Red Sea ==> Med. Sea", vesselId);
 
@@ -548,15 +2305,14 @@ int returnFromEilatToEndSailing(int vesselId)
         return 1;
     }
 
-    Sleep(randomSleepTime());
+    Sleep(getServiceTime(SERVICE_TIME_DOCK, 0));
 
-    // Signal that the 'Med. Sea <== Red Sea' pipe is free for another vessel to pass.
-    if (!ReleaseSemaphore(redToMedCanalSemaphore, 1, NULL))
-    {
-        fprintf(stderr, "HaifaPort::Vessel %2d::returnFromEilatToEndSailing::Unexpected Error -"
-            " medToRedCanalSemaphore.V()\n", vesselId);
-        return 1;
-    }
+    // Signal the canal that the vessel has left the 'Med. Sea <== Red Sea' lane.
+    // Comment: a restart of EilatPort counts the vessels in the lane, so they leave it together.
+    AcquireSRWLockShared(&eilatPortLock);
+    exitSuezCanal(suezCanal, SUEZ_CANAL_RED_TO_MED);
+    InterlockedDecrement(&numberOfVesselsLeavingCanal);
+    ReleaseSRWLockShared(&eilatPortLock);
 
     sprintf(string, "Vessel %2d - done sailing @ Haifa Port", vesselId);
 
@@ -568,4 +2324,14 @@ int returnFromEilatToEndSailing(int vesselId)
     }
 
     return 0;
-}
\ No newline at end of file
+}
+
+int recordVoyageStage(int stage, ULONGLONG* stageStartTime)
+{
+    ULONGLONG now = GetTickCount64();
+
+    recordLatency(&voyageStageLatencies[stage], now - *stageStartTime);
+    *stageStartTime = now;
+
+    return 0;
+}
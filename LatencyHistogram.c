@@ -0,0 +1,117 @@
+#include "LatencyHistogram.h"
+
+int getLatencyBucket(ULONGLONG latency);
+ULONGLONG getLatencyBucketUpperBound(int bucket);
+
+void initializeLatencyHistogram(LatencyHistogram* histogram)
+{
+    SecureZeroMemory((void*)histogram, sizeof(LatencyHistogram));
+}
+
+int getLatencyBucket(ULONGLONG latency)
+{
+    if (latency > 0xFFFFFFFF)
+    {
+        latency = 0xFFFFFFFF;
+    }
+
+    if (latency < LATENCY_HISTOGRAM_SUB_BUCKETS)
+    {
+        return (int)latency;
+    }
+
+    // Find the power of 2 of the latency, the bits below its top bit pick the sub bucket.
+    int exponent = 0;
+
+    while ((latency >> (exponent + 1)) != 0)
+    {
+        exponent++;
+    }
+
+    int subBucket = (int)(latency >> (exponent - LATENCY_HISTOGRAM_SUB_BUCKET_BITS)) &
+        (LATENCY_HISTOGRAM_SUB_BUCKETS - 1);
+
+    return (exponent - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS + subBucket;
+}
+
+ULONGLONG getLatencyBucketUpperBound(int bucket)
+{
+    if (bucket < LATENCY_HISTOGRAM_SUB_BUCKETS)
+    {
+        return bucket;
+    }
+
+    int exponent = bucket / LATENCY_HISTOGRAM_SUB_BUCKETS + LATENCY_HISTOGRAM_SUB_BUCKET_BITS - 1;
+    ULONGLONG subBucket = bucket % LATENCY_HISTOGRAM_SUB_BUCKETS;
+    ULONGLONG width = 1ULL << (exponent - LATENCY_HISTOGRAM_SUB_BUCKET_BITS);
+
+    return (1ULL << exponent) + (subBucket + 1) * width - 1;
+}
+
+void recordLatency(LatencyHistogram* histogram, ULONGLONG latency)
+{
+    LONG maxLatency = histogram->maxLatency;
+    LONG newLatency = latency > 0x7FFFFFFF ? 0x7FFFFFFF : (LONG)latency;
+
+    InterlockedIncrement(&histogram->counts[getLatencyBucket(latency)]);
+    InterlockedIncrement(&histogram->numberOfSamples);
+    InterlockedExchangeAdd64(&histogram->sumOfLatencies, (LONGLONG)latency);
+
+    // Raise the max only if no other thread has raised it higher in the meantime.
+    while (newLatency > maxLatency)
+    {
+        LONG previousMax = InterlockedCompareExchange(&histogram->maxLatency, newLatency, maxLatency);
+
+        if (previousMax == maxLatency)
+        {
+            break;
+        }
+
+        maxLatency = previousMax;
+    }
+}
+
+ULONGLONG getLatencyPercentile(LatencyHistogram* histogram, double percent)
+{
+    LONG numberOfSamples = histogram->numberOfSamples;
+
+    if (numberOfSamples == 0)
+    {
+        return 0;
+    }
+
+    // The rank of the sample which the percentile falls on, rounded up.
+    LONGLONG rank = (LONGLONG)(percent / 100.0 * numberOfSamples + 0.999999);
+    LONGLONG seenSamples = 0;
+
+    if (rank < 1)
+    {
+        rank = 1;
+    }
+
+    for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++)
+    {
+        seenSamples += histogram->counts[i];
+
+        if (seenSamples >= rank)
+        {
+            ULONGLONG upperBound = getLatencyBucketUpperBound(i);
+
+            // No sample is above the max, so don't report the bucket's bound past it.
+            return upperBound < (ULONGLONG)histogram->maxLatency ?
+                upperBound : (ULONGLONG)histogram->maxLatency;
+        }
+    }
+
+    return histogram->maxLatency;
+}
+
+ULONGLONG getAverageLatency(LatencyHistogram* histogram)
+{
+    if (histogram->numberOfSamples == 0)
+    {
+        return 0;
+    }
+
+    return (ULONGLONG)(histogram->sumOfLatencies / histogram->numberOfSamples);
+}
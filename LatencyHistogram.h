@@ -0,0 +1,27 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <windows.h>
+
+// Latencies below 2^LATENCY_HISTOGRAM_SUB_BUCKET_BITS miliseconds get a bucket each,
+// above that every power of 2 is split into 2^LATENCY_HISTOGRAM_SUB_BUCKET_BITS buckets,
+// so a percentile is accurate to about 6% with a fixed amount of memory.
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 4
+#define LATENCY_HISTOGRAM_SUB_BUCKETS (1 << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+#define LATENCY_HISTOGRAM_BUCKETS ((32 - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS)
+
+// Histogram of latencies in miliseconds. Any thread may record into it without a lock.
+typedef struct {
+    volatile LONG counts[LATENCY_HISTOGRAM_BUCKETS];
+    volatile LONG numberOfSamples;
+    volatile LONG maxLatency;
+    volatile LONGLONG sumOfLatencies;
+} LatencyHistogram;
+
+void initializeLatencyHistogram(LatencyHistogram* histogram);
+void recordLatency(LatencyHistogram* histogram, ULONGLONG latency);
+// Returns the latency which the given percent (0-100) of the samples don't exceed.
+ULONGLONG getLatencyPercentile(LatencyHistogram* histogram, double percent);
+ULONGLONG getAverageLatency(LatencyHistogram* histogram);
+
+#endif
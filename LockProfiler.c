@@ -0,0 +1,192 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "LockProfiler.h"
+
+#ifdef PORT_LOCK_PROFILER
+
+// Profiles in the order they were first used, a profile adds itself on its first wait.
+LockProfile* lockProfiles[MAX_LOCK_PROFILES];
+volatile LONG numberOfLockProfiles = 0;
+
+void recordLockWait(LockProfile* profile, LONGLONG waitTime, int isContended, int isAcquired);
+void recordLockRelease(LockProfile* profile);
+LONGLONG getLockProfilerTicks(void);
+int compareLockProfiles(const void* first, const void* second);
+
+DWORD waitForProfiledObject(LockProfile* profile, HANDLE handle, DWORD timeout)
+{
+    // A free primitive is taken without a wait, which isn't timed.
+    DWORD result = waitForWatchedObject(profile->name, profile->isLock, handle, 0);
+
+    if (result != WAIT_TIMEOUT || timeout == 0)
+    {
+        recordLockWait(profile, 0, FALSE, result == WAIT_OBJECT_0 || result == WAIT_ABANDONED);
+        return result;
+    }
+
+    LONGLONG startTicks = getLockProfilerTicks();
+
+    result = waitForWatchedObject(profile->name, profile->isLock, handle, timeout);
+    recordLockWait(profile, getLockProfilerTicks() - startTicks, TRUE,
+        result == WAIT_OBJECT_0 || result == WAIT_ABANDONED);
+
+    return result;
+}
+
+BOOL releaseProfiledMutex(LockProfile* profile, HANDLE mutex)
+{
+    // Comment: the hold ends before the release, since the next holder may take it right away.
+    recordLockRelease(profile);
+
+    return releaseWatchedMutex(profile->name, mutex);
+}
+
+BOOL releaseProfiledSemaphore(LockProfile* profile, HANDLE semaphore, LONG releaseCount)
+{
+    recordLockRelease(profile);
+
+    return releaseWatchedSemaphore(profile->name, profile->isLock, semaphore, releaseCount);
+}
+
+void waitForProfiledWord(LockProfile* profile, WaitWord* waitWord)
+{
+    if (*waitWord != 0)
+    {
+        waitForWatchedWord(profile->name, waitWord);
+        recordLockWait(profile, 0, FALSE, TRUE);
+        return;
+    }
+
+    LONGLONG startTicks = getLockProfilerTicks();
+
+    waitForWatchedWord(profile->name, waitWord);
+    recordLockWait(profile, getLockProfilerTicks() - startTicks, TRUE, TRUE);
+}
+
+int signalProfiledWord(LockProfile* profile, WaitWord* waitWord)
+{
+    recordLockRelease(profile);
+
+    return signalWord(waitWord);
+}
+
+int rankLockProfiles(LockProfile* rankedProfiles[])
+{
+    int numberOfProfiles = numberOfLockProfiles < MAX_LOCK_PROFILES ? numberOfLockProfiles : MAX_LOCK_PROFILES;
+
+    for (int i = 0; i < numberOfProfiles; i++)
+    {
+        rankedProfiles[i] = lockProfiles[i];
+    }
+
+    qsort(rankedProfiles, numberOfProfiles, sizeof(LockProfile*), compareLockProfiles);
+
+    return numberOfProfiles;
+}
+
+void resetLockProfiles(void)
+{
+    int numberOfProfiles = numberOfLockProfiles < MAX_LOCK_PROFILES ? numberOfLockProfiles : MAX_LOCK_PROFILES;
+
+    // Comment: a profile stays registered, so it isn't added to the ranking twice.
+    for (int i = 0; i < numberOfProfiles; i++)
+    {
+        lockProfiles[i]->numberOfAcquisitions = 0;
+        lockProfiles[i]->numberOfContentions = 0;
+        lockProfiles[i]->numberOfTimeouts = 0;
+        lockProfiles[i]->waitTime = 0;
+        lockProfiles[i]->maxWaitTime = 0;
+        lockProfiles[i]->holdTime = 0;
+        lockProfiles[i]->numberOfHolds = 0;
+    }
+}
+
+void formatLockProfile(char string[], LockProfile* profile)
+{
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceFrequency(&frequency);
+
+    double ticksPerMilisecond = frequency.QuadPart / 1000.0;
+
+    snprintf(string, MAX_LOCK_PROFILE_STRING, "%s - %lld acquisitions, %lld contended, %lld timed out,"
+        " wait total/max %.3f/%.3f ms, hold avg %.4f ms", profile->name,
+        profile->numberOfAcquisitions, profile->numberOfContentions, profile->numberOfTimeouts,
+        profile->waitTime / ticksPerMilisecond, profile->maxWaitTime / ticksPerMilisecond,
+        profile->numberOfHolds ? profile->holdTime / ticksPerMilisecond / profile->numberOfHolds : 0.0);
+}
+
+void recordLockWait(LockProfile* profile, LONGLONG waitTime, int isContended, int isAcquired)
+{
+    if (InterlockedCompareExchange(&profile->isRegistered, TRUE, FALSE) == FALSE)
+    {
+        LONG index = InterlockedIncrement(&numberOfLockProfiles) - 1;
+
+        if (index < MAX_LOCK_PROFILES)
+        {
+            lockProfiles[index] = profile;
+        }
+    }
+
+    if (isContended)
+    {
+        InterlockedIncrement64(&profile->numberOfContentions);
+        InterlockedExchangeAdd64(&profile->waitTime, waitTime);
+
+        LONGLONG maxWaitTime = profile->maxWaitTime;
+
+        while (waitTime > maxWaitTime &&
+            InterlockedCompareExchange64(&profile->maxWaitTime, waitTime, maxWaitTime) != maxWaitTime)
+        {
+            maxWaitTime = profile->maxWaitTime;
+        }
+    }
+
+    if (!isAcquired)
+    {
+        InterlockedIncrement64(&profile->numberOfTimeouts);
+        return;
+    }
+
+    InterlockedIncrement64(&profile->numberOfAcquisitions);
+
+    if (profile->isLock)
+    {
+        profile->acquireTime = getLockProfilerTicks();
+        profile->holderThreadId = GetCurrentThreadId();
+    }
+}
+
+void recordLockRelease(LockProfile* profile)
+{
+    if (!profile->isLock || profile->holderThreadId != GetCurrentThreadId())
+    {
+        return;
+    }
+
+    profile->holderThreadId = 0;
+    InterlockedExchangeAdd64(&profile->holdTime, getLockProfilerTicks() - profile->acquireTime);
+    InterlockedIncrement64(&profile->numberOfHolds);
+}
+
+LONGLONG getLockProfilerTicks(void)
+{
+    LARGE_INTEGER ticks;
+
+    QueryPerformanceCounter(&ticks);
+
+    return ticks.QuadPart;
+}
+
+int compareLockProfiles(const void* first, const void* second)
+{
+    LONGLONG firstWaitTime = (*(LockProfile* const*)first)->waitTime;
+    LONGLONG secondWaitTime = (*(LockProfile* const*)second)->waitTime;
+
+    return (secondWaitTime > firstWaitTime) - (secondWaitTime < firstWaitTime);
+}
+
+#endif
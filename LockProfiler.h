@@ -0,0 +1,71 @@
+#ifndef LOCK_PROFILER_H
+#define LOCK_PROFILER_H
+
+#include <windows.h>
+
+#include "ParkingLot.h"
+#include "StallDetector.h"
+
+#define MAX_LOCK_PROFILES 32 // Most primitives a process may profile.
+#define MAX_LOCK_PROFILE_STRING 160 // Size of the largest line formatLockProfile writes.
+
+// Contention of a named primitive, such as a mutex, a semaphore or an array of wait words.
+// Times are in QueryPerformanceCounter ticks. A wait is contended when the primitive wasn't
+// free at once, and only contended waits add to the wait time. A lock's hold time is counted
+// when the thread which took it releases it. Signals, which other threads wait for, aren't held.
+typedef struct {
+    const char* name;
+    int isLock;
+    volatile LONGLONG numberOfAcquisitions;
+    volatile LONGLONG numberOfContentions;
+    volatile LONGLONG numberOfTimeouts;
+    volatile LONGLONG waitTime;
+    volatile LONGLONG maxWaitTime;
+    volatile LONGLONG holdTime;
+    volatile LONGLONG numberOfHolds;
+    volatile LONGLONG acquireTime; // When the last holder took the primitive.
+    volatile DWORD holderThreadId;
+    volatile LONG isRegistered; // Set once the profile has been added to the ranking.
+} LockProfile;
+
+// Initializers of a lock's and of a signal's profile.
+#define LOCK_PROFILE(name) { name, TRUE }
+#define SIGNAL_PROFILE(name) { name, FALSE }
+
+// Every wait and release of a profiled primitive goes through these, which are only the
+// stall detector's watched calls unless the ports are built with PORT_LOCK_PROFILER defined,
+// and the plain Win32 calls when built with neither it nor PORT_STALL_DETECTOR.
+#ifdef PORT_LOCK_PROFILER
+DWORD waitForProfiledObject(LockProfile* profile, HANDLE handle, DWORD timeout);
+BOOL releaseProfiledMutex(LockProfile* profile, HANDLE mutex);
+BOOL releaseProfiledSemaphore(LockProfile* profile, HANDLE semaphore, LONG releaseCount);
+void waitForProfiledWord(LockProfile* profile, WaitWord* waitWord);
+int signalProfiledWord(LockProfile* profile, WaitWord* waitWord);
+
+// Fills rankedProfiles with every profile used so far, the longest total wait first.
+// Returns the number of them.
+int rankLockProfiles(LockProfile* rankedProfiles[]);
+// Clears the counts and times of every profile used so far, as a new run starts.
+void resetLockProfiles(void);
+// Writes the profile's counts and times in miliseconds to string.
+void formatLockProfile(char string[], LockProfile* profile);
+#elif defined(PORT_STALL_DETECTOR)
+#define waitForProfiledObject(profile, handle, timeout) \
+    waitForWatchedObject((profile)->name, (profile)->isLock, handle, timeout)
+#define releaseProfiledMutex(profile, mutex) releaseWatchedMutex((profile)->name, mutex)
+#define releaseProfiledSemaphore(profile, semaphore, releaseCount) \
+    releaseWatchedSemaphore((profile)->name, (profile)->isLock, semaphore, releaseCount)
+#define waitForProfiledWord(profile, waitWord) waitForWatchedWord((profile)->name, waitWord)
+#define signalProfiledWord(profile, waitWord) signalWord(waitWord)
+#define resetLockProfiles()
+#else
+#define waitForProfiledObject(profile, handle, timeout) WaitForSingleObject(handle, timeout)
+#define releaseProfiledMutex(profile, mutex) ReleaseMutex(mutex)
+#define releaseProfiledSemaphore(profile, semaphore, releaseCount) \
+    ReleaseSemaphore(semaphore, releaseCount, NULL)
+#define waitForProfiledWord(profile, waitWord) waitForWord(waitWord)
+#define signalProfiledWord(profile, waitWord) signalWord(waitWord)
+#define resetLockProfiles()
+#endif
+
+#endif
@@ -0,0 +1,184 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "MessageChannel.h"
+
+MessageChannel* createPipeChannel(HANDLE pipeHandle)
+{
+    MessageChannel* channel = (MessageChannel*)calloc(1, sizeof(MessageChannel));
+
+    if (channel == NULL)
+    {
+        return NULL;
+    }
+
+    channel->pipeHandle = pipeHandle;
+    channel->numberOfReferences = 1;
+
+    return channel;
+}
+
+MessageChannel* createMemoryChannel(int capacity)
+{
+    MessageChannel* channel = (MessageChannel*)calloc(1, sizeof(MessageChannel));
+
+    if (channel == NULL)
+    {
+        return NULL;
+    }
+
+    channel->messages = (char(*)[MESSAGE_SIZE])malloc((size_t)capacity * MESSAGE_SIZE);
+
+    if (channel->messages == NULL)
+    {
+        free(channel);
+        return NULL;
+    }
+
+    channel->pipeHandle = INVALID_HANDLE_VALUE;
+    channel->capacity = capacity;
+    channel->numberOfReferences = 2;
+    InitializeSRWLock(&channel->lock);
+    InitializeConditionVariable(&channel->notEmptyCondition);
+    InitializeConditionVariable(&channel->notFullCondition);
+
+    return channel;
+}
+
+void closeMessageChannel(MessageChannel* channel)
+{
+    if (channel->pipeHandle != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(channel->pipeHandle);
+        free(channel);
+        return;
+    }
+
+    AcquireSRWLockExclusive(&channel->lock);
+    channel->isClosed = TRUE;
+    int numberOfReferences = --channel->numberOfReferences;
+    ReleaseSRWLockExclusive(&channel->lock);
+
+    // Wake whoever waits on the other end, so it finds the channel closed.
+    WakeAllConditionVariable(&channel->notEmptyCondition);
+    WakeAllConditionVariable(&channel->notFullCondition);
+
+    if (numberOfReferences == 0)
+    {
+        free(channel->messages);
+        free(channel);
+    }
+}
+
+void breakMessageChannel(MessageChannel* channel)
+{
+    if (channel->pipeHandle != INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    AcquireSRWLockExclusive(&channel->lock);
+    channel->isClosed = TRUE;
+    ReleaseSRWLockExclusive(&channel->lock);
+
+    WakeAllConditionVariable(&channel->notEmptyCondition);
+    WakeAllConditionVariable(&channel->notFullCondition);
+}
+
+int readMessage(MessageChannel* channel, char message[])
+{
+    if (channel->pipeHandle != INVALID_HANDLE_VALUE)
+    {
+        DWORD numberOfReadBytes;
+
+        return ReadFile(channel->pipeHandle, message, MESSAGE_SIZE, &numberOfReadBytes, NULL);
+    }
+
+    AcquireSRWLockExclusive(&channel->lock);
+
+    while (channel->numberOfMessages == 0 && !channel->isClosed)
+    {
+        SleepConditionVariableSRW(&channel->notEmptyCondition, &channel->lock, INFINITE, 0);
+    }
+
+    // As with a pipe, the messages written before the channel was closed may still be read.
+    int isRead = channel->numberOfMessages > 0;
+
+    if (isRead)
+    {
+        memcpy(message, channel->messages[channel->head], MESSAGE_SIZE);
+        channel->head = (channel->head + 1) % channel->capacity;
+        channel->numberOfMessages--;
+    }
+
+    ReleaseSRWLockExclusive(&channel->lock);
+
+    if (isRead)
+    {
+        WakeConditionVariable(&channel->notFullCondition);
+    }
+
+    return isRead;
+}
+
+int writeMessage(MessageChannel* channel, const char message[])
+{
+    LARGE_INTEGER startTime, endTime;
+    int isWritten;
+
+    QueryPerformanceCounter(&startTime);
+
+    if (channel->pipeHandle != INVALID_HANDLE_VALUE)
+    {
+        DWORD numberOfWrittenBytes;
+
+        isWritten = WriteFile(channel->pipeHandle, message, MESSAGE_SIZE, &numberOfWrittenBytes, NULL);
+    }
+    else
+    {
+        AcquireSRWLockExclusive(&channel->lock);
+
+        while (channel->numberOfMessages == channel->capacity && !channel->isClosed)
+        {
+            SleepConditionVariableSRW(&channel->notFullCondition, &channel->lock, INFINITE, 0);
+        }
+
+        isWritten = !channel->isClosed;
+
+        if (isWritten)
+        {
+            int tail = (channel->head + channel->numberOfMessages) % channel->capacity;
+
+            memcpy(channel->messages[tail], message, MESSAGE_SIZE);
+            channel->numberOfMessages++;
+        }
+
+        ReleaseSRWLockExclusive(&channel->lock);
+
+        if (isWritten)
+        {
+            WakeConditionVariable(&channel->notEmptyCondition);
+        }
+    }
+
+    QueryPerformanceCounter(&endTime);
+
+    InterlockedIncrement(&channel->numberOfWrittenMessages);
+    InterlockedExchangeAdd64(&channel->writeTicks, endTime.QuadPart - startTime.QuadPart);
+
+    return isWritten;
+}
+
+double getAverageMessageWriteTime(MessageChannel* channel)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+
+    if (channel->numberOfWrittenMessages == 0)
+    {
+        return 0.0;
+    }
+
+    return (double)channel->writeTicks * 1000000.0 / (double)frequency.QuadPart /
+        channel->numberOfWrittenMessages;
+}
@@ -0,0 +1,42 @@
+#ifndef MESSAGE_CHANNEL_H
+#define MESSAGE_CHANNEL_H
+
+#include <windows.h>
+
+#define MESSAGE_SIZE 60 // Every message between the ports has this size, as BUFFER_SIZE of both ports.
+#define MESSAGE_CHANNEL_CAPACITY 64 // Messages an in-memory channel holds before a writer waits.
+
+// One direction of the link between HaifaPort and EilatPort. It is either an end of an anonymous
+// pipe, when EilatPort runs as its own process, or a ring of messages in memory shared by both
+// ends, when EilatPort runs on threads of HaifaPort.
+typedef struct {
+    HANDLE pipeHandle; // INVALID_HANDLE_VALUE for an in-memory channel.
+    char (*messages)[MESSAGE_SIZE];
+    int capacity;
+    int head;
+    int numberOfMessages;
+    int isClosed;
+    int numberOfReferences; // An in-memory channel is freed once both of its ends are closed.
+    SRWLOCK lock;
+    CONDITION_VARIABLE notEmptyCondition;
+    CONDITION_VARIABLE notFullCondition;
+    volatile LONG numberOfWrittenMessages;
+    volatile LONGLONG writeTicks; // QueryPerformanceCounter ticks spent writing messages.
+} MessageChannel;
+
+// Returns NULL on failure.
+MessageChannel* createPipeChannel(HANDLE pipeHandle);
+MessageChannel* createMemoryChannel(int capacity);
+// Closes this end of the channel. Once an in-memory channel is closed, reading it fails when
+// it is empty and writing it fails, as with a broken pipe.
+void closeMessageChannel(MessageChannel* channel);
+// Fails an in-memory channel for both of its ends, as closing it would, though the caller's end
+// is still to be closed. Any thread may break it, as when one of its port's threads failed.
+void breakMessageChannel(MessageChannel* channel);
+// Both return FALSE on failure, as ReadFile and WriteFile do.
+int readMessage(MessageChannel* channel, char message[]);
+int writeMessage(MessageChannel* channel, const char message[]);
+// Returns the average microseconds a message took to write.
+double getAverageMessageWriteTime(MessageChannel* channel);
+
+#endif
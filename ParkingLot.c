@@ -0,0 +1,79 @@
+#include "ParkingLot.h"
+
+// A wait queue of the parking lot. Its lock and condition variable are zero when initialized,
+// so the table needs no set-up. Each bucket is on a cache line of its own.
+typedef struct __declspec(align(64)) {
+    SRWLOCK lock;
+    CONDITION_VARIABLE condition;
+    volatile LONG numberOfWaiters; // Lets a signal skip the lock when no thread is parked.
+} ParkingLotBucket;
+
+ParkingLotBucket parkingLotBuckets[PARKING_LOT_BUCKETS];
+
+ParkingLotBucket* getParkingLotBucket(WaitWord* waitWord);
+int tryTakeWord(WaitWord* waitWord);
+
+void waitForWord(WaitWord* waitWord)
+{
+    // A hand-off usually comes soon, a short spin saves parking and waking for it.
+    for (int i = 0; i < PARKING_LOT_SPIN; i++)
+    {
+        if (tryTakeWord(waitWord))
+        {
+            return;
+        }
+
+        YieldProcessor();
+    }
+
+    ParkingLotBucket* bucket = getParkingLotBucket(waitWord);
+
+    AcquireSRWLockExclusive(&bucket->lock);
+
+    // Comment: the waiter is counted before the word is checked again, and the signaler sets
+    // the word before it reads the count, both with a full barrier, so either the waiter sees
+    // the signal or the signaler sees the waiter and wakes it.
+    InterlockedIncrement(&bucket->numberOfWaiters);
+
+    while (!tryTakeWord(waitWord))
+    {
+        SleepConditionVariableSRW(&bucket->condition, &bucket->lock, INFINITE, 0);
+    }
+
+    InterlockedDecrement(&bucket->numberOfWaiters);
+    ReleaseSRWLockExclusive(&bucket->lock);
+}
+
+int signalWord(WaitWord* waitWord)
+{
+    if (InterlockedCompareExchange(waitWord, 1, 0) != 0)
+    {
+        return FALSE;
+    }
+
+    ParkingLotBucket* bucket = getParkingLotBucket(waitWord);
+
+    if (bucket->numberOfWaiters > 0)
+    {
+        // Taking the lock makes sure a counted waiter is either asleep or will see the word.
+        // Every waiter of the bucket is woken, since words of other threads may share it.
+        AcquireSRWLockExclusive(&bucket->lock);
+        ReleaseSRWLockExclusive(&bucket->lock);
+        WakeAllConditionVariable(&bucket->condition);
+    }
+
+    return TRUE;
+}
+
+ParkingLotBucket* getParkingLotBucket(WaitWord* waitWord)
+{
+    // Fibonacci hashing, so the neighbouring words of an array spread over the buckets.
+    ULONGLONG address = (ULONGLONG)(ULONG_PTR)waitWord >> 2;
+
+    return &parkingLotBuckets[((address * 0x9E3779B97F4A7C15ULL) >> 32) % PARKING_LOT_BUCKETS];
+}
+
+int tryTakeWord(WaitWord* waitWord)
+{
+    return *waitWord == 1 && InterlockedCompareExchange(waitWord, 0, 1) == 1;
+}
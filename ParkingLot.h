@@ -0,0 +1,21 @@
+#ifndef PARKING_LOT_H
+#define PARKING_LOT_H
+
+#include <windows.h>
+
+#define PARKING_LOT_BUCKETS 256 // Wait queues the waiting threads are hashed into, by their word's address.
+#define PARKING_LOT_SPIN 64 // Times a waiter checks its word before it parks.
+
+// A wait object of a single thread, in place of a semaphore with a max count of 1. It is 1
+// while signaled and 0 otherwise, so a zeroed array of words is a set of unsignaled wait
+// objects and takes no kernel objects or handles. Only a thread which has to wait parks, in
+// the bucket of its word's address, which it may share with the words of other threads.
+typedef volatile LONG WaitWord;
+
+// Waits till the word is signaled and takes its signal, as WaitForSingleObject(INFINITE).
+void waitForWord(WaitWord* waitWord);
+// Signals the word and wakes its waiter, as ReleaseSemaphore by 1.
+// Returns FALSE if the word was already signaled.
+int signalWord(WaitWord* waitWord);
+
+#endif
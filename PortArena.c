@@ -0,0 +1,140 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "PortArena.h"
+
+#define PORT_ARENA_COMMIT_ALIGN(size) (((size) + PORT_ARENA_COMMIT_SIZE - 1) & ~(SIZE_T)(PORT_ARENA_COMMIT_SIZE - 1))
+
+int commitPortArenaRegion(PortArenaRegion* region, SIZE_T used);
+
+PortArena* createPortArena(SIZE_T hotRegionSize, SIZE_T coldRegionSize)
+{
+    // The arena itself is at the start of its hot region.
+    SIZE_T regionSizes[PORT_ARENA_REGIONS] = { PORT_ARENA_COMMIT_ALIGN(PORT_ARENA_ALIGN(sizeof(PortArena)) + hotRegionSize),
+        PORT_ARENA_COMMIT_ALIGN(coldRegionSize) };
+
+    // Comment: both regions are a single reservation, so releasing it releases the whole arena.
+    char* base = (char*)VirtualAlloc(NULL, regionSizes[PORT_ARENA_HOT] + regionSizes[PORT_ARENA_COLD], MEM_RESERVE,
+        PAGE_READWRITE);
+
+    if (base == NULL)
+    {
+        fprintf(stderr, "createPortArena::Unexpected Error - Reserving %Iu bytes failed (%d)!\n",
+            regionSizes[PORT_ARENA_HOT] + regionSizes[PORT_ARENA_COLD], GetLastError());
+        return NULL;
+    }
+
+    PortArenaRegion hotRegion = { base, 0, 0, regionSizes[PORT_ARENA_HOT] };
+
+    if (!commitPortArenaRegion(&hotRegion, PORT_ARENA_ALIGN(sizeof(PortArena))))
+    {
+        VirtualFree(base, 0, MEM_RELEASE);
+        return NULL;
+    }
+
+    // Committed memory is zeroed, so only the regions need to be set.
+    PortArena* arena = (PortArena*)base;
+
+    arena->regions[PORT_ARENA_HOT] = hotRegion;
+    arena->regions[PORT_ARENA_HOT].used = PORT_ARENA_ALIGN(sizeof(PortArena));
+
+    for (int i = PORT_ARENA_HOT + 1; i < PORT_ARENA_REGIONS; i++)
+    {
+        arena->regions[i].base = arena->regions[i - 1].base + arena->regions[i - 1].reserved;
+        arena->regions[i].reserved = regionSizes[i];
+    }
+
+    return arena;
+}
+
+void* allocateFromPortArena(PortArena* arena, int region, SIZE_T size)
+{
+    PortArenaRegion* arenaRegion = &arena->regions[region];
+    SIZE_T used = arenaRegion->used + PORT_ARENA_ALIGN(size);
+
+    if (arena->isSealed)
+    {
+        fprintf(stderr, "allocateFromPortArena::Unexpected Error - The arena is sealed!\n");
+        return NULL;
+    }
+
+    if (used < arenaRegion->used || !commitPortArenaRegion(arenaRegion, used))
+    {
+        return NULL;
+    }
+
+    void* block = arenaRegion->base + arenaRegion->used;
+
+    arenaRegion->used = used;
+    arena->numberOfAllocations++;
+
+    return block;
+}
+
+int resetPortArena(PortArena* arena, SIZE_T hotRegionSize, SIZE_T coldRegionSize)
+{
+    SIZE_T headerSize = PORT_ARENA_ALIGN(sizeof(PortArena));
+
+    if (headerSize + hotRegionSize > arena->regions[PORT_ARENA_HOT].reserved ||
+        coldRegionSize > arena->regions[PORT_ARENA_COLD].reserved)
+    {
+        return FALSE;
+    }
+
+    // Blocks are handed out zeroed, so the ones of the last run are cleared.
+    memset(arena->regions[PORT_ARENA_HOT].base + headerSize, 0, arena->regions[PORT_ARENA_HOT].used - headerSize);
+    memset(arena->regions[PORT_ARENA_COLD].base, 0, arena->regions[PORT_ARENA_COLD].used);
+
+    arena->regions[PORT_ARENA_HOT].used = headerSize;
+    arena->regions[PORT_ARENA_COLD].used = 0;
+    arena->isSealed = FALSE;
+    arena->numberOfAllocations = 0;
+
+    return TRUE;
+}
+
+void sealPortArena(PortArena* arena)
+{
+    arena->isSealed = TRUE;
+}
+
+SIZE_T getPortArenaUsedSize(PortArena* arena, int region)
+{
+    // The arena's own header isn't counted as a block of the hot region.
+    return arena->regions[region].used - (region == PORT_ARENA_HOT ? PORT_ARENA_ALIGN(sizeof(PortArena)) : 0);
+}
+
+void releasePortArena(PortArena* arena)
+{
+    VirtualFree(arena->regions[PORT_ARENA_HOT].base, 0, MEM_RELEASE);
+}
+
+int commitPortArenaRegion(PortArenaRegion* region, SIZE_T used)
+{
+    if (used <= region->committed)
+    {
+        return TRUE;
+    }
+
+    SIZE_T committed = PORT_ARENA_COMMIT_ALIGN(used);
+
+    if (committed > region->reserved)
+    {
+        fprintf(stderr, "commitPortArenaRegion::Unexpected Error - "
+            "The arena's region of %Iu bytes is full!\n", region->reserved);
+        return FALSE;
+    }
+
+    if (VirtualAlloc(region->base + region->committed, committed - region->committed,
+        MEM_COMMIT, PAGE_READWRITE) == NULL)
+    {
+        fprintf(stderr, "commitPortArenaRegion::Unexpected Error - Committing failed (%d)!\n",
+            GetLastError());
+        return FALSE;
+    }
+
+    region->committed = committed;
+
+    return TRUE;
+}
@@ -0,0 +1,48 @@
+#ifndef PORT_ARENA_H
+#define PORT_ARENA_H
+
+#include <windows.h>
+
+#define PORT_ARENA_ALIGNMENT 64 // Every block starts on a cache line of its own.
+#define PORT_ARENA_COMMIT_SIZE 65536 // A region commits its memory as it grows, 64KB at a time.
+
+// Bytes a block of the given size takes in its region.
+#define PORT_ARENA_ALIGN(size) (((size) + PORT_ARENA_ALIGNMENT - 1) & ~(SIZE_T)(PORT_ARENA_ALIGNMENT - 1))
+
+// Regions of an arena, each lays out its blocks one after the other.
+#define PORT_ARENA_HOT 0 // State the threads touch on every hand-off, as semaphores and queues.
+#define PORT_ARENA_COLD 1 // State touched at start-up and teardown, as thread handles and IDs.
+#define PORT_ARENA_REGIONS 2
+
+typedef struct {
+    char* base;
+    SIZE_T used;
+    SIZE_T committed;
+    SIZE_T reserved;
+} PortArenaRegion;
+
+// Memory of a run, reserved at once and released at once, its blocks are never freed one
+// by one. The arena itself lives at the start of its hot region. An arena isn't thread safe,
+// only the thread which runs the port allocates from it.
+typedef struct {
+    PortArenaRegion regions[PORT_ARENA_REGIONS];
+    int isSealed;
+    int numberOfAllocations;
+} PortArena;
+
+// Reserves the address space of each region, the bytes its blocks take together, which the
+// caller sums up with PORT_ARENA_ALIGN. Returns NULL on failure.
+PortArena* createPortArena(SIZE_T hotRegionSize, SIZE_T coldRegionSize);
+// Returns a zeroed block from the region, NULL if the region is full or the arena is sealed.
+void* allocateFromPortArena(PortArena* arena, int region, SIZE_T size);
+// Frees every block of the arena at once for another run, whose regions take the given sizes,
+// while the memory its last run committed stays committed. Returns FALSE if they don't fit.
+int resetPortArena(PortArena* arena, SIZE_T hotRegionSize, SIZE_T coldRegionSize);
+// Marks the end of the run's start-up, allocations after it fail.
+void sealPortArena(PortArena* arena);
+// Returns how many bytes the region's blocks take.
+SIZE_T getPortArenaUsedSize(PortArena* arena, int region);
+// Releases the arena along with every block allocated from it.
+void releasePortArena(PortArena* arena);
+
+#endif
@@ -0,0 +1,459 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+
+#include "RunNamespace.h"
+
+#define BENCHMARK_SEED 1 // Every benchmark run draws the same times and cargo.
+#define DEFAULT_TOLERANCE 10.0 // Percent a metric may be worse than its baseline.
+#define MAX_COMMAND_LINE 1024 // Size of the largest command line to start HaifaPort with.
+#define MAX_RESULTS 256 // Size of the largest results row HaifaPort prints.
+#define MAX_BENCHMARK_LINE 1024 // Size of the largest line of a results file.
+#define MAX_BENCHMARK_POINTS 64 // Most points a results file may hold.
+
+// Short service times, so a point takes seconds and the ports' own costs aren't lost in sleeps.
+#define BENCHMARK_SERVICE_TIMES " -service depart=exponential:20 -service transit=exponential:50" \
+    " -service dock=exponential:20 -service unload=exponential:2"
+
+// Fleet sizes and crane counts the benchmark runs every combination of.
+const int benchmarkFleets[] = { 12, 24, 48 };
+const int benchmarkCranes[] = { 2, 3, 4 };
+
+// Columns of HaifaPort's -results row, in its order.
+const char* resultColumns[] = { "vessels", "makespanMs", "vesselsPerSecond",
+    "p50Ms", "p90Ms", "p99Ms", "maxMs", "userMsPerVessel", "kernelMsPerVessel",
+    "departP50Ms", "departP99Ms", "outboundP50Ms", "outboundP99Ms",
+    "eilatP50Ms", "eilatP99Ms", "dockP50Ms", "dockP99Ms" };
+#define NUMBER_OF_RESULT_COLUMNS (sizeof(resultColumns) / sizeof(resultColumns[0]))
+
+// Metrics a regression is looked for in, and whether a higher value is better.
+typedef struct {
+    const char* name;
+    int isHigherBetter;
+} BenchmarkMetric;
+
+const BenchmarkMetric comparedMetrics[] = { { "vesselsPerSecond", TRUE }, { "makespanMs", FALSE },
+    { "p99Ms", FALSE }, { "userMsPerVessel", FALSE }, { "kernelMsPerVessel", FALSE } };
+#define NUMBER_OF_COMPARED_METRICS (sizeof(comparedMetrics) / sizeof(comparedMetrics[0]))
+
+// A point of a results file.
+typedef struct {
+    int fleet;
+    int cranes;
+    double metrics[NUMBER_OF_COMPARED_METRICS];
+    int hasMetrics;
+} BenchmarkPoint;
+
+// Main thread functions:
+// Run every point one at a time and write their results as JSON, one point per line.
+int runBenchmark(const char* fileName, int argc, char* argv[]);
+// Run HaifaPort for a point and read its results row. Returns FALSE if it failed.
+int runBenchmarkPoint(const char* commandLine, const char* runId, char results[]);
+// Compare a results file against its baseline. Returns the number of regressions.
+int compareBenchmark(const char* baselineFileName, const char* fileName, double tolerance);
+// Read the points of a results file. Returns their number.
+int readBenchmarkPoints(const char* fileName, BenchmarkPoint points[]);
+// Returns TRUE if the line holds "name": value, which is then set.
+int readBenchmarkValue(const char* line, const char* name, double* value);
+// Write the string as a JSON string, with its quotes, backslashes and control characters escaped.
+void writeJsonString(FILE* file, const char* string);
+// Returns TRUE if the value is a JSON number. A metric HaifaPort couldn't measure isn't, and is written as null.
+int isJsonNumber(const char* value);
+
+int main(int argc, char* argv[])
+{
+    if (argc >= 3 && strcmp(argv[1], "run") == 0)
+    {
+        return runBenchmark(argv[2], argc - 3, argv + 3) ? 0 : EXIT_FAILURE;
+    }
+
+    if ((argc == 4 || argc == 5) && strcmp(argv[1], "compare") == 0)
+    {
+        double tolerance = argc == 5 ? atof(argv[4]) : DEFAULT_TOLERANCE;
+
+        return compareBenchmark(argv[2], argv[3], tolerance) == 0 ? 0 : EXIT_FAILURE;
+    }
+
+    fprintf(stderr, "PortBenchmark::Main::Error - Number of arguments is invalid! Please enter either"
+        " run <results file> [HaifaPort options] or compare <baseline file> <results file> [tolerance %%]!\n");
+    exit(EXIT_SUCCESS);
+}
+
+int runBenchmark(const char* fileName, int argc, char* argv[])
+{
+    char extraOptions[MAX_COMMAND_LINE / 2] = "";
+    size_t length = 0;
+    int isSuccessful = TRUE;
+    int pointIndex = 0;
+
+    // Options after the results file are given to every point, as -inprocess.
+    for (int i = 0; i < argc; i++)
+    {
+        if (length + strlen(argv[i]) + 2 > sizeof(extraOptions))
+        {
+            fprintf(stderr, "PortBenchmark::runBenchmark::Error - Options are too long!\n");
+            exit(EXIT_SUCCESS);
+        }
+
+        length += sprintf(extraOptions + length, " %s", argv[i]);
+    }
+
+    FILE* resultsFile = fopen(fileName, "w");
+
+    if (resultsFile == NULL)
+    {
+        fprintf(stderr, "PortBenchmark::runBenchmark::Error - Opening results file '%s' failed!\n",
+            fileName);
+        exit(EXIT_FAILURE);
+    }
+
+    // Comment: the options are written as given, so a path such as C:\times.txt is escaped.
+    fprintf(resultsFile, "{\n  \"seed\": %d,\n  \"options\": ", BENCHMARK_SEED);
+    writeJsonString(resultsFile, extraOptions);
+    fprintf(resultsFile, ",\n  \"points\": [\n");
+
+    const int numberOfFleets = sizeof(benchmarkFleets) / sizeof(int);
+    const int numberOfCraneCounts = sizeof(benchmarkCranes) / sizeof(int);
+
+    for (int i = 0; i < numberOfFleets; i++)
+    {
+        for (int j = 0; j < numberOfCraneCounts; j++)
+        {
+            char commandLine[MAX_COMMAND_LINE];
+            char runId[MAX_RUN_ID + 1];
+            char results[MAX_RESULTS];
+
+            // Comment: points run one at a time, so they don't compete for the cores.
+            sprintf(runId, "%lu-%d", GetCurrentProcessId(), ++pointIndex);
+            sprintf(commandLine, "HaifaPort.exe %d -cranes %d -seed %d -results -run %s%s%s",
+                benchmarkFleets[i], benchmarkCranes[j], BENCHMARK_SEED, runId,
+                BENCHMARK_SERVICE_TIMES, extraOptions);
+
+            fprintf(resultsFile, "    {\"fleet\": %d, \"cranes\": %d", benchmarkFleets[i], benchmarkCranes[j]);
+
+            if (runBenchmarkPoint(commandLine, runId, results))
+            {
+                int column = 0;
+
+                for (char* value = strtok(results, ",\r\n"); value != NULL && column < NUMBER_OF_RESULT_COLUMNS;
+                    value = strtok(NULL, ",\r\n"))
+                {
+                    fprintf(resultsFile, ", \"%s\": %s", resultColumns[column++], isJsonNumber(value) ? value : "null");
+                }
+
+                fprintf(stderr, "PortBenchmark: fleet %d, cranes %d - done\n",
+                    benchmarkFleets[i], benchmarkCranes[j]);
+            }
+            else
+            {
+                isSuccessful = FALSE;
+                fprintf(stderr, "PortBenchmark: fleet %d, cranes %d - failed, see PortBenchmark.%s.log\n",
+                    benchmarkFleets[i], benchmarkCranes[j], runId);
+            }
+
+            fprintf(resultsFile, "}%s\n", pointIndex < numberOfFleets * numberOfCraneCounts ? "," : "");
+        }
+    }
+
+    fprintf(resultsFile, "  ]\n}\n");
+    fclose(resultsFile);
+
+    return isSuccessful;
+}
+
+int runBenchmarkPoint(const char* commandLine, const char* runId, char results[])
+{
+    TCHAR ProcessName[MAX_COMMAND_LINE];
+    WCHAR logFileName[MAX_RUN_OBJECT_NAME];
+    STARTUPINFO startupInfo;
+    PROCESS_INFORMATION processInformation;
+    HANDLE readResultsHandle, writeResultsHandle;
+
+    // Set-up security attributes, so that the handles may be inherited.
+    SECURITY_ATTRIBUTES securityAttributes = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+
+    swprintf(ProcessName, MAX_COMMAND_LINE, L"%hs", commandLine);
+
+    // HaifaPort's standard output only holds its results row.
+    if (!CreatePipe(&readResultsHandle, &writeResultsHandle, &securityAttributes, 0) ||
+        !SetHandleInformation(readResultsHandle, HANDLE_FLAG_INHERIT, 0))
+    {
+        fprintf(stderr, "PortBenchmark::runBenchmarkPoint::Unexpected Error - "
+            "Results pipe creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    getRunObjectName(logFileName, L"PortBenchmark", runId);
+    wcscat(logFileName, L".log");
+
+    HANDLE logHandle = CreateFile(logFileName, GENERIC_WRITE, FILE_SHARE_READ, &securityAttributes,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (logHandle == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "PortBenchmark::runBenchmarkPoint::Unexpected Error - "
+            "Creating the log of run %s failed (%d)!\n", runId, GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    SecureZeroMemory(&processInformation, sizeof(processInformation));
+    GetStartupInfo(&startupInfo);
+
+    startupInfo.hStdError = logHandle;
+    startupInfo.hStdOutput = writeResultsHandle;
+    startupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+
+    if (!CreateProcess(NULL,    // No module name (use command line).
+        ProcessName,            // Command line.
+        NULL,                   // Process handle not inheritable.
+        NULL,                   // Thread handle not inheritable.
+        TRUE,                   // Set handle inheritance to TRUE.
+        0,                      // No creation flags.
+        NULL,                   // Use parent's environment block.
+        NULL,                   // Use parent's starting directory.
+        &startupInfo,           // Pointer to STARTUPINFO structure.
+        &processInformation)    // Pointer to PROCESS_INFORMATION structure.
+        )
+    {
+        fprintf(stderr, "PortBenchmark::runBenchmarkPoint::Unexpected Error -"
+            " CreateProcess for HaifaPort failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    // Comment: the pipe ends once HaifaPort and EilatPort, which inherits HaifaPort's handles,
+    // close their ends, so the results are read till then.
+    CloseHandle(logHandle);
+    CloseHandle(writeResultsHandle);
+    CloseHandle(processInformation.hThread);
+
+    DWORD numberOfReadBytes = 0;
+    DWORD length = 0;
+
+    while (length < MAX_RESULTS - 1 && ReadFile(readResultsHandle, results + length,
+        MAX_RESULTS - 1 - length, &numberOfReadBytes, NULL) && numberOfReadBytes > 0)
+    {
+        length += numberOfReadBytes;
+    }
+
+    results[length] = '\0';
+
+    DWORD exitCode = EXIT_FAILURE;
+
+    WaitForSingleObject(processInformation.hProcess, INFINITE);
+    GetExitCodeProcess(processInformation.hProcess, &exitCode);
+    CloseHandle(processInformation.hProcess);
+    CloseHandle(readResultsHandle);
+
+    return exitCode == 0 && length > 0;
+}
+
+int compareBenchmark(const char* baselineFileName, const char* fileName, double tolerance)
+{
+    BenchmarkPoint baselinePoints[MAX_BENCHMARK_POINTS];
+    BenchmarkPoint points[MAX_BENCHMARK_POINTS];
+    int numberOfBaselinePoints = readBenchmarkPoints(baselineFileName, baselinePoints);
+    int numberOfPoints = readBenchmarkPoints(fileName, points);
+    int numberOfRegressions = 0;
+
+    printf("%-6s %-6s %-18s %12s %12s %9s\n", "fleet", "cranes", "metric", "baseline", "current", "change");
+
+    for (int i = 0; i < numberOfPoints; i++)
+    {
+        BenchmarkPoint* baselinePoint = NULL;
+
+        for (int j = 0; j < numberOfBaselinePoints; j++)
+        {
+            if (baselinePoints[j].fleet == points[i].fleet && baselinePoints[j].cranes == points[i].cranes)
+            {
+                baselinePoint = &baselinePoints[j];
+            }
+        }
+
+        // A point which failed now but not in the baseline is a regression as well.
+        if (baselinePoint == NULL || !baselinePoint->hasMetrics || !points[i].hasMetrics)
+        {
+            int isRegression = baselinePoint != NULL && baselinePoint->hasMetrics;
+
+            printf("%-6d %-6d %-18s %s\n", points[i].fleet, points[i].cranes, "-",
+                baselinePoint == NULL ? "no baseline" : isRegression ? "failed  REGRESSION" : "no results");
+            numberOfRegressions += isRegression;
+            continue;
+        }
+
+        for (int j = 0; j < NUMBER_OF_COMPARED_METRICS; j++)
+        {
+            double baselineValue = baselinePoint->metrics[j];
+            double value = points[i].metrics[j];
+            double change = baselineValue != 0 ? (value - baselineValue) * 100.0 / baselineValue : 0;
+            int isRegression = comparedMetrics[j].isHigherBetter ? change < -tolerance : change > tolerance;
+
+            printf("%-6d %-6d %-18s %12.3f %12.3f %+8.1f%%%s\n", points[i].fleet, points[i].cranes,
+                comparedMetrics[j].name, baselineValue, value, change, isRegression ? "  REGRESSION" : "");
+            numberOfRegressions += isRegression;
+        }
+    }
+
+    // A baseline point which is missing from the results is a regression too, as a failed one is.
+    for (int i = 0; i < numberOfBaselinePoints; i++)
+    {
+        int isMissing = TRUE;
+
+        for (int j = 0; j < numberOfPoints && isMissing; j++)
+        {
+            isMissing = points[j].fleet != baselinePoints[i].fleet || points[j].cranes != baselinePoints[i].cranes;
+        }
+
+        if (isMissing)
+        {
+            int isRegression = baselinePoints[i].hasMetrics;
+
+            printf("%-6d %-6d %-18s %s\n", baselinePoints[i].fleet, baselinePoints[i].cranes, "-",
+                isRegression ? "missing  REGRESSION" : "missing");
+            numberOfRegressions += isRegression;
+        }
+    }
+
+    printf("%d regressions beyond %.1f%%\n", numberOfRegressions, tolerance);
+
+    return numberOfRegressions;
+}
+
+int readBenchmarkPoints(const char* fileName, BenchmarkPoint points[])
+{
+    FILE* resultsFile = fopen(fileName, "r");
+    char line[MAX_BENCHMARK_LINE];
+    int numberOfPoints = 0;
+
+    if (resultsFile == NULL)
+    {
+        fprintf(stderr, "PortBenchmark::readBenchmarkPoints::Error - Opening '%s' failed!\n", fileName);
+        exit(EXIT_FAILURE);
+    }
+
+    // Every point is on a line of its own, as runBenchmark writes it.
+    while (numberOfPoints < MAX_BENCHMARK_POINTS && fgets(line, sizeof(line), resultsFile) != NULL)
+    {
+        BenchmarkPoint* point = &points[numberOfPoints];
+        double fleet, cranes;
+
+        if (!readBenchmarkValue(line, "fleet", &fleet) || !readBenchmarkValue(line, "cranes", &cranes))
+        {
+            continue;
+        }
+
+        point->fleet = (int)fleet;
+        point->cranes = (int)cranes;
+        point->hasMetrics = TRUE;
+
+        for (int i = 0; i < NUMBER_OF_COMPARED_METRICS; i++)
+        {
+            point->hasMetrics &= readBenchmarkValue(line, comparedMetrics[i].name, &point->metrics[i]);
+        }
+
+        numberOfPoints++;
+    }
+
+    fclose(resultsFile);
+
+    return numberOfPoints;
+}
+
+int readBenchmarkValue(const char* line, const char* name, double* value)
+{
+    char key[MAX_BENCHMARK_LINE];
+
+    sprintf(key, "\"%s\": ", name);
+
+    const char* position = strstr(line, key);
+
+    return position != NULL && sscanf(position + strlen(key), "%lf", value) == 1;
+}
+
+void writeJsonString(FILE* file, const char* string)
+{
+    fputc('"', file);
+
+    for (const unsigned char* character = (const unsigned char*)string; *character != '\0'; character++)
+    {
+        if (*character == '"' || *character == '\\')
+        {
+            fprintf(file, "\\%c", *character);
+        }
+        else if (*character < 0x20)
+        {
+            fprintf(file, "\\u%04x", *character);
+        }
+        else
+        {
+            fputc(*character, file);
+        }
+    }
+
+    fputc('"', file);
+}
+
+int isJsonNumber(const char* value)
+{
+    // A number is -?(0|[1-9][0-9]*)(.[0-9]+)?([eE][+-]?[0-9]+)?
+    if (*value == '-')
+    {
+        value++;
+    }
+
+    if (*value == '0')
+    {
+        value++;
+    }
+    else if (*value >= '1' && *value <= '9')
+    {
+        while (*value >= '0' && *value <= '9')
+        {
+            value++;
+        }
+    }
+    else
+    {
+        return FALSE;
+    }
+
+    if (*value == '.')
+    {
+        value++;
+
+        if (*value < '0' || *value > '9')
+        {
+            return FALSE;
+        }
+
+        while (*value >= '0' && *value <= '9')
+        {
+            value++;
+        }
+    }
+
+    if (*value == 'e' || *value == 'E')
+    {
+        value++;
+
+        if (*value == '+' || *value == '-')
+        {
+            value++;
+        }
+
+        if (*value < '0' || *value > '9')
+        {
+            return FALSE;
+        }
+
+        while (*value >= '0' && *value <= '9')
+        {
+            value++;
+        }
+    }
+
+    return *value == '\0';
+}
@@ -0,0 +1,228 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+
+#include "RunNamespace.h"
+
+#define MIN_NUMBER_OF_RUNS 1
+#define MAX_NUMBER_OF_RUNS 10000
+#define MAX_COMMAND_LINE 1024 // Size of the largest command line to start HaifaPort with.
+#define RUN_ID_TOKEN "{run}" // Replaced with the run id in HaifaPort's arguments, as in -journal {run}.jrn
+
+// A simulation the launcher started and hasn't seen exit yet.
+typedef struct {
+    HANDLE processHandle;
+    char runId[MAX_RUN_ID + 1];
+    ULONGLONG startTime;
+} LauncherRun;
+
+// Main thread functions:
+// Returns how many runs may be in parallel, by default one per core.
+int getNumberOfParallelRuns(const char* argument);
+// Join HaifaPort's arguments into its command line, with the run's id in place of RUN_ID_TOKEN.
+void buildHaifaPortCommandLine(int argc, char* argv[], const char* runId, char commandLine[]);
+// Start HaifaPort for the run, its output and EilatPort's go to "<run id>.log".
+void startHaifaPortProcess(LauncherRun* run, int argc, char* argv[]);
+// Wait for any of the running simulations to exit and print how it ended. Returns FALSE if it failed.
+int waitForAnyRun(LauncherRun runs[], int* numberOfRunningRuns);
+
+int main(int argc, char* argv[])
+{
+    // Check that the user's input is valid and save it to a variable.
+    if (argc < 4)
+    {
+        fprintf(stderr, "PortLauncher::Main::Error - Number of arguments is invalid!"
+            " Please enter the number of runs, the parallel runs (0 for one per core)"
+            " and HaifaPort's arguments!\n");
+        exit(EXIT_SUCCESS);
+    }
+
+    const int numberOfRuns = atoi(argv[1]);
+    const int numberOfParallelRuns = getNumberOfParallelRuns(argv[2]);
+
+    if (numberOfRuns < MIN_NUMBER_OF_RUNS || numberOfRuns > MAX_NUMBER_OF_RUNS)
+    {
+        fprintf(stderr, "PortLauncher::Main::Error - Number of runs must be between %d-%d!\n",
+            MIN_NUMBER_OF_RUNS, MAX_NUMBER_OF_RUNS);
+        exit(EXIT_SUCCESS);
+    }
+
+    LauncherRun runs[MAXIMUM_WAIT_OBJECTS];
+    int numberOfRunningRuns = 0;
+    int numberOfFailedRuns = 0;
+    ULONGLONG startTime = GetTickCount64();
+
+    for (int i = 1; i <= numberOfRuns; i++)
+    {
+        // Once all the slots are taken, a run starts whenever another one exits.
+        if (numberOfRunningRuns == numberOfParallelRuns)
+        {
+            numberOfFailedRuns += !waitForAnyRun(runs, &numberOfRunningRuns);
+        }
+
+        // Run ids are unique on the host while this launcher runs.
+        LauncherRun* run = &runs[numberOfRunningRuns++];
+
+        sprintf(run->runId, "%lu-%d", GetCurrentProcessId(), i);
+        startHaifaPortProcess(run, argc - 3, argv + 3);
+    }
+
+    while (numberOfRunningRuns > 0)
+    {
+        numberOfFailedRuns += !waitForAnyRun(runs, &numberOfRunningRuns);
+    }
+
+    fprintf(stderr, "PortLauncher: %d runs, %d failed, %d in parallel, %.1f seconds\n",
+        numberOfRuns, numberOfFailedRuns, numberOfParallelRuns, (GetTickCount64() - startTime) / 1000.0);
+
+    return numberOfFailedRuns == 0 ? 0 : EXIT_FAILURE;
+}
+
+int getNumberOfParallelRuns(const char* argument)
+{
+    int numberOfParallelRuns = atoi(argument);
+
+    if (numberOfParallelRuns <= 0)
+    {
+        SYSTEM_INFO systemInfo;
+
+        GetSystemInfo(&systemInfo);
+        numberOfParallelRuns = (int)systemInfo.dwNumberOfProcessors;
+    }
+
+    // Comment: the launcher waits for its runs with WaitForMultipleObjects, which limits them.
+    if (numberOfParallelRuns > MAXIMUM_WAIT_OBJECTS)
+    {
+        numberOfParallelRuns = MAXIMUM_WAIT_OBJECTS;
+    }
+
+    return numberOfParallelRuns;
+}
+
+void buildHaifaPortCommandLine(int argc, char* argv[], const char* runId, char commandLine[])
+{
+    size_t length = sprintf(commandLine, "HaifaPort.exe");
+
+    for (int i = 0; i < argc; i++)
+    {
+        const char* token = strstr(argv[i], RUN_ID_TOKEN);
+        size_t argumentLength = strlen(argv[i]) + (token != NULL ? strlen(runId) : 0);
+
+        if (length + argumentLength + 2 > MAX_COMMAND_LINE - sizeof(" -run ") - MAX_RUN_ID)
+        {
+            fprintf(stderr, "PortLauncher::buildHaifaPortCommandLine::Error - "
+                "HaifaPort's arguments are too long!\n");
+            exit(EXIT_SUCCESS);
+        }
+
+        if (token == NULL)
+        {
+            length += sprintf(commandLine + length, " %s", argv[i]);
+        }
+        else
+        {
+            length += sprintf(commandLine + length, " %.*s%s%s", (int)(token - argv[i]), argv[i],
+                runId, token + strlen(RUN_ID_TOKEN));
+        }
+    }
+
+    sprintf(commandLine + length, " -run %s", runId);
+}
+
+void startHaifaPortProcess(LauncherRun* run, int argc, char* argv[])
+{
+    char commandLine[MAX_COMMAND_LINE];
+    TCHAR ProcessName[MAX_COMMAND_LINE];
+    WCHAR logFileName[MAX_RUN_OBJECT_NAME];
+    STARTUPINFO startupInfo;
+    PROCESS_INFORMATION processInformation;
+
+    // Set-up security attributes, so that the log's handle may be inherited.
+    SECURITY_ATTRIBUTES securityAttributes = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+
+    buildHaifaPortCommandLine(argc, argv, run->runId, commandLine);
+    swprintf(ProcessName, MAX_COMMAND_LINE, L"%hs", commandLine);
+    getRunObjectName(logFileName, L"PortLauncher", run->runId);
+    wcscat(logFileName, L".log");
+
+    HANDLE logHandle = CreateFile(logFileName, GENERIC_WRITE, FILE_SHARE_READ, &securityAttributes,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (logHandle == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "PortLauncher::startHaifaPortProcess::Unexpected Error - "
+            "Creating the log of run %s failed (%d)!\n", run->runId, GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    SecureZeroMemory(&processInformation, sizeof(processInformation));
+    GetStartupInfo(&startupInfo);
+
+    // Both ports print to the standard error, which goes to the run's log.
+    startupInfo.hStdError = logHandle;
+    startupInfo.hStdOutput = logHandle;
+    startupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+
+    if (!CreateProcess(NULL,    // No module name (use command line).
+        ProcessName,            // Command line.
+        NULL,                   // Process handle not inheritable.
+        NULL,                   // Thread handle not inheritable.
+        TRUE,                   // Set handle inheritance to TRUE.
+        0,                      // No creation flags.
+        NULL,                   // Use parent's environment block.
+        NULL,                   // Use parent's starting directory.
+        &startupInfo,           // Pointer to STARTUPINFO structure.
+        &processInformation)    // Pointer to PROCESS_INFORMATION structure.
+        )
+    {
+        fprintf(stderr, "PortLauncher::startHaifaPortProcess::Unexpected Error -"
+            " CreateProcess for HaifaPort failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    // Comment: the log's handle is closed right away, so runs started later don't inherit it.
+    CloseHandle(logHandle);
+    CloseHandle(processInformation.hThread);
+
+    run->processHandle = processInformation.hProcess;
+    run->startTime = GetTickCount64();
+
+    fprintf(stderr, "PortLauncher: Run %s started: %s\n", run->runId, commandLine);
+}
+
+int waitForAnyRun(LauncherRun runs[], int* numberOfRunningRuns)
+{
+    HANDLE processHandles[MAXIMUM_WAIT_OBJECTS];
+
+    for (int i = 0; i < *numberOfRunningRuns; i++)
+    {
+        processHandles[i] = runs[i].processHandle;
+    }
+
+    DWORD waitResult = WaitForMultipleObjects(*numberOfRunningRuns, processHandles, FALSE, INFINITE);
+
+    if (waitResult >= WAIT_OBJECT_0 + *numberOfRunningRuns)
+    {
+        fprintf(stderr, "PortLauncher::waitForAnyRun::Unexpected Error - "
+            "Waiting for the runs failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    LauncherRun* run = &runs[waitResult - WAIT_OBJECT_0];
+    DWORD exitCode = EXIT_FAILURE;
+
+    GetExitCodeProcess(run->processHandle, &exitCode);
+    CloseHandle(run->processHandle);
+
+    fprintf(stderr, "PortLauncher: Run %s exited with %lu after %.1f seconds\n",
+        run->runId, exitCode, (GetTickCount64() - run->startTime) / 1000.0);
+
+    // The last running run takes the exited run's slot.
+    *run = runs[--*numberOfRunningRuns];
+
+    return exitCode == 0;
+}
@@ -0,0 +1,549 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <io.h>
+#include <fcntl.h>
+#include <windows.h>
+
+#include "MessageChannel.h"
+#include "ServiceTime.h"
+#include "VesselQueue.h"
+#include "ParkingLot.h"
+#include "SafeCalls.h"
+
+#define DEFAULT_ITERATIONS 100000 // Operations every thread runs per primitive.
+#define MAX_THREADS MAXIMUM_WAIT_OBJECTS // The threads are waited for with WaitForMultipleObjects.
+#define MAX_STRING 200 // Size of the largest string printed on the safePrintWithTimeStamp path.
+#define ECHO_OPTION "-echo" // Starts the benchmark as the other end of the pipe round-trip.
+
+// A thread of a microbenchmark, all of them start together once startEvent is set.
+typedef struct {
+    int index;
+    int iterations;
+    HANDLE startEvent;
+} MicrobenchmarkThread;
+
+// A primitive the ports depend on, with the function its threads run and
+// the setup and clean up of its state for the given number of threads.
+typedef struct {
+    const char* name;
+    LPTHREAD_START_ROUTINE routine;
+    void (*setUp)(int numberOfThreads);
+    void (*cleanUp)(int numberOfThreads);
+} Microbenchmark;
+
+// Main thread functions:
+// Runs the primitive with the given number of threads. Returns the miliseconds they took.
+double runMicrobenchmark(Microbenchmark* microbenchmark, int numberOfThreads, int iterations);
+// Echoes every message on the standard input to the standard output, till the input ends.
+int runEcho(void);
+
+// Set up and clean up of every primitive's state.
+void setUpQueue(int numberOfThreads);
+void cleanUpQueue(int numberOfThreads);
+void setUpPingPong(int numberOfThreads);
+void cleanUpPingPong(int numberOfThreads);
+void setUpWaitWordPingPong(int numberOfThreads);
+void setUpPipes(int numberOfThreads);
+void cleanUpPipes(int numberOfThreads);
+void setUpPrint(int numberOfThreads);
+void cleanUpPrint(int numberOfThreads);
+void setUpRandom(int numberOfThreads);
+void cleanUpRandom(int numberOfThreads);
+void setUpNothing(int numberOfThreads);
+
+// The thread functions, one per primitive.
+// A VesselQueue enqueue and dequeue under a mutex, as the barrier's classQueues are used.
+DWORD WINAPI QueueThread(LPVOID Param);
+// A semaphore hand-off to another thread and back, as vesselsSemaphores and cranesSemaphores.
+DWORD WINAPI PingPongThread(LPVOID Param);
+// The same hand-off through wait words, as the ports' vessels and cranes wait now.
+DWORD WINAPI WaitWordPingPongThread(LPVOID Param);
+// A 60-byte message to an echo process and back, as the ports' pipes.
+DWORD WINAPI PipeThread(LPVOID Param);
+// safePrintWithTimeStamp itself, with the standard error on the null device.
+DWORD WINAPI PrintThread(LPVOID Param);
+// safeRand itself.
+DWORD WINAPI RandomThread(LPVOID Param);
+// A service time draw, which takes no lock.
+DWORD WINAPI ServiceTimeThread(LPVOID Param);
+
+// State of the primitives.
+VesselQueue* vesselQueue;
+HANDLE queueMutex;
+HANDLE pingPongSemaphores[MAX_THREADS]; // A thread waits on its own and signals its partner's.
+WaitWord pingPongWaitWords[MAX_THREADS];
+HANDLE echoProcesses[MAX_THREADS];
+MessageChannel* toEchoChannels[MAX_THREADS];
+MessageChannel* fromEchoChannels[MAX_THREADS];
+int standardError; // The standard error while it is on the null device, so printing costs formatting and writing.
+
+Microbenchmark microbenchmarks[] = {
+    { "VesselQueue", QueueThread, setUpQueue, cleanUpQueue },
+    { "semaphore ping-pong", PingPongThread, setUpPingPong, cleanUpPingPong },
+    { "wait word ping-pong", WaitWordPingPongThread, setUpWaitWordPingPong, setUpNothing },
+    { "pipe round-trip", PipeThread, setUpPipes, cleanUpPipes },
+    { "safePrintWithTimeStamp", PrintThread, setUpPrint, cleanUpPrint },
+    { "safeRand", RandomThread, setUpRandom, cleanUpRandom },
+    { "getServiceTime", ServiceTimeThread, setUpNothing, setUpNothing },
+};
+
+int main(int argc, char* argv[])
+{
+    if (argc == 2 && strcmp(argv[1], ECHO_OPTION) == 0)
+    {
+        return runEcho();
+    }
+
+    SYSTEM_INFO systemInfo;
+    GetSystemInfo(&systemInfo);
+
+    int maxNumberOfThreads = argc > 1 ? atoi(argv[1]) : (int)systemInfo.dwNumberOfProcessors;
+    int iterations = argc > 2 ? atoi(argv[2]) : DEFAULT_ITERATIONS;
+
+    if (maxNumberOfThreads < 1 || maxNumberOfThreads > MAX_THREADS || iterations < 1)
+    {
+        fprintf(stderr, "PortMicrobenchmark::Main::Error - Please enter the max threads (1-%d)"
+            " and the iterations per thread!\n", MAX_THREADS);
+        exit(EXIT_SUCCESS);
+    }
+
+    initializeServiceTimes(5, 3000);
+
+    printf("%-24s %8s %12s %12s\n", "primitive", "threads", "ns/op", "Mops/s");
+
+    for (int i = 0; i < sizeof(microbenchmarks) / sizeof(Microbenchmark); i++)
+    {
+        // Threads double till the max, which is always run.
+        for (int numberOfThreads = 1; ; numberOfThreads *= 2)
+        {
+            if (numberOfThreads > maxNumberOfThreads)
+            {
+                numberOfThreads = maxNumberOfThreads;
+            }
+
+            // Comment: ping-pong threads come in pairs, so an odd count runs one thread more.
+            int numberOfRunThreads = microbenchmarks[i].routine == PingPongThread ||
+                microbenchmarks[i].routine == WaitWordPingPongThread ?
+                (numberOfThreads + 1) / 2 * 2 : numberOfThreads;
+
+            if (numberOfRunThreads > MAX_THREADS)
+            {
+                break;
+            }
+
+            double elapsedTime = runMicrobenchmark(&microbenchmarks[i], numberOfRunThreads, iterations);
+
+            // A thread's operation takes ns/op, all of them together make Mops/s.
+            printf("%-24s %8d %12.1f %12.3f\n", microbenchmarks[i].name, numberOfRunThreads,
+                elapsedTime * 1000000.0 / iterations,
+                (double)iterations * numberOfRunThreads / elapsedTime / 1000.0);
+
+            if (numberOfThreads == maxNumberOfThreads)
+            {
+                break;
+            }
+        }
+    }
+
+    return 0;
+}
+
+double runMicrobenchmark(Microbenchmark* microbenchmark, int numberOfThreads, int iterations)
+{
+    MicrobenchmarkThread threads[MAX_THREADS];
+    HANDLE threadHandles[MAX_THREADS];
+    HANDLE startEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+    LARGE_INTEGER frequency, startTicks, endTicks;
+    DWORD threadId;
+
+    if (startEvent == NULL)
+    {
+        fprintf(stderr, "PortMicrobenchmark::runMicrobenchmark::Unexpected Error - "
+            "Event creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    microbenchmark->setUp(numberOfThreads);
+
+    for (int i = 0; i < numberOfThreads; i++)
+    {
+        threads[i].index = i;
+        threads[i].iterations = iterations;
+        threads[i].startEvent = startEvent;
+        threadHandles[i] = CreateThread(NULL, 0, microbenchmark->routine, &threads[i], 0, &threadId);
+
+        if (threadHandles[i] == NULL)
+        {
+            fprintf(stderr, "PortMicrobenchmark::runMicrobenchmark::Unexpected Error - "
+                "Thread creation failed!\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    // Comment: the threads are all created before the clock starts, so only the primitive is timed.
+    Sleep(10);
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&startTicks);
+    SetEvent(startEvent);
+    WaitForMultipleObjects(numberOfThreads, threadHandles, TRUE, INFINITE);
+    QueryPerformanceCounter(&endTicks);
+
+    for (int i = 0; i < numberOfThreads; i++)
+    {
+        CloseHandle(threadHandles[i]);
+    }
+
+    CloseHandle(startEvent);
+    microbenchmark->cleanUp(numberOfThreads);
+
+    return (endTicks.QuadPart - startTicks.QuadPart) * 1000.0 / frequency.QuadPart;
+}
+
+int runEcho(void)
+{
+    MessageChannel* fromParentChannel = createPipeChannel(GetStdHandle(STD_INPUT_HANDLE));
+    MessageChannel* toParentChannel = createPipeChannel(GetStdHandle(STD_OUTPUT_HANDLE));
+    char message[MESSAGE_SIZE];
+
+    if (fromParentChannel == NULL || toParentChannel == NULL)
+    {
+        return EXIT_FAILURE;
+    }
+
+    while (readMessage(fromParentChannel, message) && writeMessage(toParentChannel, message))
+    {
+    }
+
+    closeMessageChannel(fromParentChannel);
+    closeMessageChannel(toParentChannel);
+
+    return 0;
+}
+
+void setUpQueue(int numberOfThreads)
+{
+    vesselQueue = constructQueue(numberOfThreads, NULL);
+    queueMutex = CreateMutex(NULL, FALSE, NULL);
+
+    if (vesselQueue == NULL || queueMutex == NULL)
+    {
+        fprintf(stderr, "PortMicrobenchmark::setUpQueue::Unexpected Error - "
+            "Queue/Mutex creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void cleanUpQueue(int numberOfThreads)
+{
+    destructQueue(vesselQueue);
+    CloseHandle(queueMutex);
+}
+
+void setUpPingPong(int numberOfThreads)
+{
+    for (int i = 0; i < numberOfThreads; i++)
+    {
+        pingPongSemaphores[i] = CreateSemaphore(NULL, 0, 1, NULL);
+
+        if (pingPongSemaphores[i] == NULL)
+        {
+            fprintf(stderr, "PortMicrobenchmark::setUpPingPong::Unexpected Error - "
+                "Semaphore creation failed!\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void cleanUpPingPong(int numberOfThreads)
+{
+    for (int i = 0; i < numberOfThreads; i++)
+    {
+        CloseHandle(pingPongSemaphores[i]);
+    }
+}
+
+void setUpWaitWordPingPong(int numberOfThreads)
+{
+    for (int i = 0; i < numberOfThreads; i++)
+    {
+        pingPongWaitWords[i] = 0;
+    }
+}
+
+void setUpPipes(int numberOfThreads)
+{
+    // Set-up security attributes, so that handles may be inherited.
+    SECURITY_ATTRIBUTES securityAttributes = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+    TCHAR ProcessName[MAX_PATH + sizeof(ECHO_OPTION) + 1];
+    TCHAR moduleName[MAX_PATH];
+
+    GetModuleFileName(NULL, moduleName, MAX_PATH);
+    swprintf(ProcessName, sizeof(ProcessName) / sizeof(TCHAR), L"\"%ls\" %hs", moduleName, ECHO_OPTION);
+
+    for (int i = 0; i < numberOfThreads; i++)
+    {
+        HANDLE readFromParentHandle, writeToEchoHandle, readFromEchoHandle, writeToParentHandle;
+        STARTUPINFO startupInfo;
+        PROCESS_INFORMATION processInformation;
+
+        if (!CreatePipe(&readFromParentHandle, &writeToEchoHandle, &securityAttributes, 0) ||
+            !CreatePipe(&readFromEchoHandle, &writeToParentHandle, &securityAttributes, 0))
+        {
+            fprintf(stderr, "PortMicrobenchmark::setUpPipes::Unexpected Error - "
+                "Pipe creation failed!\n");
+            exit(EXIT_FAILURE);
+        }
+
+        // Only the echo process's ends are inherited.
+        SetHandleInformation(writeToEchoHandle, HANDLE_FLAG_INHERIT, 0);
+        SetHandleInformation(readFromEchoHandle, HANDLE_FLAG_INHERIT, 0);
+
+        SecureZeroMemory(&processInformation, sizeof(processInformation));
+        GetStartupInfo(&startupInfo);
+
+        startupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+        startupInfo.hStdOutput = writeToParentHandle;
+        startupInfo.hStdInput = readFromParentHandle;
+        startupInfo.dwFlags = STARTF_USESTDHANDLES;
+
+        if (!CreateProcess(NULL, ProcessName, NULL, NULL, TRUE, 0, NULL, NULL,
+            &startupInfo, &processInformation))
+        {
+            fprintf(stderr, "PortMicrobenchmark::setUpPipes::Unexpected Error -"
+                " CreateProcess for the echo failed (%d)!\n", GetLastError());
+            exit(EXIT_FAILURE);
+        }
+
+        CloseHandle(readFromParentHandle);
+        CloseHandle(writeToParentHandle);
+        CloseHandle(processInformation.hThread);
+
+        echoProcesses[i] = processInformation.hProcess;
+        toEchoChannels[i] = createPipeChannel(writeToEchoHandle);
+        fromEchoChannels[i] = createPipeChannel(readFromEchoHandle);
+
+        if (toEchoChannels[i] == NULL || fromEchoChannels[i] == NULL)
+        {
+            fprintf(stderr, "PortMicrobenchmark::setUpPipes::Unexpected Error - "
+                "Memory allocation failed!\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+void cleanUpPipes(int numberOfThreads)
+{
+    // The echo processes exit once their input ends.
+    for (int i = 0; i < numberOfThreads; i++)
+    {
+        closeMessageChannel(toEchoChannels[i]);
+        closeMessageChannel(fromEchoChannels[i]);
+    }
+
+    WaitForMultipleObjects(numberOfThreads, echoProcesses, TRUE, INFINITE);
+
+    for (int i = 0; i < numberOfThreads; i++)
+    {
+        CloseHandle(echoProcesses[i]);
+    }
+}
+
+void setUpPrint(int numberOfThreads)
+{
+    // A named semaphore, as HaifaPort creates ProcessSafePrint for the run.
+    WCHAR semaphoreName[MAX_STRING];
+
+    swprintf(semaphoreName, MAX_STRING, L"PortMicrobenchmarkPrint.%lu", GetCurrentProcessId());
+    processSafePrintSemaphore = CreateSemaphore(NULL, 1, 1, semaphoreName);
+
+    int nullFile = _open("NUL", _O_WRONLY);
+
+    fflush(stderr);
+    standardError = _dup(_fileno(stderr));
+
+    if (processSafePrintSemaphore == NULL || nullFile == -1 || standardError == -1 ||
+        _dup2(nullFile, _fileno(stderr)) != 0)
+    {
+        fprintf(stderr, "PortMicrobenchmark::setUpPrint::Unexpected Error - "
+            "Semaphore/File creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    _close(nullFile);
+}
+
+void cleanUpPrint(int numberOfThreads)
+{
+    fflush(stderr);
+    _dup2(standardError, _fileno(stderr));
+    _close(standardError);
+    CloseHandle(processSafePrintSemaphore);
+}
+
+void setUpRandom(int numberOfThreads)
+{
+    randomMutex = CreateMutex(NULL, FALSE, NULL);
+
+    if (randomMutex == NULL)
+    {
+        fprintf(stderr, "PortMicrobenchmark::setUpRandom::Unexpected Error - "
+            "Mutex creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void cleanUpRandom(int numberOfThreads)
+{
+    CloseHandle(randomMutex);
+}
+
+void setUpNothing(int numberOfThreads)
+{
+}
+
+DWORD WINAPI QueueThread(LPVOID Param)
+{
+    MicrobenchmarkThread* thread = (MicrobenchmarkThread*)Param;
+
+    WaitForSingleObject(thread->startEvent, INFINITE);
+
+    for (int i = 0; i < thread->iterations; i++)
+    {
+        WaitForSingleObject(queueMutex, INFINITE);
+        enqueue(vesselQueue, thread->index);
+        ReleaseMutex(queueMutex);
+
+        WaitForSingleObject(queueMutex, INFINITE);
+        dequeue(vesselQueue);
+        ReleaseMutex(queueMutex);
+    }
+
+    return 0;
+}
+
+DWORD WINAPI PingPongThread(LPVOID Param)
+{
+    MicrobenchmarkThread* thread = (MicrobenchmarkThread*)Param;
+    // Even threads serve, their odd partner returns every hand-off.
+    int isServing = thread->index % 2 == 0;
+    HANDLE ownSemaphore = pingPongSemaphores[thread->index];
+    HANDLE partnerSemaphore = pingPongSemaphores[thread->index ^ 1];
+
+    WaitForSingleObject(thread->startEvent, INFINITE);
+
+    for (int i = 0; i < thread->iterations; i++)
+    {
+        if (isServing)
+        {
+            ReleaseSemaphore(partnerSemaphore, 1, NULL);
+            WaitForSingleObject(ownSemaphore, INFINITE);
+        }
+        else
+        {
+            WaitForSingleObject(ownSemaphore, INFINITE);
+            ReleaseSemaphore(partnerSemaphore, 1, NULL);
+        }
+    }
+
+    return 0;
+}
+
+DWORD WINAPI WaitWordPingPongThread(LPVOID Param)
+{
+    MicrobenchmarkThread* thread = (MicrobenchmarkThread*)Param;
+    int isServing = thread->index % 2 == 0;
+    WaitWord* ownWaitWord = &pingPongWaitWords[thread->index];
+    WaitWord* partnerWaitWord = &pingPongWaitWords[thread->index ^ 1];
+
+    WaitForSingleObject(thread->startEvent, INFINITE);
+
+    for (int i = 0; i < thread->iterations; i++)
+    {
+        if (isServing)
+        {
+            signalWord(partnerWaitWord);
+            waitForWord(ownWaitWord);
+        }
+        else
+        {
+            waitForWord(ownWaitWord);
+            signalWord(partnerWaitWord);
+        }
+    }
+
+    return 0;
+}
+
+DWORD WINAPI PipeThread(LPVOID Param)
+{
+    MicrobenchmarkThread* thread = (MicrobenchmarkThread*)Param;
+    char message[MESSAGE_SIZE] = "1 25 1";
+
+    WaitForSingleObject(thread->startEvent, INFINITE);
+
+    for (int i = 0; i < thread->iterations; i++)
+    {
+        if (!writeMessage(toEchoChannels[thread->index], message) ||
+            !readMessage(fromEchoChannels[thread->index], message))
+        {
+            fprintf(stderr, "PortMicrobenchmark::PipeThread::Unexpected Error - "
+                "Round-trip to the echo failed!\n");
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+DWORD WINAPI PrintThread(LPVOID Param)
+{
+    MicrobenchmarkThread* thread = (MicrobenchmarkThread*)Param;
+    char string[MAX_STRING];
+
+    WaitForSingleObject(thread->startEvent, INFINITE);
+
+    for (int i = 0; i < thread->iterations; i++)
+    {
+        sprintf(string, "Vessel %2d - arrived @ Eilat Port", thread->index);
+
+        if (!safePrintWithTimeStamp(string))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+DWORD WINAPI RandomThread(LPVOID Param)
+{
+    MicrobenchmarkThread* thread = (MicrobenchmarkThread*)Param;
+    volatile int randomNumber;
+
+    WaitForSingleObject(thread->startEvent, INFINITE);
+
+    for (int i = 0; i < thread->iterations; i++)
+    {
+        randomNumber = safeRand();
+    }
+
+    return 0;
+}
+
+DWORD WINAPI ServiceTimeThread(LPVOID Param)
+{
+    MicrobenchmarkThread* thread = (MicrobenchmarkThread*)Param;
+    volatile DWORD serviceTime;
+
+    WaitForSingleObject(thread->startEvent, INFINITE);
+
+    for (int i = 0; i < thread->iterations; i++)
+    {
+        serviceTime = getServiceTime(SERVICE_TIME_TRANSIT, 0);
+    }
+
+    return 0;
+}
@@ -0,0 +1,620 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <windows.h>
+
+#include "RunNamespace.h"
+
+#define MAX_AXES 8 // Most parameters a grid may sweep.
+#define MAX_AXIS_VALUES 16 // Most values of a single parameter.
+#define MAX_VALUE 48 // Size of the largest parameter name or value.
+#define MAX_POINTS 4096 // Most points of a grid.
+#define MAX_GRID_LINE 1024 // Size of the largest line of a grid file.
+#define MAX_COMMAND_LINE 1024 // Size of the largest command line to start HaifaPort with.
+#define MAX_RESULTS 256 // Size of the largest results row HaifaPort prints.
+#define MAX_LOG_LINE 512 // Size of the largest line of a point's log which is read.
+#define FAULT_REPORT "Eilat Port: Faults - " // Prefix of EilatPort's fault report in a point's log.
+#define FLEET_AXIS "fleet" // The grid's axis of HaifaPort's first argument, the fleet.
+#define REUSE_OPTION "-reuse" // Runs the points on EilatPort sessions which serve one point after another.
+#define MAX_STANDBY_SESSIONS 16 // Most standby sessions an EilatPortServer keeps.
+
+// A parameter of the grid, either the fleet or any of HaifaPort's and EilatPort's options.
+typedef struct {
+    char name[MAX_VALUE];
+    char values[MAX_AXIS_VALUES][MAX_VALUE];
+    int numberOfValues;
+} SweepAxis;
+
+// A point of the grid, with the results HaifaPort printed once it was done.
+typedef struct {
+    int valueIndexes[MAX_AXES];
+    char runId[MAX_RUN_ID + 1];
+    HANDLE processHandle;
+    HANDLE resultsHandle; // Read end of the pipe which HaifaPort's standard output goes to.
+    DWORD exitCode;
+    char results[MAX_RESULTS];
+    char faults[MAX_RESULTS]; // EilatPort's fault counts from the point's log, empty without faults.
+} SweepPoint;
+
+// Main thread functions:
+// Read the grid's axes, one "<fleet | option> <value> <value> ..." line each.
+void readSweepGrid(const char* fileName);
+// Returns how many runs may be in parallel, by default one per core.
+int getNumberOfParallelRuns(const char* argument);
+// Set the value indexes of the point, the last axis changes the fastest.
+void setSweepPointValues(SweepPoint* point, int pointIndex);
+// Start an EilatPortServer with a standby session for each parallel run, in a job which ends it
+// and its sessions once the sweep closes it.
+void startSweepServer(int numberOfParallelRuns);
+// Start HaifaPort in-process, or connected to the sweep's server, for the point, with its results
+// on a pipe and its output in a log.
+void startSweepPoint(SweepPoint* point);
+// Wait for any of the running points to exit and read its results.
+void waitForAnySweepPoint(SweepPoint* runningPoints[], int* numberOfRunningPoints);
+// Read EilatPort's fault report from the point's log as a row of its counts.
+void readSweepPointFaults(SweepPoint* point);
+// Write a row for every point, as JSON if the file's name ends with ".json" and as CSV otherwise.
+void writeSweepResults(const char* fileName);
+
+// The grid and its points.
+SweepAxis axes[MAX_AXES];
+int numberOfAxes = 0;
+SweepPoint* points;
+int numberOfPoints = 1;
+// Set by -reuse, the sweep's EilatPortServer and the job it runs in.
+int isReusingSessions = FALSE;
+char serverName[MAX_RUN_ID + 1];
+HANDLE serverJobHandle = NULL;
+
+int main(int argc, char* argv[])
+{
+    // Check that the user's input is valid and save it to a variable.
+    if (argc != 4 && (argc != 5 || strcmp(argv[4], REUSE_OPTION) != 0))
+    {
+        fprintf(stderr, "PortSweep::Main::Error - Number of arguments is invalid!"
+            " Please enter the grid file, the parallel runs (0 for one per core)"
+            " and the results file, optionally followed by %s!\n", REUSE_OPTION);
+        exit(EXIT_SUCCESS);
+    }
+
+    isReusingSessions = argc == 5;
+
+    readSweepGrid(argv[1]);
+
+    const int numberOfParallelRuns = getNumberOfParallelRuns(argv[2]);
+
+    points = (SweepPoint*)calloc(numberOfPoints, sizeof(SweepPoint));
+
+    if (points == NULL)
+    {
+        fprintf(stderr, "PortSweep::Main::Unexpected Error - Memory allocation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    SweepPoint* runningPoints[MAXIMUM_WAIT_OBJECTS];
+    int numberOfRunningPoints = 0;
+    ULONGLONG startTime = GetTickCount64();
+
+    if (isReusingSessions)
+    {
+        startSweepServer(numberOfParallelRuns);
+    }
+
+    for (int i = 0; i < numberOfPoints; i++)
+    {
+        // Once all the slots are taken, a point starts whenever another one exits.
+        if (numberOfRunningPoints == numberOfParallelRuns)
+        {
+            waitForAnySweepPoint(runningPoints, &numberOfRunningPoints);
+        }
+
+        setSweepPointValues(&points[i], i);
+        sprintf(points[i].runId, "%lu-%d", GetCurrentProcessId(), i + 1);
+        startSweepPoint(&points[i]);
+        runningPoints[numberOfRunningPoints++] = &points[i];
+    }
+
+    while (numberOfRunningPoints > 0)
+    {
+        waitForAnySweepPoint(runningPoints, &numberOfRunningPoints);
+    }
+
+    // Closing the job ends the server and its sessions, which wait for points that never come.
+    if (isReusingSessions)
+    {
+        CloseHandle(serverJobHandle);
+    }
+
+    writeSweepResults(argv[3]);
+
+    fprintf(stderr, "PortSweep: %d points, %d in parallel, %.1f seconds\n",
+        numberOfPoints, numberOfParallelRuns, (GetTickCount64() - startTime) / 1000.0);
+
+    free(points);
+
+    return 0;
+}
+
+void readSweepGrid(const char* fileName)
+{
+    FILE* gridFile = fopen(fileName, "r");
+    char line[MAX_GRID_LINE];
+    int hasFleetAxis = FALSE;
+
+    if (gridFile == NULL)
+    {
+        fprintf(stderr, "PortSweep::readSweepGrid::Error - Opening grid file '%s' failed!\n", fileName);
+        exit(EXIT_SUCCESS);
+    }
+
+    while (fgets(line, sizeof(line), gridFile) != NULL)
+    {
+        char* token = strtok(line, " \t\r\n");
+
+        // Empty lines and comments, which start with '#', are skipped.
+        if (token == NULL || token[0] == '#')
+        {
+            continue;
+        }
+
+        if (numberOfAxes == MAX_AXES || strlen(token) >= MAX_VALUE)
+        {
+            fprintf(stderr, "PortSweep::readSweepGrid::Error - "
+                "A grid has up to %d axes, with names shorter than %d!\n", MAX_AXES, MAX_VALUE);
+            exit(EXIT_SUCCESS);
+        }
+
+        SweepAxis* axis = &axes[numberOfAxes++];
+
+        strcpy(axis->name, token);
+        hasFleetAxis |= strcmp(axis->name, FLEET_AXIS) == 0;
+
+        while ((token = strtok(NULL, " \t\r\n")) != NULL)
+        {
+            if (axis->numberOfValues == MAX_AXIS_VALUES || strlen(token) >= MAX_VALUE)
+            {
+                fprintf(stderr, "PortSweep::readSweepGrid::Error - "
+                    "An axis has up to %d values, each shorter than %d!\n", MAX_AXIS_VALUES, MAX_VALUE);
+                exit(EXIT_SUCCESS);
+            }
+
+            strcpy(axis->values[axis->numberOfValues++], token);
+        }
+
+        if (axis->numberOfValues == 0 || numberOfPoints * axis->numberOfValues > MAX_POINTS)
+        {
+            fprintf(stderr, "PortSweep::readSweepGrid::Error - "
+                "Axis '%s' must have values, and a grid up to %d points!\n", axis->name, MAX_POINTS);
+            exit(EXIT_SUCCESS);
+        }
+
+        numberOfPoints *= axis->numberOfValues;
+    }
+
+    fclose(gridFile);
+
+    if (!hasFleetAxis)
+    {
+        fprintf(stderr, "PortSweep::readSweepGrid::Error - "
+            "The grid must have a '%s' axis!\n", FLEET_AXIS);
+        exit(EXIT_SUCCESS);
+    }
+}
+
+int getNumberOfParallelRuns(const char* argument)
+{
+    int numberOfParallelRuns = atoi(argument);
+
+    if (numberOfParallelRuns <= 0)
+    {
+        SYSTEM_INFO systemInfo;
+
+        GetSystemInfo(&systemInfo);
+        numberOfParallelRuns = (int)systemInfo.dwNumberOfProcessors;
+    }
+
+    // Comment: the sweep waits for its points with WaitForMultipleObjects, which limits them.
+    if (numberOfParallelRuns > MAXIMUM_WAIT_OBJECTS)
+    {
+        numberOfParallelRuns = MAXIMUM_WAIT_OBJECTS;
+    }
+
+    return numberOfParallelRuns;
+}
+
+void setSweepPointValues(SweepPoint* point, int pointIndex)
+{
+    for (int i = numberOfAxes - 1; i >= 0; i--)
+    {
+        point->valueIndexes[i] = pointIndex % axes[i].numberOfValues;
+        pointIndex /= axes[i].numberOfValues;
+    }
+}
+
+void startSweepServer(int numberOfParallelRuns)
+{
+    TCHAR ProcessName[MAX_COMMAND_LINE];
+    WCHAR logFileName[MAX_RUN_OBJECT_NAME];
+    STARTUPINFO startupInfo;
+    PROCESS_INFORMATION processInformation;
+    JOBOBJECT_EXTENDED_LIMIT_INFORMATION jobLimits;
+    SECURITY_ATTRIBUTES securityAttributes = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+
+    // Comment: the points take a session each, so more parallel runs than standby sessions
+    // wait for one as any other HaifaPort with -connect does.
+    const int numberOfStandbySessions = numberOfParallelRuns < MAX_STANDBY_SESSIONS ?
+        numberOfParallelRuns : MAX_STANDBY_SESSIONS;
+
+    sprintf(serverName, "%lu-sessions", GetCurrentProcessId());
+    swprintf(ProcessName, MAX_COMMAND_LINE, L"EilatPortServer.exe %hs %d", serverName, numberOfStandbySessions);
+
+    serverJobHandle = CreateJobObject(NULL, NULL);
+    SecureZeroMemory(&jobLimits, sizeof(jobLimits));
+    jobLimits.BasicLimitInformation.LimitFlags = JOB_OBJECT_LIMIT_KILL_ON_JOB_CLOSE;
+
+    if (serverJobHandle == NULL ||
+        !SetInformationJobObject(serverJobHandle, JobObjectExtendedLimitInformation, &jobLimits, sizeof(jobLimits)))
+    {
+        fprintf(stderr, "PortSweep::startSweepServer::Unexpected Error - "
+            "Creating the server's job failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    // The server's and its sessions' output, EilatPort's reports of every point among it.
+    getRunObjectName(logFileName, L"PortSweep", serverName);
+    wcscat(logFileName, L".log");
+
+    HANDLE logHandle = CreateFile(logFileName, GENERIC_WRITE, FILE_SHARE_READ, &securityAttributes,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (logHandle == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "PortSweep::startSweepServer::Unexpected Error - "
+            "Creating the server's log failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    SecureZeroMemory(&processInformation, sizeof(processInformation));
+    GetStartupInfo(&startupInfo);
+
+    startupInfo.hStdError = logHandle;
+    startupInfo.hStdOutput = logHandle;
+    startupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+
+    // The server starts suspended till it is in the job, so every session it starts is in it too.
+    if (!CreateProcess(NULL,    // No module name (use command line).
+        ProcessName,            // Command line.
+        NULL,                   // Process handle not inheritable.
+        NULL,                   // Thread handle not inheritable.
+        TRUE,                   // Set handle inheritance to TRUE.
+        CREATE_SUSPENDED,       // Resumed once it is in the job.
+        NULL,                   // Use parent's environment block.
+        NULL,                   // Use parent's starting directory.
+        &startupInfo,           // Pointer to STARTUPINFO structure.
+        &processInformation)    // Pointer to PROCESS_INFORMATION structure.
+        )
+    {
+        fprintf(stderr, "PortSweep::startSweepServer::Unexpected Error -"
+            " CreateProcess for EilatPortServer failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    if (!AssignProcessToJobObject(serverJobHandle, processInformation.hProcess) ||
+        ResumeThread(processInformation.hThread) == (DWORD)-1)
+    {
+        fprintf(stderr, "PortSweep::startSweepServer::Unexpected Error - "
+            "Starting the server in its job failed (%d)!\n", GetLastError());
+        TerminateProcess(processInformation.hProcess, EXIT_FAILURE);
+        exit(EXIT_FAILURE);
+    }
+
+    CloseHandle(logHandle);
+    CloseHandle(processInformation.hThread);
+    CloseHandle(processInformation.hProcess);
+
+    fprintf(stderr, "PortSweep: Server %s started with %d standby sessions\n", serverName,
+        numberOfStandbySessions);
+}
+
+void startSweepPoint(SweepPoint* point)
+{
+    char commandLine[MAX_COMMAND_LINE];
+    TCHAR ProcessName[MAX_COMMAND_LINE];
+    WCHAR logFileName[MAX_RUN_OBJECT_NAME];
+    STARTUPINFO startupInfo;
+    PROCESS_INFORMATION processInformation;
+    HANDLE writeResultsHandle;
+    size_t length;
+
+    // Set-up security attributes, so that the handles may be inherited.
+    SECURITY_ATTRIBUTES securityAttributes = { sizeof(SECURITY_ATTRIBUTES), NULL, TRUE };
+
+    // The fleet comes first, every other axis is an option. EilatPort runs in-process, so a
+    // point costs a single process, or with -reuse on a session which served earlier points.
+    for (int i = 0; i < numberOfAxes; i++)
+    {
+        if (strcmp(axes[i].name, FLEET_AXIS) == 0)
+        {
+            length = sprintf(commandLine, "HaifaPort.exe %s", axes[i].values[point->valueIndexes[i]]);
+        }
+    }
+
+    for (int i = 0; i < numberOfAxes; i++)
+    {
+        if (strcmp(axes[i].name, FLEET_AXIS) != 0)
+        {
+            length += sprintf(commandLine + length, " %s %s", axes[i].name,
+                axes[i].values[point->valueIndexes[i]]);
+        }
+    }
+
+    if (isReusingSessions)
+    {
+        length += sprintf(commandLine + length, " -connect %s", serverName);
+    }
+    else
+    {
+        length += sprintf(commandLine + length, " -inprocess");
+    }
+
+    sprintf(commandLine + length, " -results -run %s", point->runId);
+    swprintf(ProcessName, MAX_COMMAND_LINE, L"%hs", commandLine);
+
+    // HaifaPort's standard output only holds its results row.
+    if (!CreatePipe(&point->resultsHandle, &writeResultsHandle, &securityAttributes, 0) ||
+        !SetHandleInformation(point->resultsHandle, HANDLE_FLAG_INHERIT, 0))
+    {
+        fprintf(stderr, "PortSweep::startSweepPoint::Unexpected Error - "
+            "Results pipe creation failed!\n");
+        exit(EXIT_FAILURE);
+    }
+
+    getRunObjectName(logFileName, L"PortSweep", point->runId);
+    wcscat(logFileName, L".log");
+
+    HANDLE logHandle = CreateFile(logFileName, GENERIC_WRITE, FILE_SHARE_READ, &securityAttributes,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (logHandle == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "PortSweep::startSweepPoint::Unexpected Error - "
+            "Creating the log of run %s failed (%d)!\n", point->runId, GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    SecureZeroMemory(&processInformation, sizeof(processInformation));
+    GetStartupInfo(&startupInfo);
+
+    startupInfo.hStdError = logHandle;
+    startupInfo.hStdOutput = writeResultsHandle;
+    startupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+
+    if (!CreateProcess(NULL,    // No module name (use command line).
+        ProcessName,            // Command line.
+        NULL,                   // Process handle not inheritable.
+        NULL,                   // Thread handle not inheritable.
+        TRUE,                   // Set handle inheritance to TRUE.
+        0,                      // No creation flags.
+        NULL,                   // Use parent's environment block.
+        NULL,                   // Use parent's starting directory.
+        &startupInfo,           // Pointer to STARTUPINFO structure.
+        &processInformation)    // Pointer to PROCESS_INFORMATION structure.
+        )
+    {
+        fprintf(stderr, "PortSweep::startSweepPoint::Unexpected Error -"
+            " CreateProcess for HaifaPort failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    // Comment: the handles are closed right away, so points started later don't inherit them
+    // and the results pipe ends once HaifaPort exits.
+    CloseHandle(logHandle);
+    CloseHandle(writeResultsHandle);
+    CloseHandle(processInformation.hThread);
+
+    point->processHandle = processInformation.hProcess;
+
+    fprintf(stderr, "PortSweep: Point %s started: %s\n", point->runId, commandLine);
+}
+
+void waitForAnySweepPoint(SweepPoint* runningPoints[], int* numberOfRunningPoints)
+{
+    HANDLE processHandles[MAXIMUM_WAIT_OBJECTS];
+
+    for (int i = 0; i < *numberOfRunningPoints; i++)
+    {
+        processHandles[i] = runningPoints[i]->processHandle;
+    }
+
+    DWORD waitResult = WaitForMultipleObjects(*numberOfRunningPoints, processHandles, FALSE, INFINITE);
+
+    if (waitResult >= WAIT_OBJECT_0 + *numberOfRunningPoints)
+    {
+        fprintf(stderr, "PortSweep::waitForAnySweepPoint::Unexpected Error - "
+            "Waiting for the points failed (%d)!\n", GetLastError());
+        exit(EXIT_FAILURE);
+    }
+
+    SweepPoint* point = runningPoints[waitResult - WAIT_OBJECT_0];
+    DWORD numberOfReadBytes = 0;
+    DWORD length = 0;
+
+    // Comment: the row is far smaller than the pipe's buffer, so HaifaPort never waits for it
+    // to be read and it is read only once HaifaPort exited.
+    while (length < MAX_RESULTS - 1 && ReadFile(point->resultsHandle, point->results + length,
+        MAX_RESULTS - 1 - length, &numberOfReadBytes, NULL) && numberOfReadBytes > 0)
+    {
+        length += numberOfReadBytes;
+    }
+
+    point->results[length] = '\0';
+    point->results[strcspn(point->results, "\r\n")] = '\0';
+
+    GetExitCodeProcess(point->processHandle, &point->exitCode);
+    CloseHandle(point->processHandle);
+    CloseHandle(point->resultsHandle);
+    readSweepPointFaults(point);
+
+    if (point->exitCode != 0 || point->results[0] == '\0')
+    {
+        fprintf(stderr, "PortSweep: Point %s failed with %lu, see its log\n",
+            point->runId, point->exitCode);
+    }
+
+    // The last running point takes the exited point's slot.
+    runningPoints[waitResult - WAIT_OBJECT_0] = runningPoints[--*numberOfRunningPoints];
+}
+
+void readSweepPointFaults(SweepPoint* point)
+{
+    WCHAR logFileName[MAX_RUN_OBJECT_NAME];
+    char line[MAX_LOG_LINE];
+    int numberOfCraneFailures, numberOfCraneStalls, numberOfMovedVessels, numberOfLaneFailures;
+    unsigned long long craneDownTime;
+
+    getRunObjectName(logFileName, L"PortSweep", point->runId);
+    wcscat(logFileName, L".log");
+
+    FILE* logFile = _wfopen(logFileName, L"r");
+
+    point->faults[0] = '\0';
+
+    if (logFile == NULL)
+    {
+        return;
+    }
+
+    // Comment: the report's other line, of the vessels per second, is in HaifaPort's results as well.
+    while (fgets(line, MAX_LOG_LINE, logFile) != NULL)
+    {
+        char* report = strstr(line, FAULT_REPORT);
+
+        if (report != NULL && sscanf(report + strlen(FAULT_REPORT), "%d crane failures, %d crane stalls, "
+            "%llu ms of crane down time, %d vessels moved, %d canal lane failures", &numberOfCraneFailures,
+            &numberOfCraneStalls, &craneDownTime, &numberOfMovedVessels, &numberOfLaneFailures) == 5)
+        {
+            sprintf(point->faults, "%d,%d,%llu,%d,%d", numberOfCraneFailures, numberOfCraneStalls, craneDownTime,
+                numberOfMovedVessels, numberOfLaneFailures);
+        }
+    }
+
+    fclose(logFile);
+}
+
+void writeSweepResults(const char* fileName)
+{
+    // Columns of HaifaPort's results row, after the grid's own.
+    const char* resultColumns[] = { "vessels", "makespanMs", "vesselsPerSecond",
+        "p50Ms", "p90Ms", "p99Ms", "maxMs", "userMsPerVessel", "kernelMsPerVessel",
+        "departP50Ms", "departP99Ms", "outboundP50Ms", "outboundP99Ms",
+        "eilatP50Ms", "eilatP99Ms", "dockP50Ms", "dockP99Ms",
+        "craneFailures", "craneStalls", "craneDownMs", "movedVessels", "laneFailures" };
+    const int numberOfResultColumns = sizeof(resultColumns) / sizeof(resultColumns[0]);
+    const int numberOfFaultColumns = 5; // The last columns, read from EilatPort's fault report.
+    size_t fileNameLength = strlen(fileName);
+    int isJson = fileNameLength > 5 && strcmp(fileName + fileNameLength - 5, ".json") == 0;
+    FILE* resultsFile = fopen(fileName, "w");
+
+    if (resultsFile == NULL)
+    {
+        fprintf(stderr, "PortSweep::writeSweepResults::Error - Opening results file '%s' failed!\n",
+            fileName);
+        exit(EXIT_FAILURE);
+    }
+
+    if (isJson)
+    {
+        fprintf(resultsFile, "[\n");
+    }
+    else
+    {
+        // Options are named without their leading '-'.
+        for (int i = 0; i < numberOfAxes; i++)
+        {
+            fprintf(resultsFile, "%s,", axes[i].name + (axes[i].name[0] == '-'));
+        }
+
+        fprintf(resultsFile, "exitCode");
+
+        for (int i = 0; i < numberOfResultColumns; i++)
+        {
+            fprintf(resultsFile, ",%s", resultColumns[i]);
+        }
+
+        fprintf(resultsFile, "\n");
+    }
+
+    for (int i = 0; i < numberOfPoints; i++)
+    {
+        SweepPoint* point = &points[i];
+        char results[MAX_RESULTS];
+        char faults[MAX_RESULTS];
+        char* values[sizeof(resultColumns) / sizeof(resultColumns[0])] = { NULL };
+        int numberOfValues = 0;
+
+        // A failed point has empty results, and a point without faults has no fault counts.
+        strcpy(results, point->results);
+        strcpy(faults, point->faults);
+
+        for (char* value = strtok(results, ","); value != NULL &&
+            numberOfValues < numberOfResultColumns - numberOfFaultColumns; value = strtok(NULL, ","))
+        {
+            values[numberOfValues++] = value;
+        }
+
+        numberOfValues = numberOfResultColumns - numberOfFaultColumns;
+
+        for (char* value = strtok(faults, ","); value != NULL && numberOfValues < numberOfResultColumns;
+            value = strtok(NULL, ","))
+        {
+            values[numberOfValues++] = value;
+        }
+
+        if (isJson)
+        {
+            fprintf(resultsFile, "  {");
+
+            for (int j = 0; j < numberOfAxes; j++)
+            {
+                fprintf(resultsFile, "\"%s\": \"%s\", ", axes[j].name + (axes[j].name[0] == '-'),
+                    axes[j].values[point->valueIndexes[j]]);
+            }
+
+            fprintf(resultsFile, "\"exitCode\": %lu", point->exitCode);
+
+            for (int j = 0; j < numberOfResultColumns; j++)
+            {
+                fprintf(resultsFile, ", \"%s\": %s", resultColumns[j], values[j] != NULL ? values[j] : "null");
+            }
+
+            fprintf(resultsFile, "}%s\n", i + 1 < numberOfPoints ? "," : "");
+        }
+        else
+        {
+            for (int j = 0; j < numberOfAxes; j++)
+            {
+                fprintf(resultsFile, "%s,", axes[j].values[point->valueIndexes[j]]);
+            }
+
+            fprintf(resultsFile, "%lu", point->exitCode);
+
+            for (int j = 0; j < numberOfResultColumns; j++)
+            {
+                fprintf(resultsFile, ",%s", values[j] != NULL ? values[j] : "");
+            }
+
+            fprintf(resultsFile, "\n");
+        }
+    }
+
+    if (isJson)
+    {
+        fprintf(resultsFile, "]\n");
+    }
+
+    fclose(resultsFile);
+}
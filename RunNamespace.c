@@ -0,0 +1,32 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "RunNamespace.h"
+
+int isValidRunId(const char* runId)
+{
+    size_t length = strlen(runId);
+
+    if (length == 0 || length > MAX_RUN_ID)
+    {
+        return FALSE;
+    }
+
+    for (size_t i = 0; i < length; i++)
+    {
+        if (!isalnum((unsigned char)runId[i]) && runId[i] != '-' && runId[i] != '_')
+        {
+            return FALSE;
+        }
+    }
+
+    return TRUE;
+}
+
+void getRunObjectName(WCHAR name[], const WCHAR* baseName, const char* runId)
+{
+    swprintf(name, MAX_RUN_OBJECT_NAME, L"%ls.%hs", baseName, runId);
+}
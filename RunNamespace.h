@@ -0,0 +1,17 @@
+#ifndef RUN_NAMESPACE_H
+#define RUN_NAMESPACE_H
+
+#include <windows.h>
+
+// Every named object and shared memory of a run is suffixed with its run id, so any number of
+// runs may share a host. HaifaPort takes the run id with -run, or its process ID by default,
+// and passes it on to EilatPort's command line.
+#define MAX_RUN_ID 32 // Longest run id, without its terminating null.
+#define MAX_RUN_OBJECT_NAME 96 // Longest name of a run's object, with its terminating null.
+
+// Returns TRUE if the run id is 1..MAX_RUN_ID letters, digits, '-' or '_'.
+int isValidRunId(const char* runId);
+// Fills name with "<baseName>.<runId>".
+void getRunObjectName(WCHAR name[], const WCHAR* baseName, const char* runId);
+
+#endif
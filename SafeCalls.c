@@ -0,0 +1,45 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "SafeCalls.h"
+
+HANDLE randomMutex;
+HANDLE processSafePrintSemaphore;
+LockProfile randomMutexProfile = LOCK_PROFILE("randomMutex");
+LockProfile processSafePrintProfile = LOCK_PROFILE("ProcessSafePrint");
+
+int safeRand(void)
+{
+    waitForProfiledObject(&randomMutexProfile, randomMutex, INFINITE);
+
+    int randomNumber = rand();
+
+    if (!releaseProfiledMutex(&randomMutexProfile, randomMutex))
+    {
+        fprintf(stderr, "SafeCalls::safeRand::Unexpected error - randomMutex.V()\n");
+    }
+
+    return randomNumber;
+}
+
+int safePrintWithTimeStamp(char string[])
+{
+    SYSTEMTIME currentTime;
+
+    waitForProfiledObject(&processSafePrintProfile, processSafePrintSemaphore, INFINITE);
+
+    GetLocalTime(&currentTime);
+    fprintf(stderr, "[%02d:%02d:%02d] %s\n",
+        currentTime.wHour, currentTime.wMinute, currentTime.wSecond, string);
+
+    if (!releaseProfiledSemaphore(&processSafePrintProfile, processSafePrintSemaphore, 1))
+    {
+        fprintf(stderr, "SafeCalls::safePrintWithTimeStamp::Unexpected Error - "
+            "processSafePrintSemaphore.V()\n");
+        return FALSE;
+    }
+
+    return TRUE;
+}
@@ -0,0 +1,23 @@
+#ifndef SAFE_CALLS_H
+#define SAFE_CALLS_H
+
+#include <windows.h>
+
+#include "LockProfiler.h"
+
+// rand() and the timestamped print, shared by both ports so that any of their threads may call them.
+// Each port creates or opens the handles before its threads start.
+// randomMutex is the process's own. fprintf may be a thread safe function, though it isn't process
+// safe, so processSafePrintSemaphore is the run's ProcessSafePrint semaphore, which HaifaPort
+// creates and EilatPort opens, and both ports wait untill it's their turn to print.
+extern HANDLE randomMutex;
+extern HANDLE processSafePrintSemaphore;
+extern LockProfile randomMutexProfile;
+extern LockProfile processSafePrintProfile;
+
+// Thread safe rand().
+int safeRand(void);
+// Prints the string to the standard error with the local time. Returns FALSE on failure.
+int safePrintWithTimeStamp(char string[]);
+
+#endif
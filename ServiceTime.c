@@ -0,0 +1,313 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "ServiceTime.h"
+
+#define MAX_SERVICE_TIME_OPTION 256 // Size of the largest -service option.
+
+const char* serviceTimeStageNames[] = { "depart", "transit", "dock", "unload", "load" };
+const char* serviceTimeDistributionNames[] = { "constant", "uniform", "exponential", "lognormal",
+    "pareto", "empirical" };
+// Parameters every distribution takes, an empirical distribution takes its file instead.
+const int serviceTimeNumberOfParameters[] = { 1, 2, 1, 2, 2, 0 };
+
+ServiceTimeDistribution serviceTimes[SERVICE_TIME_STAGES];
+
+// Random state of each thread, seeded on its first draw, so threads never wait for one another.
+__declspec(thread) ULONGLONG serviceTimeRandomState = 0;
+ULONGLONG serviceTimeSeed = 0; // 0 seeds by the time.
+
+ULONGLONG mixServiceTimeSeed(ULONGLONG seed);
+double getUniformRandom(void);
+double getInverseNormal(double probability);
+double sampleServiceTime(ServiceTimeDistribution* distribution);
+int readEmpiricalServiceTimes(ServiceTimeDistribution* distribution, const char* fileName);
+int compareServiceTimes(const void* first, const void* second);
+
+void initializeServiceTimes(int minTime, int maxTime)
+{
+    for (int i = 0; i < SERVICE_TIME_STAGES; i++)
+    {
+        free(serviceTimes[i].samples);
+        memset(&serviceTimes[i], 0, sizeof(ServiceTimeDistribution));
+        serviceTimes[i].type = SERVICE_TIME_UNIFORM;
+        serviceTimes[i].parameters[0] = minTime;
+        serviceTimes[i].parameters[1] = maxTime;
+        serviceTimes[i].isPerTon = FALSE;
+    }
+}
+
+int setServiceTimeDistribution(const char* option)
+{
+    char buffer[MAX_SERVICE_TIME_OPTION];
+    ServiceTimeDistribution distribution = { 0 };
+    int stage = -1;
+
+    if (strlen(option) >= MAX_SERVICE_TIME_OPTION)
+    {
+        return FALSE;
+    }
+
+    strcpy(buffer, option);
+
+    char* stageName = strtok(buffer, "=");
+    char* distributionName = strtok(NULL, ":");
+
+    if (stageName == NULL || distributionName == NULL)
+    {
+        return FALSE;
+    }
+
+    for (int i = 0; i < SERVICE_TIME_STAGES; i++)
+    {
+        if (strcmp(stageName, serviceTimeStageNames[i]) == 0)
+        {
+            stage = i;
+        }
+    }
+
+    distribution.type = -1;
+
+    for (int i = 0; i < sizeof(serviceTimeDistributionNames) / sizeof(char*); i++)
+    {
+        if (strcmp(distributionName, serviceTimeDistributionNames[i]) == 0)
+        {
+            distribution.type = i;
+        }
+    }
+
+    if (stage == -1 || distribution.type == -1)
+    {
+        return FALSE;
+    }
+
+    if (distribution.type == SERVICE_TIME_EMPIRICAL)
+    {
+        // Comment: the file's name is the rest of the option, it may hold ':' as in "C:\times.txt".
+        char* fileName = strtok(NULL, "");
+
+        if (fileName == NULL || !readEmpiricalServiceTimes(&distribution, fileName))
+        {
+            return FALSE;
+        }
+    }
+
+    for (int i = 0; i < serviceTimeNumberOfParameters[distribution.type]; i++)
+    {
+        char* parameter = strtok(NULL, ":");
+
+        if (parameter == NULL)
+        {
+            return FALSE;
+        }
+
+        distribution.parameters[i] = atof(parameter);
+    }
+
+    double* parameters = distribution.parameters;
+
+    if (strtok(NULL, ":") != NULL ||
+        (distribution.type == SERVICE_TIME_CONSTANT && parameters[0] < 0) ||
+        (distribution.type == SERVICE_TIME_UNIFORM && (parameters[0] < 0 || parameters[1] < parameters[0])) ||
+        (distribution.type == SERVICE_TIME_EXPONENTIAL && parameters[0] <= 0) ||
+        (distribution.type == SERVICE_TIME_LOGNORMAL && parameters[1] < 0) ||
+        (distribution.type == SERVICE_TIME_PARETO && (parameters[0] <= 0 || parameters[1] <= 0)))
+    {
+        free(distribution.samples);
+        return FALSE;
+    }
+
+    // A configured unloading or loading time is per ton, as the crane's work grows with the cargo.
+    distribution.isPerTon = stage == SERVICE_TIME_UNLOAD || stage == SERVICE_TIME_LOAD;
+
+    free(serviceTimes[stage].samples);
+    serviceTimes[stage] = distribution;
+
+    return TRUE;
+}
+
+DWORD getServiceTime(int stage, int cargoWeight)
+{
+    double serviceTime = sampleServiceTime(&serviceTimes[stage]);
+
+    if (serviceTimes[stage].isPerTon && cargoWeight > 0)
+    {
+        serviceTime *= cargoWeight;
+    }
+
+    return serviceTime < SERVICE_TIME_MAX ? (DWORD)(serviceTime + 0.5) : SERVICE_TIME_MAX;
+}
+
+void seedServiceTimes(ULONGLONG seed)
+{
+    serviceTimeSeed = seed;
+}
+
+void seedServiceTimeThread(ULONGLONG stream)
+{
+    if (serviceTimeSeed != 0)
+    {
+        serviceTimeRandomState = mixServiceTimeSeed(serviceTimeSeed + mixServiceTimeSeed(stream));
+    }
+}
+
+ULONGLONG mixServiceTimeSeed(ULONGLONG seed)
+{
+    // splitmix64's finalizer, so nearby seeds and streams make unrelated states.
+    // A state of 0 is replaced, since xorshift never leaves it.
+    seed += 0x9E3779B97F4A7C15ULL;
+    seed = (seed ^ (seed >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    seed = (seed ^ (seed >> 27)) * 0x94D049BB133111EBULL;
+    seed ^= seed >> 31;
+
+    return seed != 0 ? seed : 1;
+}
+
+double getUniformRandom(void)
+{
+    // Every thread gets its own seed, which differs by its ID.
+    if (serviceTimeRandomState == 0)
+    {
+        serviceTimeRandomState = (GetTickCount64() << 20) ^ GetCurrentThreadId() ^ 0x9E3779B97F4A7C15ULL;
+    }
+
+    // xorshift64*, its top 53 bits make a double in (0, 1).
+    serviceTimeRandomState ^= serviceTimeRandomState >> 12;
+    serviceTimeRandomState ^= serviceTimeRandomState << 25;
+    serviceTimeRandomState ^= serviceTimeRandomState >> 27;
+
+    ULONGLONG random = serviceTimeRandomState * 0x2545F4914F6CDD1DULL;
+
+    return ((random >> 11) + 0.5) / 9007199254740992.0;
+}
+
+double getInverseNormal(double probability)
+{
+    // Acklam's rational approximation of the standard normal's inverse CDF,
+    // its relative error is below 1.15e-9.
+    static const double a[] = { -3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+        1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00 };
+    static const double b[] = { -5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+        6.680131188771972e+01, -1.328068155288572e+01 };
+    static const double c[] = { -7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+        -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00 };
+    static const double d[] = { 7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+        3.754408661907416e+00 };
+    const double lowTail = 0.02425;
+
+    if (probability < lowTail || probability > 1 - lowTail)
+    {
+        double q = sqrt(-2 * log(probability < lowTail ? probability : 1 - probability));
+        double x = (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+            ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1);
+
+        return probability < lowTail ? x : -x;
+    }
+
+    double q = probability - 0.5;
+    double r = q * q;
+
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+        (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1);
+}
+
+double sampleServiceTime(ServiceTimeDistribution* distribution)
+{
+    double* parameters = distribution->parameters;
+
+    if (distribution->type == SERVICE_TIME_CONSTANT)
+    {
+        return parameters[0];
+    }
+
+    double probability = getUniformRandom();
+
+    switch (distribution->type)
+    {
+    case SERVICE_TIME_UNIFORM:
+        return parameters[0] + probability * (parameters[1] - parameters[0]);
+    case SERVICE_TIME_EXPONENTIAL:
+        return -parameters[0] * log(probability);
+    case SERVICE_TIME_LOGNORMAL:
+        return exp(parameters[0] + parameters[1] * getInverseNormal(probability));
+    case SERVICE_TIME_PARETO:
+        return parameters[0] / pow(probability, 1 / parameters[1]);
+    default:
+    {
+        // Interpolate between the two sorted samples around the probability.
+        double position = probability * (distribution->numberOfSamples - 1);
+        int index = (int)position;
+
+        if (index + 1 >= distribution->numberOfSamples)
+        {
+            return distribution->samples[distribution->numberOfSamples - 1];
+        }
+
+        return distribution->samples[index] +
+            (position - index) * (distribution->samples[index + 1] - distribution->samples[index]);
+    }
+    }
+}
+
+int readEmpiricalServiceTimes(ServiceTimeDistribution* distribution, const char* fileName)
+{
+    FILE* samplesFile = fopen(fileName, "r");
+    int capacity = 1024;
+    double sample;
+
+    if (samplesFile == NULL)
+    {
+        fprintf(stderr, "readEmpiricalServiceTimes::Error - Opening '%s' failed!\n", fileName);
+        return FALSE;
+    }
+
+    distribution->samples = (double*)malloc(capacity * sizeof(double));
+    distribution->numberOfSamples = 0;
+
+    while (distribution->samples != NULL && distribution->numberOfSamples < SERVICE_TIME_MAX_SAMPLES &&
+        fscanf(samplesFile, "%lf", &sample) == 1)
+    {
+        if (distribution->numberOfSamples == capacity)
+        {
+            capacity *= 2;
+
+            double* samples = (double*)realloc(distribution->samples, capacity * sizeof(double));
+
+            if (samples == NULL)
+            {
+                free(distribution->samples);
+                distribution->samples = NULL;
+                break;
+            }
+
+            distribution->samples = samples;
+        }
+
+        distribution->samples[distribution->numberOfSamples++] = sample < 0 ? 0 : sample;
+    }
+
+    fclose(samplesFile);
+
+    if (distribution->samples == NULL || distribution->numberOfSamples == 0)
+    {
+        fprintf(stderr, "readEmpiricalServiceTimes::Error - '%s' holds no times!\n", fileName);
+        free(distribution->samples);
+        distribution->samples = NULL;
+        return FALSE;
+    }
+
+    qsort(distribution->samples, distribution->numberOfSamples, sizeof(double), compareServiceTimes);
+
+    return TRUE;
+}
+
+int compareServiceTimes(const void* first, const void* second)
+{
+    double difference = *(const double*)first - *(const double*)second;
+
+    return (difference > 0) - (difference < 0);
+}
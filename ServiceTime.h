@@ -0,0 +1,48 @@
+#ifndef SERVICE_TIME_H
+#define SERVICE_TIME_H
+
+#include <windows.h>
+
+// Stages of a vessel's voyage which take time, each with its own distribution.
+#define SERVICE_TIME_DEPART 0 // Leaving a port.
+#define SERVICE_TIME_TRANSIT 1 // Sailing through the canal.
+#define SERVICE_TIME_DOCK 2 // Docking at a port.
+#define SERVICE_TIME_UNLOAD 3 // Unloading by a crane, per ton once a distribution is set.
+#define SERVICE_TIME_LOAD 4 // Loading by a crane at HaifaPort in round trips, per ton as unloading is.
+#define SERVICE_TIME_STAGES 5
+
+// Distributions a stage's time may be drawn from, in miliseconds.
+#define SERVICE_TIME_CONSTANT 0 // constant:<ms>
+#define SERVICE_TIME_UNIFORM 1 // uniform:<min>:<max>
+#define SERVICE_TIME_EXPONENTIAL 2 // exponential:<mean>
+#define SERVICE_TIME_LOGNORMAL 3 // lognormal:<mu>:<sigma>, of the time's natural log.
+#define SERVICE_TIME_PARETO 4 // pareto:<scale>:<shape>, no time is below scale.
+#define SERVICE_TIME_EMPIRICAL 5 // empirical:<file>, drawn from the file's times, one per line.
+
+#define SERVICE_TIME_MAX 600000 // Longest time a stage may take, heavy tails are cut at 10 minutes.
+#define SERVICE_TIME_MAX_SAMPLES 1000000 // Most times an empirical distribution is read from.
+
+// A stage's distribution. Times are drawn by inverting its CDF at a uniform random number,
+// which takes a few instructions and no lock.
+typedef struct {
+    int type;
+    double parameters[2];
+    double* samples; // Sorted times of an empirical distribution.
+    int numberOfSamples;
+    int isPerTon; // The time is multiplied by the cargo's weight.
+} ServiceTimeDistribution;
+
+// Every stage takes a uniform time between minTime and maxTime till it is set otherwise.
+void initializeServiceTimes(int minTime, int maxTime);
+// Sets a stage's distribution from "<stage>=<distribution>:<parameters>", where the stage is
+// depart, transit, dock, unload or load. Returns FALSE if it is invalid.
+int setServiceTimeDistribution(const char* option);
+// With a seed, a thread which seeds its draws with a stream of its own, as its vessel's ID,
+// draws the same times on every run whatever the order threads run in. Threads which don't
+// and runs without a seed draw from seeds by the time.
+void seedServiceTimes(ULONGLONG seed);
+void seedServiceTimeThread(ULONGLONG stream);
+// Draws the time in miliseconds the stage takes for a vessel with the given cargo.
+DWORD getServiceTime(int stage, int cargoWeight);
+
+#endif
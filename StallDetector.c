@@ -0,0 +1,359 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "StallDetector.h"
+
+#ifdef PORT_STALL_DETECTOR
+
+StallWatch* stallWatches = NULL; // NULL while no watchdog runs.
+int maxNumberOfStallWatches;
+// Indexes of the free watches, the last freed on top, so the watches in use stay at the front
+// and the watchdog only checks the ones below the most ever in use at once.
+int* freeStallWatches;
+int numberOfFreeStallWatches;
+volatile LONG numberOfUsedStallWatches;
+SRWLOCK stallWatchesLock = SRWLOCK_INIT;
+const char* stallDetectorPortName;
+DWORD stallThreshold;
+HANDLE stallDetectorStopEvent;
+HANDLE stallDetectorHandle;
+int numberOfStalls = 0;
+
+// The calling thread's watch, NULL if it isn't watched.
+__declspec(thread) StallWatch* currentStallWatch = NULL;
+
+DWORD WINAPI StallDetector(LPVOID Param);
+void printStallSnapshot(StallWatch* stalledWatch, const char* stalledPrimitive, ULONGLONG now);
+void holdStallLock(const char* primitiveName);
+void getStallOwner(char owner[], StallWatch* stallWatch);
+void releaseStallLock(const char* primitiveName);
+
+int startStallDetector(const char* portName, int maxNumberOfThreads, DWORD threshold)
+{
+    DWORD threadId;
+
+    stallWatches = (StallWatch*)calloc(maxNumberOfThreads, sizeof(StallWatch));
+    freeStallWatches = (int*)malloc(maxNumberOfThreads * sizeof(int));
+    stallDetectorStopEvent = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+    if (stallWatches == NULL || freeStallWatches == NULL || stallDetectorStopEvent == NULL)
+    {
+        fprintf(stderr, "startStallDetector::Unexpected Error - Memory allocation or event creation failed!\n");
+        free(stallWatches);
+        free(freeStallWatches);
+        stallWatches = NULL;
+
+        if (stallDetectorStopEvent != NULL)
+        {
+            CloseHandle(stallDetectorStopEvent);
+        }
+
+        return FALSE;
+    }
+
+    for (int i = 0; i < maxNumberOfThreads; i++)
+    {
+        freeStallWatches[i] = maxNumberOfThreads - 1 - i;
+    }
+
+    maxNumberOfStallWatches = maxNumberOfThreads;
+    numberOfFreeStallWatches = maxNumberOfThreads;
+    numberOfUsedStallWatches = 0;
+    numberOfStalls = 0;
+    stallDetectorPortName = portName;
+    stallThreshold = threshold;
+    stallDetectorHandle = CreateThread(NULL, 0, StallDetector, NULL, 0, &threadId);
+
+    if (stallDetectorHandle == NULL)
+    {
+        fprintf(stderr, "startStallDetector::Unexpected Error - Watchdog thread creation failed!\n");
+        free(stallWatches);
+        free(freeStallWatches);
+        stallWatches = NULL;
+        CloseHandle(stallDetectorStopEvent);
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+void stopStallDetector(void)
+{
+    if (stallWatches == NULL)
+    {
+        return;
+    }
+
+    SetEvent(stallDetectorStopEvent);
+    WaitForSingleObject(stallDetectorHandle, INFINITE);
+    CloseHandle(stallDetectorHandle);
+    CloseHandle(stallDetectorStopEvent);
+
+    fprintf(stderr, "%s: Stall detector - %d waits stalled over %lu ms\n", stallDetectorPortName,
+        numberOfStalls, stallThreshold);
+
+    // Comment: the watches aren't freed, since threads which were left running may still use theirs.
+    // Only the calling thread is known to be done with its watch, till it is watched again.
+    AcquireSRWLockExclusive(&stallWatchesLock);
+    free(freeStallWatches);
+    stallWatches = NULL;
+    ReleaseSRWLockExclusive(&stallWatchesLock);
+    currentStallWatch = NULL;
+}
+
+void watchStallThread(const char* ownerName, int ownerId)
+{
+    if (stallWatches == NULL)
+    {
+        return;
+    }
+
+    AcquireSRWLockExclusive(&stallWatchesLock);
+
+    // A thread which finds no free watch runs unwatched.
+    if (stallWatches == NULL || numberOfFreeStallWatches == 0)
+    {
+        ReleaseSRWLockExclusive(&stallWatchesLock);
+        return;
+    }
+
+    int watchIndex = freeStallWatches[--numberOfFreeStallWatches];
+    StallWatch* stallWatch = &stallWatches[watchIndex];
+
+    stallWatch->threadId = GetCurrentThreadId();
+    stallWatch->ownerName = ownerName;
+    stallWatch->ownerId = ownerId;
+    stallWatch->waitPrimitive = NULL;
+    stallWatch->reportedWaitStartTime = 0;
+
+    for (int j = 0; j < MAX_STALL_HELD_LOCKS; j++)
+    {
+        stallWatch->heldLocks[j] = NULL;
+    }
+
+    InterlockedExchange(&stallWatch->isInUse, TRUE);
+
+    if (watchIndex >= numberOfUsedStallWatches)
+    {
+        InterlockedExchange(&numberOfUsedStallWatches, watchIndex + 1);
+    }
+
+    ReleaseSRWLockExclusive(&stallWatchesLock);
+    currentStallWatch = stallWatch;
+}
+
+void unwatchStallThread(void)
+{
+    if (currentStallWatch == NULL)
+    {
+        return;
+    }
+
+    currentStallWatch->waitPrimitive = NULL;
+    AcquireSRWLockExclusive(&stallWatchesLock);
+    InterlockedExchange(&currentStallWatch->isInUse, FALSE);
+
+    // The watch of a watchdog which has stopped since isn't one of the running watchdog's.
+    if (stallWatches != NULL && currentStallWatch >= stallWatches &&
+        currentStallWatch < stallWatches + maxNumberOfStallWatches)
+    {
+        freeStallWatches[numberOfFreeStallWatches++] = (int)(currentStallWatch - stallWatches);
+    }
+
+    ReleaseSRWLockExclusive(&stallWatchesLock);
+    currentStallWatch = NULL;
+}
+
+void beginStallWait(const char* primitiveName)
+{
+    if (currentStallWatch == NULL)
+    {
+        return;
+    }
+
+    // The start time is set first, so the watchdog never sees a primitive with an old time.
+    currentStallWatch->waitStartTime = GetTickCount64();
+    MemoryBarrier();
+    currentStallWatch->waitPrimitive = primitiveName;
+}
+
+void endStallWait(void)
+{
+    if (currentStallWatch != NULL)
+    {
+        currentStallWatch->waitPrimitive = NULL;
+    }
+}
+
+DWORD waitForWatchedObject(const char* primitiveName, int isLock, HANDLE handle, DWORD timeout)
+{
+    beginStallWait(primitiveName);
+
+    DWORD result = WaitForSingleObject(handle, timeout);
+
+    endStallWait();
+
+    if (isLock && (result == WAIT_OBJECT_0 || result == WAIT_ABANDONED))
+    {
+        holdStallLock(primitiveName);
+    }
+
+    return result;
+}
+
+BOOL releaseWatchedMutex(const char* primitiveName, HANDLE mutex)
+{
+    releaseStallLock(primitiveName);
+
+    return ReleaseMutex(mutex);
+}
+
+BOOL releaseWatchedSemaphore(const char* primitiveName, int isLock, HANDLE semaphore, LONG releaseCount)
+{
+    if (isLock)
+    {
+        releaseStallLock(primitiveName);
+    }
+
+    return ReleaseSemaphore(semaphore, releaseCount, NULL);
+}
+
+void waitForWatchedWord(const char* primitiveName, WaitWord* waitWord)
+{
+    beginStallWait(primitiveName);
+    waitForWord(waitWord);
+    endStallWait();
+}
+
+void holdStallLock(const char* primitiveName)
+{
+    if (currentStallWatch == NULL)
+    {
+        return;
+    }
+
+    for (int i = 0; i < MAX_STALL_HELD_LOCKS; i++)
+    {
+        if (currentStallWatch->heldLocks[i] == NULL)
+        {
+            currentStallWatch->heldLocks[i] = primitiveName;
+            return;
+        }
+    }
+}
+
+void releaseStallLock(const char* primitiveName)
+{
+    if (currentStallWatch == NULL)
+    {
+        return;
+    }
+
+    for (int i = 0; i < MAX_STALL_HELD_LOCKS; i++)
+    {
+        if (currentStallWatch->heldLocks[i] == primitiveName)
+        {
+            currentStallWatch->heldLocks[i] = NULL;
+            return;
+        }
+    }
+}
+
+DWORD WINAPI StallDetector(LPVOID Param)
+{
+    DWORD checkInterval = stallThreshold / STALL_DETECTOR_CHECKS ? stallThreshold / STALL_DETECTOR_CHECKS : 1;
+
+    while (WaitForSingleObject(stallDetectorStopEvent, checkInterval) == WAIT_TIMEOUT)
+    {
+        ULONGLONG now = GetTickCount64();
+
+        for (int i = 0; i < numberOfUsedStallWatches; i++)
+        {
+            StallWatch* stallWatch = &stallWatches[i];
+            const char* waitPrimitive = stallWatch->waitPrimitive;
+            ULONGLONG waitStartTime = stallWatch->waitStartTime;
+
+            if (stallWatch->isInUse && waitPrimitive != NULL && now > waitStartTime &&
+                now - waitStartTime > stallThreshold && stallWatch->reportedWaitStartTime != waitStartTime)
+            {
+                stallWatch->reportedWaitStartTime = waitStartTime;
+                numberOfStalls++;
+                printStallSnapshot(stallWatch, waitPrimitive, now);
+            }
+        }
+    }
+
+    return 0;
+}
+
+void printStallSnapshot(StallWatch* stalledWatch, const char* stalledPrimitive, ULONGLONG now)
+{
+    SYSTEMTIME currentTime;
+    char owner[MAX_STALL_OWNER];
+
+    getStallOwner(owner, stalledWatch);
+
+    // Comment: printed without ProcessSafePrint, which may be the very primitive that stalls.
+    GetLocalTime(&currentTime);
+    fprintf(stderr, "[%02d:%02d:%02d] %s: Stall - %s has waited %llu ms on %s, wait-for snapshot:\n",
+        currentTime.wHour, currentTime.wMinute, currentTime.wSecond, stallDetectorPortName,
+        owner, now - stalledWatch->waitStartTime, stalledPrimitive);
+
+    // Only threads which wait or hold a lock take part in a stall.
+    for (int i = 0; i < numberOfUsedStallWatches; i++)
+    {
+        StallWatch* stallWatch = &stallWatches[i];
+        const char* waitPrimitive = stallWatch->waitPrimitive;
+        char heldLocks[MAX_STALL_HELD_LOCKS * 32] = "";
+        size_t length = 0;
+
+        if (!stallWatch->isInUse)
+        {
+            continue;
+        }
+
+        for (int j = 0; j < MAX_STALL_HELD_LOCKS; j++)
+        {
+            const char* heldLock = stallWatch->heldLocks[j];
+
+            if (heldLock != NULL)
+            {
+                length += snprintf(heldLocks + length, sizeof(heldLocks) - length, " %s", heldLock);
+            }
+        }
+
+        if (waitPrimitive == NULL && length == 0)
+        {
+            continue;
+        }
+
+        getStallOwner(owner, stallWatch);
+
+        if (waitPrimitive != NULL)
+        {
+            fprintf(stderr, "    %s (thread %lu) - waits on %s for %llu ms, holds%s\n", owner,
+                stallWatch->threadId, waitPrimitive, now - stallWatch->waitStartTime,
+                length ? heldLocks : " nothing");
+        }
+        else
+        {
+            fprintf(stderr, "    %s (thread %lu) - runs, holds%s\n", owner, stallWatch->threadId, heldLocks);
+        }
+    }
+}
+
+void getStallOwner(char owner[], StallWatch* stallWatch)
+{
+    if (stallWatch->ownerId == 0)
+    {
+        snprintf(owner, MAX_STALL_OWNER, "%s", stallWatch->ownerName);
+    }
+    else
+    {
+        snprintf(owner, MAX_STALL_OWNER, "%s %d", stallWatch->ownerName, stallWatch->ownerId);
+    }
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef STALL_DETECTOR_H
+#define STALL_DETECTOR_H
+
+#include <windows.h>
+
+#include "ParkingLot.h"
+
+#define MAX_STALL_HELD_LOCKS 4 // Most locks a thread is shown to hold at once.
+#define STALL_DETECTOR_CHECKS 4 // The watchdog checks the waits this many times per threshold.
+#define MAX_STALL_OWNER 64 // Size of the largest owner's name with its ID.
+
+// A watched thread: who it is, what it waits on since when, and which locks it holds.
+// Only its thread writes it, the watchdog reads it without a lock, so a snapshot may be
+// a moment out of date.
+typedef struct {
+    volatile LONG isInUse;
+    DWORD threadId;
+    const char* ownerName; // Vessel, Crane, ...
+    int ownerId; // The vessel's or crane's ID, 0 for a thread of which there's one.
+    const char* volatile waitPrimitive; // NULL while the thread doesn't wait.
+    volatile ULONGLONG waitStartTime;
+    ULONGLONG reportedWaitStartTime; // The watchdog reports each stalled wait once.
+    const char* volatile heldLocks[MAX_STALL_HELD_LOCKS];
+} StallWatch;
+
+// The ports watch their threads only when built with PORT_STALL_DETECTOR defined, or with
+// PORT_LOCK_PROFILER, whose wrappers watch every wait they profile. Otherwise every call below
+// compiles to nothing and the primitives' wrappers are the plain Win32 calls.
+#if defined(PORT_LOCK_PROFILER) && !defined(PORT_STALL_DETECTOR)
+#define PORT_STALL_DETECTOR
+#endif
+
+#ifdef PORT_STALL_DETECTOR
+// Starts the watchdog, which reports every wait longer than threshold miliseconds with a
+// snapshot of what every watched thread waits on and holds. maxNumberOfThreads bounds the
+// threads watched at once, a thread which starts while every watch is taken runs unwatched.
+// Without a started watchdog the watched calls cost a check. Returns FALSE if it couldn't be started.
+int startStallDetector(const char* portName, int maxNumberOfThreads, DWORD threshold);
+// Stops the watchdog and prints the number of stalls it reported.
+void stopStallDetector(void);
+// Watches the calling thread's waits till it ends them with unwatchStallThread.
+void watchStallThread(const char* ownerName, int ownerId);
+void unwatchStallThread(void);
+
+// Marks the calling thread as waiting on a primitive which isn't waited on by the calls
+// below, as a pipe, till it ends the wait.
+void beginStallWait(const char* primitiveName);
+void endStallWait(void);
+
+// The Win32 and wait word calls, watched. A lock is shown held by the thread which took it
+// till it releases it, other primitives are signals which aren't held.
+DWORD waitForWatchedObject(const char* primitiveName, int isLock, HANDLE handle, DWORD timeout);
+BOOL releaseWatchedMutex(const char* primitiveName, HANDLE mutex);
+BOOL releaseWatchedSemaphore(const char* primitiveName, int isLock, HANDLE semaphore, LONG releaseCount);
+void waitForWatchedWord(const char* primitiveName, WaitWord* waitWord);
+#else
+#define startStallDetector(portName, maxNumberOfThreads, threshold) FALSE
+#define stopStallDetector()
+#define watchStallThread(ownerName, ownerId)
+#define unwatchStallThread()
+#define beginStallWait(primitiveName)
+#define endStallWait()
+#endif
+
+#endif
@@ -0,0 +1,193 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "StorageYard.h"
+#include "StallDetector.h"
+
+DWORD WINAPI StorageYardWorker(LPVOID Param);
+void changeStorageYardStock(StorageYard* yard, int tons);
+
+StorageYard* openStorageYard(int capacity, StorageYardWorkers workers[])
+{
+    StorageYard* yard = (StorageYard*)calloc(1, sizeof(StorageYard));
+
+    if (yard == NULL)
+    {
+        fprintf(stderr, "StorageYard::openStorageYard::Unexpected Error - Memory allocation failed!\n");
+        return NULL;
+    }
+
+    yard->capacity = capacity;
+    yard->openTime = GetTickCount64();
+    yard->lastStockChangeTime = yard->openTime;
+    InitializeSRWLock(&yard->lock);
+    InitializeConditionVariable(&yard->spaceCondition);
+    InitializeConditionVariable(&yard->stockCondition);
+
+    for (int i = 0; i < STORAGE_YARD_WORKER_KINDS; i++)
+    {
+        yard->workers[i] = workers[i];
+    }
+
+    // Trucks are created first, so the first workers to start take the trucks' kind.
+    for (int i = 0; i < STORAGE_YARD_WORKER_KINDS; i++)
+    {
+        for (int j = 0; j < workers[i].numberOfWorkers; j++)
+        {
+            HANDLE workerHandle = CreateThread(NULL, 0, StorageYardWorker, yard, 0, NULL);
+
+            if (workerHandle == NULL)
+            {
+                fprintf(stderr, "StorageYard::openStorageYard::Unexpected Error - "
+                    "Worker thread creation failed!\n");
+                drainStorageYard(yard);
+                closeStorageYard(yard);
+                return NULL;
+            }
+
+            yard->workerHandles[yard->numberOfWorkerHandles++] = workerHandle;
+        }
+    }
+
+    return yard;
+}
+
+void drainStorageYard(StorageYard* yard)
+{
+    // The workers drain whatever is left before they exit.
+    AcquireSRWLockExclusive(&yard->lock);
+    yard->isClosing = TRUE;
+    ReleaseSRWLockExclusive(&yard->lock);
+
+    WakeAllConditionVariable(&yard->stockCondition);
+    WaitForMultipleObjects(yard->numberOfWorkerHandles, yard->workerHandles, TRUE, INFINITE);
+}
+
+void closeStorageYard(StorageYard* yard)
+{
+    for (int i = 0; i < yard->numberOfWorkerHandles; i++)
+    {
+        CloseHandle(yard->workerHandles[i]);
+    }
+
+    free(yard);
+}
+
+void depositToStorageYard(StorageYard* yard, int tons)
+{
+    ULONGLONG blockStartTime = 0;
+    int isBlocked = FALSE;
+
+    AcquireSRWLockExclusive(&yard->lock);
+    yard->numberOfDeposits++;
+
+    while (tons > 0)
+    {
+        int room = yard->capacity - yard->stock;
+
+        // A full yard holds the crane, and so the vessel at its station, till a worker takes a load.
+        if (room <= 0)
+        {
+            if (!isBlocked)
+            {
+                isBlocked = TRUE;
+                blockStartTime = GetTickCount64();
+                yard->numberOfBlockedDeposits++;
+            }
+
+            beginStallWait("storageYardSpace");
+            SleepConditionVariableSRW(&yard->spaceCondition, &yard->lock, INFINITE, 0);
+            endStallWait();
+            continue;
+        }
+
+        int part = tons < room ? tons : room;
+
+        changeStorageYardStock(yard, part);
+        yard->numberOfDepositedTons += part;
+        tons -= part;
+        WakeAllConditionVariable(&yard->stockCondition);
+    }
+
+    if (isBlocked)
+    {
+        ULONGLONG blockedTime = GetTickCount64() - blockStartTime;
+
+        yard->blockedTime += blockedTime;
+        yard->maxBlockedTime = blockedTime > yard->maxBlockedTime ? blockedTime : yard->maxBlockedTime;
+    }
+
+    ReleaseSRWLockExclusive(&yard->lock);
+}
+
+int parseStorageYardWorkers(StorageYardWorkers* workers, const char* value)
+{
+    int numberOfWorkers, tonsPerSecond;
+
+    if (sscanf(value, "%d:%d", &numberOfWorkers, &tonsPerSecond) != 2 || numberOfWorkers < 0 ||
+        numberOfWorkers > STORAGE_YARD_MAX_WORKERS || tonsPerSecond < 1)
+    {
+        return FALSE;
+    }
+
+    workers->numberOfWorkers = numberOfWorkers;
+    workers->tonsPerSecond = tonsPerSecond;
+
+    return TRUE;
+}
+
+double getStorageYardAverageFill(StorageYard* yard)
+{
+    ULONGLONG openedTime = yard->lastStockChangeTime - yard->openTime;
+
+    return openedTime == 0 ? 0.0 : (double)yard->stockTime / ((double)yard->capacity * openedTime);
+}
+
+void changeStorageYardStock(StorageYard* yard, int tons)
+{
+    // Called with the yard's lock held.
+    ULONGLONG now = GetTickCount64();
+
+    yard->stockTime += (ULONGLONG)yard->stock * (now - yard->lastStockChangeTime);
+    yard->lastStockChangeTime = now;
+    yard->stock += tons;
+    yard->peakStock = yard->stock > yard->peakStock ? yard->stock : yard->peakStock;
+}
+
+DWORD WINAPI StorageYardWorker(LPVOID Param)
+{
+    StorageYard* yard = (StorageYard*)Param;
+    LONG index = InterlockedIncrement(&yard->numberOfStartedWorkers) - 1;
+    int kind = index < yard->workers[STORAGE_YARD_TRUCK].numberOfWorkers ? STORAGE_YARD_TRUCK : STORAGE_YARD_RAIL;
+    int loadSize = yard->workers[kind].tonsPerSecond;
+
+    for (;;)
+    {
+        AcquireSRWLockExclusive(&yard->lock);
+
+        while (yard->stock == 0 && !yard->isClosing)
+        {
+            SleepConditionVariableSRW(&yard->stockCondition, &yard->lock, INFINITE, 0);
+        }
+
+        if (yard->stock == 0)
+        {
+            ReleaseSRWLockExclusive(&yard->lock);
+            break;
+        }
+
+        int load = yard->stock < loadSize ? yard->stock : loadSize;
+
+        changeStorageYardStock(yard, -load);
+        yard->numberOfDrainedTons[kind] += load;
+        ReleaseSRWLockExclusive(&yard->lock);
+
+        // The load's room is free once it is taken, hauling it away takes the rest of the time.
+        WakeAllConditionVariable(&yard->spaceCondition);
+        Sleep(STORAGE_YARD_HAUL_TIME);
+    }
+
+    return 0;
+}
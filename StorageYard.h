@@ -0,0 +1,65 @@
+#ifndef STORAGE_YARD_H
+#define STORAGE_YARD_H
+
+#include <windows.h>
+
+// Kinds of the workers which drain the yard, each kind with its own number of workers and rate.
+#define STORAGE_YARD_TRUCK 0
+#define STORAGE_YARD_RAIL 1
+#define STORAGE_YARD_WORKER_KINDS 2
+
+#define STORAGE_YARD_MAX_WORKERS 16 // Most workers of a kind.
+#define STORAGE_YARD_HAUL_TIME 1000 // A worker hauls a load a second, of as many tons as its rate.
+
+#define STORAGE_YARD_DEFAULT_TRUCKS 2
+#define STORAGE_YARD_DEFAULT_TRUCK_RATE 10 // Tons a truck hauls a second.
+#define STORAGE_YARD_DEFAULT_TRAINS 1
+#define STORAGE_YARD_DEFAULT_TRAIN_RATE 30 // Tons a train hauls a second.
+
+// A kind of worker, as set by its -trucks or -rail option.
+typedef struct {
+    int numberOfWorkers;
+    int tonsPerSecond;
+} StorageYardWorkers;
+
+// Cargo unloaded in EilatPort which waits to be hauled away, in tons. Cranes deposit their
+// cargo and wait while the yard is full, workers take a load at a time and wait while it is
+// empty. Times are in miliseconds.
+typedef struct {
+    int capacity;
+    int stock;
+    int peakStock;
+    StorageYardWorkers workers[STORAGE_YARD_WORKER_KINDS];
+    SRWLOCK lock;
+    CONDITION_VARIABLE spaceCondition; // Woken once a worker has taken a load.
+    CONDITION_VARIABLE stockCondition; // Woken once a crane has deposited cargo.
+    int isClosing;
+    HANDLE workerHandles[STORAGE_YARD_WORKER_KINDS * STORAGE_YARD_MAX_WORKERS];
+    int numberOfWorkerHandles;
+    volatile LONG numberOfStartedWorkers; // A worker's kind is by the order it started in.
+    // Statistics for the report.
+    LONGLONG numberOfDepositedTons;
+    LONGLONG numberOfDrainedTons[STORAGE_YARD_WORKER_KINDS];
+    int numberOfDeposits;
+    int numberOfBlockedDeposits;
+    ULONGLONG blockedTime;
+    ULONGLONG maxBlockedTime;
+    ULONGLONG stockTime; // Stock in tons multiplied by the miliseconds it was held.
+    ULONGLONG lastStockChangeTime;
+    ULONGLONG openTime;
+} StorageYard;
+
+// Opens a yard of the given capacity and starts its workers. Returns NULL on failure.
+StorageYard* openStorageYard(int capacity, StorageYardWorkers workers[]);
+// Waits till the workers have drained the yard, then stops them. No cargo may be deposited after.
+void drainStorageYard(StorageYard* yard);
+void closeStorageYard(StorageYard* yard);
+// Deposits the cargo, waiting for room whenever the yard is full. A cargo heavier than
+// the yard's capacity is deposited a part at a time.
+void depositToStorageYard(StorageYard* yard, int tons);
+// Parses "<workers>:<tons per second>" of a -trucks or -rail option. Returns FALSE if invalid.
+int parseStorageYardWorkers(StorageYardWorkers* workers, const char* value);
+// Returns the yard's average fill, as a share of its capacity, since it was opened.
+double getStorageYardAverageFill(StorageYard* yard);
+
+#endif
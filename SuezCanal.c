@@ -0,0 +1,475 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SuezCanal.h"
+#include "LockProfiler.h"
+
+// Names of the canal's objects, shared between HaifaPort and EilatPort, suffixed with the run id.
+#define SUEZ_CANAL_STATE_NAME L"SuezCanalState"
+#define SUEZ_CANAL_MUTEX_NAME L"SuezCanalMutex"
+#define SUEZ_CANAL_MED_TO_RED_NAME L"SuezCanalMedToRed"
+#define SUEZ_CANAL_RED_TO_MED_NAME L"SuezCanalRedToMed"
+#define SUEZ_CANAL_REQUEST_NAME L"SuezCanalRequest"
+
+#define SUEZ_CANAL_MAX_ADMISSIONS 0x7FFFFFFF
+
+const char* suezCanalPolicyNames[] = { "cycle", "queue", "wait" };
+
+// Contention of the canal's primitives in this process, by the port's names for them.
+LockProfile suezCanalMutexProfile = LOCK_PROFILE("SuezCanalMutex");
+LockProfile suezCanalDirectionProfiles[SUEZ_CANAL_DIRECTIONS] = {
+    SIGNAL_PROFILE("medToRedCanalSemaphore"), SIGNAL_PROFILE("redToMedCanalSemaphore") };
+
+// Names of the canal's objects within a run's namespace.
+typedef struct {
+    WCHAR state[MAX_RUN_OBJECT_NAME];
+    WCHAR mutex[MAX_RUN_OBJECT_NAME];
+    WCHAR directions[SUEZ_CANAL_DIRECTIONS][MAX_RUN_OBJECT_NAME];
+    WCHAR request[MAX_RUN_OBJECT_NAME];
+} SuezCanalNames;
+
+void getSuezCanalNames(SuezCanalNames* names, const char* runId);
+// Makes room in the heap for the given number of arrival times. Returns FALSE if it couldn't grow.
+int growSuezCanalWaitHeap(SuezCanalWaitHeap* heap, int size);
+void pushSuezCanalWaitHeap(SuezCanalWaitHeap* heap, ULONGLONG arrivalTime);
+// Removes the heap's oldest arrival time.
+void popSuezCanalWaitHeap(SuezCanalWaitHeap* heap);
+// Sets the direction's oldest arrival time in the state from the process's wait heaps.
+void updateSuezCanalOldestArrival(SuezCanal* canal, int direction);
+int shouldSwitchSuezCanal(SuezCanalState* state, ULONGLONG now);
+void dispatchSuezCanal(SuezCanal* canal);
+
+void getSuezCanalNames(SuezCanalNames* names, const char* runId)
+{
+    getRunObjectName(names->state, SUEZ_CANAL_STATE_NAME, runId);
+    getRunObjectName(names->mutex, SUEZ_CANAL_MUTEX_NAME, runId);
+    getRunObjectName(names->directions[SUEZ_CANAL_MED_TO_RED], SUEZ_CANAL_MED_TO_RED_NAME, runId);
+    getRunObjectName(names->directions[SUEZ_CANAL_RED_TO_MED], SUEZ_CANAL_RED_TO_MED_NAME, runId);
+    getRunObjectName(names->request, SUEZ_CANAL_REQUEST_NAME, runId);
+}
+
+int growSuezCanalWaitHeap(SuezCanalWaitHeap* heap, int size)
+{
+    if (size <= heap->capacity)
+    {
+        return TRUE;
+    }
+
+    int capacity = heap->capacity == 0 ? SUEZ_CANAL_WAIT_HEAP_CAPACITY : 2 * heap->capacity;
+    ULONGLONG* arrivalTimes = (ULONGLONG*)realloc(heap->arrivalTimes, capacity * sizeof(ULONGLONG));
+
+    if (arrivalTimes == NULL)
+    {
+        return FALSE;
+    }
+
+    heap->arrivalTimes = arrivalTimes;
+    heap->capacity = capacity;
+
+    return TRUE;
+}
+
+void pushSuezCanalWaitHeap(SuezCanalWaitHeap* heap, ULONGLONG arrivalTime)
+{
+    int i = heap->size++;
+
+    // Sift the arrival time up past the later ones.
+    while (i > 0 && heap->arrivalTimes[(i - 1) / 2] > arrivalTime)
+    {
+        heap->arrivalTimes[i] = heap->arrivalTimes[(i - 1) / 2];
+        i = (i - 1) / 2;
+    }
+
+    heap->arrivalTimes[i] = arrivalTime;
+}
+
+void popSuezCanalWaitHeap(SuezCanalWaitHeap* heap)
+{
+    ULONGLONG lastArrivalTime = heap->arrivalTimes[--heap->size];
+    int i = 0;
+
+    // Sift the last arrival time down from the root past the earlier ones.
+    while (2 * i + 1 < heap->size)
+    {
+        int child = 2 * i + 1;
+
+        if (child + 1 < heap->size && heap->arrivalTimes[child + 1] < heap->arrivalTimes[child])
+        {
+            child++;
+        }
+
+        if (heap->arrivalTimes[child] >= lastArrivalTime)
+        {
+            break;
+        }
+
+        heap->arrivalTimes[i] = heap->arrivalTimes[child];
+        i = child;
+    }
+
+    if (heap->size > 0)
+    {
+        heap->arrivalTimes[i] = lastArrivalTime;
+    }
+}
+
+void updateSuezCanalOldestArrival(SuezCanal* canal, int direction)
+{
+    SuezCanalWaitHeap* waiting = &canal->waitingArrivalTimes[direction];
+    SuezCanalWaitHeap* entered = &canal->enteredArrivalTimes[direction];
+
+    // Comment: every entered arrival time is also a waiting one, so the waiting heap isn't empty
+    // while the entered one isn't.
+    while (entered->size > 0 && entered->arrivalTimes[0] == waiting->arrivalTimes[0])
+    {
+        popSuezCanalWaitHeap(entered);
+        popSuezCanalWaitHeap(waiting);
+    }
+
+    canal->state->oldestArrivalTime[direction] = waiting->size > 0 ? waiting->arrivalTimes[0] : 0;
+}
+
+SuezCanal* createSuezCanal(const char* runId, int policy, int policyParameter, int convoySize)
+{
+    SuezCanal* canal = (SuezCanal*)calloc(1, sizeof(SuezCanal));
+    SuezCanalNames names;
+
+    if (canal == NULL)
+    {
+        return NULL;
+    }
+
+    getSuezCanalNames(&names, runId);
+
+    canal->mappingHandle = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0,
+        sizeof(SuezCanalState), names.state);
+    canal->state = (canal->mappingHandle == NULL) ? NULL :
+        (SuezCanalState*)MapViewOfFile(canal->mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SuezCanalState));
+    canal->mutex = CreateMutex(NULL, FALSE, names.mutex);
+    canal->directionSemaphores[SUEZ_CANAL_MED_TO_RED] = CreateSemaphore(NULL, 0,
+        SUEZ_CANAL_MAX_ADMISSIONS, names.directions[SUEZ_CANAL_MED_TO_RED]);
+    canal->directionSemaphores[SUEZ_CANAL_RED_TO_MED] = CreateSemaphore(NULL, 0,
+        SUEZ_CANAL_MAX_ADMISSIONS, names.directions[SUEZ_CANAL_RED_TO_MED]);
+    canal->requestEvent = CreateEvent(NULL, FALSE, FALSE, names.request);
+
+    if (canal->state == NULL || canal->mutex == NULL || canal->requestEvent == NULL ||
+        canal->directionSemaphores[SUEZ_CANAL_MED_TO_RED] == NULL ||
+        canal->directionSemaphores[SUEZ_CANAL_RED_TO_MED] == NULL)
+    {
+        closeSuezCanal(canal);
+        return NULL;
+    }
+
+    // A new mapping is zero filled, so only the settings are set.
+    canal->state->policy = policy;
+    canal->state->policyParameter = policyParameter;
+    canal->state->convoySize = convoySize;
+    canal->state->directionStartTime = GetTickCount64();
+
+    return canal;
+}
+
+SuezCanal* openSuezCanal(const char* runId)
+{
+    SuezCanal* canal = (SuezCanal*)calloc(1, sizeof(SuezCanal));
+    SuezCanalNames names;
+
+    if (canal == NULL)
+    {
+        return NULL;
+    }
+
+    getSuezCanalNames(&names, runId);
+
+    canal->mappingHandle = OpenFileMapping(FILE_MAP_ALL_ACCESS, FALSE, names.state);
+    canal->state = (canal->mappingHandle == NULL) ? NULL :
+        (SuezCanalState*)MapViewOfFile(canal->mappingHandle, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SuezCanalState));
+    canal->mutex = OpenMutex(MUTEX_ALL_ACCESS, FALSE, names.mutex);
+    canal->directionSemaphores[SUEZ_CANAL_MED_TO_RED] = OpenSemaphore(SEMAPHORE_ALL_ACCESS, FALSE,
+        names.directions[SUEZ_CANAL_MED_TO_RED]);
+    canal->directionSemaphores[SUEZ_CANAL_RED_TO_MED] = OpenSemaphore(SEMAPHORE_ALL_ACCESS, FALSE,
+        names.directions[SUEZ_CANAL_RED_TO_MED]);
+    canal->requestEvent = OpenEvent(EVENT_ALL_ACCESS, FALSE, names.request);
+
+    if (canal->state == NULL || canal->mutex == NULL || canal->requestEvent == NULL ||
+        canal->directionSemaphores[SUEZ_CANAL_MED_TO_RED] == NULL ||
+        canal->directionSemaphores[SUEZ_CANAL_RED_TO_MED] == NULL)
+    {
+        closeSuezCanal(canal);
+        return NULL;
+    }
+
+    return canal;
+}
+
+void closeSuezCanal(SuezCanal* canal)
+{
+    if (canal->state != NULL)
+    {
+        UnmapViewOfFile(canal->state);
+    }
+
+    HANDLE handles[] = { canal->mappingHandle, canal->mutex, canal->requestEvent,
+        canal->directionSemaphores[SUEZ_CANAL_MED_TO_RED], canal->directionSemaphores[SUEZ_CANAL_RED_TO_MED] };
+
+    for (int i = 0; i < sizeof(handles) / sizeof(HANDLE); i++)
+    {
+        if (handles[i] != NULL)
+        {
+            CloseHandle(handles[i]);
+        }
+    }
+
+    for (int i = 0; i < SUEZ_CANAL_DIRECTIONS; i++)
+    {
+        free(canal->waitingArrivalTimes[i].arrivalTimes);
+        free(canal->enteredArrivalTimes[i].arrivalTimes);
+    }
+
+    free(canal);
+}
+
+void enterSuezCanal(SuezCanal* canal, int direction)
+{
+    SuezCanalState* state = canal->state;
+    SuezCanalWaitHeap* waiting = &canal->waitingArrivalTimes[direction];
+    SuezCanalWaitHeap* entered = &canal->enteredArrivalTimes[direction];
+    ULONGLONG arrivalTime = GetTickCount64();
+
+    waitForProfiledObject(&suezCanalMutexProfile, canal->mutex, INFINITE);
+
+    if (state->firstArrivalTime == 0)
+    {
+        state->firstArrivalTime = arrivalTime;
+    }
+
+    // Comment: the entered heap has room for every waiting vessel, so the vessel's arrival time
+    // is never left behind when it enters. Were there no room, the vessel would wait without it
+    // and not be taken as the oldest.
+    int isArrivalKept = growSuezCanalWaitHeap(entered, waiting->size + 1) &&
+        growSuezCanalWaitHeap(waiting, waiting->size + 1);
+
+    if (isArrivalKept)
+    {
+        pushSuezCanalWaitHeap(waiting, arrivalTime);
+        updateSuezCanalOldestArrival(canal, direction);
+    }
+
+    state->numberOfArrivedVessels[direction]++;
+    state->numberOfWaitingVessels[direction]++;
+
+    releaseProfiledMutex(&suezCanalMutexProfile, canal->mutex);
+    SetEvent(canal->requestEvent);
+
+    // Wait for the controller to admit the vessel in a convoy.
+    waitForProfiledObject(&suezCanalDirectionProfiles[direction], canal->directionSemaphores[direction],
+        INFINITE);
+
+    ULONGLONG waitTime = GetTickCount64() - arrivalTime;
+
+    waitForProfiledObject(&suezCanalMutexProfile, canal->mutex, INFINITE);
+
+    if (isArrivalKept)
+    {
+        pushSuezCanalWaitHeap(entered, arrivalTime);
+        updateSuezCanalOldestArrival(canal, direction);
+    }
+
+    state->totalWaitTime += waitTime;
+
+    if (waitTime > state->maxWaitTime)
+    {
+        state->maxWaitTime = waitTime;
+    }
+
+    releaseProfiledMutex(&suezCanalMutexProfile, canal->mutex);
+}
+
+void exitSuezCanal(SuezCanal* canal, int direction)
+{
+    SuezCanalState* state = canal->state;
+
+    waitForProfiledObject(&suezCanalMutexProfile, canal->mutex, INFINITE);
+
+    // Comment: after a restart a recovered vessel may exit a second time, so the lane
+    // is never taken to hold less than no vessels.
+    if (state->numberOfVesselsInLane > 0)
+    {
+        state->numberOfVesselsInLane--;
+    }
+
+    state->numberOfTransits[direction]++;
+    state->lastTransitTime = GetTickCount64();
+
+    releaseProfiledMutex(&suezCanalMutexProfile, canal->mutex);
+    SetEvent(canal->requestEvent);
+}
+
+void resetSuezCanalDirection(SuezCanal* canal, int direction, int numberOfVesselsInLane)
+{
+    SuezCanalState* state = canal->state;
+
+    waitForProfiledObject(&suezCanalMutexProfile, canal->mutex, INFINITE);
+
+    // Take back admissions the stopped vessels didn't use.
+    while (waitForProfiledObject(&suezCanalDirectionProfiles[direction],
+        canal->directionSemaphores[direction], 0) == WAIT_OBJECT_0)
+    {
+    }
+
+    state->numberOfWaitingVessels[direction] = 0;
+    state->numberOfAdmittedVessels[direction] = state->numberOfArrivedVessels[direction];
+    // Comment: the stopped process's vessels waited in the direction, their arrival times went with it.
+    state->oldestArrivalTime[direction] = 0;
+
+    if (state->direction == direction)
+    {
+        state->numberOfVesselsInLane = numberOfVesselsInLane;
+    }
+
+    releaseProfiledMutex(&suezCanalMutexProfile, canal->mutex);
+    SetEvent(canal->requestEvent);
+}
+
+int getSuezCanalPolicy(const char* name)
+{
+    for (int i = 0; i < sizeof(suezCanalPolicyNames) / sizeof(suezCanalPolicyNames[0]); i++)
+    {
+        if (strcmp(name, suezCanalPolicyNames[i]) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+const char* getSuezCanalPolicyName(int policy)
+{
+    return suezCanalPolicyNames[policy];
+}
+
+int getSuezCanalDefaultParameter(int policy)
+{
+    switch (policy)
+    {
+    case SUEZ_CANAL_FIXED_CYCLE:
+        return SUEZ_CANAL_DEFAULT_CYCLE;
+    case SUEZ_CANAL_QUEUE_LENGTH:
+        return SUEZ_CANAL_DEFAULT_QUEUE_LENGTH;
+    default:
+        return SUEZ_CANAL_DEFAULT_MAX_WAIT;
+    }
+}
+
+int shouldSwitchSuezCanal(SuezCanalState* state, ULONGLONG now)
+{
+    int otherDirection = 1 - state->direction;
+
+    if (state->numberOfWaitingVessels[otherDirection] == 0)
+    {
+        return FALSE;
+    }
+
+    if (state->numberOfWaitingVessels[state->direction] == 0)
+    {
+        return TRUE;
+    }
+
+    switch (state->policy)
+    {
+    case SUEZ_CANAL_FIXED_CYCLE:
+        return now - state->directionStartTime >= (ULONGLONG)state->policyParameter;
+    case SUEZ_CANAL_QUEUE_LENGTH:
+        return state->numberOfWaitingVessels[otherDirection] >= state->policyParameter;
+    default:
+    {
+        // A semaphore may release its waiters in any order, so the oldest one is kept by the wait heaps.
+        ULONGLONG oldestArrivalTime = state->oldestArrivalTime[otherDirection];
+
+        return oldestArrivalTime != 0 && now - oldestArrivalTime >= (ULONGLONG)state->policyParameter;
+    }
+    }
+}
+
+void dispatchSuezCanal(SuezCanal* canal)
+{
+    SuezCanalState* state = canal->state;
+    ULONGLONG now = GetTickCount64();
+
+    if (!state->isSwitching && shouldSwitchSuezCanal(state, now))
+    {
+        state->isSwitching = TRUE;
+    }
+
+    // The lane only switches once the last convoy has cleared it.
+    if (state->numberOfVesselsInLane > 0)
+    {
+        return;
+    }
+
+    if (state->isSwitching)
+    {
+        state->direction = 1 - state->direction;
+        state->directionStartTime = now;
+        state->isSwitching = FALSE;
+        state->numberOfSwitches++;
+    }
+
+    int convoySize = state->numberOfWaitingVessels[state->direction];
+
+    if (convoySize == 0)
+    {
+        return;
+    }
+
+    if (convoySize > state->convoySize)
+    {
+        convoySize = state->convoySize;
+    }
+
+    state->numberOfWaitingVessels[state->direction] -= convoySize;
+    state->numberOfAdmittedVessels[state->direction] += convoySize;
+    state->numberOfVesselsInLane = convoySize;
+    state->numberOfConvoys++;
+
+    releaseProfiledSemaphore(&suezCanalDirectionProfiles[state->direction],
+        canal->directionSemaphores[state->direction], convoySize);
+}
+
+void stopSuezCanalController(SuezCanal* canal, HANDLE controllerHandle)
+{
+    waitForProfiledObject(&suezCanalMutexProfile, canal->mutex, INFINITE);
+    canal->state->isClosing = TRUE;
+    releaseProfiledMutex(&suezCanalMutexProfile, canal->mutex);
+
+    SetEvent(canal->requestEvent);
+    WaitForSingleObject(controllerHandle, INFINITE);
+}
+
+DWORD WINAPI SuezCanalController(LPVOID Param)
+{
+    SuezCanal* canal = (SuezCanal*)Param;
+    int isClosing = FALSE;
+
+    watchStallThread("SuezCanalController", 0);
+
+    while (!isClosing)
+    {
+        // Vessels signal when they wait or leave the lane, the timeout serves the time based policies.
+        WaitForSingleObject(canal->requestEvent, SUEZ_CANAL_CONTROLLER_INTERVAL);
+        waitForProfiledObject(&suezCanalMutexProfile, canal->mutex, INFINITE);
+
+        dispatchSuezCanal(canal);
+        isClosing = canal->state->isClosing;
+
+        releaseProfiledMutex(&suezCanalMutexProfile, canal->mutex);
+    }
+
+    unwatchStallThread();
+
+    return 0;
+}
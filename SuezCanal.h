@@ -0,0 +1,97 @@
+#ifndef SUEZ_CANAL_H
+#define SUEZ_CANAL_H
+
+#include <windows.h>
+
+#include "RunNamespace.h"
+
+// Directions of the canal's single lane.
+#define SUEZ_CANAL_MED_TO_RED 0
+#define SUEZ_CANAL_RED_TO_MED 1
+#define SUEZ_CANAL_DIRECTIONS 2
+
+// Policies by which the controller switches the lane's direction. Whatever the policy,
+// the lane is switched when only the other direction has vessels waiting.
+#define SUEZ_CANAL_FIXED_CYCLE 0 // Switch once the direction has been open for policyParameter miliseconds.
+#define SUEZ_CANAL_QUEUE_LENGTH 1 // Switch once policyParameter vessels wait in the other direction.
+#define SUEZ_CANAL_MAX_WAIT 2 // Switch once a vessel has waited policyParameter miliseconds in the other direction.
+
+#define SUEZ_CANAL_DEFAULT_POLICY SUEZ_CANAL_MAX_WAIT
+#define SUEZ_CANAL_DEFAULT_CYCLE 6000
+#define SUEZ_CANAL_DEFAULT_QUEUE_LENGTH 3
+#define SUEZ_CANAL_DEFAULT_MAX_WAIT 5000
+#define SUEZ_CANAL_DEFAULT_CONVOY_SIZE 5 // Most vessels which enter the lane together.
+
+#define SUEZ_CANAL_CONTROLLER_INTERVAL 100 // The controller checks time based policies every 100 miliseconds.
+#define SUEZ_CANAL_WAIT_HEAP_CAPACITY 64 // Arrival times a wait heap holds at first, it doubles as it fills.
+
+// State of the canal, shared between HaifaPort and EilatPort in a named file mapping
+// and protected by the canal's named mutex.
+typedef struct {
+    int policy;
+    int policyParameter;
+    int convoySize;
+    int isClosing;
+    int direction;
+    int isSwitching; // No convoy enters till the lane is clear and its direction switched.
+    int numberOfVesselsInLane;
+    int numberOfWaitingVessels[SUEZ_CANAL_DIRECTIONS];
+    LONGLONG numberOfArrivedVessels[SUEZ_CANAL_DIRECTIONS];
+    LONGLONG numberOfAdmittedVessels[SUEZ_CANAL_DIRECTIONS];
+    // Arrival time of the oldest vessel which waits to enter in each direction, 0 while none does.
+    // It is set by the process whose vessels wait in the direction, from its wait heaps.
+    ULONGLONG oldestArrivalTime[SUEZ_CANAL_DIRECTIONS];
+    ULONGLONG directionStartTime;
+    // Statistics for the report.
+    ULONGLONG firstArrivalTime;
+    ULONGLONG lastTransitTime;
+    int numberOfTransits[SUEZ_CANAL_DIRECTIONS];
+    int numberOfConvoys;
+    int numberOfSwitches;
+    LONGLONG totalWaitTime;
+    ULONGLONG maxWaitTime;
+} SuezCanalState;
+
+// Arrival times of a process's vessels, a binary min-heap whose root is the oldest. It grows
+// as more of them wait at once.
+typedef struct {
+    ULONGLONG* arrivalTimes;
+    int size;
+    int capacity;
+} SuezCanalWaitHeap;
+
+// Handles of a process to the canal. HaifaPort creates the canal and runs its controller,
+// EilatPort opens it. The controller admits a convoy of waiting vessels by releasing their
+// direction's semaphore as many times.
+typedef struct {
+    HANDLE mappingHandle;
+    SuezCanalState* state;
+    HANDLE mutex;
+    HANDLE directionSemaphores[SUEZ_CANAL_DIRECTIONS];
+    HANDLE requestEvent; // Signaled whenever the controller should reconsider the lane.
+    // Only one process's vessels wait in each direction, so a vessel's arrival time is kept in its
+    // own process, in a heap of the waiting vessels and one of those which entered before they
+    // were the oldest. Such a vessel is only taken out of the waiting once it would be the oldest.
+    SuezCanalWaitHeap waitingArrivalTimes[SUEZ_CANAL_DIRECTIONS];
+    SuezCanalWaitHeap enteredArrivalTimes[SUEZ_CANAL_DIRECTIONS];
+} SuezCanal;
+
+// Returns NULL on failure. The canal's objects are named within the run's namespace.
+SuezCanal* createSuezCanal(const char* runId, int policy, int policyParameter, int convoySize);
+SuezCanal* openSuezCanal(const char* runId);
+void closeSuezCanal(SuezCanal* canal);
+// Waits till the vessel enters the lane in a convoy of its direction.
+void enterSuezCanal(SuezCanal* canal, int direction);
+void exitSuezCanal(SuezCanal* canal, int direction);
+// After the process on the other end of the canal stopped, forget its vessels which wait to
+// enter in the direction and set how many vessels are still in the lane.
+void resetSuezCanalDirection(SuezCanal* canal, int direction, int numberOfVesselsInLane);
+// Returns the policy of the given name ("cycle", "queue" or "wait"), -1 if there is none.
+int getSuezCanalPolicy(const char* name);
+const char* getSuezCanalPolicyName(int policy);
+int getSuezCanalDefaultParameter(int policy);
+// Stops the controller thread, which runs SuezCanalController with the canal as parameter.
+void stopSuezCanalController(SuezCanal* canal, HANDLE controllerHandle);
+DWORD WINAPI SuezCanalController(LPVOID Param);
+
+#endif
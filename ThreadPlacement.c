@@ -0,0 +1,234 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ThreadPlacement.h"
+
+#define PLACEMENT_MASK_BITS ((int)sizeof(DWORD_PTR) * 8)
+
+const char* threadPlacementPolicyNames[] = { "none", "compact", "spread", "isolated" };
+
+int placementPolicy = PLACEMENT_NONE;
+int numberOfPlacementCoordinators = 1;
+int numberOfPlacementCranes = 0;
+// The port's cores, each by the mask of its logical processors the process may run on.
+DWORD_PTR placementCores[MAX_PLACEMENT_CORES];
+int numberOfPlacementCores = 0;
+// The port's logical processors in the order threads are pinned to them.
+DWORD_PTR placementProcessors[MAX_PLACEMENT_CORES];
+int numberOfPlacementProcessors = 0;
+double handOffTicksPerMicrosecond = 1.0;
+
+int findProcessCores(DWORD_PTR processMask, DWORD_PTR cores[]);
+DWORD_PTR getCoreProcessor(DWORD_PTR coreMask, int index);
+DWORD_PTR getThreadPlacementMask(int role, int index);
+
+int getThreadPlacementPolicy(const char* name)
+{
+    for (int i = 0; i < sizeof(threadPlacementPolicyNames) / sizeof(threadPlacementPolicyNames[0]); i++)
+    {
+        if (strcmp(name, threadPlacementPolicyNames[i]) == 0)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+const char* getThreadPlacementPolicyName(int policy)
+{
+    return threadPlacementPolicyNames[policy];
+}
+
+int initializeThreadPlacement(int policy, int port, int numberOfCoordinators, int numberOfCranes)
+{
+    DWORD_PTR processMask, systemMask;
+    DWORD_PTR cores[MAX_PLACEMENT_CORES];
+    LARGE_INTEGER frequency;
+
+    QueryPerformanceFrequency(&frequency);
+    handOffTicksPerMicrosecond = frequency.QuadPart / 1000000.0;
+
+    placementPolicy = policy;
+    numberOfPlacementCoordinators = numberOfCoordinators;
+    numberOfPlacementCranes = numberOfCranes;
+
+    if (policy == PLACEMENT_NONE)
+    {
+        return TRUE;
+    }
+
+    if (!GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+    {
+        fprintf(stderr, "initializeThreadPlacement::Unexpected Error - Reading the process's affinity failed!\n");
+        return FALSE;
+    }
+
+    int numberOfCores = findProcessCores(processMask, cores);
+    int numberOfEilatPortCores = numberOfCores / 2;
+
+    // Comment: a single core can't be split, so both ports are placed on it.
+    if (numberOfCores == 1)
+    {
+        placementCores[0] = cores[0];
+        numberOfPlacementCores = 1;
+    }
+    else
+    {
+        int firstCore = port == PLACEMENT_EILAT_PORT ? 0 : numberOfEilatPortCores;
+
+        numberOfPlacementCores = port == PLACEMENT_EILAT_PORT ? numberOfEilatPortCores :
+            numberOfCores - numberOfEilatPortCores;
+        memcpy(placementCores, cores + firstCore, numberOfPlacementCores * sizeof(DWORD_PTR));
+    }
+
+    // Compact takes every logical processor of a core before the next core, spread takes
+    // the first logical processor of every core before any core's second.
+    numberOfPlacementProcessors = 0;
+
+    for (int i = 0; i < PLACEMENT_MASK_BITS; i++)
+    {
+        for (int j = 0; j < PLACEMENT_MASK_BITS; j++)
+        {
+            int core = policy == PLACEMENT_SPREAD ? j : i;
+            DWORD_PTR processor = core < numberOfPlacementCores ?
+                getCoreProcessor(placementCores[core], policy == PLACEMENT_SPREAD ? i : j) : 0;
+
+            if (processor != 0)
+            {
+                placementProcessors[numberOfPlacementProcessors++] = processor;
+            }
+        }
+    }
+
+    return TRUE;
+}
+
+int findProcessCores(DWORD_PTR processMask, DWORD_PTR cores[])
+{
+    SYSTEM_LOGICAL_PROCESSOR_INFORMATION* information = NULL;
+    DWORD length = 0;
+    int numberOfCores = 0;
+
+    // The first call only returns the length of the information.
+    if (!GetLogicalProcessorInformation(NULL, &length) && GetLastError() == ERROR_INSUFFICIENT_BUFFER)
+    {
+        information = (SYSTEM_LOGICAL_PROCESSOR_INFORMATION*)malloc(length);
+    }
+
+    if (information != NULL && GetLogicalProcessorInformation(information, &length))
+    {
+        for (DWORD i = 0; i < length / sizeof(SYSTEM_LOGICAL_PROCESSOR_INFORMATION); i++)
+        {
+            DWORD_PTR coreMask = information[i].ProcessorMask & processMask;
+
+            if (information[i].Relationship == RelationProcessorCore && coreMask != 0 &&
+                numberOfCores < MAX_PLACEMENT_CORES)
+            {
+                cores[numberOfCores++] = coreMask;
+            }
+        }
+    }
+
+    free(information);
+
+    // Without the processors' information every logical processor is taken as a core.
+    if (numberOfCores == 0)
+    {
+        for (int i = 0; i < PLACEMENT_MASK_BITS; i++)
+        {
+            if (processMask & (DWORD_PTR)1 << i)
+            {
+                cores[numberOfCores++] = (DWORD_PTR)1 << i;
+            }
+        }
+    }
+
+    return numberOfCores;
+}
+
+DWORD_PTR getCoreProcessor(DWORD_PTR coreMask, int index)
+{
+    for (int i = 0; i < PLACEMENT_MASK_BITS; i++)
+    {
+        if (coreMask & (DWORD_PTR)1 << i && index-- == 0)
+        {
+            return (DWORD_PTR)1 << i;
+        }
+    }
+
+    return 0;
+}
+
+int placeThread(HANDLE thread, int role, int index)
+{
+    if (placementPolicy == PLACEMENT_NONE)
+    {
+        return TRUE;
+    }
+
+    return SetThreadAffinityMask(thread, getThreadPlacementMask(role, index)) != 0;
+}
+
+DWORD_PTR getThreadPlacementMask(int role, int index)
+{
+    DWORD_PTR portMask = 0;
+
+    for (int i = 0; i < numberOfPlacementCores; i++)
+    {
+        portMask |= placementCores[i];
+    }
+
+    // Coordinators take a core each from the first one on, though at least one core is left
+    // for the rest. Without another core they aren't isolated.
+    int numberOfCoordinatorCores = numberOfPlacementCoordinators < numberOfPlacementCores ?
+        numberOfPlacementCoordinators : numberOfPlacementCores - 1;
+    DWORD_PTR coordinatorsMask = 0;
+
+    for (int i = 0; placementPolicy == PLACEMENT_ISOLATED && i < numberOfCoordinatorCores; i++)
+    {
+        coordinatorsMask |= placementCores[i];
+    }
+
+    if (role == PLACEMENT_HELPER || (placementPolicy == PLACEMENT_ISOLATED && role != PLACEMENT_COORDINATOR))
+    {
+        return portMask & ~coordinatorsMask;
+    }
+
+    if (placementPolicy == PLACEMENT_ISOLATED)
+    {
+        return coordinatorsMask ? placementCores[index % numberOfCoordinatorCores] : portMask;
+    }
+
+    // The coordinators and the pipe's reader take the first processors, then the cranes and
+    // the vessels by their indexes.
+    int slot = role == PLACEMENT_COORDINATOR ? index : role == PLACEMENT_CANAL_IO ? numberOfPlacementCoordinators :
+        role == PLACEMENT_CRANE ? numberOfPlacementCoordinators + 1 + index :
+        numberOfPlacementCoordinators + 1 + numberOfPlacementCranes + index;
+
+    return placementProcessors[slot % numberOfPlacementProcessors];
+}
+
+int getNumberOfPlacementCores(void)
+{
+    return placementPolicy == PLACEMENT_NONE ? 0 : numberOfPlacementCores;
+}
+
+void stampHandOff(HandOffStamp* stamp)
+{
+    LARGE_INTEGER ticks;
+
+    QueryPerformanceCounter(&ticks);
+    *stamp = ticks.QuadPart;
+}
+
+void recordHandOff(LatencyHistogram* histogram, HandOffStamp* stamp)
+{
+    LARGE_INTEGER ticks;
+
+    QueryPerformanceCounter(&ticks);
+    recordLatency(histogram, (ULONGLONG)((ticks.QuadPart - *stamp) / handOffTicksPerMicrosecond));
+}
@@ -0,0 +1,49 @@
+#ifndef THREAD_PLACEMENT_H
+#define THREAD_PLACEMENT_H
+
+#include <windows.h>
+
+#include "LatencyHistogram.h"
+
+// Policies of where a port's threads run. With any policy but none each port takes its own
+// half of the process's cores, EilatPort the lower one, so the two don't compete for them.
+#define PLACEMENT_NONE 0 // Threads float over every processor, as the scheduler sees fit.
+#define PLACEMENT_COMPACT 1 // Threads are pinned to adjacent logical processors, sharing cores and caches.
+#define PLACEMENT_SPREAD 2 // Threads are pinned to a core each before any core takes a second one.
+#define PLACEMENT_ISOLATED 3 // Coordinators have a core of their own, the rest float over the other cores.
+
+// Roles of the threads which are placed, a role's threads are placed by their index.
+#define PLACEMENT_COORDINATOR 0 // An unloading quay, or the canal's controller in HaifaPort.
+#define PLACEMENT_CANAL_IO 1 // The main thread, which reads the other port's pipe.
+#define PLACEMENT_CRANE 2
+#define PLACEMENT_VESSEL 3
+#define PLACEMENT_HELPER 4 // Threads which mostly sleep, they are never pinned to a single processor.
+
+#define PLACEMENT_EILAT_PORT 0
+#define PLACEMENT_HAIFA_PORT 1
+
+#define MAX_PLACEMENT_CORES 64 // Only the processors of the process's group are placed on.
+
+// The time a waiting thread was signaled at, so the thread it signaled can record the hand-off.
+typedef volatile LONGLONG HandOffStamp;
+
+// Returns the policy of the given name, -1 if there's no such policy.
+int getThreadPlacementPolicy(const char* name);
+const char* getThreadPlacementPolicyName(int policy);
+
+// Finds the port's cores for the given policy. The coordinators' and cranes' indexes run
+// up to their numbers, the threads are placed in the order of their roles and indexes.
+// Returns FALSE if the process's cores couldn't be read.
+int initializeThreadPlacement(int policy, int port, int numberOfCoordinators, int numberOfCranes);
+// Sets the thread's affinity by the policy, its role and its index within the role.
+// Returns FALSE if the affinity couldn't be set.
+int placeThread(HANDLE thread, int role, int index);
+// Returns the number of cores the port's threads are placed on, 0 with no policy.
+int getNumberOfPlacementCores(void);
+
+// Stamps the time right before a waiting thread is signaled.
+void stampHandOff(HandOffStamp* stamp);
+// Records the time since the stamp in microseconds, called by the signaled thread once it runs.
+void recordHandOff(LatencyHistogram* histogram, HandOffStamp* stamp);
+
+#endif
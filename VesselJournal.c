@@ -0,0 +1,322 @@
+#define _CRT_SECURE_NO_WARNINGS
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "VesselJournal.h"
+
+DWORD WINAPI VesselJournalCommitter(LPVOID Param);
+int recoverVesselJournalRecords(VesselJournal* journal, int vesselStates[], int numberOfVessels);
+int mapVesselJournal(VesselJournal* journal, DWORD protection, DWORD access, LONGLONG size);
+void unmapVesselJournal(VesselJournal* journal);
+int commitVesselJournal(VesselJournal* journal);
+void addVesselJournalOverhead(VesselJournal* journal, LARGE_INTEGER* startTime);
+
+VesselJournal* openVesselJournal(const char* fileName, int numberOfNewRecords, int isRecovering,
+    int vesselStates[], int numberOfVessels)
+{
+    VesselJournal* journal = (VesselJournal*)calloc(1, sizeof(VesselJournal));
+
+    if (journal == NULL)
+    {
+        fprintf(stderr, "VesselJournal::openVesselJournal::Unexpected Error - "
+            "Memory allocation failed!\n");
+        return NULL;
+    }
+
+    journal->fileHandle = CreateFileA(fileName, GENERIC_READ | GENERIC_WRITE, 0, NULL,
+        isRecovering ? OPEN_ALWAYS : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if (journal->fileHandle == INVALID_HANDLE_VALUE)
+    {
+        fprintf(stderr, "VesselJournal::openVesselJournal::Error - "
+            "Journal file '%s' could not be opened (%d)!\n", fileName, GetLastError());
+        free(journal);
+        return NULL;
+    }
+
+    if (isRecovering && !recoverVesselJournalRecords(journal, vesselStates, numberOfVessels))
+    {
+        fprintf(stderr, "VesselJournal::openVesselJournal::Error - "
+            "Journal file '%s' is not a vessel journal!\n", fileName);
+        CloseHandle(journal->fileHandle);
+        free(journal);
+        return NULL;
+    }
+
+    // Mapping a view larger than the file extends the file, so the whole journal is allocated once.
+    journal->recordCapacity = journal->numberOfRecoveredRecords + numberOfNewRecords;
+
+    if (!mapVesselJournal(journal, PAGE_READWRITE, FILE_MAP_WRITE, sizeof(VesselJournalHeader) +
+        (LONGLONG)journal->recordCapacity * sizeof(VesselJournalRecord)))
+    {
+        fprintf(stderr, "VesselJournal::openVesselJournal::Unexpected Error - "
+            "Mapping journal file '%s' failed (%d)!\n", fileName, GetLastError());
+        CloseHandle(journal->fileHandle);
+        free(journal);
+        return NULL;
+    }
+
+    // Records after the recovered ones may be left over from a run which stopped before
+    // committing them, clear them so they aren't taken as valid by the next recovery.
+    memcpy(journal->header->magic, VESSEL_JOURNAL_MAGIC, sizeof(journal->header->magic));
+    journal->header->recordCapacity = journal->recordCapacity;
+    memset(journal->records + journal->numberOfRecoveredRecords, 0,
+        (size_t)numberOfNewRecords * sizeof(VesselJournalRecord));
+    FlushViewOfFile(journal->header, 0);
+    FlushFileBuffers(journal->fileHandle);
+
+    journal->numberOfReservedRecords = journal->numberOfRecoveredRecords;
+    journal->numberOfCommittedRecords = journal->numberOfRecoveredRecords;
+    InitializeSRWLock(&journal->commitLock);
+    InitializeConditionVariable(&journal->commitCondition);
+    journal->commitRequestEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
+    journal->committerHandle = (journal->commitRequestEvent == NULL) ? NULL :
+        CreateThread(NULL, 0, VesselJournalCommitter, journal, 0, NULL);
+
+    if (journal->committerHandle == NULL)
+    {
+        fprintf(stderr, "VesselJournal::openVesselJournal::Unexpected Error - "
+            "Committer thread creation failed!\n");
+        unmapVesselJournal(journal);
+        CloseHandle(journal->fileHandle);
+        free(journal);
+        return NULL;
+    }
+
+    return journal;
+}
+
+int recoverVesselJournalRecords(VesselJournal* journal, int vesselStates[], int numberOfVessels)
+{
+    LARGE_INTEGER fileSize;
+
+    if (!GetFileSizeEx(journal->fileHandle, &fileSize))
+    {
+        return FALSE;
+    }
+
+    // A journal which was never written to has nothing to recover.
+    if (fileSize.QuadPart == 0)
+    {
+        return TRUE;
+    }
+
+    if (fileSize.QuadPart < (LONGLONG)sizeof(VesselJournalHeader) ||
+        !mapVesselJournal(journal, PAGE_READONLY, FILE_MAP_READ, 0))
+    {
+        return FALSE;
+    }
+
+    if (memcmp(journal->header->magic, VESSEL_JOURNAL_MAGIC, sizeof(journal->header->magic)) != 0)
+    {
+        unmapVesselJournal(journal);
+        return FALSE;
+    }
+
+    LONGLONG numberOfRecords = (fileSize.QuadPart - (LONGLONG)sizeof(VesselJournalHeader)) /
+        (LONGLONG)sizeof(VesselJournalRecord);
+
+    // The valid records are the ones in a row from the start, a record which was torn or never
+    // completed ends them. Only those may have been committed.
+    while (journal->numberOfRecoveredRecords < numberOfRecords &&
+        journal->records[journal->numberOfRecoveredRecords].sequence ==
+        journal->numberOfRecoveredRecords + 1)
+    {
+        VesselJournalRecord* record = &journal->records[journal->numberOfRecoveredRecords];
+
+        if (record->vesselId >= 1 && record->vesselId <= numberOfVessels)
+        {
+            vesselStates[record->vesselId - 1] = record->state;
+        }
+
+        journal->numberOfRecoveredRecords++;
+    }
+
+    unmapVesselJournal(journal);
+
+    return TRUE;
+}
+
+int mapVesselJournal(VesselJournal* journal, DWORD protection, DWORD access, LONGLONG size)
+{
+    journal->mappingHandle = CreateFileMapping(journal->fileHandle, NULL, protection,
+        (DWORD)(size >> 32), (DWORD)size, NULL);
+    journal->header = (journal->mappingHandle == NULL) ? NULL :
+        (VesselJournalHeader*)MapViewOfFile(journal->mappingHandle, access, 0, 0, 0);
+
+    if (journal->header == NULL)
+    {
+        if (journal->mappingHandle != NULL)
+        {
+            CloseHandle(journal->mappingHandle);
+        }
+
+        return FALSE;
+    }
+
+    journal->records = (VesselJournalRecord*)(journal->header + 1);
+
+    return TRUE;
+}
+
+void unmapVesselJournal(VesselJournal* journal)
+{
+    UnmapViewOfFile(journal->header);
+    CloseHandle(journal->mappingHandle);
+    journal->header = NULL;
+    journal->records = NULL;
+}
+
+void closeVesselJournal(VesselJournal* journal)
+{
+    // The committer commits whatever is left before it exits.
+    InterlockedExchange(&journal->isClosing, TRUE);
+    SetEvent(journal->commitRequestEvent);
+    WaitForSingleObject(journal->committerHandle, INFINITE);
+
+    CloseHandle(journal->committerHandle);
+    CloseHandle(journal->commitRequestEvent);
+    unmapVesselJournal(journal);
+    CloseHandle(journal->fileHandle);
+    free(journal);
+}
+
+LONG appendVesselJournalRecord(VesselJournal* journal, int vesselId, int state)
+{
+    LARGE_INTEGER startTime;
+    QueryPerformanceCounter(&startTime);
+
+    LONG index = InterlockedIncrement(&journal->numberOfReservedRecords) - 1;
+
+    if (index >= journal->recordCapacity)
+    {
+        return 0;
+    }
+
+    VesselJournalRecord* record = &journal->records[index];
+
+    record->vesselId = vesselId;
+    record->state = state;
+    // Publish the record, the full barrier keeps its fields from being written after it.
+    InterlockedExchange(&record->sequence, index + 1);
+
+    addVesselJournalOverhead(journal, &startTime);
+
+    return index + 1;
+}
+
+int waitForVesselJournalCommit(VesselJournal* journal, LONG sequence)
+{
+    LARGE_INTEGER startTime;
+    QueryPerformanceCounter(&startTime);
+
+    // Wake the committer right away, every thread which waits meanwhile joins the same commit.
+    SetEvent(journal->commitRequestEvent);
+
+    AcquireSRWLockExclusive(&journal->commitLock);
+
+    while (journal->numberOfCommittedRecords < sequence && !journal->isFailed)
+    {
+        SleepConditionVariableSRW(&journal->commitCondition, &journal->commitLock, INFINITE, 0);
+    }
+
+    int isCommitted = journal->numberOfCommittedRecords >= sequence;
+
+    ReleaseSRWLockExclusive(&journal->commitLock);
+
+    addVesselJournalOverhead(journal, &startTime);
+
+    return isCommitted;
+}
+
+double getVesselJournalOverhead(VesselJournal* journal)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+
+    return (double)journal->overheadTicks * 1000.0 / (double)frequency.QuadPart;
+}
+
+void addVesselJournalOverhead(VesselJournal* journal, LARGE_INTEGER* startTime)
+{
+    LARGE_INTEGER endTime;
+    QueryPerformanceCounter(&endTime);
+
+    InterlockedExchangeAdd64(&journal->overheadTicks, endTime.QuadPart - startTime->QuadPart);
+}
+
+int commitVesselJournal(VesselJournal* journal)
+{
+    // Only the committer changes numberOfCommittedRecords, so it reads it without the lock.
+    int firstRecord = journal->numberOfCommittedRecords;
+    int lastRecord = firstRecord;
+    int numberOfReservedRecords = journal->numberOfReservedRecords;
+
+    if (numberOfReservedRecords > journal->recordCapacity)
+    {
+        numberOfReservedRecords = journal->recordCapacity;
+    }
+
+    while (lastRecord < numberOfReservedRecords &&
+        journal->records[lastRecord].sequence == lastRecord + 1)
+    {
+        lastRecord++;
+    }
+
+    if (lastRecord == firstRecord)
+    {
+        return TRUE;
+    }
+
+    if (!FlushViewOfFile(&journal->records[firstRecord],
+        (SIZE_T)(lastRecord - firstRecord) * sizeof(VesselJournalRecord)) ||
+        !FlushFileBuffers(journal->fileHandle))
+    {
+        return FALSE;
+    }
+
+    AcquireSRWLockExclusive(&journal->commitLock);
+    journal->numberOfCommittedRecords = lastRecord;
+    journal->numberOfCommits++;
+    ReleaseSRWLockExclusive(&journal->commitLock);
+
+    WakeAllConditionVariable(&journal->commitCondition);
+
+    return TRUE;
+}
+
+DWORD WINAPI VesselJournalCommitter(LPVOID Param)
+{
+    VesselJournal* journal = (VesselJournal*)Param;
+
+    for (;;)
+    {
+        WaitForSingleObject(journal->commitRequestEvent, VESSEL_JOURNAL_COMMIT_INTERVAL);
+
+        // Read the flag before committing, so the records appended before closing are committed.
+        int isClosing = journal->isClosing;
+
+        if (!commitVesselJournal(journal))
+        {
+            fprintf(stderr, "VesselJournal::VesselJournalCommitter::Unexpected Error - "
+                "Flushing the journal failed (%d)!\n", GetLastError());
+
+            // Whoever waits for a commit is woken to find it failed.
+            AcquireSRWLockExclusive(&journal->commitLock);
+            journal->isFailed = TRUE;
+            ReleaseSRWLockExclusive(&journal->commitLock);
+            WakeAllConditionVariable(&journal->commitCondition);
+
+            return EXIT_FAILURE;
+        }
+
+        if (isClosing)
+        {
+            break;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef VESSEL_JOURNAL_H
+#define VESSEL_JOURNAL_H
+
+#include <windows.h>
+
+// States a vessel goes through in EilatPort, in the order they are journaled.
+#define VESSEL_JOURNAL_NONE 0 // The vessel has no record in the journal.
+#define VESSEL_JOURNAL_ARRIVED 1
+#define VESSEL_JOURNAL_QUEUED 2
+#define VESSEL_JOURNAL_DOCKED 3
+#define VESSEL_JOURNAL_UNLOADED 4
+#define VESSEL_JOURNAL_DEPARTED 5
+#define VESSEL_JOURNAL_STATES 5 // Most records a vessel appends during a single run.
+
+#define VESSEL_JOURNAL_MAGIC "EJRN" // First 4 bytes of a journal file.
+#define VESSEL_JOURNAL_COMMIT_INTERVAL 5 // Records nobody waits for are committed after 5 miliseconds.
+
+// A state transition of a vessel. The sequence is written last, so a record is only
+// valid if its sequence is its index in the journal + 1.
+typedef struct {
+    volatile LONG sequence;
+    int vesselId;
+    int state;
+    int reserved;
+} VesselJournalRecord;
+
+// Header of a journal file, followed by recordCapacity VesselJournalRecords.
+typedef struct {
+    char magic[4];
+    int recordCapacity;
+} VesselJournalHeader;
+
+// Write-ahead journal mapped into memory. Any thread may append a record without a lock,
+// a committer thread flushes every valid record in a row to disk at once (group commit)
+// and wakes the threads which wait for them.
+typedef struct {
+    HANDLE fileHandle;
+    HANDLE mappingHandle;
+    VesselJournalHeader* header;
+    VesselJournalRecord* records;
+    int recordCapacity;
+    int numberOfRecoveredRecords; // Records which were already in the journal when it was opened.
+    volatile LONG numberOfReservedRecords;
+    int numberOfCommittedRecords;
+    int numberOfCommits;
+    SRWLOCK commitLock;
+    CONDITION_VARIABLE commitCondition;
+    HANDLE commitRequestEvent;
+    HANDLE committerHandle;
+    volatile LONG isClosing;
+    volatile LONG isFailed; // Set once a commit failed, the committer ends and nothing is committed anymore.
+    volatile LONGLONG overheadTicks; // QueryPerformanceCounter ticks spent appending and waiting.
+} VesselJournal;
+
+// Opens the journal with room for numberOfNewRecords more records. When recovering, the valid
+// records in the file are kept and the last state of each vessel is set in vesselStates
+// (by vesselId - 1), otherwise the file is truncated. Returns NULL on failure.
+VesselJournal* openVesselJournal(const char* fileName, int numberOfNewRecords, int isRecovering,
+    int vesselStates[], int numberOfVessels);
+// Commits the remaining records and closes the journal.
+void closeVesselJournal(VesselJournal* journal);
+// Appends a record and returns its sequence, 0 if the journal is full.
+LONG appendVesselJournalRecord(VesselJournal* journal, int vesselId, int state);
+// Waits till the record of the sequence, and every record before it, is on disk.
+// Returns FALSE if the journal failed to commit them.
+int waitForVesselJournalCommit(VesselJournal* journal, LONG sequence);
+// Returns the miliseconds threads spent appending records and waiting for commits.
+double getVesselJournalOverhead(VesselJournal* journal);
+
+#endif
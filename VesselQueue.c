@@ -0,0 +1,147 @@
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "VesselQueue.h"
+
+// Links the nodes into the pool.
+void fillNodePool(VesselNodePool* nodePool, VesselNode vesselNodes[], int numberOfNodes);
+
+VesselQueue* constructQueue(int limit, PortArena* arena)
+{
+    // The nodes follow the queue in the same block.
+    SIZE_T size = sizeof(VesselQueue) + limit * sizeof(VesselNode);
+    VesselQueue* vesselQueue = arena == NULL ? (VesselQueue*)malloc(size) :
+        (VesselQueue*)allocateFromPortArena(arena, PORT_ARENA_HOT, size);
+
+    if (vesselQueue == NULL)
+    {
+        fprintf(stderr, "EilatPort::ConstructQueue::Unexpected Error - "
+            "Memory allocation failed!\n");
+        return NULL;
+    }
+
+    vesselQueue->limit = limit;
+    vesselQueue->size = 0;
+    vesselQueue->head = NULL;
+    vesselQueue->tail = NULL;
+    vesselQueue->nodePool = &vesselQueue->ownNodePool;
+    fillNodePool(vesselQueue->nodePool, (VesselNode*)(vesselQueue + 1), limit);
+
+    return vesselQueue;
+}
+
+VesselNodePool* constructNodePool(int numberOfNodes, PortArena* arena)
+{
+    // The nodes follow the pool in the same block.
+    VesselNodePool* nodePool = (VesselNodePool*)allocateFromPortArena(arena, PORT_ARENA_HOT,
+        sizeof(VesselNodePool) + numberOfNodes * sizeof(VesselNode));
+
+    if (nodePool == NULL)
+    {
+        fprintf(stderr, "EilatPort::ConstructNodePool::Unexpected Error - "
+            "Memory allocation failed!\n");
+        return NULL;
+    }
+
+    fillNodePool(nodePool, (VesselNode*)(nodePool + 1), numberOfNodes);
+
+    return nodePool;
+}
+
+VesselQueue* constructSharedQueue(int limit, VesselNodePool* nodePool, PortArena* arena)
+{
+    VesselQueue* vesselQueue = (VesselQueue*)allocateFromPortArena(arena, PORT_ARENA_HOT, sizeof(VesselQueue));
+
+    if (vesselQueue == NULL)
+    {
+        fprintf(stderr, "EilatPort::ConstructSharedQueue::Unexpected Error - "
+            "Memory allocation failed!\n");
+        return NULL;
+    }
+
+    vesselQueue->limit = limit;
+    vesselQueue->size = 0;
+    vesselQueue->head = NULL;
+    vesselQueue->tail = NULL;
+    vesselQueue->nodePool = nodePool;
+    vesselQueue->ownNodePool.freeNodes = NULL;
+
+    return vesselQueue;
+}
+
+void fillNodePool(VesselNodePool* nodePool, VesselNode vesselNodes[], int numberOfNodes)
+{
+    nodePool->freeNodes = NULL;
+
+    // Comment: pushed from the last, so the pool gives its nodes from the first one on.
+    for (int i = numberOfNodes - 1; i >= 0; i--)
+    {
+        vesselNodes[i].prev = nodePool->freeNodes;
+        nodePool->freeNodes = &vesselNodes[i];
+    }
+}
+
+void destructQueue(VesselQueue* vesselQueue)
+{
+    free(vesselQueue);
+}
+
+int enqueue(VesselQueue* vesselQueue, int vesselId)
+{
+    if (vesselQueue == NULL)
+    {
+        return FALSE;
+    }
+
+    if (vesselQueue->size >= vesselQueue->limit || vesselQueue->nodePool->freeNodes == NULL)
+    {
+        return FALSE;
+    }
+
+    VesselNode* vesselNode = vesselQueue->nodePool->freeNodes;
+
+    vesselQueue->nodePool->freeNodes = vesselNode->prev;
+    vesselNode->vesselId = vesselId;
+    vesselNode->enqueueTime = GetTickCount64();
+    vesselNode->prev = NULL;
+
+    if (vesselQueue->size == 0) // Queue is empty
+    {
+        vesselQueue->head = vesselNode;
+        vesselQueue->tail = vesselNode;
+    }
+    else // Add to the end of the Queue
+    {
+        vesselQueue->tail->prev = vesselNode;
+        vesselQueue->tail = vesselNode;
+    }
+
+    vesselQueue->size++;
+    return TRUE;
+}
+
+int dequeue(VesselQueue* vesselQueue)
+{
+    if (isEmpty(vesselQueue))
+    {
+        return -1;
+    }
+
+    VesselNode* vesselNode;
+    int vesselId;
+
+    vesselNode = vesselQueue->head;
+    vesselId = vesselNode->vesselId;
+    vesselQueue->head = vesselNode->prev;
+    vesselQueue->size--;
+
+    vesselNode->prev = vesselQueue->nodePool->freeNodes;
+    vesselQueue->nodePool->freeNodes = vesselNode;
+
+    return vesselId;
+}
+
+int isEmpty(VesselQueue* vesselQueue)
+{
+    return vesselQueue->size == 0;
+}
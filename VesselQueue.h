@@ -0,0 +1,49 @@
+#ifndef VESSEL_QUEUE_H
+#define VESSEL_QUEUE_H
+
+#include <windows.h>
+
+#include "PortArena.h"
+
+// Node of Queue
+typedef struct Node_t {
+    int vesselId;
+    ULONGLONG enqueueTime; // GetTickCount64() when the vessel entered the queue.
+    struct Node_t* prev;
+} VesselNode;
+
+// Nodes no vessel holds, linked by prev, of a single queue or shared by several queues.
+typedef struct {
+    VesselNode* freeNodes;
+} VesselNodePool;
+
+// Queue of vessels which leave FIFO, a queue isn't thread safe and is protected by its owner.
+// A queue takes its nodes from a pool built at its construction, so enqueue and dequeue never
+// allocate. Queues which share a pool must be protected by the same owner.
+typedef struct {
+    VesselNode* head;
+    VesselNode* tail;
+    VesselNodePool* nodePool; // The queue's own pool, or one it shares.
+    VesselNodePool ownNodePool;
+    int size;
+    int limit;
+} VesselQueue;
+
+// Functions which support handling a Queue.
+// Constructs the queue with a node for each vessel it may hold, in the arena's hot region,
+// or with malloc if the arena is NULL. Returns NULL on failure.
+VesselQueue* constructQueue(int limit, PortArena* arena);
+// Constructs a pool of nodes in the arena's hot region. Returns NULL on failure.
+VesselNodePool* constructNodePool(int numberOfNodes, PortArena* arena);
+// Constructs a queue in the arena's hot region which takes its nodes from the shared pool,
+// so the queues together hold no more vessels than the pool has nodes. Returns NULL on failure.
+VesselQueue* constructSharedQueue(int limit, VesselNodePool* nodePool, PortArena* arena);
+// Only for a queue constructed with malloc, a queue in an arena is released with the arena.
+void destructQueue(VesselQueue* vesselQueue);
+// Returns FALSE if the queue is full, or its pool has no free node.
+int enqueue(VesselQueue* vesselQueue, int vesselId);
+// Returns the vessel's ID, -1 if the queue is empty.
+int dequeue(VesselQueue* vesselQueue);
+int isEmpty(VesselQueue* vesselQueue);
+
+#endif